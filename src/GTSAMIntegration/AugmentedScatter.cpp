@@ -38,9 +38,28 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
  * -------------------------------------------------------------------------- */
 #include "AugmentedScatter.hpp"
 #include <gtsam/linear/GaussianFactorGraph.h>
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <memory>
 
 using namespace gtsam;
 
+namespace
+{
+// Below this number of factors the overhead of the threading is larger than the gain.
+constexpr size_t minFactorsMT = 50;
+
+bool useMT(size_t numFactors, dso::IndexThreadReduce<dso::Vec10>* red)
+{
+    return red && dso::multiThreading && numFactors >= minFactorsMT;
+}
+
+// The cost of factors varies a lot (e.g. marginalization priors vs. IMU factors), so we use more chunks than threads.
+int chunkSize(size_t numFactors)
+{
+    return std::max<int>(1, numFactors / (4 * NUM_THREADS));
+}
+}
+
 dmvio::AugmentedScatter::AugmentedScatter(const GaussianFactorGraph& gfg, boost::optional<const Ordering&> ordering, const std::map<gtsam::Key, size_t>& keyDimMap)
 {
     // If we have an ordering, pre-fill the ordered variables first
@@ -110,3 +129,90 @@ gtsam::Matrix dmvio::AugmentedScatter::computeAugmentedHessian(const gtsam::Gaus
     gtsam::Matrix augmented = combined.info().selfadjointView();
     return augmented;
 }
+
+std::pair<gtsam::Matrix, gtsam::Vector>
+dmvio::AugmentedScatter::computeHessianMT(const GaussianFactorGraph& gfg, dso::IndexThreadReduce<dso::Vec10>* red)
+{
+    gtsam::Matrix augmented = computeAugmentedHessianMT(gfg, red);
+    size_t n = augmented.rows() - 1;
+    return std::make_pair(augmented.topLeftCorner(n, n), augmented.topRightCorner(n, 1));
+}
+
+gtsam::Matrix dmvio::AugmentedScatter::computeAugmentedHessianMT(const gtsam::GaussianFactorGraph& gfg,
+                                                                 dso::IndexThreadReduce<dso::Vec10>* red)
+{
+    if(!useMT(gfg.size(), red))
+    {
+        return computeAugmentedHessian(gfg);
+    }
+
+    // Each thread only accesses its own partial Hessian, they all have the layout of this scatter.
+    std::vector<std::unique_ptr<HessianFactor>> partials(NUM_THREADS);
+    GaussianFactorGraph emptyGraph;
+    red->reduce([&](int min, int max, dso::Vec10* stats, int tid)
+                {
+                    if(min >= max) return;
+                    std::unique_ptr<HessianFactor>& partial = partials[tid];
+                    if(!partial)
+                    {
+                        partial.reset(new HessianFactor(emptyGraph, *this));
+                    }
+                    for(int i = min; i < max; i++)
+                    {
+                        if(gfg[i])
+                        {
+                            gfg[i]->updateHessian(partial->keys(), &partial->info());
+                        }
+                    }
+                }, 0, gfg.size(), chunkSize(gfg.size()));
+
+    DenseIndex dim = 0;
+    for(auto&& partial : partials)
+    {
+        if(partial) dim = partial->info().rows();
+    }
+
+    // Sum up the upper triangles, each thread handles a range of columns.
+    gtsam::Matrix upper = gtsam::Matrix::Zero(dim, dim);
+    red->reduce([&](int min, int max, dso::Vec10* stats, int tid)
+                {
+                    for(auto&& partial : partials)
+                    {
+                        if(!partial) continue;
+                        auto partialView = partial->info().selfadjointView();
+                        const auto& partialUpper = partialView.nestedExpression();
+                        for(int col = min; col < max; col++)
+                        {
+                            upper.col(col).head(col + 1) += partialUpper.col(col).head(col + 1);
+                        }
+                    }
+                }, 0, dim, 0);
+
+    gtsam::Matrix augmented = upper.selfadjointView<Eigen::Upper>();
+    return augmented;
+}
+
+gtsam::GaussianFactorGraph::shared_ptr dmvio::linearizeMT(const gtsam::NonlinearFactorGraph& graph,
+                                                          const gtsam::Values& values,
+                                                          dso::IndexThreadReduce<dso::Vec10>* red)
+{
+    if(!useMT(graph.size(), red))
+    {
+        return graph.linearize(values);
+    }
+
+    // Each thread writes to different entries of the preallocated graph.
+    auto gfg = boost::make_shared<GaussianFactorGraph>();
+    gfg->resize(graph.size());
+    red->reduce([&](int min, int max, dso::Vec10* stats, int tid)
+                {
+                    for(int i = min; i < max; i++)
+                    {
+                        if(graph[i])
+                        {
+                            gfg->at(i) = graph[i]->linearize(values);
+                        }
+                    }
+                }, 0, graph.size(), chunkSize(graph.size()));
+    return gfg;
+}
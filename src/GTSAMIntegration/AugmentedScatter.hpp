@@ -29,6 +29,7 @@
 
 #include "util/NumType.h"
 #include "OptimizationBackend/EnergyFunctionalStructs.h"
+#include "util/IndexThreadReduce.h"
 
 #include <gtsam/linear/Scatter.h>
 
@@ -44,7 +45,19 @@ public:
 
     std::pair<gtsam::Matrix, gtsam::Vector> computeHessian(const gtsam::GaussianFactorGraph& gfg);
     gtsam::Matrix computeAugmentedHessian(const gtsam::GaussianFactorGraph& gfg);
+
+    // Same as above, but distributes the factors to the threads of red. Each thread scatters into its own augmented
+    // Hessian, which are summed up in parallel over disjoint column ranges afterwards.
+    // Falls back to the single threaded version if red is nullptr, multiThreading is off, or the graph is small.
+    std::pair<gtsam::Matrix, gtsam::Vector>
+    computeHessianMT(const gtsam::GaussianFactorGraph& gfg, dso::IndexThreadReduce<dso::Vec10>* red);
+    gtsam::Matrix computeAugmentedHessianMT(const gtsam::GaussianFactorGraph& gfg, dso::IndexThreadReduce<dso::Vec10>* red);
 };
+
+// Like graph.linearize(values), but linearizes the factors in parallel using red (if it is not nullptr).
+// The factors must support being linearized concurrently (which is the case for all factors used in DM-VIO).
+gtsam::GaussianFactorGraph::shared_ptr linearizeMT(const gtsam::NonlinearFactorGraph& graph, const gtsam::Values& values,
+                                                   dso::IndexThreadReduce<dso::Vec10>* red);
 }
 
 
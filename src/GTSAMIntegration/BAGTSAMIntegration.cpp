@@ -31,7 +31,6 @@
 #include "AugmentedScatter.hpp"
 #include <gtsam/linear/GaussianFactorGraph.h>
 #include <iomanip>
-#include <numeric>
 
 #include "FullSystem/HessianBlocks.h"
 #include "dso/util/FrameShell.h"
@@ -92,6 +91,15 @@ void BAGTSAMIntegration::updateBAOrdering(std::vector<dso::EFFrame*>& frames)
     {
         extension->updateBAOrdering(frames, &baOrdering, baDimMap);
     }
+
+    // Offsets are computed once per window change.
+    baStore.setLayout(baOrdering, baDimMap);
+    framePoseVariables.clear();
+    for(dso::EFFrame* h : frames)
+    {
+        framePoseVariables.push_back(baStore.find(gtsam::Symbol('p', h->data->shell->id)));
+    }
+    evalValuesNeedFullCopy = true;
 }
 
 void BAGTSAMIntegration::updateBAValues(std::vector<dso::EFFrame*>& frames)
@@ -128,8 +136,8 @@ BAGTSAMIntegration::computeBAUpdate(const dso::MatXX& inputH, const VecX& inputB
     dmvio::TimeMeasurement timeMeasurement("computeBAUpdate");
 
     updateBAValues(frames);
-    *baEvalValues = *baValues;
-    computeEvaluationPointValues(frames, baEvalValues);
+    baStore.loadFrom(*baValues);
+    updateEvalValues(frames, false);
     baGraphs->updateEvalValues(*baEvalValues);
 
     dmvio::TimeMeasurement timeMeasGraphs("baUpdateBuildHessians");
@@ -140,8 +148,7 @@ BAGTSAMIntegration::computeBAUpdate(const dso::MatXX& inputH, const VecX& inputB
     // Compute DSO Hessian and b.
     // --------------------------------------------------
     // Convert H and b from DSO to GTSAM (swapping rotation and translation, converting left increment to right increment).
-    auto convertedHAndB = convertHAndBFromDSO(inputH, inputB, *transformationDSOToBA, computeDSOWeight(), baOrdering,
-                                              *baEvalValues, baDimMap);
+    auto convertedHAndB = convertDSOHAndB(inputH, inputB);
     gtsam::Matrix HFromDSO = convertedHAndB.first;
     gtsam::Vector bFromDSO = convertedHAndB.second;
 
@@ -154,11 +161,7 @@ BAGTSAMIntegration::computeBAUpdate(const dso::MatXX& inputH, const VecX& inputB
     auto gtsamHb = baGraphs->getHAndB(*baValues, baOrdering, baDimMap, &additionalKeys);
 
     // Fix all keys which were not in the ordering.
-    auto accumFun = [this](int num, const gtsam::Key& key)
-    {
-        return num + baDimMap.at(key);
-    };
-    int nonFixedSize = std::accumulate(baOrdering.begin(), baOrdering.end(), 0, accumFun);
+    int nonFixedSize = baStore.getTotalDim();
     gtsam::Matrix HFull = gtsamHb.first.topLeftCorner(nonFixedSize, nonFixedSize);
     gtsam::Vector bFull = gtsamHb.second.head(nonFixedSize);
 
@@ -190,15 +193,9 @@ BAGTSAMIntegration::computeBAUpdate(const dso::MatXX& inputH, const VecX& inputB
     matrixInversionMeasurement.end();
 
     // Update values based on the computed increment.
+    baStore.retract(inc, newBAStore);
     newBAValues.reset(new gtsam::Values());
-    int current_pos = 0;
-    for(size_t i = 0; i < baOrdering.size(); i++)
-    {
-        gtsam::Key k = baOrdering[i];
-        size_t s = baDimMap[k];
-        newBAValues->insert(k, *(baValues->at(k).retract_(inc.segment(current_pos, s))));
-        current_pos += s;
-    }
+    newBAStore.writeTo(*newBAValues);
 
     canBreakOptimization = true;
     for(auto& extension : extensions)
@@ -224,16 +221,14 @@ BAGTSAMIntegration::computeBAUpdate(const dso::MatXX& inputH, const VecX& inputB
     dso::VecX returning = inc.segment(0, smallN);
 
     // Exchange R and T (to convert it back to dso convention).
+    assert(framePoseVariables.size() == frames.size());
     for(dso::EFFrame* h : frames)
     {
         int id = CPARS + 8 * h->idx;
 
-        long fullId = h->data->shell->id;
-        gtsam::Symbol poseKey('p', fullId);
-
         // In practice this is usually the identity transformation.
         dso::Mat44 worldToCam = transformationDSOToBA->transformPoseInverse(
-                newBAValues->at<gtsam::Pose3>(poseKey).matrix());
+                newBAStore.getPose(framePoseVariables[h->idx]).matrix());
         Sophus::SE3d newVal(worldToCam);
 
         Sophus::SE3d oldVal = h->data->PRE_worldToCam;
@@ -254,11 +249,10 @@ BAGTSAMIntegration::addMarginalizedPointsBA(const dso::MatXX& H_in, const dso::V
                                             std::vector<dso::EFFrame*>& frames)
 {
     updateBAValues(frames);
-    *baEvalValues = *baValues;
-    computeEvaluationPointValues(frames, baEvalValues);
+    baStore.loadFrom(*baValues);
+    updateEvalValues(frames, false);
 
-    auto convertedHAndB = convertHAndBFromDSO(H_in, b_in, *transformationDSOToBA, computeDSOWeight(), baOrdering,
-                                              *baEvalValues, baDimMap);
+    auto convertedHAndB = convertDSOHAndB(H_in, b_in);
 
     gtsam::LinearContainerFactor::shared_ptr lcf = convertedDSOHAndBToFactor(convertedHAndB.first,
                                                                              convertedHAndB.second, *baEvalValues);
@@ -328,6 +322,35 @@ void BAGTSAMIntegration::addPriorBA(dso::EFFrame* h, const dso::Vec8& H_diag, co
     baGraphs->addFactor(lcfA, false);
 }
 
+void BAGTSAMIntegration::updateEvalValues(const std::vector<dso::EFFrame*>& frames, bool fullCopy)
+{
+    if(fullCopy || evalValuesNeedFullCopy)
+    {
+        *baEvalValues = *baValues;
+        evalValuesNeedFullCopy = false;
+    }else
+    {
+        // Only the variables in the ordering can have changed since the last full copy (baStore has to be loaded).
+        baStore.writeTo(*baEvalValues);
+    }
+    computeEvaluationPointValues(frames, baEvalValues);
+
+    evalPoses.clear();
+    for(dso::EFFrame* h : frames)
+    {
+        evalPoses.emplace_back(h->data->get_worldToCam_evalPT().matrix());
+    }
+}
+
+std::pair<gtsam::Matrix, gtsam::Vector> BAGTSAMIntegration::convertDSOHAndB(const dso::MatXX& H, const dso::VecX& b)
+{
+    if(transformationDSOToBA->getAllOptimizedSymbols().empty())
+    {
+        return convertHAndBFromDSO(H, b, *transformationDSOToBA, computeDSOWeight(), CPARS, evalPoses);
+    }
+    return convertHAndBFromDSO(H, b, *transformationDSOToBA, computeDSOWeight(), baOrdering, *baEvalValues, baDimMap);
+}
+
 // Computes values where the FEJValue is used for DSO variables (pose and affine brightness) **only**.
 void BAGTSAMIntegration::computeEvaluationPointValues(const std::vector<dso::EFFrame*>& frames,
                                                       gtsam::Values::shared_ptr values)
@@ -362,6 +385,11 @@ void BAGTSAMIntegration::acceptBAUpdate(double energy)
         extension->acceptUpdate(baValues, newBAValues);
     }
 
+    // newBAValues only contains the keys of the graphs, so the key sets differ if baValues contained other keys.
+    if(newBAValues->size() != baValues->size())
+    {
+        evalValuesNeedFullCopy = true;
+    }
     baValues = newBAValues;
     lastDSOEnergy = energy;
 }
@@ -402,6 +430,7 @@ void BAGTSAMIntegration::addFirstBAFrame(int keyframeId)
     {
         extension->addFirstBAFrame(keyframeId, baGraphs.get(), baValues);
     }
+    evalValuesNeedFullCopy = true;
 }
 
 void
@@ -445,6 +474,30 @@ double BAGTSAMIntegration::getBAEnergy(bool useNewValues)
            settings.weightDSOToGTSAM/* / computeDSOWeight()*/; // caller is responsible for dividing by dynamic weight
 }
 
+void BAGTSAMIntegration::fillCheckpoint(BACheckpoint& checkpoint)
+{
+    checkpoint.currBATimestamp = currBATimestamp;
+    checkpoint.values = valuesToCheckpoint(*baValues);
+    checkpoint.evalValues = valuesToCheckpoint(*baEvalValues);
+
+    // Linearized at the same point as in computeBAUpdate.
+    gtsam::Values fejValues;
+    auto factor = baGraphs->linearizeToFactor(*baValues, fejValues);
+    checkpoint.fejValues = valuesToCheckpoint(fejValues);
+    checkpoint.graphFactor = factor ? linearFactorToCheckpoint(*factor) : LinearFactorCheckpoint();
+}
+
+void BAGTSAMIntegration::restoreFromCheckpoint(const BACheckpoint& checkpoint, std::vector<dso::EFFrame*>& frames)
+{
+    currBATimestamp = checkpoint.currBATimestamp;
+    baValues.reset(new gtsam::Values(valuesFromCheckpoint(checkpoint.values)));
+    baEvalValues.reset(new gtsam::Values(valuesFromCheckpoint(checkpoint.evalValues)));
+
+    baGraphs->resetToFactor(linearFactorFromCheckpoint(checkpoint.graphFactor),
+                            valuesFromCheckpoint(checkpoint.fejValues), *baEvalValues, *baValues);
+    updateBAOrdering(frames);
+}
+
 void BAGTSAMIntegration::addExtension(std::shared_ptr<BAExtension> extension)
 {
     extensions.push_back(extension);
@@ -473,8 +526,7 @@ void BAGTSAMIntegration::removeExtension(BAExtension* extension)
 gtsam::NonlinearFactor::shared_ptr BAGTSAMIntegration::getActiveDSOFactor()
 {
     // We recompute so that no lambda is added.
-    auto convertedHAndB = convertHAndBFromDSO(lastDSOH, lastDSOB, *transformationDSOToBA, computeDSOWeight(),
-                                              baOrdering, *baEvalValues, baDimMap);
+    auto convertedHAndB = convertDSOHAndB(lastDSOH, lastDSOB);
     return convertedDSOHAndBToFactor(convertedHAndB.first, convertedHAndB.second, *baValuesAfterBAUpdate,
                                      lastDSOEnergy *
                                      computeDSOWeight()); // note that we need to use baValues for the active Hessian.
@@ -482,6 +534,8 @@ gtsam::NonlinearFactor::shared_ptr BAGTSAMIntegration::getActiveDSOFactor()
 
 gtsam::Values* BAGTSAMIntegration::getMutableValues()
 {
+    // The caller might insert values which are not in the ordering.
+    evalValuesNeedFullCopy = true;
     return baValues.get();
 }
 
@@ -508,8 +562,7 @@ const gtsam::Ordering& BAGTSAMIntegration::getBaOrderingSmall() const
 void BAGTSAMIntegration::postOptimization(vector<dso::EFFrame*>& frames)
 {
     baEvalValues.reset(new gtsam::Values());
-    *baEvalValues = *baValues;
-    computeEvaluationPointValues(frames, baEvalValues);
+    updateEvalValues(frames, true);
     baGraphs->updateEvalValues(*baEvalValues);
 }
 
@@ -518,6 +571,11 @@ void BAGTSAMIntegration::setDynamicDSOWeightCallback(BAGTSAMIntegration::Dynamic
     dynamicWeightCallback = std::move(callback);
 }
 
+void BAGTSAMIntegration::setThreadReduce(dso::IndexThreadReduce<dso::Vec10>* red)
+{
+    baGraphs->red = red;
+}
+
 double BAGTSAMIntegration::computeDSOWeight() const
 {
     return settings.weightDSOToGTSAM * dynamicDSOWeight;
@@ -560,11 +618,11 @@ std::pair<gtsam::Matrix, gtsam::Vector>
 BAGraphs::getHAndB(const gtsam::Values& values, const gtsam::Ordering& ordering,
                    const std::map<gtsam::Key, size_t>& keyDimMap, gtsam::Ordering* fillAdditionalKeys)
 {
-    gtsam::GaussianFactorGraph::shared_ptr gfg = graph->linearize(values);
+    gtsam::GaussianFactorGraph::shared_ptr gfg = linearizeMT(*graph, values, red);
     AugmentedScatter scatter(*gfg, ordering, keyDimMap);
     if(fillAdditionalKeys)
     {
         fillAdditionalKeysFromScatter(ordering, *fillAdditionalKeys, scatter);
     }
-    return scatter.computeHessian(*gfg);
+    return scatter.computeHessianMT(*gfg, red);
 }
\ No newline at end of file
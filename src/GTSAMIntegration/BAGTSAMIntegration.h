@@ -34,6 +34,8 @@
 
 #include "PoseTransformation.h"
 #include "AugmentedScatter.hpp"
+#include "BAVariableStore.h"
+#include "util/SystemCheckpoint.h"
 
 
 // This source file, and in particular the class BAGTSAMIntegration is responsible for integrating the Bundle Adjustment for DSO into GTSAM.
@@ -110,6 +112,18 @@ public:
     virtual void updateEvalValues(const gtsam::Values& evalValues)
     {}
 
+    // Linearize the factors used for the optimization into a single factor at values (using FEJ), and output the
+    // FEJValues it relies on. Used for checkpointing. Returns nullptr if there are no factors.
+    virtual gtsam::LinearContainerFactor::shared_ptr
+    linearizeToFactor(const gtsam::Values& values, gtsam::Values& fejValuesOut) = 0;
+
+    // Replace all factors with the passed one (obtained from linearizeToFactor), e.g. when restoring a checkpoint.
+    virtual void resetToFactor(gtsam::NonlinearFactor::shared_ptr factor, const gtsam::Values& fejValues,
+                               const gtsam::Values& evalValues, const gtsam::Values& currValues) = 0;
+
+    // If set, getHAndB linearizes the factors and computes the Hessian in parallel with it.
+    dso::IndexThreadReduce<dso::Vec10>* red = nullptr;
+
 private:
     gtsam::NonlinearFactorGraph::shared_ptr graph;
 };
@@ -146,6 +160,9 @@ public:
                                                        bool coarseTrackingWasGood)>;
     void setDynamicDSOWeightCallback(DynamicWeightCallback callback);
 
+    // Thread pool used to compute the GTSAM Hessian (usually the one of the FullSystem).
+    void setThreadReduce(dso::IndexThreadReduce<dso::Vec10>* red);
+
     // Get a factor which contains the active DSO part.
     // Must only be called between an optimization iteration and the next marginalization (as otherwise the ordering does not match the matrices).
     gtsam::NonlinearFactor::shared_ptr getActiveDSOFactor();
@@ -206,6 +223,11 @@ public:
 
     double getBAEnergy(bool useNewValues);
 
+    // Store / restore the state. Extensions are not included, they have to be handled separately.
+    // restoreFromCheckpoint expects that the frames have already been restored on the DSO side.
+    void fillCheckpoint(BACheckpoint& checkpoint);
+    void restoreFromCheckpoint(const BACheckpoint& checkpoint, std::vector<dso::EFFrame*>& frames);
+
 protected:
     std::vector<std::shared_ptr<BAExtension>> extensions;
 
@@ -222,6 +244,19 @@ private:
     gtsam::Ordering baOrdering, baOrderingSmall; // baOrdering contains all keys and baOrderingSmall only the ones known by DSO (only poses).
     std::map<gtsam::Key, size_t> baDimMap;
 
+    // Dense variable layout of baOrdering, recomputed in updateBAOrdering. baStore is loaded from baValues in each
+    // iteration and newBAStore contains the retracted values.
+    BAVariableStore baStore, newBAStore;
+    std::vector<int> framePoseVariables; // index of the pose variable in baStore for each frame.
+    std::vector<gtsam::Pose3> evalPoses; // DSO evaluation points of the poses for each frame.
+    // If false baEvalValues contains the same keys as baValues, so that only the variables in the ordering need to be
+    // updated instead of copying all baValues.
+    bool evalValuesNeedFullCopy = true;
+
+    // Updates baEvalValues (and evalPoses) from baValues, using the FEJ values for DSO variables.
+    void updateEvalValues(const std::vector<dso::EFFrame*>& frames, bool fullCopy);
+    std::pair<gtsam::Matrix, gtsam::Vector> convertDSOHAndB(const dso::MatXX& H, const dso::VecX& b);
+
     bool canBreakOptimization = false;
 
     dso::CalibHessian* HCalib;
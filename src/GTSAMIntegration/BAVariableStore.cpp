@@ -0,0 +1,208 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BAVariableStore.h"
+#include "GTSAMUtils.h"
+#include <atomic>
+
+using namespace dmvio;
+
+namespace
+{
+// Appends the value to array if it has type T.
+template<typename T> bool tryLoad(const gtsam::Value& value, std::vector<T>& array, BAVariableStore::Variable& variable,
+                                  BAVariableStore::VariableType type)
+{
+    auto* casted = dynamic_cast<const gtsam::GenericValue<T>*>(&value);
+    if(!casted) return false;
+    variable.type = type;
+    variable.index = array.size();
+    array.push_back(casted->value());
+    return true;
+}
+
+template<int D> bool tryLoadVector(const gtsam::Value& value, gtsam::Vector& vectorData, int& vectorPos,
+                                   BAVariableStore::Variable& variable)
+{
+    auto* casted = dynamic_cast<const gtsam::GenericValue<Eigen::Matrix<double, D, 1>>*>(&value);
+    if(!casted || variable.dim != D) return false;
+    variable.type = BAVariableStore::VECTOR;
+    variable.index = vectorPos;
+    vectorData.segment<D>(vectorPos) = casted->value();
+    vectorPos += D;
+    return true;
+}
+
+template<typename T> void retractArray(std::vector<T>& array, int index, const gtsam::Vector& inc, int offset)
+{
+    typedef typename gtsam::traits<T>::TangentVector Tangent;
+    array[index] = gtsam::traits<T>::Retract(array[index], inc.segment<Tangent::RowsAtCompileTime>(offset));
+}
+}
+
+void BAVariableStore::setLayout(const gtsam::Ordering& ordering, const std::map<gtsam::Key, size_t>& keyDimMap)
+{
+    static std::atomic<uint64_t> nextLayoutId(1);
+    layoutId = nextLayoutId++;
+    variables.clear();
+    indexForKey.clear();
+    totalDim = 0;
+    for(gtsam::Key key : ordering)
+    {
+        Variable variable;
+        variable.key = key;
+        variable.offset = totalDim;
+        variable.dim = keyDimMap.at(key);
+        indexForKey[key] = variables.size();
+        variables.push_back(variable);
+        totalDim += variable.dim;
+    }
+    vectorData.resize(totalDim);
+}
+
+void BAVariableStore::loadFrom(const gtsam::Values& values)
+{
+    // Types are determined again on every load, which is cheap and keeps the store valid if an extension replaced
+    // a value with a different type. Clearing the arrays keeps their capacity.
+    poses.clear();
+    rotations.clear();
+    scales.clear();
+    biases.clear();
+    genericValues.clear();
+    int vectorPos = 0;
+    for(Variable& variable : variables)
+    {
+        const gtsam::Value& value = values.at(variable.key);
+        if(tryLoad(value, poses, variable, POSE) || tryLoad(value, rotations, variable, ROTATION) ||
+           tryLoad(value, scales, variable, SCALE) || tryLoad(value, biases, variable, BIAS) ||
+           tryLoadVector<2>(value, vectorData, vectorPos, variable) ||
+           tryLoadVector<3>(value, vectorData, vectorPos, variable) ||
+           tryLoadVector<4>(value, vectorData, vectorPos, variable))
+        {
+            continue;
+        }
+        variable.type = GENERIC;
+        variable.index = -1;
+        genericValues.insert(variable.key, value);
+    }
+}
+
+void BAVariableStore::writeTo(gtsam::Values& values) const
+{
+    for(const Variable& variable : variables)
+    {
+        switch(variable.type)
+        {
+            case POSE:
+                eraseAndInsert(values, variable.key, poses[variable.index]);
+                break;
+            case ROTATION:
+                eraseAndInsert(values, variable.key, rotations[variable.index]);
+                break;
+            case SCALE:
+                eraseAndInsert(values, variable.key, scales[variable.index]);
+                break;
+            case BIAS:
+                eraseAndInsert(values, variable.key, biases[variable.index]);
+                break;
+            case VECTOR:
+                if(variable.dim == 2)
+                {
+                    eraseAndInsert(values, variable.key, gtsam::Vector2(vectorData.segment<2>(variable.index)));
+                }else if(variable.dim == 3)
+                {
+                    eraseAndInsert(values, variable.key, gtsam::Vector3(vectorData.segment<3>(variable.index)));
+                }else
+                {
+                    eraseAndInsert(values, variable.key, gtsam::Vector4(vectorData.segment<4>(variable.index)));
+                }
+                break;
+            case GENERIC:
+                if(values.exists(variable.key))
+                {
+                    values.update(variable.key, genericValues.at(variable.key));
+                }else
+                {
+                    values.insert(variable.key, genericValues.at(variable.key));
+                }
+                break;
+        }
+    }
+}
+
+void BAVariableStore::retract(const gtsam::Vector& inc, BAVariableStore& out) const
+{
+    assert(inc.size() >= totalDim);
+    // Assignment reuses the memory of out.
+    out.variables = variables;
+    out.totalDim = totalDim;
+    out.poses = poses;
+    out.rotations = rotations;
+    out.scales = scales;
+    out.biases = biases;
+    out.vectorData = vectorData;
+    if(out.layoutId != layoutId)
+    {
+        out.indexForKey = indexForKey;
+        out.layoutId = layoutId;
+    }
+    out.genericValues.clear();
+
+    for(const Variable& variable : variables)
+    {
+        switch(variable.type)
+        {
+            case POSE:
+                retractArray(out.poses, variable.index, inc, variable.offset);
+                break;
+            case ROTATION:
+                retractArray(out.rotations, variable.index, inc, variable.offset);
+                break;
+            case SCALE:
+                retractArray(out.scales, variable.index, inc, variable.offset);
+                break;
+            case BIAS:
+                retractArray(out.biases, variable.index, inc, variable.offset);
+                break;
+            case VECTOR:
+                out.vectorData.segment(variable.index, variable.dim) += inc.segment(variable.offset, variable.dim);
+                break;
+            case GENERIC:
+                out.genericValues.insert(variable.key, *(genericValues.at(variable.key).retract_(
+                        inc.segment(variable.offset, variable.dim))));
+                break;
+        }
+    }
+}
+
+int BAVariableStore::find(gtsam::Key key) const
+{
+    auto it = indexForKey.find(key);
+    return it == indexForKey.end() ? -1 : it->second;
+}
+
+const gtsam::Pose3& BAVariableStore::getPose(int variableIndex) const
+{
+    const Variable& variable = variables[variableIndex];
+    assert(variable.type == POSE);
+    return poses[variable.index];
+}
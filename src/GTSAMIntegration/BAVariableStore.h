@@ -0,0 +1,101 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DMVIO_BAVARIABLESTORE_H
+#define DMVIO_BAVARIABLESTORE_H
+
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <gtsam/nonlinear/Values.h>
+#include <gtsam/inference/Ordering.h>
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/navigation/ImuBias.h>
+#include "Sim3GTSAM.h"
+
+namespace dmvio
+{
+
+// Dense, index-addressed storage for the variables of the BA window.
+// The layout (position of each variable in the Hessian and the increment) is computed once per window change with
+// setLayout. The values are kept in contiguous arrays per type (poses, rotations, scales, biases, and one vector for
+// all vector-valued variables like affine brightness, calibration and velocities), so that the retraction is a tight
+// loop. gtsam::Values are only read and written at the boundaries (loadFrom and writeTo).
+class BAVariableStore
+{
+public:
+    enum VariableType
+    {
+        VECTOR, POSE, ROTATION, SCALE, BIAS, GENERIC
+    };
+
+    struct Variable
+    {
+        gtsam::Key key;
+        int offset; // Position in Hessian and increment.
+        int dim;
+        VariableType type = GENERIC;
+        int index = -1; // Index in the array of the type (for VECTOR the position in vectorData).
+    };
+
+    // Computes the layout for the passed ordering.
+    void setLayout(const gtsam::Ordering& ordering, const std::map<gtsam::Key, size_t>& keyDimMap);
+
+    // Reads all variables of the layout from values. The type of each variable is determined from the stored value.
+    void loadFrom(const gtsam::Values& values);
+
+    // Writes all variables of the layout into values (replacing existing ones).
+    void writeTo(gtsam::Values& values) const;
+
+    // Sets out to the variables of this store retracted with inc (which has to follow the layout).
+    void retract(const gtsam::Vector& inc, BAVariableStore& out) const;
+
+    // Returns the index of the variable with the key, or -1 if it is not part of the layout.
+    int find(gtsam::Key key) const;
+
+    // Returns the pose of the variable with the given index. The variable must be a pose.
+    const gtsam::Pose3& getPose(int variableIndex) const;
+
+    const std::vector<Variable>& getVariables() const
+    { return variables; }
+
+    // Dimension of all variables together.
+    int getTotalDim() const
+    { return totalDim; }
+
+private:
+    std::vector<Variable> variables;
+    std::unordered_map<gtsam::Key, int> indexForKey;
+    int totalDim = 0;
+    uint64_t layoutId = 0; // Unique for each call to setLayout, so that retract only copies indexForKey if necessary.
+
+    std::vector<gtsam::Pose3> poses;
+    std::vector<gtsam::Rot3> rotations;
+    std::vector<ScaleGTSAM> scales;
+    std::vector<gtsam::imuBias::ConstantBias> biases;
+    gtsam::Vector vectorData;
+    gtsam::Values genericValues; // Fallback for all other types.
+};
+
+}
+
+#endif //DMVIO_BAVARIABLESTORE_H
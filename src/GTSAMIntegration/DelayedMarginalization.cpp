@@ -24,11 +24,75 @@
 #include "Marginalization.h"
 #include "util/TimeMeasurement.h"
 #include "GTSAMUtils.h"
+#include "ExtUtils.h"
 #include <gtsam/nonlinear/NonlinearFactorGraph.h>
 #include <gtsam/linear/GaussianFactorGraph.h>
+#include <gtsam/base/SymmetricBlockMatrix.h>
+#include <gtsam/linear/HessianFactor.h>
+#include <gtsam/linear/JacobianFactor.h>
+#include <unordered_set>
 
 using namespace dmvio;
 
+namespace
+{
+// Copies the factor graph, sharing all factors which can be used by several graphs (and threads) at once.
+// Factors handling FEJ store a pointer to the FEJValues of their graph and have mutable state, so they are cloned.
+gtsam::NonlinearFactorGraph::shared_ptr copyGraphSharingFactors(const gtsam::NonlinearFactorGraph& graph)
+{
+    auto copy = boost::make_shared<gtsam::NonlinearFactorGraph>();
+    copy->reserve(graph.size());
+    for(auto&& factor : graph)
+    {
+        if(factor && dynamic_cast<const FactorHandlingFEJ*>(factor.get()))
+        {
+            copy->push_back(factor->clone());
+        }else
+        {
+            copy->push_back(factor);
+        }
+    }
+    return copy;
+}
+
+size_t estimateValuesMemory(const gtsam::Values& values)
+{
+    size_t bytes = 0;
+    for(auto&& val : values)
+    {
+        // Map node and value object, the manifold types store at most a few more doubles than their dimension.
+        bytes += 64 + 2 * sizeof(double) * val.value.dim();
+    }
+    return bytes;
+}
+
+size_t estimateFactorMemory(const gtsam::NonlinearFactor& factor)
+{
+    size_t bytes = 64 + sizeof(gtsam::Key) * factor.size();
+    auto* lcf = dynamic_cast<const gtsam::LinearContainerFactor*>(&factor);
+    if(lcf)
+    {
+        auto* hessian = dynamic_cast<const gtsam::HessianFactor*>(lcf->linearFactor().get());
+        auto* jacobian = dynamic_cast<const gtsam::JacobianFactor*>(lcf->linearFactor().get());
+        if(hessian)
+        {
+            bytes += sizeof(double) * (hessian->rows() * hessian->rows());
+        }else if(jacobian)
+        {
+            bytes += sizeof(double) * (jacobian->rows() * (jacobian->cols() + 1));
+        }
+        if(lcf->hasLinearizationPoint())
+        {
+            bytes += estimateValuesMemory(*lcf->linearizationPoint());
+        }
+    }else
+    {
+        bytes += 64 * sizeof(double) * factor.size(); // Measurements and noise models of typical factors.
+    }
+    return bytes;
+}
+}
+
 DelayedMarginalizationGraphs::DelayedMarginalizationGraphs(int mainGraphDelay, int maxGroupInMainGraph)
 {
     addMainGraph(std::make_shared<DelayedGraph>(mainGraphDelay, maxGroupInMainGraph));
@@ -64,19 +128,130 @@ dmvio::DelayedMarginalizationGraphs::getHAndB(const gtsam::Values& values, const
 {
     auto graph = getMainGraph()->getGraph();
 
+    // Split into constant factors (handled by the constantFactorCache) and factors which need to be linearized.
+    std::vector<gtsam::NonlinearFactor::shared_ptr> constantFactors;
+    gtsam::NonlinearFactorGraph nonlinearFactors;
+    for(auto&& factor : *graph)
+    {
+        auto* lcf = dynamic_cast<gtsam::LinearContainerFactor*>(factor.get());
+        if(lcf && lcf->hasLinearizationPoint())
+        {
+            constantFactors.push_back(factor);
+        }else
+        {
+            nonlinearFactors.push_back(factor);
+        }
+    }
+
     // Make sure that the GTSAM factors use the FEJValues.
     getMainGraph()->setFEJValuesForFactors(true);
     // Lienarize the graph
-    gtsam::GaussianFactorGraph::shared_ptr gfg = graph->linearize(values);
+    gtsam::GaussianFactorGraph::shared_ptr gfg = linearizeMT(nonlinearFactors, values, red);
     getMainGraph()->setFEJValuesForFactors(false);
 
+    // The Hessian contains the keys of all factors, so the scatter is computed with the constant factors (at their
+    // linearization point) added.
+    gtsam::GaussianFactorGraph gfgWithConstant = *gfg;
+    for(auto&& factor : constantFactors)
+    {
+        gfgWithConstant.push_back(static_cast<gtsam::LinearContainerFactor&>(*factor).linearFactor());
+    }
+
     // Compute the Hessian and gradient vector. We use the AugmentedScatter which also works for keys which don't exist in the graph.
-    AugmentedScatter scatter(*gfg, ordering, keyDimMap);
+    AugmentedScatter scatter(gfgWithConstant, ordering, keyDimMap);
     if(fillAdditionalKeys)
     {
         fillAdditionalKeysFromScatter(ordering, *fillAdditionalKeys, scatter);
     }
-    return scatter.computeHessian(*gfg);
+
+    if(!updateConstantFactorCache(constantFactors, scatter))
+    {
+        // Linearize the constant factors normally.
+        for(auto&& factor : constantFactors)
+        {
+            gfg->push_back(factor->linearize(values));
+        }
+        return scatter.computeHessianMT(*gfg, red);
+    }
+
+    auto HAndB = scatter.computeHessianMT(*gfg, red);
+
+    // The gradient of the constant factors changes with the offset to the linearization point:
+    // b = b0 - H * delta (see LinearContainerFactor::linearize).
+    const ConstantFactorCache& cache = constantFactorCache;
+    gtsam::Vector delta = gtsam::Vector::Zero(cache.H.rows());
+    int pos = 0;
+    for(auto&& slot : cache.layout)
+    {
+        if(cache.linearizationPoint.exists(slot.first))
+        {
+            delta.segment(pos, slot.second) = cache.linearizationPoint.at(slot.first).localCoordinates_(
+                    values.at(slot.first));
+        }
+        pos += slot.second;
+    }
+    HAndB.first += cache.H;
+    HAndB.second += cache.b - cache.H * delta;
+
+#ifdef DEBUG
+    gtsam::GaussianFactorGraph gfgFull = *gfg;
+    for(auto&& factor : constantFactors)
+    {
+        gfgFull.push_back(factor->linearize(values));
+    }
+    auto fullHAndB = scatter.computeHessian(gfgFull);
+    assertEqEigen(fullHAndB.first, HAndB.first, 1e-6);
+    assertEqEigen(fullHAndB.second, HAndB.second, 1e-6);
+#endif
+
+    return HAndB;
+}
+
+bool DelayedMarginalizationGraphs::updateConstantFactorCache(
+        const std::vector<gtsam::NonlinearFactor::shared_ptr>& constantFactors, AugmentedScatter& scatter)
+{
+    ConstantFactorCache& cache = constantFactorCache;
+    bool layoutEqual = cache.layout.size() == scatter.size() &&
+                       std::equal(scatter.begin(), scatter.end(), cache.layout.begin(),
+                                  [](const gtsam::SlotEntry& slot, const std::pair<gtsam::Key, size_t>& entry)
+                                  { return slot.key == entry.first && slot.dimension == entry.second; });
+    if(layoutEqual && cache.factors == constantFactors)
+    {
+        return cache.valid;
+    }
+
+    dmvio::TimeMeasurement meas("updateConstantFactorCache");
+    cache.factors = constantFactors;
+    cache.layout.clear();
+    for(auto&& slot : scatter)
+    {
+        cache.layout.emplace_back(slot.key, slot.dimension);
+    }
+
+    // All factors need to have the same linearization point for shared keys (which is the case with FEJ).
+    cache.valid = false;
+    cache.linearizationPoint.clear();
+    gtsam::GaussianFactorGraph gfg;
+    for(auto&& factor : constantFactors)
+    {
+        auto& lcf = static_cast<gtsam::LinearContainerFactor&>(*factor);
+        const gtsam::Values& linPoint = *lcf.linearizationPoint();
+        for(auto&& val : linPoint)
+        {
+            if(!cache.linearizationPoint.exists(val.key))
+            {
+                cache.linearizationPoint.insert(val.key, val.value);
+            }else if(!cache.linearizationPoint.at(val.key).equals_(val.value, 1e-9))
+            {
+                return false;
+            }
+        }
+        gfg.push_back(lcf.linearFactor());
+    }
+
+    std::tie(cache.H, cache.b) = scatter.computeHessianMT(gfg, red);
+    cache.valid = true;
+    return true;
 }
 
 void dmvio::DelayedMarginalizationGraphs::marginalizeFrame(const gtsam::FastVector<gtsam::Key>& keysToMarginalize,
@@ -194,15 +369,17 @@ dmvio::DelayedGraph::marginalize(const gtsam::FastVector<gtsam::Key>& keysToMarg
     marginalizationOrder.push_back(keysToMarginalize);
 
     // update values
+    gtsam::Values& delayedValuesMutable = delayedValues.mutate();
     for(auto&& val : *values)
     {
-        eraseAndInsert(delayedValues, val.key, val.value);
+        eraseAndInsert(delayedValuesMutable, val.key, val.value);
     }
     if(currValues)
     {
+        gtsam::Values& delayedCurrValuesMutable = delayedCurrValues.mutate();
         for(auto&& val : *currValues)
         {
-            eraseAndInsert(delayedCurrValues, val.key, val.value);
+            eraseAndInsert(delayedCurrValuesMutable, val.key, val.value);
         }
     }
 
@@ -218,14 +395,14 @@ void dmvio::DelayedGraph::readvanceUntilDelay()
 
         // Insert values for keysToMarginalize, even though they will be removed below, but they are necessary
         // so that all fejValues contains all values needed for the linearization below.
-        fejValues->insertConnectedKeys(keysToMarg, delayedValues);
+        fejValues->insertConnectedKeys(keysToMarg, delayedValues.get());
 
         // The connected keys have to be inserted into the fejMap before the linearization inside marginalizeOut.
         auto connectedKeyCallback = [this](const gtsam::FastSet<gtsam::Key>& connectedKeys)
         {
             // Get connected keys and insert fejMap.
             // delayedValues should be baEvalValues, i.e. evaluation point values for poses and affine, and the current values for everything else.
-            fejValues->insertConnectedKeys(connectedKeys, delayedValues);
+            fejValues->insertConnectedKeys(connectedKeys, delayedValues.get());
         };
 
         if(!keysToMarg.empty())
@@ -235,13 +412,13 @@ void dmvio::DelayedGraph::readvanceUntilDelay()
 
             for(auto&& key : keysToMarg)
             {
-                if(delayedCurrValues.exists(key))
+                if(delayedCurrValues.get().exists(key))
                 {
-                    delayedCurrValues.erase(key);
+                    delayedCurrValues.mutate().erase(key);
                 }
-                if(delayedValues.exists(key))
+                if(delayedValues.get().exists(key))
                 {
-                    delayedValues.erase(key);
+                    delayedValues.mutate().erase(key);
                 }
             }
 
@@ -275,12 +452,12 @@ gtsam::NonlinearFactorGraph::shared_ptr DelayedGraph::getGraph() const
 
 const gtsam::Values& DelayedGraph::getDelayedValues() const
 {
-    return delayedValues;
+    return delayedValues.get();
 }
 
 const gtsam::Values& DelayedGraph::getDelayedCurrValues() const
 {
-    return delayedCurrValues;
+    return delayedCurrValues.get();
 }
 
 int DelayedGraph::getMaxGroupInGraph() const
@@ -306,7 +483,7 @@ DelayedGraph::DelayedGraph(int delayN, int maxGroupInGraph, const gtsam::Nonline
 
 DelayedGraph::DelayedGraph(const DelayedGraph& other)
         : delayN(other.delayN), maxGroupInGraph(other.maxGroupInGraph),
-          graph(boost::make_shared<gtsam::NonlinearFactorGraph>(other.graph->clone())),
+          graph(copyGraphSharingFactors(*other.graph)),
           marginalizationOrder(other.marginalizationOrder), delayedValues(other.delayedValues),
           delayedCurrValues(other.delayedCurrValues), fejValues(new FEJValues(*(other.fejValues)))
 {}
@@ -365,3 +542,91 @@ void DisconnectedDelayedGraph::marginalize(const gtsam::FastVector<gtsam::Key>&
         }
     }
 }
+
+gtsam::LinearContainerFactor::shared_ptr
+DelayedMarginalizationGraphs::linearizeToFactor(const gtsam::Values& values, gtsam::Values& fejValuesOut)
+{
+    auto mainGraph = getMainGraph();
+    fejValuesOut = mainGraph->fejValues->fejValues;
+
+    gtsam::KeySet keys = mainGraph->getGraph()->keys();
+    if(keys.empty()) return nullptr;
+
+    // Same linearization as in getHAndB.
+    mainGraph->setFEJValuesForFactors(true);
+    gtsam::GaussianFactorGraph::shared_ptr gfg = mainGraph->getGraph()->linearize(values);
+    mainGraph->setFEJValuesForFactors(false);
+
+    gtsam::Ordering ordering(keys.begin(), keys.end());
+    std::vector<size_t> dims;
+    for(auto&& key : ordering)
+    {
+        dims.push_back(values.at(key).dim());
+    }
+    gtsam::SymmetricBlockMatrix sm(dims, true);
+    sm.setFullMatrix(gfg->augmentedHessian(ordering));
+
+    return gtsam::LinearContainerFactor::shared_ptr(
+            new gtsam::LinearContainerFactor(gtsam::HessianFactor(ordering, sm), values));
+}
+
+void DelayedMarginalizationGraphs::resetToFactor(gtsam::NonlinearFactor::shared_ptr factor,
+                                                 const gtsam::Values& fejValues, const gtsam::Values& evalValues,
+                                                 const gtsam::Values& currValues)
+{
+    auto oldMainGraph = getMainGraph();
+    gtsam::NonlinearFactorGraph::shared_ptr graph(new gtsam::NonlinearFactorGraph());
+    if(factor)
+    {
+        graph->add(factor);
+    }
+    auto fej = std::make_shared<FEJValues>();
+    fej->fejValues = fejValues;
+    auto newMainGraph = std::make_shared<DelayedGraph>(oldMainGraph->getDelayN(), oldMainGraph->getMaxGroupInGraph(),
+                                                       graph, std::deque<gtsam::FastVector<gtsam::Key>>(),
+                                                       evalValues, currValues, std::move(fej));
+
+    delayedGraphs.assign(1, oldMainGraph);
+    disconnectedGraphs.clear();
+    mainGraphInd = 0;
+    replaceMainGraph(std::move(newMainGraph));
+}
+
+void DelayedMarginalizationGraphs::printMemoryUsage(std::ostream& stream,
+                                                   const std::vector<const DelayedGraph*>& additionalGraphs) const
+{
+    std::vector<const DelayedGraph*> graphs(additionalGraphs);
+    for(auto&& graph : delayedGraphs)
+    {
+        graphs.push_back(graph.get());
+    }
+    DelayedGraphMemory memory = computeDelayedGraphMemory(graphs);
+    stream << "Delayed graphs (" << graphs.size() << "): estimated " << memory.withSharing / 1024 << " KB ("
+           << memory.withoutSharing / 1024 << " KB without sharing)." << std::endl;
+}
+
+DelayedGraphMemory dmvio::computeDelayedGraphMemory(const std::vector<const DelayedGraph*>& graphs)
+{
+    DelayedGraphMemory memory;
+    std::unordered_set<const void*> counted;
+    auto add = [&memory, &counted](const void* id, size_t bytes)
+    {
+        memory.withoutSharing += bytes;
+        if(counted.insert(id).second)
+        {
+            memory.withSharing += bytes;
+        }
+    };
+    for(const DelayedGraph* graph : graphs)
+    {
+        for(auto&& factor : *graph->getGraph())
+        {
+            if(factor) add(factor.get(), estimateFactorMemory(*factor));
+        }
+        // The values are only inspected through the const getters, which doesn't unshare them.
+        add(&graph->getDelayedValues(), estimateValuesMemory(graph->getDelayedValues()));
+        add(&graph->getDelayedCurrValues(), estimateValuesMemory(graph->getDelayedCurrValues()));
+        add(graph->fejValues.get(), estimateValuesMemory(graph->fejValues->fejValues));
+    }
+    return memory;
+}
@@ -26,6 +26,7 @@
 #include "GTSAMIntegration/BAGTSAMIntegration.h"
 #include "GTSAMIntegration/PoseTransformation.h"
 #include "GTSAMIntegration/FEJValues.h"
+#include "util/CopyOnWrite.h"
 
 namespace dmvio
 {
@@ -42,7 +43,9 @@ public:
                  std::deque<gtsam::FastVector<gtsam::Key>> marginalizationOrder,
                  gtsam::Values delayedValues, gtsam::Values delayedCurrValues, std::shared_ptr<FEJValues> fejValues);
 
-    DelayedGraph(const DelayedGraph& other); // copy constructor.
+    // Copy constructor. Values and all factors which don't handle FEJ are shared with other until modified, so copies
+    // are cheap even for a large delay.
+    DelayedGraph(const DelayedGraph& other);
 
     // changes the delay, but doesn't readvance.
     void setDelayN(int delayN);
@@ -88,9 +91,19 @@ protected:
 
     // delayedValues contain the baEvalValues, meaning FEJValues for DSO variables, and current values for all other variables.
     // delayedCurrValues contain baValues, meaning current values for all variables.
-    gtsam::Values delayedValues, delayedCurrValues; // contain the delayed values (including new keys).
+    CopyOnWrite<gtsam::Values> delayedValues, delayedCurrValues; // contain the delayed values (including new keys).
 };
 
+// Estimated memory used by delayed graphs, counting shared factors and values once (withSharing) or for each graph
+// they are used in (withoutSharing). The sizes are derived from the matrix dimensions and number of keys plus fixed
+// per-object overheads, they are not measured allocations.
+struct DelayedGraphMemory
+{
+    size_t withSharing = 0;
+    size_t withoutSharing = 0;
+};
+DelayedGraphMemory computeDelayedGraphMemory(const std::vector<const DelayedGraph*>& graphs);
+
 // This is a delayed graph which just saves the factors and marginalization commands in the right order.
 // It can be used to "reconnect" a DelayedGraph which has not been updated for a while.
 // Used e.g. for the realtime version of the PGBA (which has to run in a separate thread decoupled from the main BA).
@@ -151,6 +164,15 @@ public:
 
     void updateEvalValues(const gtsam::Values& evalValues) override;
 
+    // Only the main graph is used. All other delayed graphs are dropped on reset, as they need the full history.
+    gtsam::LinearContainerFactor::shared_ptr
+    linearizeToFactor(const gtsam::Values& values, gtsam::Values& fejValuesOut) override;
+    void resetToFactor(gtsam::NonlinearFactor::shared_ptr factor, const gtsam::Values& fejValues,
+                       const gtsam::Values& evalValues, const gtsam::Values& currValues) override;
+
+    // Prints the memory used by all delayed graphs, including additionalGraphs which are not managed by this class.
+    void printMemoryUsage(std::ostream& stream, const std::vector<const DelayedGraph*>& additionalGraphs = {}) const;
+
 private:
     // Delayed graphs to use. (doesn't contain main graph).
     std::vector<std::shared_ptr<DelayedGraph>> delayedGraphs;
@@ -160,6 +182,22 @@ private:
 
     std::vector<GraphReplacementCallback> mainGraphCallbacks;
 
+    // The LinearContainerFactors of the main graph (marginalization priors) have a constant Hessian, only their
+    // gradient changes (linearly) with the values. getHAndB therefore keeps their summed Hessian and gradient at the
+    // linearization point, and only linearizes the remaining factors in each iteration.
+    struct ConstantFactorCache
+    {
+        bool valid = false; // false if it has to be recomputed or the factors have no common linearization point.
+        std::vector<gtsam::NonlinearFactor::shared_ptr> factors; // The factors the cache was computed for.
+        std::vector<std::pair<gtsam::Key, size_t>> layout; // Keys and dimensions of the Hessian.
+        gtsam::Values linearizationPoint;
+        gtsam::Matrix H;
+        gtsam::Vector b;
+    };
+    ConstantFactorCache constantFactorCache;
+    // Returns false if the factors don't have a common linearization point, in which case the cache cannot be used.
+    bool updateConstantFactorCache(const std::vector<gtsam::NonlinearFactor::shared_ptr>& constantFactors,
+                                   AugmentedScatter& scatter);
 };
 
 }
@@ -21,6 +21,11 @@
 */
 
 #include "GTSAMUtils.h"
+#include "Sim3GTSAM.h"
+#include <gtsam/base/SymmetricBlockMatrix.h>
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/navigation/ImuBias.h>
+#include <gtsam/linear/HessianFactor.h>
 
 using namespace gtsam;
 
@@ -76,3 +81,119 @@ void dmvio::removeKeysFromGraph(gtsam::NonlinearFactorGraph& graph, const std::s
 }
 
 
+
+std::vector<dmvio::ValueCheckpoint> dmvio::valuesToCheckpoint(const gtsam::Values& values)
+{
+    std::vector<ValueCheckpoint> returning;
+    returning.reserve(values.size());
+    for(auto&& val : values)
+    {
+        ValueCheckpoint checkpoint;
+        checkpoint.key = val.key;
+        gtsam::Vector data;
+        switch(Symbol(val.key).chr())
+        {
+            case 'p':
+            case 'i':
+            {
+                gtsam::Matrix4 mat = val.value.cast<Pose3>().matrix();
+                data = Eigen::Map<gtsam::Vector>(mat.data(), 16);
+                break;
+            }
+            case 'g':
+            {
+                gtsam::Matrix3 mat = val.value.cast<Rot3>().matrix();
+                data = Eigen::Map<gtsam::Vector>(mat.data(), 9);
+                break;
+            }
+            case 'a':
+                data = val.value.cast<gtsam::Vector2>();
+                break;
+            case 'v':
+                data = val.value.cast<gtsam::Vector3>();
+                break;
+            case 'c':
+                data = val.value.cast<gtsam::Vector4>();
+                break;
+            case 'b':
+                data = val.value.cast<imuBias::ConstantBias>().vector();
+                break;
+            case 's':
+                data = gtsam::Vector1(val.value.cast<ScaleGTSAM>().scale);
+                break;
+            default:
+                std::cout << "WARNING: Cannot store value with key " << Symbol(val.key).chr()
+                          << Symbol(val.key).index() << " in checkpoint." << std::endl;
+                continue;
+        }
+        checkpoint.data.assign(data.data(), data.data() + data.size());
+        returning.push_back(std::move(checkpoint));
+    }
+    return returning;
+}
+
+gtsam::Values dmvio::valuesFromCheckpoint(const std::vector<ValueCheckpoint>& checkpoint)
+{
+    gtsam::Values values;
+    for(auto&& val : checkpoint)
+    {
+        Eigen::Map<const gtsam::Vector> data(val.data.data(), val.data.size());
+        switch(Symbol(val.key).chr())
+        {
+            case 'p':
+            case 'i':
+                values.insert(val.key, Pose3(Eigen::Map<const gtsam::Matrix4>(val.data.data())));
+                break;
+            case 'g':
+                values.insert(val.key, Rot3(gtsam::Matrix3(Eigen::Map<const gtsam::Matrix3>(val.data.data()))));
+                break;
+            case 'a':
+                values.insert(val.key, gtsam::Vector2(data));
+                break;
+            case 'v':
+                values.insert(val.key, gtsam::Vector3(data));
+                break;
+            case 'c':
+                values.insert(val.key, gtsam::Vector4(data));
+                break;
+            case 'b':
+                values.insert(val.key, imuBias::ConstantBias(gtsam::Vector6(data)));
+                break;
+            case 's':
+                values.insert(val.key, ScaleGTSAM(data[0]));
+                break;
+            default:
+                assert(false);
+        }
+    }
+    return values;
+}
+
+dmvio::LinearFactorCheckpoint dmvio::linearFactorToCheckpoint(const gtsam::LinearContainerFactor& factor)
+{
+    LinearFactorCheckpoint checkpoint;
+    const GaussianFactor::shared_ptr& gaussian = factor.factor();
+    for(auto it = gaussian->begin(); it != gaussian->end(); ++it)
+    {
+        checkpoint.keys.push_back(*it);
+        checkpoint.dims.push_back(gaussian->getDim(it));
+    }
+    checkpoint.augmentedHessian = gaussian->augmentedInformation();
+    if(factor.linearizationPoint())
+    {
+        checkpoint.linearizationPoint = valuesToCheckpoint(*factor.linearizationPoint());
+    }
+    return checkpoint;
+}
+
+gtsam::LinearContainerFactor::shared_ptr dmvio::linearFactorFromCheckpoint(const LinearFactorCheckpoint& checkpoint)
+{
+    if(checkpoint.empty()) return nullptr;
+    gtsam::Ordering ordering(checkpoint.keys.begin(), checkpoint.keys.end());
+    std::vector<size_t> dims(checkpoint.dims.begin(), checkpoint.dims.end());
+    gtsam::SymmetricBlockMatrix sm(dims, true);
+    sm.setFullMatrix(checkpoint.augmentedHessian);
+    return gtsam::LinearContainerFactor::shared_ptr(
+            new gtsam::LinearContainerFactor(gtsam::HessianFactor(ordering, sm),
+                                             valuesFromCheckpoint(checkpoint.linearizationPoint)));
+}
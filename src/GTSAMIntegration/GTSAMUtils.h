@@ -27,6 +27,7 @@
 #include <set>
 #include <gtsam/nonlinear/Symbol.h>
 #include <gtsam/nonlinear/LinearContainerFactor.h>
+#include "util/SystemCheckpoint.h"
 
 namespace dmvio
 {
@@ -38,6 +39,13 @@ gtsam::Matrix augmentedHessianFromPair(const std::pair<gtsam::Matrix, gtsam::Vec
 void removeKeysFromGraph(gtsam::NonlinearFactorGraph& graph, const std::set<gtsam::Key>& keysToRemove,
                          int stopAfterNoRemoval = -1);
 
+// Conversion to and from the plain checkpoint types. Values are supported for all variable types of the BA, the type
+// is determined by the character of the key symbol.
+std::vector<ValueCheckpoint> valuesToCheckpoint(const gtsam::Values& values);
+gtsam::Values valuesFromCheckpoint(const std::vector<ValueCheckpoint>& checkpoint);
+LinearFactorCheckpoint linearFactorToCheckpoint(const gtsam::LinearContainerFactor& factor);
+gtsam::LinearContainerFactor::shared_ptr linearFactorFromCheckpoint(const LinearFactorCheckpoint& checkpoint);
+
 template<typename T> void eraseAndInsert(gtsam::Values& values, gtsam::Key key, const T& value)
 {
     if(values.exists(key))
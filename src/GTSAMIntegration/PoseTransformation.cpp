@@ -54,19 +54,27 @@ std::vector<gtsam::Key> PoseTransformation::getAllOptimizedSymbols() const
 
 gtsam::Matrix66 TransformIdentity::getPoseDerivative(const PoseType& pose, DerivativeDirection direction)
 {
-    // Analytic derivative only implemented for RIGHT_to_LEFT at the moment.
-    if(direction == DerivativeDirection::RIGHT_TO_LEFT)
+    gtsam::Matrix66 returning;
+    switch(direction)
     {
-        gtsam::Matrix66 returning = gtsam::Pose3(pose).AdjointMap();
+        case DerivativeDirection::LEFT_TO_LEFT:
+        case DerivativeDirection::RIGHT_TO_RIGHT:
+            returning.setIdentity();
+            break;
+        case DerivativeDirection::RIGHT_TO_LEFT:
+            returning = gtsam::Pose3(pose).AdjointMap();
+            break;
+        case DerivativeDirection::LEFT_TO_RIGHT:
+            returning = gtsam::Pose3(pose).inverse().AdjointMap();
+            break;
+    }
 #ifdef DEBUG
-        // Check numeric jacobian.
-        Sophus::SE3d poseForNum(pose);
-        gtsam::Matrix numJac = computeNumericJacobian(*this, poseForNum, &poseForNum, direction);
-        assertNumericJac(numJac, returning);
+    // Check numeric jacobian.
+    Sophus::SE3d poseForNum(pose);
+    gtsam::Matrix numJac = computeNumericJacobian(*this, poseForNum, &poseForNum, direction);
+    assertNumericJac(numJac, returning);
 #endif
-        return returning;
-    }
-    return PoseTransformation::getPoseDerivative(pose, direction); // Use numeric derivative if not implemented.
+    return returning;
 }
 
 // Exchanges rotation and translation (the first 6 rows/columns) in a Jacobian matrix.
@@ -131,6 +139,18 @@ dmvio::convertHAndBFromDSO(const dso::MatXX& HInput, const dso::VecX& bInput, Po
     int numFrames = (n - numCPARS) / 8;
     assert(n == numFrames * 8 + numCPARS);
 
+    if(poseTransformation.getAllOptimizedSymbols().empty())
+    {
+        std::vector<gtsam::Pose3> poses;
+        poses.reserve(numFrames);
+        for(auto&& key : ordering)
+        {
+            if(Symbol(key).chr() == 'p') poses.push_back(values.at<gtsam::Pose3>(key));
+        }
+        timeMeasurement.cancel();
+        return convertHAndBFromDSO(HInput, bInput, poseTransformation, weightDSOToGTSAM, numCPARS, poses);
+    }
+
     // Exchange rotation with translation for all frames (because the order is different in GTSAM!)
     // First exchange the rows.
     for(int i = 0; i < numFrames; ++i)
@@ -167,6 +187,38 @@ dmvio::convertHAndBFromDSO(const dso::MatXX& HInput, const dso::VecX& bInput, Po
     return pair;
 }
 
+std::pair<gtsam::Matrix, gtsam::Vector>
+dmvio::convertHAndBFromDSO(const dso::MatXX& HInput, const dso::VecX& bInput, PoseTransformation& poseTransformation,
+                           double weightDSOToGTSAM, int numCPARS, const std::vector<gtsam::Pose3>& poses)
+{
+    dmvio::TimeMeasurement timeMeasurement("convertHAndBFromDSO");
+    assert(poseTransformation.getAllOptimizedSymbols().empty());
+    int numFrames = poses.size();
+    assert(HInput.rows() == numFrames * 8 + numCPARS);
+
+    gtsam::Matrix H = weightDSOToGTSAM * HInput;
+    gtsam::Vector b = weightDSOToGTSAM * bInput;
+
+    // Exchanges rotation and translation (because the order is different in GTSAM).
+    gtsam::Matrix66 swapRT = gtsam::Matrix66::Zero();
+    swapRT.topRightCorner<3, 3>().setIdentity();
+    swapRT.bottomLeftCorner<3, 3>().setIdentity();
+
+    poseTransformation.precomputeForDerivatives();
+    for(int i = 0; i < numFrames; ++i)
+    {
+        int id = numCPARS + 8 * i;
+        // Same as for the generic version: RIGHT_TO_LEFT because DSO has a left sided increment.
+        gtsam::Matrix66 J = swapRT * poseTransformation.getPoseDerivative(poses[i].matrix(),
+                                                                         DerivativeDirection::RIGHT_TO_LEFT);
+        H.middleCols<6>(id) = H.middleCols<6>(id) * J;
+        H.middleRows<6>(id) = J.transpose() * H.middleRows<6>(id);
+        b.segment<6>(id) = J.transpose() * b.segment<6>(id);
+    }
+
+    // DSO uses -b compared to GTSAM.
+    return std::make_pair(H, -b);
+}
 
 std::pair<gtsam::Matrix, gtsam::Vector>
 dmvio::convertHAndBWithPoseTransformation(const std::pair<gtsam::Matrix, gtsam::Vector>& input,
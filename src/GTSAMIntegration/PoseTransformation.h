@@ -101,6 +101,11 @@ public:
     virtual void updateWithValues(const gtsam::Values& values)
     {}
 
+    // Writes all parameters the derivatives depend on (apart from the pose) to params, so that callers can cache
+    // derivatives per evaluation point. Returns false if this is not supported, in which case nothing may be cached.
+    virtual bool getDerivativeParameters(Eigen::VectorXd& params) const
+    { return false; }
+
     int getOptimizedDim(gtsam::Key key) const
     { return keyDimMap.at(key); } // get dimension of optimized symbol
 
@@ -131,6 +136,12 @@ public:
     }
 
     virtual gtsam::Matrix66 getPoseDerivative(const PoseType& pose, DerivativeDirection direction) override;
+
+    bool getDerivativeParameters(Eigen::VectorXd& params) const override
+    {
+        params.resize(0);
+        return true;
+    }
 };
 
 // Create the inverse of a PoseTransformation.
@@ -169,6 +180,14 @@ std::pair<gtsam::Matrix, gtsam::Vector> convertHAndBFromDSO(const dso::MatXX& H,
                                                             const gtsam::Values& values,
                                                             const std::map<gtsam::Key, size_t>& keyDimMap);
 
+// Same as above for a poseTransformation without optimized symbols, with the poses of all frames passed in the order of
+// the DSO Hessian (which contains numCPARS calibration parameters followed by pose and affine brightness of each frame).
+// The relative Jacobian is applied blockwise instead of multiplying with a dense matrix.
+std::pair<gtsam::Matrix, gtsam::Vector> convertHAndBFromDSO(const dso::MatXX& H, const dso::VecX& b,
+                                                            PoseTransformation& poseTransformation,
+                                                            double weightDSOToGTSAM, int numCPARS,
+                                                            const std::vector<gtsam::Pose3>& poses);
+
 // Convert H and b between 2 GTSAM factor graphs.
 // Note that the transformation has to be defined "the other way round" compared to the Hessians:
 // To convert a Hessian that is defined in the IMU space to the DSO space you have to provide the TransformDSOToIMU.
@@ -25,9 +25,11 @@
 #include "Marginalization.h"
 #include <gtsam/linear/HessianFactor.h>
 #include <gtsam/linear/JacobianFactor.h>
+#include <gtsam/navigation/ImuFactor.h>
 #include "GTSAMUtils.h"
 #include "util/TimeMeasurement.h"
 #include "ExtUtils.h"
+#include <algorithm>
 
 dmvio::PoseTransformationFactor::PoseTransformationFactor(const gtsam::NonlinearFactor::shared_ptr& factor,
                                                           const PoseTransformation& poseTransformationPassed,
@@ -63,13 +65,42 @@ dmvio::PoseTransformationFactor::PoseTransformationFactor(const gtsam::Nonlinear
     {
         additionalDim += poseTransformation->getOptimizedDim(key);
     }
+
+    initIMUFastPath();
 }
 
 dmvio::PoseTransformationFactor::PoseTransformationFactor(const dmvio::PoseTransformationFactor& o)
         : gtsam::NonlinearFactor(o), factor(o.factor->clone()), poseTransformation(o.poseTransformation->clone()),
           conversionType(o.conversionType),
           additionalDim(o.additionalDim), fixedValues(o.fixedValues), fixedKeys(o.fixedKeys), fixedKeySet(o.fixedKeySet)
-{}
+{
+    initIMUFastPath();
+}
+
+void dmvio::PoseTransformationFactor::initIMUFastPath()
+{
+    imuChild = dynamic_cast<const gtsam::ImuFactor*>(factor.get());
+    if(imuChild)
+    {
+        // Constrained and robust noise models need the generic linearization of NoiseModelFactor.
+        imuNoise = boost::dynamic_pointer_cast<gtsam::noiseModel::Gaussian>(imuChild->noiseModel());
+        if(!imuNoise || imuNoise->isConstrained())
+        {
+            imuChild = nullptr;
+            imuNoise.reset();
+        }
+    }
+    childJacobians.resize(imuChild ? 5 : 0);
+}
+
+template<typename T> T dmvio::PoseTransformationFactor::getChildValue(gtsam::Key key, const gtsam::Values& c) const
+{
+    if(fixedKeySet.find(key) != fixedKeySet.end())
+    {
+        return fixedValues.at<T>(key);
+    }
+    return c.at<T>(key);
+}
 
 dmvio::PoseTransformationFactor::~PoseTransformationFactor()
 = default;
@@ -86,8 +117,32 @@ gtsam::Values dmvio::PoseTransformationFactor::convertValues(const gtsam::Values
     return ret;
 }
 
+gtsam::Vector dmvio::PoseTransformationFactor::evaluateIMUError(const gtsam::Values& c, bool computeJacobians) const
+{
+    poseTransformation->updateWithValues(c);
+
+    // Keys of the ImuFactor are pose_i, vel_i, pose_j, vel_j, bias_i.
+    const gtsam::KeyVector& childKeys = factor->keys();
+    gtsam::Pose3 pose_i(poseTransformation->transformPose(getChildValue<gtsam::Pose3>(childKeys[0], c).matrix()));
+    gtsam::Pose3 pose_j(poseTransformation->transformPose(getChildValue<gtsam::Pose3>(childKeys[2], c).matrix()));
+    gtsam::Vector3 vel_i = getChildValue<gtsam::Vector3>(childKeys[1], c);
+    gtsam::Vector3 vel_j = getChildValue<gtsam::Vector3>(childKeys[3], c);
+    gtsam::imuBias::ConstantBias bias_i = getChildValue<gtsam::imuBias::ConstantBias>(childKeys[4], c);
+
+    if(!computeJacobians)
+    {
+        return imuChild->evaluateError(pose_i, vel_i, pose_j, vel_j, bias_i);
+    }
+    return imuChild->evaluateError(pose_i, vel_i, pose_j, vel_j, bias_i, childJacobians[0], childJacobians[1],
+                                   childJacobians[2], childJacobians[3], childJacobians[4]);
+}
+
 double dmvio::PoseTransformationFactor::error(const gtsam::Values& c) const
 {
+    if(imuChild)
+    {
+        return 0.5 * imuNoise->whiten(evaluateIMUError(c, false)).squaredNorm();
+    }
     return factor->error(convertValues(c));
 }
 
@@ -119,8 +174,106 @@ void dmvio::PoseTransformationFactor::setFEJValues(std::shared_ptr<FEJValues> fe
     fej = std::move(fejPassed);
 }
 
+const std::vector<gtsam::Matrix>&
+dmvio::PoseTransformationFactor::getCachedDerivatives(int slot, const PoseTransformation::PoseType& pose) const
+{
+    DerivativeCache& cache = derivativeCache[slot];
+    bool cacheable = poseTransformation->getDerivativeParameters(parameterBuffer);
+    if(cacheable && cache.valid && cache.pose == pose && cache.parameters.size() == parameterBuffer.size() &&
+       cache.parameters == parameterBuffer)
+    {
+        return cache.derivatives;
+    }
+    poseTransformation->precomputeForDerivatives();
+    cache.derivatives = poseTransformation->getAllDerivatives(pose, DerivativeDirection::RIGHT_TO_RIGHT);
+    cache.pose = pose;
+    cache.parameters = parameterBuffer;
+    cache.valid = cacheable;
+    return cache.derivatives;
+}
+
+boost::shared_ptr<gtsam::GaussianFactor> dmvio::PoseTransformationFactor::linearizeIMU(const gtsam::Values& c) const
+{
+    // Same as NoiseModelFactor::linearize, but on the transformed poses.
+    gtsam::Vector b = -evaluateIMUError(c, true);
+    imuNoise->WhitenSystem(childJacobians, b);
+
+    auto&& optimizedSymbols = poseTransformation->getAllOptimizedSymbols();
+    if(fej)
+    {
+        // Avoid building new values if all optimized symbols have FEJ values (which is the normal case).
+        bool allInFEJ = std::all_of(optimizedSymbols.begin(), optimizedSymbols.end(), [this](gtsam::Key key)
+        { return fej->fejValues.exists(key); });
+        if(allInFEJ)
+        {
+            poseTransformation->updateWithValues(fej->fejValues);
+        }else
+        {
+            poseTransformation->updateWithValues(fej->buildValues(optimizedSymbols, c));
+        }
+    }
+
+    // Terms are ordered like keys_: non-fixed child keys followed by the optimized symbols.
+    std::vector<std::pair<gtsam::Key, gtsam::Matrix> > terms(keys_.size());
+    int i = 0;
+    int firstOptPos = keys_.size() - optimizedSymbols.size();
+    const gtsam::KeyVector& childKeys = factor->keys();
+    for(int k = 0; k < 5; ++k)
+    {
+        gtsam::Key key = childKeys[k];
+        bool fixed = fixedKeySet.find(key) != fixedKeySet.end();
+        const gtsam::Matrix& A = childJacobians[k];
+        if(k == 0 || k == 2)
+        {
+            gtsam::Pose3 pose;
+            if(fixed)
+            {
+                pose = fixedValues.at<gtsam::Pose3>(key);
+            }else if(fej && fej->fejValues.exists(key))
+            {
+                pose = fej->fejValues.at<gtsam::Pose3>(key);
+            }else
+            {
+                pose = c.at<gtsam::Pose3>(key);
+            }
+            const std::vector<gtsam::Matrix>& derivatives = getCachedDerivatives(k / 2, pose.matrix());
+
+            if(!fixed)
+            {
+                terms[i].first = key;
+                terms[i].second = A * derivatives[0];
+                i++;
+            }
+            for(int j = 0; j < optimizedSymbols.size(); ++j)
+            {
+                auto& term = terms[firstOptPos + j];
+                if(k == 0)
+                {
+                    term.first = optimizedSymbols[j];
+                    term.second = A * derivatives[j + 1];
+                }else
+                {
+                    term.second += A * derivatives[j + 1];
+                }
+            }
+        }else if(!fixed)
+        {
+            terms[i].first = key;
+            terms[i].second = A;
+            i++;
+        }
+    }
+
+    return boost::shared_ptr<gtsam::GaussianFactor>(new gtsam::JacobianFactor(terms, b));
+}
+
 boost::shared_ptr<gtsam::GaussianFactor> dmvio::PoseTransformationFactor::linearize(const gtsam::Values& c) const
 {
+    if(imuChild)
+    {
+        return linearizeIMU(c);
+    }
+
     // First convert FEJValues for child factor.
     if(childFej)
     {
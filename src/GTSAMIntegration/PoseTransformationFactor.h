@@ -29,6 +29,11 @@
 #include "util/SettingsUtil.h"
 #include "FEJValues.h"
 
+namespace gtsam
+{
+class ImuFactor;
+}
+
 namespace dmvio
 {
 
@@ -40,6 +45,9 @@ namespace dmvio
 // The factor will also apply First-Estimates Jacobians if setFEJMapForGraph has been called for the graph before optimization.
 // Note that the child factor must not optimize any of the additional symbols optimized by the PoseTransformation.
 // Assumes that all (but only) poses use the symbol 'p'
+// If the child is a gtsam::ImuFactor (the case in production) a fast path is used, which evaluates the child directly
+// on the transformed poses instead of building converted gtsam::Values, and caches the transform derivatives per
+// evaluation point (they stay constant over the LM iterations when FEJ is used).
 class PoseTransformationFactor : public gtsam::NonlinearFactor, public FactorHandlingFEJ
 {
 public:
@@ -81,12 +89,25 @@ public:
 
     void setFEJValues(std::shared_ptr<FEJValues> fej) override;
 
+    const gtsam::NonlinearFactor::shared_ptr& getChildFactor() const
+    { return factor; }
+
     gtsam::Values fixedValues;
 private:
     // convert the values using the PoseTransformation
     // The resulting values will only contain values for the symbols optimized by the child factor, or the TransformationFactor.
     gtsam::Values convertValues(const gtsam::Values& c) const;
 
+    void initIMUFastPath();
+    // Updates the poseTransformation and evaluates the ImuFactor child, optionally writing its Jacobians to childJacobians.
+    gtsam::Vector evaluateIMUError(const gtsam::Values& c, bool computeJacobians) const;
+    boost::shared_ptr<gtsam::GaussianFactor> linearizeIMU(const gtsam::Values& c) const;
+    // Returns the derivatives of the poseTransformation (RIGHT_TO_RIGHT), reusing them if nothing has changed since
+    // the last call with the same slot.
+    const std::vector<gtsam::Matrix>& getCachedDerivatives(int slot, const PoseTransformation::PoseType& pose) const;
+    // Returns the child value, taken from fixedValues for fixed keys.
+    template<typename T> T getChildValue(gtsam::Key key, const gtsam::Values& c) const;
+
 
     gtsam::NonlinearFactor::shared_ptr factor; // child factor.
 
@@ -101,6 +122,21 @@ private:
 
     std::shared_ptr<FEJValues> fej;
     std::shared_ptr<FEJValues> childFej;
+
+    // Fast path for gtsam::ImuFactor children (nullptr otherwise).
+    const gtsam::ImuFactor* imuChild = nullptr;
+    gtsam::noiseModel::Gaussian::shared_ptr imuNoise;
+    mutable std::vector<gtsam::Matrix> childJacobians;
+
+    struct DerivativeCache
+    {
+        bool valid = false;
+        PoseTransformation::PoseType pose;
+        Eigen::VectorXd parameters;
+        std::vector<gtsam::Matrix> derivatives;
+    };
+    mutable DerivativeCache derivativeCache[2]; // One for each pose of the ImuFactor.
+    mutable Eigen::VectorXd parameterBuffer;
 };
 std::ostream& operator<<(std::ostream& os, dmvio::PoseTransformationFactor::ConversionType& conversion);
 std::istream& operator>>(std::istream& is, dmvio::PoseTransformationFactor::ConversionType& conversion);
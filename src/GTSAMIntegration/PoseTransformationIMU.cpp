@@ -247,6 +247,21 @@ void TransformDSOToIMU::updateWithValues(const gtsam::Values& values)
     }
 }
 
+bool TransformDSOToIMU::getDerivativeParameters(Eigen::VectorXd& params) const
+{
+    // Scale, gravity direction, extrinsics, and which of them are optimized (which changes the returned derivatives).
+    params.resize(25);
+    params[0] = T_S_DSO.scale();
+    Eigen::Matrix3d rotation = R_dsoW_metricW.matrix();
+    Eigen::Matrix<double, 3, 4> extrinsics = T_cam_imu.matrix3x4();
+    params.segment<9>(1) = Eigen::Map<Eigen::Matrix<double, 9, 1>>(rotation.data());
+    params.segment<12>(10) = Eigen::Map<Eigen::Matrix<double, 12, 1>>(extrinsics.data());
+    params[22] = *optScale;
+    params[23] = *optGravity;
+    params[24] = *optT_cam_imu;
+    return true;
+}
+
 void TransformDSOToIMU::setScale(double variable)
 {
     precomputedValid = false;
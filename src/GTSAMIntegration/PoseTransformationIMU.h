@@ -75,6 +75,7 @@ public:
     std::vector<gtsam::Key> getAllOptimizedSymbols() const override;
     // Updated all optimized symbols using the value in values (if available).
     void updateWithValues(const gtsam::Values& values) override;
+    bool getDerivativeParameters(Eigen::VectorXd& params) const override;
 
     // Setters and getters.
     // --------------------------------------------------
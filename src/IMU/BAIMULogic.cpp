@@ -798,6 +798,38 @@ bool BAIMULogic::isScaleFixed() const
     return scaleFixed;
 }
 
+void BAIMULogic::fillCheckpoint(IMUCheckpoint& checkpoint) const
+{
+    checkpoint.firstFrameId = firstFrameId;
+    checkpoint.noIMUInOrderingUntilKFId = noIMUInOrderingUntilKFId;
+    checkpoint.previousKeyframeId = previousKeyframeId;
+    checkpoint.firstBATimestamp = firstBATimestamp;
+    checkpoint.scaleFixed = scaleFixed;
+    checkpoint.optimizeScale = optimizeScale;
+    checkpoint.optimizeGravity = optimizeGravity;
+    checkpoint.optimizeIMUExtrinsics = optimizeIMUExtrinsics;
+    checkpoint.optimizeTransform = optimizeTransform;
+    checkpoint.factorForCoarseGraph =
+            factorForCoarseGraph ? linearFactorToCheckpoint(*factorForCoarseGraph) : LinearFactorCheckpoint();
+}
+
+void BAIMULogic::restoreFromCheckpoint(const IMUCheckpoint& checkpoint)
+{
+    firstFrameId = checkpoint.firstFrameId;
+    noIMUInOrderingUntilKFId = checkpoint.noIMUInOrderingUntilKFId;
+    previousKeyframeId = currKeyframeId = checkpoint.previousKeyframeId;
+    firstBATimestamp = checkpoint.firstBATimestamp;
+    scaleFixed = checkpoint.scaleFixed;
+    optimizeScale = checkpoint.optimizeScale;
+    optimizeGravity = checkpoint.optimizeGravity;
+    optimizeIMUExtrinsics = checkpoint.optimizeIMUExtrinsics;
+    optimizeTransform = checkpoint.optimizeTransform;
+    factorForCoarseGraph = linearFactorFromCheckpoint(checkpoint.factorForCoarseGraph);
+
+    maxScaleInterval = 0.0;
+    minScaleInterval = 1000.0;
+}
+
 double BAIMULogic::computeDynamicDSOWeight(double lastDSOEnergy, double lastRMSE, bool coarseTrackingWasGood)
 {
     // Compute dynamic photometric weight. Basically a threshold robust cost function.
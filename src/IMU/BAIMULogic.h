@@ -132,6 +132,11 @@ public:
 
     bool isScaleFixed() const;
 
+    // Store / restore the state for checkpoints. Must be called after finishKeyframeOptimization for the newest KF.
+    // After restoring, the BA values have to be restored before calling finishKeyframeOptimization.
+    void fillCheckpoint(IMUCheckpoint& checkpoint) const;
+    void restoreFromCheckpoint(const IMUCheckpoint& checkpoint);
+
     double computeDynamicDSOWeight(double lastDSOEnergy, double lastRMSE, bool coarseTrackingWasGood);
 
 private:
@@ -204,6 +204,9 @@ Sophus::SE3d dmvio::CoarseIMULogic::addIMUData(const dmvio::IMUData& imuData, in
         }
     }
 
+    predictedValues = *coarseValues;
+    predictedGraphSize = coarseGraph->size();
+
     // The returned prediction will be used as an initialization for the coarse direct image alignment.
     return referenceToFrame;
 }
@@ -423,6 +426,46 @@ void dmvio::CoarseIMULogic::addVisualToCoarseGraph(const dso::Mat88& H, const ds
     coarseGraph->add(lcf);
 }
 
+bool dmvio::CoarseIMULogic::getPredictedRelativeCovariance(gtsam::Matrix6& covOut)
+{
+    dmvio::TimeMeasurement timeMeasurement("getPredictedRelativeCovariance");
+    if(!coarseValues || !coarseValues->exists(currentPoseKey) || !coarseValues->exists(refPoseKey)) return false;
+
+    // coarseOrdering starts with the reference and the current pose, so their joint covariance is the inverse of the
+    // Schur complement of the remaining variables in the Hessian (no need for a full gtsam::Marginals).
+    gtsam::GaussianFactorGraph::shared_ptr gfg = coarseGraph->linearize(*coarseValues);
+    gtsam::Matrix H = gfg->hessian(coarseOrdering).first;
+    if(H.rows() < 12) return false;
+    int numOther = H.rows() - 12;
+    gtsam::Matrix Hpp = H.topLeftCorner(12, 12);
+    if(numOther > 0)
+    {
+        Eigen::LDLT<gtsam::Matrix> otherLDLT(H.bottomRightCorner(numOther, numOther));
+        if(otherLDLT.info() != Eigen::Success) return false;
+        Hpp -= H.topRightCorner(12, numOther) * otherLDLT.solve(H.bottomLeftCorner(numOther, 12));
+    }
+    Eigen::LDLT<Eigen::Matrix<double, 12, 12>> posesLDLT(Hpp);
+    if(posesLDLT.info() != Eigen::Success) return false;
+    Eigen::Matrix<double, 12, 12> joint = posesLDLT.solve(Eigen::Matrix<double, 12, 12>::Identity());
+    gtsam::Matrix6 covRef = joint.topLeftCorner<6, 6>();
+    gtsam::Matrix6 covCurrent = joint.bottomRightCorner<6, 6>();
+    gtsam::Matrix6 covCurrentRef = joint.bottomLeftCorner<6, 6>();
+
+    // relPose = ref^-1 * current, so its tangent is approximately deltaCurrent - Ad(relPose^-1) * deltaRef.
+    gtsam::Pose3 relPose = coarseValues->at<gtsam::Pose3>(refPoseKey).between(
+            coarseValues->at<gtsam::Pose3>(currentPoseKey));
+    gtsam::Matrix6 A = relPose.inverse().AdjointMap();
+    gtsam::Matrix6 crossCov = covCurrentRef * A.transpose();
+    covOut = covCurrent + A * covRef * A.transpose() - crossCov - crossCov.transpose();
+    return covOut.allFinite();
+}
+
+void dmvio::CoarseIMULogic::resetToPrediction()
+{
+    coarseValues.reset(new gtsam::Values(predictedValues));
+    coarseGraph->resize(predictedGraphSize);
+}
+
 gtsam::imuBias::ConstantBias dmvio::CoarseIMULogic::getBias(int frameId)
 {
     gtsam::imuBias::ConstantBias currentBias;
@@ -443,6 +486,16 @@ gtsam::Vector3 dmvio::CoarseIMULogic::getVelocity(int frameId)
     return velocity;
 }
 
+Sophus::SE3d dmvio::CoarseIMULogic::getIMUToWorld(int frameId)
+{
+    return Sophus::SE3d(coarseValues->at<gtsam::Pose3>(gtsam::Symbol('p', frameId)).matrix());
+}
+
+bool dmvio::CoarseIMULogic::hasState(int frameId) const
+{
+    return coarseValues && coarseValues->exists(gtsam::Symbol('p', frameId));
+}
+
 
 void dmvio::CoarseIMULogic::printCoarseBiases(const dmvio::GTData* gtData, int frameId)
 {
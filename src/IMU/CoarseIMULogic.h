@@ -81,10 +81,19 @@ public:
     // Add linearized visual factor to the coarse graph.
     void addVisualToCoarseGraph(const dso::Mat88& H, const dso::Vec8& b, bool trackingIsGood);
 
+    // Covariance of the predicted pose of the current frame relative to the reference frame (metric, IMU frame,
+    // first rotation then translation). Returns false if it cannot be computed.
+    bool getPredictedRelativeCovariance(gtsam::Matrix6& covOut);
+
+    // Undo a coarse tracking attempt: reset the values and graph to the state after the last addIMUData.
+    void resetToPrediction();
+
 
     Sophus::SE3d getCoarseKFPose();
     gtsam::imuBias::ConstantBias getBias(int frameId);
     gtsam::Vector3 getVelocity(int frameId);
+    Sophus::SE3d getIMUToWorld(int frameId);
+    bool hasState(int frameId) const; // True if pose, velocity and bias of the frame are in the coarse graph.
     void printCoarseBiases(const dmvio::GTData* gtData, int frameId);
     double getScale() const;
 
@@ -108,6 +117,10 @@ private:
     gtsam::Ordering coarseOrdering;
     gtsam::Values::shared_ptr newCoarseValues;
 
+    // State directly after addIMUData (used by resetToPrediction).
+    gtsam::Values predictedValues;
+    size_t predictedGraphSize = 0;
+
     int currentKeyframeId = -1;
     double currCoarseTimestamp;
     bool firstCoarseInit = true;
@@ -33,6 +33,7 @@
 #include "GTSAMIntegration/ExtUtils.h"
 #include "IMUUtils.h"
 #include "GTSAMIntegration/DelayedMarginalization.h"
+#include "IMUInitialization/IMUInitializerStates.h"
 
 using namespace dmvio;
 using std::cout;
@@ -42,6 +43,36 @@ IMUIntegration::IMUIntegration(dso::CalibHessian* HCalib, const IMUCalibration&
                                IMUSettings& imuSettingsPassed, bool linearizeOperationPassed)
         : linearizeOperation(linearizeOperationPassed), preparedKeyframe(-1), preparedKFCreated(false),
           imuCalibration(imuCalibrationPassed), imuSettings(imuSettingsPassed)
+{
+    createComponents(HCalib);
+}
+
+void IMUIntegration::reset(dso::CalibHessian* HCalib)
+{
+    // The initializer and the logic classes reference the BAGTSAMIntegration and this, so they are destroyed first.
+    imuInitializer.reset();
+    coarseLogic.reset();
+    baLogic.reset();
+    baGTSAMIntegration.reset();
+
+    preintegratedBA.reset();
+    preintegratedBACurr.reset();
+    preintegratedForNextCoarse.reset();
+    preparedKeyframe = -1;
+    preparedCoarseVel.setZero();
+    preparedKFCreated = false;
+    imuDataPreintegrated = false;
+    lastIMUData.clear();
+    latestBias = gtsam::imuBias::ConstantBias();
+    informationBAToCoarse.reset();
+    baInitialized = false;
+    coarseInitialized = false;
+    initializedBeforePostOptimization = false;
+
+    createComponents(HCalib);
+}
+
+void IMUIntegration::createComponents(dso::CalibHessian* HCalib)
 {
     // Create preintegrationParams
     double accelVar = imuCalibration.accel_sigma * imuCalibration.accel_sigma;
@@ -49,7 +80,7 @@ IMUIntegration::IMUIntegration(dso::CalibHessian* HCalib, const IMUCalibration&
     double integrationVar = imuCalibration.integration_sigma * imuCalibration.integration_sigma;
 
     // --------------------------------------------------
-    preintegrationParams.reset(new gtsam::PreintegrationParams(imuCalibrationPassed.gravity));
+    preintegrationParams.reset(new gtsam::PreintegrationParams(imuCalibration.gravity));
     preintegrationParams->setIntegrationCovariance(integrationVar * Eigen::Matrix3d::Identity());
     preintegrationParams->setAccelerometerCovariance(accelVar * Eigen::Matrix3d::Identity());
     preintegrationParams->setGyroscopeCovariance(gyroVar * Eigen::Matrix3d::Identity());
@@ -210,6 +241,18 @@ void IMUIntegration::addVisualToCoarseGraph(const dso::Mat88& H, const dso::Vec8
     coarseLogic->addVisualToCoarseGraph(H, b, trackingIsGood);
 }
 
+bool IMUIntegration::getCoarsePredictionCovariance(gtsam::Matrix6& covOut)
+{
+    if(!isCoarseInitialized()) return false;
+    return coarseLogic->getPredictedRelativeCovariance(covOut);
+}
+
+void IMUIntegration::resetCoarseToPrediction()
+{
+    if(!isCoarseInitialized()) return;
+    coarseLogic->resetToPrediction();
+}
+
 void IMUIntegration::setGTData(dmvio::GTData* gtData, int frameId)
 {
     dmvio::TimeMeasurement timeMeasurement("printBiases");
@@ -380,6 +423,18 @@ void IMUIntegration::finishCoarseTracking(const dso::FrameShell& frameShell, boo
     }
 }
 
+bool IMUIntegration::getCoarseIMUState(const dso::FrameShell& frameShell, IMUState& stateOut)
+{
+    if(!isCoarseInitialized() || !coarseLogic->hasState(frameShell.id)) return false;
+    stateOut.timestamp = frameShell.timestamp;
+    stateOut.imuToWorld = coarseLogic->getIMUToWorld(frameShell.id);
+    stateOut.velocity = coarseLogic->getVelocity(frameShell.id);
+    gtsam::imuBias::ConstantBias bias = coarseLogic->getBias(frameShell.id);
+    stateOut.accBias = bias.accelerometer();
+    stateOut.gyrBias = bias.gyroscope();
+    return true;
+}
+
 bool IMUIntegration::isCoarseInitialized()
 {
     return coarseInitialized;
@@ -393,4 +448,40 @@ void IMUIntegration::resetBAPreintegration()
 double IMUIntegration::getCoarseScale()
 {
     return coarseLogic->getScale();
-}
\ No newline at end of file
+}
+
+void IMUIntegration::fillCheckpoint(SystemCheckpoint& checkpoint) const
+{
+    checkpoint.hasIMU = true;
+    baGTSAMIntegration->fillCheckpoint(checkpoint.ba);
+    baLogic->fillCheckpoint(checkpoint.imu);
+}
+
+void IMUIntegration::restoreFromCheckpoint(const SystemCheckpoint& checkpoint, std::vector<dso::EFFrame*>& frames,
+                                           int lastKeyframeId)
+{
+    if(!baInitialized)
+    {
+        baGTSAMIntegration->addExtension(baLogic);
+    }
+    baInitialized = true;
+    coarseInitialized = true;
+    initializedBeforePostOptimization = true;
+
+    // The flags of the BAIMULogic are needed for the BA ordering, so restore them first.
+    baLogic->restoreFromCheckpoint(checkpoint.imu);
+    baGTSAMIntegration->restoreFromCheckpoint(checkpoint.ba, frames);
+    baLogic->getTransformDSOToIMU()->updateWithValues(*baGTSAMIntegration->getBaValues());
+
+    informationBAToCoarse = baLogic->finishKeyframeOptimization(lastKeyframeId);
+    latestBias = informationBAToCoarse->latestBABias;
+
+    imuInitializer->lockAndSetState(std::make_unique<InactiveIMUInitializerState>());
+
+    // Behave as if lastKeyframeId was just created, so that the next coarse tracking reference is initialized.
+    preparedKeyframe = lastKeyframeId;
+    preparedKFCreated = true;
+    preintegratedForNextCoarse.reset(new gtsam::PreintegratedImuMeasurements(preintegrationParams, latestBias));
+    imuDataPreintegrated = false;
+    preintegratedBACurr->resetIntegrationAndSetBias(latestBias);
+}
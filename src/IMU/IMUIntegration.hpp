@@ -52,6 +52,7 @@
 #include <dso/util/FrameShell.h>
 
 #include "CoarseIMULogic.h"
+#include "IMUPropagator.h"
 #include "IMUInitialization/IMUInitializer.h"
 
 namespace dmvio
@@ -73,6 +74,10 @@ public:
 
     ~IMUIntegration();
 
+    // Returns to the state after construction (with the same calibration and settings). The object stays at the same
+    // address, so references to it (e.g. in the CoarseTrackers) remain valid.
+    void reset(dso::CalibHessian* HCalib);
+
     // Return true if the CoarseTracking logic is initialized.
     bool isCoarseInitialized();
 
@@ -111,9 +116,19 @@ public:
 
     void addVisualToCoarseGraph(const dso::Mat88& H, const dso::Vec8& b, bool trackingIsGood);
 
+    // Covariance of the IMU prediction for the current frame relative to the tracking reference (metric, first
+    // rotation then translation). Returns false if not available.
+    bool getCoarsePredictionCovariance(gtsam::Matrix6& covOut);
+
+    // Reset the coarse graph to the IMU prediction, so that the coarse tracking can be repeated.
+    void resetCoarseToPrediction();
+
     // Returns the pose of the current keyframe as computed by the coarse tracking as a gtsam Pose (imu to world)
     Sophus::SE3d getCoarseKFPose();
 
+    // Get the metric IMU state of a frame estimated by the coarse tracking. Returns false if it is not available.
+    bool getCoarseIMUState(const dso::FrameShell& frameShell, IMUState& stateOut);
+
     // Called when DSO finishes coarse tracking.
     void finishCoarseTracking(const dso::FrameShell& frameShell, bool willBecomeKeyframe);
 
@@ -167,7 +182,17 @@ public:
     // Get the scale of TransformDSOToIMU used for the coarse tracking currently (can be called from any thread).
     double getCoarseScale();
 
+    // Store the BA and IMU state in the checkpoint. Called from the BA thread after finishKeyframeOperations.
+    void fillCheckpoint(SystemCheckpoint& checkpoint) const;
+    // Restores the system in visual-inertial mode. The DSO frames must already be inserted into the energy
+    // functional. The IMU initializer is deactivated as the restored state is already initialized.
+    void restoreFromCheckpoint(const SystemCheckpoint& checkpoint, std::vector<dso::EFFrame*>& frames,
+                               int lastKeyframeId);
+
 private:
+    // Creates the BA integration, the logic classes and the IMU initializer. Called by the constructor and reset.
+    void createComponents(dso::CalibHessian* HCalib);
+
     IMUCalibration imuCalibration;
     IMUSettings& imuSettings;
 
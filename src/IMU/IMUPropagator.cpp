@@ -0,0 +1,96 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "IMUPropagator.h"
+
+dmvio::IMUPropagator::IMUPropagator(const Eigen::Vector3d& gravity)
+        : gravity(gravity)
+{}
+
+void dmvio::IMUPropagator::addIMUData(double timestamp, const Eigen::Vector3d& accData,
+                                      const Eigen::Vector3d& gyrData)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    Measurement measurement{timestamp, accData, gyrData};
+    buffer.push_back(measurement);
+    if(buffer.size() > maxBufferSize)
+    {
+        buffer.pop_front();
+    }
+
+    if(!anchored || timestamp <= current.timestamp) return;
+
+    integrate(measurement);
+
+    for(dso::IOWrap::Output3DWrapper* ow : outputWrapper)
+    {
+        ow->publishIMURatePose(current);
+    }
+}
+
+void dmvio::IMUPropagator::reanchor(const dmvio::IMUState& trackedState)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    current = trackedState;
+    anchored = true;
+
+    // Older measurements are not needed anymore.
+    while(!buffer.empty() && buffer.front().timestamp <= trackedState.timestamp)
+    {
+        buffer.pop_front();
+    }
+    // Catch up with the IMU data which has arrived while the frame was tracked.
+    for(auto&& measurement : buffer)
+    {
+        integrate(measurement);
+    }
+}
+
+void dmvio::IMUPropagator::reset()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    anchored = false;
+}
+
+bool dmvio::IMUPropagator::getCurrentState(dmvio::IMUState& stateOut)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    stateOut = current;
+    return anchored;
+}
+
+void dmvio::IMUPropagator::setOutputWrapper(std::vector<dso::IOWrap::Output3DWrapper*> wrappers)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    outputWrapper = std::move(wrappers);
+}
+
+void dmvio::IMUPropagator::integrate(const Measurement& measurement)
+{
+    double dt = measurement.timestamp - current.timestamp;
+    Eigen::Vector3d acc = current.imuToWorld.so3() * (measurement.accData - current.accBias) + gravity;
+
+    current.imuToWorld.translation() += current.velocity * dt + 0.5 * acc * dt * dt;
+    current.velocity += acc * dt;
+    current.imuToWorld.so3() = current.imuToWorld.so3() * Sophus::SO3d::exp((measurement.gyrData - current.gyrBias) * dt);
+    current.timestamp = measurement.timestamp;
+}
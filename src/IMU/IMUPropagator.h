@@ -0,0 +1,100 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DMVIO_IMUPROPAGATOR_H
+#define DMVIO_IMUPROPAGATOR_H
+
+#include <Eigen/Core>
+#include <sophus/se3.hpp>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "dso/IOWrapper/Output3DWrapper.h"
+
+namespace dmvio
+{
+
+// State of the IMU in the metric world frame (the frame used by the IMU integration, with gravity along -z).
+class IMUState
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    double timestamp = 0.0;
+    Sophus::SE3d imuToWorld;
+    Eigen::Vector3d velocity = Eigen::Vector3d::Zero();
+    Eigen::Vector3d accBias = Eigen::Vector3d::Zero();
+    Eigen::Vector3d gyrBias = Eigen::Vector3d::Zero();
+};
+
+// Provides a low-latency pose stream at IMU rate: The state of the last tracked frame is forward-propagated with each
+// new IMU measurement and published with Output3DWrapper::publishIMURatePose.
+// Whenever a new frame has been tracked the propagation is re-anchored at its state and the buffered IMU measurements
+// newer than the frame are integrated again.
+// All methods are thread-safe (IMU data usually arrives in a different thread than the tracking results).
+class IMUPropagator
+{
+public:
+    // gravity in the metric world frame (see IMUCalibration::gravity).
+    explicit IMUPropagator(const Eigen::Vector3d& gravity);
+
+    // Called for each new IMU measurement (timestamps must be increasing).
+    void addIMUData(double timestamp, const Eigen::Vector3d& accData, const Eigen::Vector3d& gyrData);
+
+    // Called with the state of a newly tracked frame.
+    void reanchor(const IMUState& trackedState);
+
+    // Stop publishing until the next call to reanchor (e.g. after a full reset).
+    void reset();
+
+    // Returns false if there is no anchor yet.
+    bool getCurrentState(IMUState& stateOut);
+
+    // Set the wrappers to publish the propagated states to.
+    void setOutputWrapper(std::vector<dso::IOWrap::Output3DWrapper*> wrappers);
+
+private:
+    struct Measurement
+    {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+        double timestamp;
+        Eigen::Vector3d accData;
+        Eigen::Vector3d gyrData;
+    };
+
+    // Integrate measurement into current state.
+    void integrate(const Measurement& measurement);
+
+    std::mutex mutex;
+    Eigen::Vector3d gravity;
+    std::vector<dso::IOWrap::Output3DWrapper*> outputWrapper;
+
+    bool anchored = false;
+    IMUState current;
+
+    // Measurements newer than the anchor, used for re-integration when the next anchor arrives.
+    std::deque<Measurement, Eigen::aligned_allocator<Measurement>> buffer;
+    static constexpr int maxBufferSize = 2000;
+};
+
+}
+
+#endif //DMVIO_IMUPROPAGATOR_H
@@ -29,6 +29,7 @@
 #include "GTSAMIntegration/ExtUtils.h"
 #include "dso/util/FrameShell.h"
 #include "GTSAMIntegration/GTSAMUtils.h"
+#include "util/TimeMeasurement.h"
 
 using namespace dmvio;
 using namespace gtsam;
@@ -157,37 +158,59 @@ void dmvio::CoarseIMUInitOptimizer::addPose(int frameId, const Sophus::SE3d& cam
     prevFramePose = framePose;
 }
 
-dmvio::CoarseIMUInitOptimizer::OptimizationResult dmvio::CoarseIMUInitOptimizer::optimize()
+void CoarseIMUInitOptimizer::updatePosesFromDSO()
 {
-    if(settings.updatePoses)
+    // Get the newest poses from DSO.
+    boost::unique_lock<boost::mutex> lock(dso::FrameShell::shellPoseMutex);
+    for(auto&& factor : graph)
     {
-        // Get the newest poses from DSO.
-        boost::unique_lock<boost::mutex> lock(dso::FrameShell::shellPoseMutex);
-        for(auto&& factor : graph)
+        PoseTransformationFactor* casted = dynamic_cast<PoseTransformationFactor*>(factor.get());
+        if(casted)
         {
-            PoseTransformationFactor* casted = dynamic_cast<PoseTransformationFactor*>(factor.get());
-            if(casted)
+            auto&& keys = casted->fixedValues.keys();
+            for(auto&& key : keys)
             {
-                auto&& keys = casted->fixedValues.keys();
-                for(auto&& key : keys)
+                gtsam::Symbol sym(key);
+                if(sym.chr() == 'p')
                 {
-                    gtsam::Symbol sym(key);
-                    if(sym.chr() == 'p')
+                    const auto* shell = activeShells.at(sym.index());
+                    // compute updated camToWorld
+                    Sophus::SE3d camToWorld = shell->camToWorld;
+                    if(shell->keyframeId == -1)
                     {
-                        const auto* shell = activeShells.at(sym.index());
-                        // compute updated camToWorld
-                        Sophus::SE3d camToWorld = shell->camToWorld;
-                        if(shell->keyframeId == -1)
-                        {
-                            camToWorld = shell->trackingRef->camToWorld * shell->camToTrackingRef;
-                        }
-                        assert(sym.index() == shell->id);
-                        eraseAndInsert(casted->fixedValues, key, gtsam::Pose3(camToWorld.inverse().matrix()));
+                        camToWorld = shell->trackingRef->camToWorld * shell->camToTrackingRef;
                     }
+                    assert(sym.index() == shell->id);
+                    eraseAndInsert(casted->fixedValues, key, gtsam::Pose3(camToWorld.inverse().matrix()));
                 }
             }
         }
     }
+}
+
+dmvio::CoarseIMUInitOptimizer::OptimizationResult
+dmvio::CoarseIMUInitOptimizer::optimize(double skipRefinementThreshold)
+{
+    if(settings.updatePoses)
+    {
+        updatePosesFromDSO();
+    }
+
+    double linearScaleVariance = -1.0;
+    if(settings.linearWarmStart && linearInitialization(linearScaleVariance))
+    {
+        if(linearScaleVariance < skipRefinementThreshold)
+        {
+            optimizedValues = values;
+            transformDSOToIMU->updateWithValues(optimizedValues);
+            double error = graph.error(optimizedValues);
+            double normalizedError = error / numFrames;
+            OptimizationResult result(0, error, normalizedError, checkError(error, normalizedError));
+            result.linearOnly = true;
+            result.linearScaleVariance = linearScaleVariance;
+            return result;
+        }
+    }
 
     LevenbergMarquardtOptimizer optimizer(graph, values, params);
     optimizedValues = optimizer.optimize();
@@ -195,18 +218,177 @@ dmvio::CoarseIMUInitOptimizer::OptimizationResult dmvio::CoarseIMUInitOptimizer:
     double error = optimizer.error();
     double normalizedError = error / numFrames;
 
-    bool good = true;
+    OptimizationResult result(optimizer.iterations(), error, normalizedError, checkError(error, normalizedError));
+    result.linearScaleVariance = linearScaleVariance;
+    return result;
+}
+
+bool CoarseIMUInitOptimizer::checkError(double error, double normalizedError)
+{
     // If error is too high we assume that odometry failed and request a full reset.
     if((settings.requestFullResetErrorThreshold > 0 && error > settings.requestFullResetErrorThreshold) ||
        (settings.requestFullResetNormalizedErrorThreshold > 0 &&
         normalizedError > settings.requestFullResetNormalizedErrorThreshold))
     {
         std::cout << "Large CoarseIMUInitializer error! Requesting full reset! " << normalizedError << std::endl;
-        good = false;
         dso::setting_fullResetRequested = true;
+        return false;
     }
+    return true;
+}
+
+bool CoarseIMUInitOptimizer::linearInitialization(double& scaleVariance)
+{
+    dmvio::TimeMeasurement meas("CoarseIMUInitLinear");
+    auto* transform = dynamic_cast<TransformDSOToIMU*>(transformDSOToIMU.get());
+    if(!transform || !transform->optimizeScale() || !transform->optimizeGravity()) return false;
+
+    const Sophus::SE3d& T_cam_imu = transform->getT_cam_imu();
+    Eigen::Matrix3d R_cam_imu = T_cam_imu.rotationMatrix();
+    Eigen::Vector3d t_cam_imu = T_cam_imu.translation();
 
-    return OptimizationResult(optimizer.iterations(), error, normalizedError, good);
+    // Collect IMU factors and velocity variables.
+    std::vector<std::pair<const PoseTransformationFactor*, const gtsam::ImuFactor*>> imuFactors;
+    std::map<gtsam::Key, int> velocityIndex;
+    for(auto&& factor : graph)
+    {
+        auto* casted = dynamic_cast<const PoseTransformationFactor*>(factor.get());
+        if(!casted) continue;
+        auto* imuFactor = dynamic_cast<const gtsam::ImuFactor*>(casted->getChildFactor().get());
+        if(!imuFactor) continue;
+        imuFactors.emplace_back(casted, imuFactor);
+        for(gtsam::Key key : {imuFactor->key2(), imuFactor->key4()})
+        {
+            if(velocityIndex.find(key) == velocityIndex.end())
+            {
+                int ind = velocityIndex.size();
+                velocityIndex[key] = ind;
+            }
+        }
+    }
+    if(imuFactors.size() < 3) return false;
+
+    auto getPose = [this](const PoseTransformationFactor* factor, gtsam::Key key)
+    {
+        const gtsam::Values& vals = factor->fixedValues.exists(key) ? factor->fixedValues : values;
+        // Poses are worldToCam, we need camToWorld.
+        return Sophus::SE3d(vals.at<gtsam::Pose3>(key).inverse().matrix());
+    };
+
+    // Unknowns: scale, gravity (in DSO world, metric), all velocities (in DSO world, metric).
+    // With R_i = R_w_cam_i * R_cam_imu the IMU position is p_i = s * c_i + R_w_cam_i * t_cam_imu, and the
+    // preintegrated measurements give:
+    //   s * (c_j - c_i) - v_i * dt - 0.5 * g * dt^2 = R_i * deltaP + R_w_cam_i * t_cam_imu - R_w_cam_j * t_cam_imu
+    //   v_j - v_i - g * dt = R_i * deltaV
+    int dim = 4 + 3 * velocityIndex.size();
+    Eigen::MatrixXd H = Eigen::MatrixXd::Zero(dim, dim);
+    Eigen::VectorXd b = Eigen::VectorXd::Zero(dim);
+    Eigen::Vector3d gravityMetric = Eigen::Vector3d::Zero();
+    for(auto&& pair : imuFactors)
+    {
+        const gtsam::ImuFactor& imuFactor = *pair.second;
+        const gtsam::PreintegratedImuMeasurements& pim = imuFactor.preintegratedMeasurements();
+        gravityMetric = pim.params()->n_gravity;
+        double dt = pim.deltaTij();
+
+        gtsam::imuBias::ConstantBias bias;
+        if(values.exists(imuFactor.key5()))
+        {
+            bias = values.at<gtsam::imuBias::ConstantBias>(imuFactor.key5());
+        }
+        // Predicting from the identity gives the bias corrected deltas plus the gravity terms.
+        gtsam::NavState predicted = pim.predict(gtsam::NavState(), bias);
+        Eigen::Vector3d deltaP = predicted.position() - 0.5 * gravityMetric * dt * dt;
+        Eigen::Vector3d deltaV = predicted.velocity() - gravityMetric * dt;
+
+        Sophus::SE3d camToWorldI = getPose(pair.first, imuFactor.key1());
+        Sophus::SE3d camToWorldJ = getPose(pair.first, imuFactor.key3());
+        Eigen::Matrix3d R_i = camToWorldI.rotationMatrix() * R_cam_imu;
+
+        // Local Jacobian for [s, g, v_i, v_j].
+        Eigen::Matrix<double, 6, 10> A = Eigen::Matrix<double, 6, 10>::Zero();
+        A.block<3, 1>(0, 0) = camToWorldJ.translation() - camToWorldI.translation();
+        A.block<3, 3>(0, 1) = -0.5 * dt * dt * Eigen::Matrix3d::Identity();
+        A.block<3, 3>(0, 4) = -dt * Eigen::Matrix3d::Identity();
+        A.block<3, 3>(3, 1) = -dt * Eigen::Matrix3d::Identity();
+        A.block<3, 3>(3, 4) = -Eigen::Matrix3d::Identity();
+        A.block<3, 3>(3, 7) = Eigen::Matrix3d::Identity();
+        Eigen::Matrix<double, 6, 1> r;
+        r.head<3>() = R_i * deltaP + camToWorldI.so3() * t_cam_imu - camToWorldJ.so3() * t_cam_imu;
+        r.tail<3>() = R_i * deltaV;
+
+        // Weight with the preintegration covariance (order rotation, position, velocity) rotated to the world.
+        Eigen::Matrix<double, 6, 6> rotation = Eigen::Matrix<double, 6, 6>::Zero();
+        rotation.block<3, 3>(0, 0) = R_i;
+        rotation.block<3, 3>(3, 3) = R_i;
+        Eigen::Matrix<double, 6, 6> covariance =
+                rotation * pim.preintMeasCov().bottomRightCorner<6, 6>() * rotation.transpose();
+        Eigen::Matrix<double, 6, 6> information = covariance.inverse();
+
+        Eigen::Matrix<double, 10, 10> HLocal = A.transpose() * information * A;
+        Eigen::Matrix<double, 10, 1> bLocal = A.transpose() * information * r;
+        int indices[10] = {0, 1, 2, 3};
+        int velI = 4 + 3 * velocityIndex.at(imuFactor.key2());
+        int velJ = 4 + 3 * velocityIndex.at(imuFactor.key4());
+        for(int k = 0; k < 3; ++k)
+        {
+            indices[4 + k] = velI + k;
+            indices[7 + k] = velJ + k;
+        }
+        for(int row = 0; row < 10; ++row)
+        {
+            b(indices[row]) += bLocal(row);
+            for(int col = 0; col < 10; ++col)
+            {
+                H(indices[row], indices[col]) += HLocal(row, col);
+            }
+        }
+    }
+
+    Eigen::LDLT<Eigen::MatrixXd> ldlt(H);
+    if(ldlt.info() != Eigen::Success || !ldlt.isPositive()) return false;
+    Eigen::Vector3d gravityDSO = ldlt.solve(b).segment<3>(1);
+    if(gravityDSO.norm() < 1e-6 || !gravityDSO.allFinite()) return false;
+
+    // Enforce the known gravity magnitude and solve again for scale and velocities.
+    gravityDSO = gravityDSO.normalized() * gravityMetric.norm();
+    int reducedDim = dim - 3;
+    Eigen::MatrixXd HReduced(reducedDim, reducedDim);
+    HReduced(0, 0) = H(0, 0);
+    HReduced.block(0, 1, 1, reducedDim - 1) = H.block(0, 4, 1, reducedDim - 1);
+    HReduced.block(1, 0, reducedDim - 1, 1) = H.block(4, 0, reducedDim - 1, 1);
+    HReduced.block(1, 1, reducedDim - 1, reducedDim - 1) = H.block(4, 4, reducedDim - 1, reducedDim - 1);
+    Eigen::VectorXd bReduced(reducedDim);
+    bReduced(0) = b(0) - H.block<1, 3>(0, 1) * gravityDSO;
+    bReduced.tail(reducedDim - 1) = b.tail(reducedDim - 1) - H.block(4, 1, reducedDim - 1, 3) * gravityDSO;
+
+    Eigen::LDLT<Eigen::MatrixXd> ldltReduced(HReduced);
+    if(ldltReduced.info() != Eigen::Success || !ldltReduced.isPositive()) return false;
+    Eigen::VectorXd x = ldltReduced.solve(bReduced);
+    double scale = x(0);
+    if(!(scale > 0.0)) return false;
+    // The variance is taken from the full system, as the gravity direction is estimated from the same data.
+    double linearScaleVariance = ldlt.solve(Eigen::VectorXd::Unit(dim, 0))(0);
+    // The ScaleGTSAM is optimized in log space.
+    scaleVariance = linearScaleVariance / (scale * scale);
+
+    // gravityDSO = R_dsoW_metricW * gravityMetric.
+    Eigen::Matrix3d R_dsoW_metricW = Eigen::Quaterniond::FromTwoVectors(gravityMetric, gravityDSO).toRotationMatrix();
+
+    int symInd = transform->getSymbolInd();
+    eraseAndInsert(values, gtsam::Symbol('s', symInd), ScaleGTSAM(scale));
+    eraseAndInsert(values, gtsam::Symbol('g', symInd), gtsam::Rot3(R_dsoW_metricW));
+    for(auto&& velocity : velocityIndex)
+    {
+        if(!values.exists(velocity.first)) continue;
+        // Velocities in GTSAM are in the metric world.
+        gtsam::Vector3 velocityMetric = R_dsoW_metricW.transpose() * x.segment<3>(1 + 3 * velocity.second);
+        eraseAndInsert(values, velocity.first, velocityMetric);
+    }
+    transformDSOToIMU->updateWithValues(values);
+    std::cout << "CoarseIMUInit linear solution: scale " << scale << " log-scale variance: " << scaleVariance
+              << std::endl;
+    return true;
 }
 
 std::shared_ptr<PoseTransformation> dmvio::CoarseIMUInitOptimizer::getUpdatedTransform()
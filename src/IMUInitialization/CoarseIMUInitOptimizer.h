@@ -67,9 +67,18 @@ public:
         double error;
         double normalizedError;
         bool good;
+        bool linearOnly = false; // True if the nonlinear optimization was skipped.
+        double linearScaleVariance = -1.0; // Variance of the log scale of the linear solution (if computed).
     };
 
-    OptimizationResult optimize();
+    // If the linear warm start succeeds with a scale variance below skipRefinementThreshold the nonlinear
+    // optimization is skipped.
+    OptimizationResult optimize(double skipRefinementThreshold = -1.0);
+
+    // Solves for scale, gravity direction and velocities in closed form from the IMU factors and current poses
+    // (keeping the bias fixed), and writes them to values. scaleVariance is the variance of the log scale.
+    // Returns false if the transform doesn't optimize scale and gravity, or the system is degenerate.
+    bool linearInitialization(double& scaleVariance);
     std::shared_ptr<PoseTransformation> getUpdatedTransform();
     gtsam::imuBias::ConstantBias getBias();
     gtsam::Key getBiasKey();
@@ -85,6 +94,8 @@ public:
     int imuFactorsRemovedUntil = -1;
 private:
     void handleFirstFrame(int frameId);
+    void updatePosesFromDSO();
+    bool checkError(double error, double normalizedError);
 
     const CoarseIMUInitOptimizerSettings& settings;
     const IMUCalibration& imuCalibration;
@@ -63,6 +63,9 @@ void CoarseIMUInitOptimizerSettings::registerArgs(dmvio::SettingsUtil& set, std:
 
     set.registerArg(prefix + "requestFullResetErrorThreshold", requestFullResetErrorThreshold);
     set.registerArg(prefix + "requestFullResetNormalizedErrorThreshold", requestFullResetNormalizedErrorThreshold);
+
+    set.registerArg(prefix + "linearWarmStart", linearWarmStart);
+    set.registerArg(prefix + "linearSkipRefinement", linearSkipRefinement);
 }
 
 void PGBASettings::registerArgs(dmvio::SettingsUtil& set, std::string prefix)
@@ -75,6 +78,10 @@ void PGBASettings::registerArgs(dmvio::SettingsUtil& set, std::string prefix)
 
     set.registerArg(prefix + "prepareGraphAddFactors", prepareGraphAddFactors);
     set.registerArg(prefix + "prepareGraphAddDelValues", prepareGraphAddDelValues);
+    set.registerArg(prefix + "printMemoryUsage", printMemoryUsage);
+    set.registerArg(prefix + "incremental", incremental);
+    set.registerArg(prefix + "incrementalIterations", incrementalIterations);
+    set.registerArg(prefix + "incrementalValidate", incrementalValidate);
 
     transformPriors.registerArgs(set, prefix);
 }
@@ -51,6 +51,13 @@ public:
 
     double requestFullResetErrorThreshold = -1; // if the error gets higher than this request a full reset.
     double requestFullResetNormalizedErrorThreshold = -1; // if the normalized error gets higher than this request a full reset.
+
+    // If true, scale, gravity direction and velocities are first solved in closed form (with the bias fixed) and used
+    // as the starting point of the nonlinear optimization.
+    bool linearWarmStart = false;
+    // If true, the nonlinear optimization is skipped when the scale variance of the linear solution is already below
+    // coarseScaleUncertaintyThresh.
+    bool linearSkipRefinement = false;
 };
 
 class PGBASettings
@@ -70,6 +77,16 @@ public:
     bool prepareGraphAddFactors = false;
     bool prepareGraphAddDelValues = false;
 
+    // Print the estimated memory used by the delayed graphs each time the PGBA graph is copied.
+    bool printMemoryUsage = false;
+
+    // If true, an iSAM2 instance is kept alive across PGBA optimizations and only the factors which changed since the
+    // last call are updated. Otherwise (default) each call runs a batch Levenberg-Marquardt optimization.
+    bool incremental = false;
+    int incrementalIterations = 3; // Number of iSAM2 updates per optimization.
+    // Additionally run the batch optimization, print both errors and use the batch result if it is better by more than 1%.
+    bool incrementalValidate = false;
+
     PoseTransformationFactor::ConversionType conversionType = PoseTransformationFactor::JACOBIAN_FACTOR;
     IMUTransformPriorSettings transformPriors;
 };
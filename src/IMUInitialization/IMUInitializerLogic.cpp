@@ -100,11 +100,19 @@ void dmvio::IMUInitializerLogic::addPose(const dso::FrameShell& shell, bool will
 dmvio::IMUInitVariances dmvio::IMUInitializerLogic::performCoarseIMUInit(double timestamp)
 {
     dmvio::TimeMeasurement optimTime("IMUInitOptimize");
-    CoarseIMUInitOptimizer::OptimizationResult result = coarseIMUOptimizer->optimize();
+    CoarseIMUInitOptimizer::OptimizationResult result = coarseIMUOptimizer->optimize(
+            settings.coarseInitSettings.linearSkipRefinement ? settings.coarseScaleUncertaintyThresh : -1.0);
     double time = optimTime.end();
 
     IMUInitVariances variances;
-    if(result.good)
+    if(result.good && result.linearOnly)
+    {
+        // The linear solution was certain enough, so no marginals are computed.
+        variances.indetermined = false;
+        variances.scaleVariance = result.linearScaleVariance;
+        std::cout << "CoarseIMUInit linear only, variance: " << variances.scaleVariance << " scale: "
+                  << transformDSOToIMU->getScale() << std::endl;
+    }else if(result.good)
     {
         gtsam::Marginals marginals = coarseIMUOptimizer->getMarginals();
         variances = IMUInitVariances(marginals, gtsam::Symbol('s', 0), coarseIMUOptimizer->getBiasKey());
@@ -21,6 +21,7 @@
 */
 
 #include "util/TimeMeasurement.h"
+#include "util/ThreadTopology.h"
 #include "IMUInitializerStates.h"
 #include "IMUInitializerLogic.h"
 #include "IMUInitializer.h"
@@ -130,6 +131,7 @@ dmvio::RealtimeCoarseIMUInitState::addPose(const dso::FrameShell& shell, bool wi
 
 void dmvio::RealtimeCoarseIMUInitState::threadRun()
 {
+    dmvio::ThreadTopology::applyToCurrentThread(THREAD_IMU_INIT);
     dmvio::TimeMeasurement timeMeasurement("RealtimeCoarseIMUInitState::threadRun");
     IMUInitVariances variances = logic.performCoarseIMUInit(optimizingTimestamp);
 
@@ -339,6 +341,7 @@ dmvio::RealtimePGBAState::postBAInit(int keyframeId, gtsam::NonlinearFactor::sha
 
 void RealtimePGBAState::threadRun()
 {
+    dmvio::ThreadTopology::applyToCurrentThread(THREAD_IMU_INIT);
     dmvio::TimeMeasurement meas("RealtimePGBAState::threadRun");
     std::pair<bool, IMUInitializerState::unique_ptr> newStatePair;
     std::unique_ptr<gtsam::Values> optimizedValues;
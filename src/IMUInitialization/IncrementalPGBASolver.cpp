@@ -0,0 +1,114 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "IncrementalPGBASolver.h"
+#include "util/TimeMeasurement.h"
+#include "dso/util/settings.h"
+#include <unordered_set>
+#include <iostream>
+
+using namespace dmvio;
+
+IncrementalPGBASolver::IncrementalPGBASolver(int numIterations)
+        : numIterations(numIterations)
+{}
+
+bool IncrementalPGBASolver::optimize(const gtsam::NonlinearFactorGraph& graph, const gtsam::Values& initialValues,
+                                     gtsam::Values& result)
+{
+    dmvio::TimeMeasurement meas("PGBAIncremental");
+    if(!isam)
+    {
+        gtsam::ISAM2Params params;
+        params.relinearizeThreshold = 0.01;
+        params.relinearizeSkip = 1;
+        params.findUnusedFactorSlots = true;
+        isam = std::make_unique<gtsam::ISAM2>(params);
+    }
+
+    // Find new and removed factors.
+    std::unordered_set<const gtsam::NonlinearFactor*> currentFactors;
+    gtsam::NonlinearFactorGraph newFactors;
+    for(auto&& factor : graph)
+    {
+        if(!factor) continue;
+        currentFactors.insert(factor.get());
+        if(factorIndices.find(factor.get()) == factorIndices.end())
+        {
+            newFactors.push_back(factor);
+        }
+    }
+    gtsam::FactorIndices removeIndices;
+    for(auto it = factorIndices.begin(); it != factorIndices.end();)
+    {
+        if(currentFactors.find(it->first) == currentFactors.end())
+        {
+            removeIndices.push_back(it->second);
+            it = factorIndices.erase(it);
+        }else
+        {
+            ++it;
+        }
+    }
+
+    gtsam::Values newValues;
+    for(auto&& key : newFactors.keys())
+    {
+        if(!isam->valueExists(key) && !newValues.exists(key))
+        {
+            newValues.insert(key, initialValues.at(key));
+        }
+    }
+
+    if(!dso::setting_debugout_runquiet)
+    {
+        std::cout << "PGBA incremental: adding " << newFactors.size() << " factors and " << newValues.size()
+                  << " variables, removing " << removeIndices.size() << " factors." << std::endl;
+    }
+
+    try
+    {
+        gtsam::ISAM2Result updateResult = isam->update(newFactors, newValues, removeIndices);
+        for(size_t i = 0; i < newFactors.size(); ++i)
+        {
+            factorIndices[newFactors[i].get()] = updateResult.newFactorsIndices[i];
+        }
+        // Further updates relinearize variables which moved more than the threshold.
+        for(int i = 1; i < numIterations; ++i)
+        {
+            isam->update();
+        }
+        result = isam->calculateEstimate();
+    }catch(gtsam::IndeterminantLinearSystemException& exc)
+    {
+        std::cout << "WARNING: PGBA incremental: indeterminant linear system, resetting." << std::endl;
+        reset();
+        return false;
+    }
+    return true;
+}
+
+void IncrementalPGBASolver::reset()
+{
+    isam.reset();
+    factorIndices.clear();
+}
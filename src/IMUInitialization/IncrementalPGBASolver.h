@@ -0,0 +1,58 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DMVIO_INCREMENTALPGBASOLVER_H
+#define DMVIO_INCREMENTALPGBASOLVER_H
+
+#include <gtsam/nonlinear/ISAM2.h>
+#include <unordered_map>
+#include <memory>
+
+namespace dmvio
+{
+
+// Keeps an iSAM2 instance alive across PGBA optimizations.
+// The passed graph is compared (by factor pointer) to the factors already in iSAM2, so only factors which were added
+// since the last call are inserted and the ones which disappeared are removed. Variables not used by any factor
+// anymore are removed by iSAM2 automatically.
+class IncrementalPGBASolver
+{
+public:
+    explicit IncrementalPGBASolver(int numIterations);
+
+    // Brings iSAM2 to the state of graph and optimizes it. Variables which are not in iSAM2 yet are initialized with
+    // initialValues, existing ones keep their previous estimate.
+    // Returns false (and resets the solver) if the linear system was indeterminant.
+    bool optimize(const gtsam::NonlinearFactorGraph& graph, const gtsam::Values& initialValues,
+                  gtsam::Values& result);
+
+    void reset();
+
+private:
+    int numIterations;
+    std::unique_ptr<gtsam::ISAM2> isam;
+    std::unordered_map<const gtsam::NonlinearFactor*, gtsam::FactorIndex> factorIndices;
+};
+
+}
+
+#endif //DMVIO_INCREMENTALPGBASOLVER_H
@@ -47,6 +47,10 @@ PoseGraphBundleAdjustment::PoseGraphBundleAdjustment(DelayedMarginalizationGraph
 {
     inputDelayedGraph = delayedMarginalization->addDelayedGraph(settings.delay,
                                                                 BAIMULogic::NO_IMU_GROUP); // This graph will only contain visual factors.
+    if(settings.incremental)
+    {
+        incrementalSolver = std::make_unique<IncrementalPGBASolver>(settings.incrementalIterations);
+    }
 }
 
 void PoseGraphBundleAdjustment::prepareOptimization()
@@ -54,6 +58,10 @@ void PoseGraphBundleAdjustment::prepareOptimization()
     // clone DelayedGraph
     delayedGraph = std::make_unique<DelayedGraph>(*inputDelayedGraph);
     disconnectedGraph = delayedMarginalization->addDisconnectedGraph(delayedGraph->getMaxGroupInGraph());
+    if(settings.printMemoryUsage)
+    {
+        delayedMarginalization->printMemoryUsage(std::cout, {delayedGraph.get()});
+    }
 }
 
 gtsam::Values dmvio::PoseGraphBundleAdjustment::optimize(gtsam::NonlinearFactor::shared_ptr activeDSOFactor,
@@ -85,20 +93,81 @@ gtsam::Values dmvio::PoseGraphBundleAdjustment::optimize(gtsam::NonlinearFactor:
     // Enable FEJ for this optimization.
     delayedGraph->setFEJValuesForFactors(true);
 
-    // Call gtsam optimize and return the value.
-    gtsam::LevenbergMarquardtParams params = gtsam::LevenbergMarquardtParams::CeresDefaults();
-    LevenbergMarquardtOptimizer optimizer(*graph, values, params);
-    Values newValues = optimizer.optimize();
+    Values newValues;
+    if(optimizeIncrementally(*graph, values, newValues))
+    {
+        std::cout << "PGBA Error (incremental, without negative energy compensation): " << graph->error(newValues)
+                  << std::endl;
+    }else
+    {
+        // In incremental mode buildGraph didn't add the negative energy compensation, so it is done here.
+        double error;
+        newValues = optimizeBatch(*graph, values, incrementalSolver != nullptr, error);
+        std::cout << "PGBA Error: " << error << std::endl;
+    }
     transformDSOToIMU->updateWithValues(newValues);
 
-    double error = optimizer.error();
-    std::cout << "PGBA Error: " << error << std::endl;
-
     delayedGraph->setFEJValuesForFactors(false);
 
     return newValues;
 }
 
+bool PoseGraphBundleAdjustment::optimizeIncrementally(const gtsam::NonlinearFactorGraph& graph,
+                                                      const gtsam::Values& values, gtsam::Values& result)
+{
+    if(!incrementalSolver || !incrementalSolver->optimize(graph, values, result))
+    {
+        return false;
+    }
+    if(settings.incrementalValidate)
+    {
+        dmvio::TimeMeasurement meas("PGBAValidation");
+        double compensatedError;
+        Values batchValues = optimizeBatch(graph, values, true, compensatedError);
+        // Both errors are evaluated without the constant compensation factor, so they are comparable.
+        double incrementalError = graph.error(result);
+        double batchError = graph.error(batchValues);
+        std::cout << "PGBA validation: incremental error: " << incrementalError << " batch error: " << batchError
+                  << std::endl;
+        if(incrementalError - batchError > 0.01 * std::abs(batchError))
+        {
+            std::cout << "WARNING: PGBA incremental result is worse than batch, using batch result." << std::endl;
+            result = batchValues;
+            incrementalSolver->reset();
+        }
+    }
+    return true;
+}
+
+gtsam::Values PoseGraphBundleAdjustment::optimizeBatch(const gtsam::NonlinearFactorGraph& graph,
+                                                       const gtsam::Values& values, bool compensate, double& error)
+{
+    const gtsam::NonlinearFactorGraph* optimizedGraph = &graph;
+    gtsam::NonlinearFactorGraph compensatedGraph;
+    if(compensate)
+    {
+        compensatedGraph = graph;
+        auto negFac = compensateNegativeEnergy(compensatedGraph, values, *transformDSOToIMU);
+        if(negFac)
+        {
+            compensatedGraph.push_back(negFac);
+        }
+        optimizedGraph = &compensatedGraph;
+    }
+    gtsam::LevenbergMarquardtParams params = gtsam::LevenbergMarquardtParams::CeresDefaults();
+    LevenbergMarquardtOptimizer optimizer(*optimizedGraph, values, params);
+    gtsam::Values result = optimizer.optimize();
+    error = optimizer.error();
+    return result;
+}
+
+void PoseGraphBundleAdjustment::resetIncrementalState()
+{
+    if(!incrementalSolver) return;
+    incrementalSolver->reset();
+    cachedIMUFactors.clear();
+}
+
 gtsam::Marginals PoseGraphBundleAdjustment::getMarginals(const Values& values)
 {
     return gtsam::Marginals(*graph, values);
@@ -181,9 +250,9 @@ gtsam::Values dmvio::PoseGraphBundleAdjustment::extendGraph(gtsam::NonlinearFact
     {
         for(auto&& val : disconnectedGraph->delayedValues)
         {
-            if(!delayedGraph->delayedValues.exists(val.key))
+            if(!delayedGraph->delayedValues.get().exists(val.key))
             {
-                delayedGraph->delayedValues.insert(val.key, val.value);
+                delayedGraph->delayedValues.mutate().insert(val.key, val.value);
             }
         }
     }
@@ -196,9 +265,12 @@ gtsam::Values dmvio::PoseGraphBundleAdjustment::extendGraph(gtsam::NonlinearFact
     // Optimize with the newly added variables.
     delayedGraph->setFEJValuesForFactors(true);
 
-    gtsam::LevenbergMarquardtParams params = gtsam::LevenbergMarquardtParams::CeresDefaults();
-    LevenbergMarquardtOptimizer optimizer(graph, values, params);
-    Values newValues = optimizer.optimize();
+    Values newValues;
+    if(!optimizeIncrementally(graph, values, newValues))
+    {
+        double error;
+        newValues = optimizeBatch(graph, values, incrementalSolver != nullptr, error);
+    }
     transformDSOToIMU->updateWithValues(newValues);
 
     delayedGraph->setFEJValuesForFactors(false);
@@ -230,8 +302,11 @@ dmvio::PoseGraphBundleAdjustment::buildGraph(gtsam::NonlinearFactorGraph& graph,
     assert(prevKFIds[preintegratedForKF[0].second] == minConnectedPoseInd);
 
     firstId = minConnectedPoseInd;
+    cachedIMUFactors.erase(cachedIMUFactors.begin(), cachedIMUFactors.upper_bound(minConnectedPoseInd));
 
-    if(!noOptimization)
+    // The incremental solver doesn't compare energies, so it doesn't need this (expensive) compensation. If it fails,
+    // optimizeBatch compensates before falling back to the batch optimization.
+    if(!noOptimization && !incrementalSolver)
     {
         // Workaround: Unfortunately the DSO marginalization factors can get a (large) negative energy which is problematic
         // for the GTSAM optimizer. So we do one GN-iteration, and manually add this energy to the graph.
@@ -287,6 +362,13 @@ int dmvio::PoseGraphBundleAdjustment::insertIMUFactorsAndValues(NonlinearFactorG
                                                                 Values& values, long long int minConnectedPoseInd,
                                                                 imuBias::ConstantBias& imuBias, Vector3& velocity)
 {
+    if(incrementalSolver && cachedTransformSymbolInd != transformDSOToIMU->getSymbolInd())
+    {
+        // The cached factors are connected to the symbols of the old transform.
+        cachedIMUFactors.clear();
+        cachedTransformSymbolInd = transformDSOToIMU->getSymbolInd();
+    }
+
     int numFactors = 0;
     for(auto&& pair : preintegratedMeasurements)
     {
@@ -295,25 +377,38 @@ int dmvio::PoseGraphBundleAdjustment::insertIMUFactorsAndValues(NonlinearFactorG
         int prevId = prevKFIds.at(id);
         auto&& imuData = pair.first;
 
-        Key prevBiasKey = B(prevId);
-        NonlinearFactor::shared_ptr imuFactor(
-                new ImuFactor(P(prevId), V(prevId),
-                              P(id), V(id), prevBiasKey,
-                              imuData));
-
-        // The IMUFactor needs to be transformed (from IMU frame to DSO frame).
-        auto transformedFactor = boost::make_shared<PoseTransformationFactor>(imuFactor,
-                                                                              *transformDSOToIMU,
-                                                                              settings.conversionType);
-        graph.add(transformedFactor);
-
-        auto biasNoiseModel = computeBiasNoiseModel(imuCalibration, imuData);
-        NonlinearFactor::shared_ptr bias_factor(
-                new BetweenFactor<imuBias::ConstantBias>(
-                        prevBiasKey, B(id),
-                        imuBias::ConstantBias(gtsam::Vector3::Zero(),
-                                              gtsam::Vector3::Zero()), biasNoiseModel));
-        graph.add(bias_factor);
+        auto cached = cachedIMUFactors.find(id);
+        if(cached != cachedIMUFactors.end() && cached->second.prevId == prevId)
+        {
+            graph.add(cached->second.imuFactor);
+            graph.add(cached->second.biasFactor);
+        }else
+        {
+            Key prevBiasKey = B(prevId);
+            NonlinearFactor::shared_ptr imuFactor(
+                    new ImuFactor(P(prevId), V(prevId),
+                                  P(id), V(id), prevBiasKey,
+                                  imuData));
+
+            // The IMUFactor needs to be transformed (from IMU frame to DSO frame).
+            auto transformedFactor = boost::make_shared<PoseTransformationFactor>(imuFactor,
+                                                                                  *transformDSOToIMU,
+                                                                                  settings.conversionType);
+            graph.add(transformedFactor);
+
+            auto biasNoiseModel = computeBiasNoiseModel(imuCalibration, imuData);
+            NonlinearFactor::shared_ptr bias_factor(
+                    new BetweenFactor<imuBias::ConstantBias>(
+                            prevBiasKey, B(id),
+                            imuBias::ConstantBias(gtsam::Vector3::Zero(),
+                                                  gtsam::Vector3::Zero()), biasNoiseModel));
+            graph.add(bias_factor);
+
+            if(incrementalSolver)
+            {
+                cachedIMUFactors[id] = CachedIMUFactors{prevId, transformedFactor, bias_factor};
+            }
+        }
 
         if(imuInputValues.exists(V(id)))
         {
@@ -476,7 +571,7 @@ void PoseGraphBundleAdjustment::mainPreparation(const gtsam::Values& optimizedVa
     updateGraphMarginalizationOrder();
 
     // update delayedValues
-    gtsam::Values& delayedValues = delayedGraph->delayedValues;
+    gtsam::Values& delayedValues = delayedGraph->delayedValues.mutate();
     for(auto&& pair : optimizedValues)
     {
         auto chr = gtsam::Symbol(pair.key).chr();
@@ -488,7 +583,7 @@ void PoseGraphBundleAdjustment::mainPreparation(const gtsam::Values& optimizedVa
     }
 
     // Replace values with optimized values!
-    delayedGraph->delayedCurrValues = optimizedValues;
+    delayedGraph->delayedCurrValues.reset(optimizedValues);
 
     // Change to delay 0.
     {
@@ -528,9 +623,9 @@ PoseGraphBundleAdjustment::prepareGraphForMainOptimization(const gtsam::Values&
     {
         for(auto&& val : disconnectedGraph->delayedValues)
         {
-            if(!delayedGraph->delayedValues.exists(val.key))
+            if(!delayedGraph->delayedValues.get().exists(val.key))
             {
-                delayedGraph->delayedValues.insert(val.key, val.value);
+                delayedGraph->delayedValues.mutate().insert(val.key, val.value);
             }
         }
     }
@@ -544,6 +639,9 @@ PoseGraphBundleAdjustment::prepareGraphForMainOptimization(const gtsam::Values&
 
     mainPreparation(optimizedValues);
 
+    // The IMU factors are now owned by the main graph.
+    resetIncrementalState();
+
     return std::move(delayedGraph);
 }
 
@@ -26,6 +26,7 @@
 
 #include <GTSAMIntegration/DelayedMarginalization.h>
 #include "IMU/BAIMULogic.h"
+#include "IncrementalPGBASolver.h"
 #include <gtsam/nonlinear/Marginals.h>
 
 namespace dmvio
@@ -138,6 +139,30 @@ private:
 
     bool allPosesUsed = false;
 
+    // Only used if settings.incremental is true. The IMU factors are kept across optimizations so that the
+    // incrementalSolver can recognize them.
+    struct CachedIMUFactors
+    {
+        int prevId;
+        gtsam::NonlinearFactor::shared_ptr imuFactor, biasFactor;
+    };
+    std::unique_ptr<IncrementalPGBASolver> incrementalSolver;
+    std::map<int, CachedIMUFactors> cachedIMUFactors;
+    int cachedTransformSymbolInd = -1;
+
+    // Optimizes the graph with the incrementalSolver if enabled. Returns false if the batch optimization should be
+    // used instead.
+    bool optimizeIncrementally(const gtsam::NonlinearFactorGraph& graph, const gtsam::Values& values,
+                               gtsam::Values& result);
+
+    // Levenberg-Marquardt optimization. If compensate is true, the negative energy compensation is added to a copy of
+    // the graph first. error is the final error of the optimized graph (including the compensation).
+    gtsam::Values optimizeBatch(const gtsam::NonlinearFactorGraph& graph, const gtsam::Values& values, bool compensate,
+                                double& error);
+
+    // Must be called before the factors are used by another graph.
+    void resetIncrementalState();
+
     // Add IMU variables to keys to marginalize.
     void updateGraphMarginalizationOrder();
 
@@ -64,6 +64,7 @@ CoarseInitializer::CoarseInitializer(int ww, int hh)
 	frameID=-1;
 	fixAffine=true;
 	printDebug=false;
+	red=0;
 
 	wM.diagonal()[0] = wM.diagonal()[1] = wM.diagonal()[2] = SCALE_XI_ROT;
 	wM.diagonal()[3] = wM.diagonal()[4] = wM.diagonal()[5] = SCALE_XI_TRANS;
@@ -81,6 +82,15 @@ CoarseInitializer::~CoarseInitializer()
 	delete[] JbBuffer_new;
 }
 
+void CoarseInitializer::reset()
+{
+	frameID=-1;
+	firstFrame=0;
+	newFrame=0;
+	thisToNext_aff = AffLight(0, 0);
+	thisToNext = SE3();
+}
+
 
 bool CoarseInitializer::trackFrame(FrameHessian *newFrameHessian, std::vector<IOWrap::Output3DWrapper*> &wraps)
 {
@@ -289,7 +299,7 @@ void CoarseInitializer::debugPlot(int lvl, std::vector<IOWrap::Output3DWrapper*>
 
 
 	int wl = w[lvl], hl = h[lvl];
-	Eigen::Vector3f* colorRef = firstFrame->dIp[lvl];
+	const ImageLevel colorRef = firstFrame->image(lvl);
 
 	MinimalImageB3 iRImg(wl,hl);
 
@@ -337,8 +347,8 @@ Vec3f CoarseInitializer::calcResAndGS(
 		bool plot)
 {
 	int wl = w[lvl], hl = h[lvl];
-	Eigen::Vector3f* colorRef = firstFrame->dIp[lvl];
-	Eigen::Vector3f* colorNew = newFrame->dIp[lvl];
+	const ImageLevel colorRef = firstFrame->image(lvl);
+	const ImageLevel colorNew = newFrame->image(lvl);
 
 	Mat33f RKi = (refToNew.rotationMatrix() * Ki[lvl]).cast<float>();
 	Vec3f t = refToNew.translation().cast<float>();
@@ -364,7 +374,7 @@ Vec3f CoarseInitializer::calcResAndGS(
 	Pnt* ptsl = points[lvl];
 
     // This part takes most of the time for this method --> parallelize this only.
-    auto processPointsForReduce = [&](int min=0, int max=1, double* stats=0, int tid=0)
+    auto processPointsForReduce = [&](int min=0, int max=1, Vec10* stats=0, int tid=0)
     {
         auto& acc9 = acc9s[tid];
         auto& E = accE[tid];
@@ -504,7 +514,10 @@ Vec3f CoarseInitializer::calcResAndGS(
         }
     };
 
-    reduce.reduce(processPointsForReduce, 0, npts, 50);
+    if(red != 0)
+        red->reduce(processPointsForReduce, 0, npts, 50);
+    else
+        processPointsForReduce(0, npts, 0, 0);
 
     for(auto&& acc9 : acc9s)
     {
@@ -779,27 +792,7 @@ void CoarseInitializer::propagateDown(int srcLvl)
 
 void CoarseInitializer::makeGradients(Eigen::Vector3f** data)
 {
-	for(int lvl=1; lvl<pyrLevelsUsed; lvl++)
-	{
-		int lvlm1 = lvl-1;
-		int wl = w[lvl], hl = h[lvl], wlm1 = w[lvlm1];
-
-		Eigen::Vector3f* dINew_l = data[lvl];
-		Eigen::Vector3f* dINew_lm = data[lvlm1];
-
-		for(int y=0;y<hl;y++)
-			for(int x=0;x<wl;x++)
-				dINew_l[x + y*wl][0] = 0.25f * (dINew_lm[2*x   + 2*y*wlm1][0] +
-													dINew_lm[2*x+1 + 2*y*wlm1][0] +
-													dINew_lm[2*x   + 2*y*wlm1+wlm1][0] +
-													dINew_lm[2*x+1 + 2*y*wlm1+wlm1][0]);
-
-		for(int idx=wl;idx < wl*(hl-1);idx++)
-		{
-			dINew_l[idx][1] = 0.5f*(dINew_l[idx+1][0] - dINew_l[idx-1][0]);
-			dINew_l[idx][2] = 0.5f*(dINew_l[idx+wl][0] - dINew_l[idx-wl][0]);
-		}
-	}
+	makeImagePyramid(data, 0, w, h, pyrLevelsUsed, 0, red);
 }
 void CoarseInitializer::setFirst(	CalibHessian* HCalib, FrameHessian* newFrameHessian)
 {
@@ -820,7 +813,7 @@ void CoarseInitializer::setFirst(	CalibHessian* HCalib, FrameHessian* newFrameHe
 		if(lvl == 0)
 			npts = sel.makeMaps(firstFrame, statusMap,densities[lvl]*w[0]*h[0],1,false,2);
 		else
-			npts = makePixelStatus(firstFrame->dIp[lvl], statusMapB, w[lvl], h[lvl], densities[lvl]*w[0]*h[0]);
+			npts = makePixelStatus(firstFrame->image(lvl), statusMapB, w[lvl], h[lvl], densities[lvl]*w[0]*h[0]);
 
 
 
@@ -848,13 +841,14 @@ void CoarseInitializer::setFirst(	CalibHessian* HCalib, FrameHessian* newFrameHe
 				pl[nl].lastHessian_new=0;
 				pl[nl].my_type= (lvl!=0) ? 1 : statusMap[x+y*wl];
 
-				Eigen::Vector3f* cpt = firstFrame->dIp[lvl] + x + y*w[lvl];
+				const ImageLevel img = firstFrame->image(lvl);
+				int cpt = x + y*w[lvl];
 				float sumGrad2=0;
 				for(int idx=0;idx<patternNum;idx++)
 				{
 					int dx = patternP[idx][0];
 					int dy = patternP[idx][1];
-					float absgrad = cpt[dx + dy*w[lvl]].tail<2>().squaredNorm();
+					float absgrad = img[cpt + dx + dy*w[lvl]].tail<2>().squaredNorm();
 					sumGrad2 += absgrad;
 				}
 
@@ -30,6 +30,7 @@
 #include "OptimizationBackend/MatrixAccumulators.h"
 #include "IOWrapper/Output3DWrapper.h"
 #include "util/settings.h"
+#include "util/IndexThreadReduce.h"
 #include "vector"
 #include <math.h>
 #include "IMU/IMUIntegration.hpp"
@@ -86,6 +87,8 @@ public:
 
 	void setFirst(	CalibHessian* HCalib, FrameHessian* newFrameHessian);
 	bool trackFrame(FrameHessian* newFrameHessian, std::vector<IOWrap::Output3DWrapper*> &wraps);
+	// the next frame passed to setFirst starts a new initialization. Does not delete firstFrame.
+	void reset();
 
 	int frameID;
 	bool fixAffine;
@@ -99,6 +102,8 @@ public:
 
 	FrameHessian* firstFrame;
 	FrameHessian* newFrame;
+
+	IndexThreadReduce<Vec10>* red; // Not owned. If not set, the points are processed single-threaded.
 private:
 
 	Mat33 K[PYR_LEVELS];
@@ -132,8 +137,6 @@ private:
 	std::array<Accumulator9, NUM_THREADS> acc9s; // one acc for each worker thread.
 	Accumulator9 acc9SC;
 
-    IndexThreadReduce<double> reduce;
-
 	Vec3f dGrads[PYR_LEVELS];
 
 	float alphaK;
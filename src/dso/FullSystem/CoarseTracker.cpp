@@ -38,6 +38,7 @@
 #include "OptimizationBackend/EnergyFunctionalStructs.h"
 #include "IOWrapper/ImageRW.h"
 #include <algorithm>
+#include <chrono>
 #include "util/TimeMeasurement.h"
 
 #if !defined(__SSE3__) && !defined(__SSE2__) && !defined(__SSE1__)
@@ -94,6 +95,9 @@ CoarseTracker::CoarseTracker(int ww, int hh, dmvio::IMUIntegration &imuIntegrati
 	debugPlot = debugPrint = true;
 	w[0]=h[0]=0;
 	refFrameID=-1;
+	finestReadyLevel=0;
+	red=0;
+	for(int lvl=0; lvl<PYR_LEVELS; lvl++) levelTime[lvl]=-1;
 }
 CoarseTracker::~CoarseTracker()
 {
@@ -102,6 +106,16 @@ CoarseTracker::~CoarseTracker()
     ptrToDelete.clear();
 }
 
+void CoarseTracker::reset()
+{
+	newFrame = 0;
+	lastRef = 0;
+	lastRef_aff_g2l = AffLight(0,0);
+	refFrameID = -1;
+	setFinestReadyLevel(0);
+	for(int lvl=0; lvl<PYR_LEVELS; lvl++) levelTime[lvl]=-1;
+}
+
 void CoarseTracker::makeK(CalibHessian* HCalib)
 {
 	w[0] = wG[0];
@@ -135,13 +149,45 @@ void CoarseTracker::makeK(CalibHessian* HCalib)
 
 
 
-void CoarseTracker::makeCoarseDepthL0(std::vector<FrameHessian*> frameHessians)
+void CoarseTracker::makeCoarseDepthL0(std::vector<FrameHessian*> frameHessians, int publishLevel)
+{
+	dmvio::TimeMeasurement timeMeasurement("makeCoarseDepthL0");
+	projectPointsAndMakePyramid(frameHessians);
+
+	// coarse levels first, so the tracker can start using them while the finer levels are computed.
+	for(int lvl=pyrLevelsUsed-1; lvl>=std::max(publishLevel, 0); lvl--)
+		finishLevel(lvl);
+}
+
+void CoarseTracker::reduceRows(boost::function<void(int,int,Vec10*,int)> callPerIndex, int numRows)
+{
+	if(multiThreading && red != 0 && numRows >= 64)
+		red->reduce(callPerIndex, 0, numRows, 0);
+	else
+	{
+		Vec10 stats;
+		callPerIndex(0, numRows, &stats, 0);
+	}
+}
+
+void CoarseTracker::projectPointsAndMakePyramid(std::vector<FrameHessian*>& frameHessians)
 {
 	// make coarse tracking templates for latstRef.
-	memset(idepth[0], 0, sizeof(float)*w[0]*h[0]);
-	memset(weightSums[0], 0, sizeof(float)*w[0]*h[0]);
+	reduceRows(boost::bind(&CoarseTracker::project_Reductor, this, &frameHessians, _1, _2, _3, _4), h[0]);
 
-	for(FrameHessian* fh : frameHessians)
+	for(int lvl=1; lvl<pyrLevelsUsed; lvl++)
+		reduceRows(boost::bind(&CoarseTracker::downsample_Reductor, this, lvl, _1, _2, _3, _4), h[lvl]);
+}
+
+void CoarseTracker::project_Reductor(std::vector<FrameHessian*>* frameHessians, int min, int max, Vec10* stats, int tid)
+{
+	// Every thread owns a stripe of rows and only accumulates points projecting into it. Thus no synchronization
+	// is needed and the summation order per pixel is the same as for the single-threaded version.
+	int idxMin = min*w[0], idxMax = max*w[0];
+	memset(idepth[0] + idxMin, 0, sizeof(float)*(idxMax-idxMin));
+	memset(weightSums[0] + idxMin, 0, sizeof(float)*(idxMax-idxMin));
+
+	for(FrameHessian* fh : *frameHessians)
 	{
 		for(PointHessian* ph : fh->pointHessians)
 		{
@@ -151,86 +197,129 @@ void CoarseTracker::makeCoarseDepthL0(std::vector<FrameHessian*> frameHessians)
 				assert(r->efResidual->isActive() && r->target == lastRef);
 				int u = r->centerProjectedTo[0] + 0.5f;
 				int v = r->centerProjectedTo[1] + 0.5f;
+				int idx = u+w[0]*v;
+				if(idx < idxMin || idx >= idxMax) continue;
+
 				float new_idepth = r->centerProjectedTo[2];
 				float weight = sqrtf(1e-3 / (ph->efPoint->HdiF+1e-12));
 
-				idepth[0][u+w[0]*v] += new_idepth *weight;
-				weightSums[0][u+w[0]*v] += weight;
+				idepth[0][idx] += new_idepth *weight;
+				weightSums[0][idx] += weight;
 			}
 		}
 	}
+}
 
+void CoarseTracker::downsample_Reductor(int lvl, int min, int max, Vec10* stats, int tid)
+{
+	int lvlm1 = lvl-1;
+	int wl = w[lvl], wlm1 = w[lvlm1];
 
-	for(int lvl=1; lvl<pyrLevelsUsed; lvl++)
-	{
-		int lvlm1 = lvl-1;
-		int wl = w[lvl], hl = h[lvl], wlm1 = w[lvlm1];
+	float* idepth_l = idepth[lvl];
+	float* weightSums_l = weightSums[lvl];
 
-		float* idepth_l = idepth[lvl];
-		float* weightSums_l = weightSums[lvl];
+	float* idepth_lm = idepth[lvlm1];
+	float* weightSums_lm = weightSums[lvlm1];
 
-		float* idepth_lm = idepth[lvlm1];
-		float* weightSums_lm = weightSums[lvlm1];
+	for(int y=min;y<max;y++)
+	{
+		int x=0;
+		// same summation order as the scalar version below, so the results are identical.
+		for(;x+4<=wl;x+=4)
+		{
+			int bidx = 2*x   + 2*y*wlm1;
+			__m128 a = _mm_loadu_ps(idepth_lm+bidx);
+			__m128 b = _mm_loadu_ps(idepth_lm+bidx+4);
+			__m128 c = _mm_loadu_ps(idepth_lm+bidx+wlm1);
+			__m128 d = _mm_loadu_ps(idepth_lm+bidx+wlm1+4);
+			__m128 sum = _mm_add_ps(_mm_shuffle_ps(a,b,_MM_SHUFFLE(2,0,2,0)), _mm_shuffle_ps(a,b,_MM_SHUFFLE(3,1,3,1)));
+			sum = _mm_add_ps(sum, _mm_shuffle_ps(c,d,_MM_SHUFFLE(2,0,2,0)));
+			sum = _mm_add_ps(sum, _mm_shuffle_ps(c,d,_MM_SHUFFLE(3,1,3,1)));
+			_mm_storeu_ps(idepth_l + x + y*wl, sum);
+
+			a = _mm_loadu_ps(weightSums_lm+bidx);
+			b = _mm_loadu_ps(weightSums_lm+bidx+4);
+			c = _mm_loadu_ps(weightSums_lm+bidx+wlm1);
+			d = _mm_loadu_ps(weightSums_lm+bidx+wlm1+4);
+			sum = _mm_add_ps(_mm_shuffle_ps(a,b,_MM_SHUFFLE(2,0,2,0)), _mm_shuffle_ps(a,b,_MM_SHUFFLE(3,1,3,1)));
+			sum = _mm_add_ps(sum, _mm_shuffle_ps(c,d,_MM_SHUFFLE(2,0,2,0)));
+			sum = _mm_add_ps(sum, _mm_shuffle_ps(c,d,_MM_SHUFFLE(3,1,3,1)));
+			_mm_storeu_ps(weightSums_l + x + y*wl, sum);
+		}
 
-		for(int y=0;y<hl;y++)
-			for(int x=0;x<wl;x++)
-			{
-				int bidx = 2*x   + 2*y*wlm1;
-				idepth_l[x + y*wl] = 		idepth_lm[bidx] +
-											idepth_lm[bidx+1] +
-											idepth_lm[bidx+wlm1] +
-											idepth_lm[bidx+wlm1+1];
-
-				weightSums_l[x + y*wl] = 	weightSums_lm[bidx] +
-											weightSums_lm[bidx+1] +
-											weightSums_lm[bidx+wlm1] +
-											weightSums_lm[bidx+wlm1+1];
-			}
+		for(;x<wl;x++)
+		{
+			int bidx = 2*x   + 2*y*wlm1;
+			idepth_l[x + y*wl] = 		idepth_lm[bidx] +
+										idepth_lm[bidx+1] +
+										idepth_lm[bidx+wlm1] +
+										idepth_lm[bidx+wlm1+1];
+
+			weightSums_l[x + y*wl] = 	weightSums_lm[bidx] +
+										weightSums_lm[bidx+1] +
+										weightSums_lm[bidx+wlm1] +
+										weightSums_lm[bidx+wlm1+1];
+		}
 	}
+}
+
+void CoarseTracker::finishLevel(int lvl)
+{
+	int wl = w[lvl], hl = h[lvl];
 
+	// dilate idepth by 1 (2 on lower levels).
+	memcpy(weightSums_bak[lvl], weightSums[lvl], wl*hl*sizeof(float));
+	reduceRows(boost::bind(&CoarseTracker::dilate_Reductor, this, lvl, _1, _2, _3, _4), hl);
+
+	// normalize idepths and weights, counting the valid points per row.
+	if((int)rowStart.size() < h[0]+1) rowStart.resize(h[0]+1);
+	reduceRows(boost::bind(&CoarseTracker::normalize_Reductor, this, lvl, _1, _2, _3, _4), hl);
 
-    // dilate idepth by 1.
-	for(int lvl=0; lvl<2; lvl++)
+	int lpc_n=0;
+	for(int y=0;y<hl;y++)
 	{
-		int numIts = 1;
+		int numInRow = rowStart[y];
+		rowStart[y] = lpc_n;
+		lpc_n += numInRow;
+	}
+	pc_n[lvl] = lpc_n;
+
+	reduceRows(boost::bind(&CoarseTracker::makePointCloud_Reductor, this, lvl, _1, _2, _3, _4), hl);
+
+	setFinestReadyLevel(lvl);
+}
+
+void CoarseTracker::dilate_Reductor(int lvl, int min, int max, Vec10* stats, int tid)
+{
+	int wh = w[lvl]*h[lvl]-w[lvl];
+	int wl = w[lvl];
+	float* weightSumsl = weightSums[lvl];
+	float* weightSumsl_bak = weightSums_bak[lvl];
+	float* idepthl = idepth[lvl];	// dotnt need to make a temp copy of depth, since I only
+									// read values with weightSumsl>0, and write ones with weightSumsl<=0.
 
+	// same index range as iterating i from w+1 to wh-1, split into rows.
+	int iMin = std::max(min*wl, wl+1);
+	int iMax = std::min(max*wl, wh-1);
 
-		for(int it=0;it<numIts;it++)
+	if(lvl < 2)
+	{
+		for(int i=iMin;i<iMax;i++)
 		{
-			int wh = w[lvl]*h[lvl]-w[lvl];
-			int wl = w[lvl];
-			float* weightSumsl = weightSums[lvl];
-			float* weightSumsl_bak = weightSums_bak[lvl];
-			memcpy(weightSumsl_bak, weightSumsl, w[lvl]*h[lvl]*sizeof(float));
-			float* idepthl = idepth[lvl];	// dotnt need to make a temp copy of depth, since I only
-											// read values with weightSumsl>0, and write ones with weightSumsl<=0.
-			for(int i=w[lvl]+1;i<wh-1;i++)
+			if(weightSumsl_bak[i] <= 0)
 			{
-				if(weightSumsl_bak[i] <= 0)
-				{
-					float sum=0, num=0, numn=0;
-					if(weightSumsl_bak[i+1+wl] > 0) { sum += idepthl[i+1+wl]; num+=weightSumsl_bak[i+1+wl]; numn++;}
-					if(weightSumsl_bak[i-1-wl] > 0) { sum += idepthl[i-1-wl]; num+=weightSumsl_bak[i-1-wl]; numn++;}
-					if(weightSumsl_bak[i+wl-1] > 0) { sum += idepthl[i+wl-1]; num+=weightSumsl_bak[i+wl-1]; numn++;}
-					if(weightSumsl_bak[i-wl+1] > 0) { sum += idepthl[i-wl+1]; num+=weightSumsl_bak[i-wl+1]; numn++;}
-					if(numn>0) {idepthl[i] = sum/numn; weightSumsl[i] = num/numn;}
-				}
+				float sum=0, num=0, numn=0;
+				if(weightSumsl_bak[i+1+wl] > 0) { sum += idepthl[i+1+wl]; num+=weightSumsl_bak[i+1+wl]; numn++;}
+				if(weightSumsl_bak[i-1-wl] > 0) { sum += idepthl[i-1-wl]; num+=weightSumsl_bak[i-1-wl]; numn++;}
+				if(weightSumsl_bak[i+wl-1] > 0) { sum += idepthl[i+wl-1]; num+=weightSumsl_bak[i+wl-1]; numn++;}
+				if(weightSumsl_bak[i-wl+1] > 0) { sum += idepthl[i-wl+1]; num+=weightSumsl_bak[i-wl+1]; numn++;}
+				if(numn>0) {idepthl[i] = sum/numn; weightSumsl[i] = num/numn;}
 			}
 		}
 	}
-
-
-	// dilate idepth by 1 (2 on lower levels).
-	for(int lvl=2; lvl<pyrLevelsUsed; lvl++)
+	else
 	{
-		int wh = w[lvl]*h[lvl]-w[lvl];
-		int wl = w[lvl];
-		float* weightSumsl = weightSums[lvl];
-		float* weightSumsl_bak = weightSums_bak[lvl];
-		memcpy(weightSumsl_bak, weightSumsl, w[lvl]*h[lvl]*sizeof(float));
-		float* idepthl = idepth[lvl];	// dotnt need to make a temp copy of depth, since I only
-										// read values with weightSumsl>0, and write ones with weightSumsl<=0.
-		for(int i=w[lvl]+1;i<wh-1;i++)
+		for(int i=iMin;i<iMax;i++)
 		{
 			if(weightSumsl_bak[i] <= 0)
 			{
@@ -243,25 +332,20 @@ void CoarseTracker::makeCoarseDepthL0(std::vector<FrameHessian*> frameHessians)
 			}
 		}
 	}
+}
 
+void CoarseTracker::normalize_Reductor(int lvl, int min, int max, Vec10* stats, int tid)
+{
+	float* weightSumsl = weightSums[lvl];
+	float* idepthl = idepth[lvl];
+	const ImageLevel dIRefl = lastRef->image(lvl);
 
-	// normalize idepths and weights.
-	for(int lvl=0; lvl<pyrLevelsUsed; lvl++)
-	{
-		float* weightSumsl = weightSums[lvl];
-		float* idepthl = idepth[lvl];
-		Eigen::Vector3f* dIRefl = lastRef->dIp[lvl];
-
-		int wl = w[lvl], hl = h[lvl];
-
-		int lpc_n=0;
-		float* lpc_u = pc_u[lvl];
-		float* lpc_v = pc_v[lvl];
-		float* lpc_idepth = pc_idepth[lvl];
-		float* lpc_color = pc_color[lvl];
-
+	int wl = w[lvl], hl = h[lvl];
 
-		for(int y=2;y<hl-2;y++)
+	for(int y=min;y<max;y++)
+	{
+		int numInRow = 0;
+		if(y>=2 && y<hl-2)
 			for(int x=2;x<wl-2;x++)
 			{
 				int i = x+y*wl;
@@ -269,29 +353,74 @@ void CoarseTracker::makeCoarseDepthL0(std::vector<FrameHessian*> frameHessians)
 				if(weightSumsl[i] > 0)
 				{
 					idepthl[i] /= weightSumsl[i];
-					lpc_u[lpc_n] = x;
-					lpc_v[lpc_n] = y;
-					lpc_idepth[lpc_n] = idepthl[i];
-					lpc_color[lpc_n] = dIRefl[i][0];
-
 
-
-					if(!std::isfinite(lpc_color[lpc_n]) || !(idepthl[i]>0))
+					if(!std::isfinite(dIRefl[i][0]) || !(idepthl[i]>0))
 					{
 						idepthl[i] = -1;
 						continue;	// just skip if something is wrong.
 					}
-					lpc_n++;
+					numInRow++;
 				}
 				else
 					idepthl[i] = -1;
 
 				weightSumsl[i] = 1;
 			}
+		rowStart[y] = numInRow;
+	}
+}
+
+void CoarseTracker::makePointCloud_Reductor(int lvl, int min, int max, Vec10* stats, int tid)
+{
+	float* idepthl = idepth[lvl];
+	const ImageLevel dIRefl = lastRef->image(lvl);
+
+	int wl = w[lvl], hl = h[lvl];
+
+	float* lpc_u = pc_u[lvl];
+	float* lpc_v = pc_v[lvl];
+	float* lpc_idepth = pc_idepth[lvl];
+	float* lpc_color = pc_color[lvl];
 
-		pc_n[lvl] = lpc_n;
+	for(int y=std::max(min,2);y<std::min(max,hl-2);y++)
+	{
+		int lpc_n = rowStart[y];
+		for(int x=2;x<wl-2;x++)
+		{
+			int i = x+y*wl;
+			if(idepthl[i] > 0)
+			{
+				lpc_u[lpc_n] = x;
+				lpc_v[lpc_n] = y;
+				lpc_idepth[lpc_n] = idepthl[i];
+				lpc_color[lpc_n] = dIRefl[i][0];
+				lpc_n++;
+			}
+		}
 	}
+}
 
+void CoarseTracker::setFinestReadyLevel(int lvl)
+{
+	boost::unique_lock<boost::mutex> lock(levelMutex);
+	finestReadyLevel = lvl;
+	levelReadySignal.notify_all();
+}
+
+bool CoarseTracker::isLevelReady(int lvl)
+{
+	boost::unique_lock<boost::mutex> lock(levelMutex);
+	return finestReadyLevel <= lvl;
+}
+
+void CoarseTracker::waitForLevel(int lvl)
+{
+	boost::unique_lock<boost::mutex> lock(levelMutex);
+	if(finestReadyLevel <= lvl) return;
+
+	dmvio::TimeMeasurement timeMeasurement("coarseTrackingWaitForRefLevel");
+	while(finestReadyLevel > lvl)
+		levelReadySignal.wait(lock);
 }
 
 
@@ -359,6 +488,15 @@ void CoarseTracker::calcGSSSE(int lvl, Mat88 &H_out, Vec8 &b_out, const SE3 &ref
 
 
 Vec6 CoarseTracker::calcRes(int lvl, const SE3 &refToNew, AffLight aff_g2l, float cutoffTH)
+{
+	return withImageLevel(newFrame->image(lvl), [&](auto dINewl)
+	{
+		return calcResImpl(dINewl, lvl, refToNew, aff_g2l, cutoffTH);
+	});
+}
+
+template<typename ImageT>
+Vec6 CoarseTracker::calcResImpl(const ImageT& dINewl, int lvl, const SE3 &refToNew, AffLight aff_g2l, float cutoffTH)
 {
 	float E = 0;
 	int numTermsInE = 0;
@@ -367,7 +505,6 @@ Vec6 CoarseTracker::calcRes(int lvl, const SE3 &refToNew, AffLight aff_g2l, floa
 
 	int wl = w[lvl];
 	int hl = h[lvl];
-	Eigen::Vector3f* dINewl = newFrame->dIp[lvl];
 	float fxl = fx[lvl];
 	float fyl = fy[lvl];
 	float cxl = cx[lvl];
@@ -522,11 +659,12 @@ Vec6 CoarseTracker::calcRes(int lvl, const SE3 &refToNew, AffLight aff_g2l, floa
 
 
 void CoarseTracker::setCoarseTrackingRef(
-		std::vector<FrameHessian*> frameHessians)
+		std::vector<FrameHessian*> frameHessians, int publishLevel)
 {
 	assert(frameHessians.size()>0);
 	lastRef = frameHessians.back();
-	makeCoarseDepthL0(frameHessians);
+	setFinestReadyLevel(pyrLevelsUsed);
+	makeCoarseDepthL0(frameHessians, publishLevel);
 
 
 
@@ -536,12 +674,20 @@ void CoarseTracker::setCoarseTrackingRef(
 	firstCoarseRMSE=-1;
 
 }
+void CoarseTracker::finishCoarseTrackingRef()
+{
+	if(finestReadyLevel == 0) return;
+	dmvio::TimeMeasurement timeMeasurement("finishCoarseTrackingRef");
+	for(int lvl=finestReadyLevel-1; lvl>=0; lvl--)
+		finishLevel(lvl);
+}
 bool CoarseTracker::trackNewestCoarse(
 		FrameHessian* newFrameHessian,
 		SE3 &lastToNew_out, AffLight &aff_g2l_out,
 		int coarsestLvl,
 		Vec5 minResForAbort,
-		IOWrap::Output3DWrapper* wrap)
+		IOWrap::Output3DWrapper* wrap,
+		const int* maxIterationsPerLevel)
 {
 	debugPlot = setting_render_displayCoarseTrackingFull;
 	debugPrint = !setting_debugout_runquiet;
@@ -553,7 +699,8 @@ bool CoarseTracker::trackNewestCoarse(
 
 
 	newFrame = newFrameHessian;
-	int maxIterations[] = {10,20,50,50,50};
+	int maxIterationsDefault[] = {10,20,50,50,50};
+	const int* maxIterations = maxIterationsPerLevel ? maxIterationsPerLevel : maxIterationsDefault;
 	float lambdaExtrapolationLimit = 0.001;
 
 	SE3 refToNew_current = lastToNew_out;
@@ -566,6 +713,8 @@ bool CoarseTracker::trackNewestCoarse(
     int lastLvl = -1;
 	for(int lvl=coarsestLvl; lvl>=0; lvl--)
 	{
+		waitForLevel(lvl);
+		auto levelStart = std::chrono::steady_clock::now();
 		float levelCutoffRepeat=1;
 		Vec6 resOld = calcRes(lvl, refToNew_current, aff_g2l_current, setting_coarseCutoffTH*levelCutoffRepeat);
 		while(resOld[5] > 0.6 && (levelCutoffRepeat < 50 || resOld[5] > 0.99) )
@@ -725,6 +874,9 @@ bool CoarseTracker::trackNewestCoarse(
 			}
 		}
 
+		double levelDuration = std::chrono::duration<double>(std::chrono::steady_clock::now() - levelStart).count();
+		levelTime[lvl] = levelTime[lvl] < 0 ? levelDuration : 0.9*levelTime[lvl] + 0.1*levelDuration;
+
 		// set last residual for that level, as well as flow indicators.
 		lastResiduals[lvl] = sqrtf((float)(resOld[0] / resOld[1]));
 		lastFlowIndicators = resOld.segment<3>(2);
@@ -770,6 +922,56 @@ bool CoarseTracker::trackNewestCoarse(
 }
 
 
+int CoarseTracker::chooseStartLevel(float expectedPixelError, int coarsestLvl, int* maxIterationsOut) const
+{
+	const int maxIterationsDefault[] = {10,20,50,50,50};
+	for(int lvl=0; lvl<PYR_LEVELS; lvl++)
+		maxIterationsOut[lvl] = maxIterationsDefault[std::min(lvl, 4)];
+	if(!std::isfinite(expectedPixelError)) return coarsestLvl;
+
+	int startLvl = 0;
+	while(startLvl < coarsestLvl && expectedPixelError > setting_coarseAdaptiveBasin * (1<<startLvl))
+		startLvl++;
+
+	// the smaller the expected error compared to the basin of a level, the fewer iterations it should need.
+	for(int lvl=0; lvl<=startLvl; lvl++)
+	{
+		float ratio = expectedPixelError / (setting_coarseAdaptiveBasin * (1<<lvl));
+		int its = (int)ceilf(ratio * maxIterationsOut[lvl]);
+		maxIterationsOut[lvl] = std::max(setting_coarseAdaptiveMinIterations, std::min(its, maxIterationsOut[lvl]));
+	}
+	return startLvl;
+}
+
+float CoarseTracker::pixelStdFromPoseStd(double rotStd, double transStd) const
+{
+	int lvl = pyrLevelsUsed-1;
+	if(pc_n[lvl] == 0) return NAN;
+	double idepthSum = 0;
+	for(int i=0;i<pc_n[lvl];i++) idepthSum += pc_idepth[lvl][i];
+	return (float)(fx[0] * (rotStd + transStd * idepthSum / pc_n[lvl]));
+}
+
+float CoarseTracker::meanPixelShift(const SE3& refToA, const SE3& refToB) const
+{
+	int lvl = pyrLevelsUsed-1;
+	Mat33f RA = refToA.rotationMatrix().cast<float>(), RB = refToB.rotationMatrix().cast<float>();
+	Vec3f tA = refToA.translation().cast<float>(), tB = refToB.translation().cast<float>();
+
+	float sum = 0;
+	int num = 0;
+	for(int i=0;i<pc_n[lvl];i++)
+	{
+		Vec3f ray = Ki[lvl] * Vec3f(pc_u[lvl][i], pc_v[lvl][i], 1);
+		Vec3f pA = RA * ray + tA * pc_idepth[lvl][i];
+		Vec3f pB = RB * ray + tB * pc_idepth[lvl][i];
+		if(!(pA[2] > 0) || !(pB[2] > 0)) continue;
+		sum += (Vec2f(pA[0]/pA[2], pA[1]/pA[2]) - Vec2f(pB[0]/pB[2], pB[1]/pB[2])).norm();
+		num++;
+	}
+	return num == 0 ? NAN : fx[0] * sum / num;
+}
+
 
 void CoarseTracker::debugPlotIDepthMap(float* minID_pt, float* maxID_pt, std::vector<IOWrap::Output3DWrapper*> &wraps) const
 {
@@ -835,9 +1037,10 @@ void CoarseTracker::debugPlotIDepthMap(float* minID_pt, float* maxID_pt, std::ve
 
 		MinimalImageB3 mf(w[lvl], h[lvl]);
 		mf.setBlack();
+		const ImageLevel dIRefl = lastRef->image(lvl);
 		for(int i=0;i<h[lvl]*w[lvl];i++)
 		{
-			int c = lastRef->dIp[lvl][i][0]*0.9f;
+			int c = dIRefl[i][0]*0.9f;
 			if(c>255) c=255;
 			mf.at(i) = Vec3b(c,c,c);
 		}
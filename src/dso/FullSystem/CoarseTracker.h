@@ -33,6 +33,7 @@
 #include "util/settings.h"
 #include "OptimizationBackend/MatrixAccumulators.h"
 #include "IOWrapper/Output3DWrapper.h"
+#include "util/IndexThreadReduce.h"
 
 #include "IMU/IMUIntegration.hpp"
 
@@ -50,14 +51,34 @@ public:
 	CoarseTracker(int w, int h, dmvio::IMUIntegration &imuIntegration);
 	~CoarseTracker();
 
+	// forget the reference frame (buffers are kept). Must not be called while tracking.
+	void reset();
+
 	bool trackNewestCoarse(
 			FrameHessian* newFrameHessian,
 			SE3 &lastToNew_out, AffLight &aff_g2l_out,
 			int coarsestLvl, Vec5 minResForAbort,
-			IOWrap::Output3DWrapper* wrap=0);
-
+			IOWrap::Output3DWrapper* wrap=0,
+			const int* maxIterationsPerLevel=0);
+
+	// For a trusted pose prediction: returns the finest level whose convergence basin (setting_coarseAdaptiveBasin
+	// pixels at that level) covers expectedPixelError (at level 0), and fills reduced per-level iteration caps.
+	int chooseStartLevel(float expectedPixelError, int coarsestLvl, int* maxIterationsOut) const;
+	// Pixel std (level 0) caused by a pose error with the given std of rotation (rad) and translation (DSO scale).
+	float pixelStdFromPoseStd(double rotStd, double transStd) const;
+	// Mean displacement (level 0 pixels) of the reference points between two relative poses.
+	float meanPixelShift(const SE3& refToA, const SE3& refToB) const;
+	// Moving average of the time (seconds) spent per level in trackNewestCoarse.
+	double levelTime[PYR_LEVELS];
+
+	// Only pyramid levels >= publishLevel are finished before this returns, so that the tracker can already switch
+	// to the new reference. finishCoarseTrackingRef has to be called afterwards (outside of the
+	// coarseTrackerSwapMutex) to compute the remaining levels. trackNewestCoarse waits for them if necessary.
 	void setCoarseTrackingRef(
-			std::vector<FrameHessian*> frameHessians);
+			std::vector<FrameHessian*> frameHessians, int publishLevel = 0);
+	void finishCoarseTrackingRef();
+	// True if trackNewestCoarse will not need to wait for level lvl (and coarser) of the reference.
+	bool isLevelReady(int lvl);
 
 	void makeK(
 			CalibHessian* HCalib);
@@ -89,17 +110,38 @@ public:
 	Vec5 lastResiduals;
 	Vec3 lastFlowIndicators;
 	double firstCoarseRMSE;
+
+	IndexThreadReduce<Vec10>* red; // Not owned, only used by the mapping thread.
 private:
 
 
-	void makeCoarseDepthL0(std::vector<FrameHessian*> frameHessians);
+	void makeCoarseDepthL0(std::vector<FrameHessian*> frameHessians, int publishLevel);
+	void projectPointsAndMakePyramid(std::vector<FrameHessian*>& frameHessians);
+	void finishLevel(int lvl);
+	void reduceRows(boost::function<void(int,int,Vec10*,int)> callPerIndex, int numRows);
+	void project_Reductor(std::vector<FrameHessian*>* frameHessians, int min, int max, Vec10* stats, int tid);
+	void downsample_Reductor(int lvl, int min, int max, Vec10* stats, int tid);
+	void dilate_Reductor(int lvl, int min, int max, Vec10* stats, int tid);
+	void normalize_Reductor(int lvl, int min, int max, Vec10* stats, int tid);
+	void makePointCloud_Reductor(int lvl, int min, int max, Vec10* stats, int tid);
 	float* idepth[PYR_LEVELS];
 	float* weightSums[PYR_LEVELS];
 	float* weightSums_bak[PYR_LEVELS];
+	std::vector<int> rowStart; // per row: index of the first pc entry (prefix sum of the valid points).
+
+	// Levels >= finestReadyLevel are usable for tracking. Written by the mapping thread, read by the tracker.
+	void setFinestReadyLevel(int lvl);
+	void waitForLevel(int lvl);
+	int finestReadyLevel;
+	boost::mutex levelMutex;
+	boost::condition_variable levelReadySignal;
 
 
 	Vec6 calcResAndGS(int lvl, Mat88 &H_out, Vec8 &b_out, const SE3 &refToNew, AffLight aff_g2l, float cutoffTH);
 	Vec6 calcRes(int lvl, const SE3 &refToNew, AffLight aff_g2l, float cutoffTH);
+	// calcRes for one image layout (const Eigen::Vector3f* or CompactLevel), see withImageLevel.
+	template<typename ImageT>
+	Vec6 calcResImpl(const ImageT& dINewl, int lvl, const SE3 &refToNew, AffLight aff_g2l, float cutoffTH);
 	void calcGSSSE(int lvl, Mat88 &H_out, Vec8 &b_out, const SE3 &refToNew, AffLight aff_g2l);
 	void calcGS(int lvl, Mat88 &H_out, Vec8 &b_out, const SE3 &refToNew, AffLight aff_g2l);
 
@@ -0,0 +1,115 @@
+/**
+* This file is part of DSO, written by Jakob Engel.
+* It has been modified by Lukas von Stumberg for the inclusion in DM-VIO (http://vision.in.tum.de/dm-vio).
+*
+* Copyright 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>
+* Copyright 2016 Technical University of Munich and Intel.
+* Developed by Jakob Engel <engelj at in dot tum dot de>,
+* for more information see <http://vision.in.tum.de/dso>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DSO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DSO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DSO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "FullSystem/FrameImagePool.h"
+#include "util/globalCalib.h"
+
+namespace dso
+{
+
+FrameImagePool& FrameImagePool::instance()
+{
+	// intentionally leaked, as frames can still be deleted during static destruction.
+	static FrameImagePool* pool = new FrameImagePool();
+	return *pool;
+}
+
+void FrameImagePool::acquire(Eigen::Vector3f** dIp) { acquireImpl(densePool, dIp); }
+void FrameImagePool::acquire(CompactPixel** dIpCompact) { acquireImpl(compactPool, dIpCompact); }
+void FrameImagePool::acquire(float** absSquaredGrad) { acquireImpl(gradPool, absSquaredGrad); }
+void FrameImagePool::release(Eigen::Vector3f** dIp) { releaseImpl(densePool, dIp); }
+void FrameImagePool::release(CompactPixel** dIpCompact) { releaseImpl(compactPool, dIpCompact); }
+void FrameImagePool::release(float** absSquaredGrad) { releaseImpl(gradPool, absSquaredGrad); }
+
+template<typename T>
+void FrameImagePool::acquireImpl(std::vector<Buffers<T>>& pool, T** levels)
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while(!pool.empty())
+		{
+			Buffers<T> buffers = pool.back();
+			pool.pop_back();
+			if(buffers.w == wG[0] && buffers.h == hG[0] && buffers.numLevels == pyrLevelsUsed)
+			{
+				for(int i=0;i<pyrLevelsUsed;i++)
+					levels[i] = buffers.levels[i];
+				return;
+			}
+			freeBuffers(buffers);
+		}
+	}
+
+	for(int i=0;i<pyrLevelsUsed;i++)
+		levels[i] = new T[wG[i]*hG[i]];
+}
+
+template<typename T>
+void FrameImagePool::releaseImpl(std::vector<Buffers<T>>& pool, T** levels)
+{
+	if(levels[0] == 0) return;
+
+	Buffers<T> buffers;
+	buffers.w = wG[0];
+	buffers.h = hG[0];
+	buffers.numLevels = pyrLevelsUsed;
+	for(int i=0;i<pyrLevelsUsed;i++)
+	{
+		buffers.levels[i] = levels[i];
+		levels[i] = 0;
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	if((int)pool.size() < maxPoolSize)
+		pool.push_back(buffers);
+	else
+		freeBuffers(buffers);
+}
+
+void FrameImagePool::clear()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	clearPool(densePool);
+	clearPool(compactPool);
+	clearPool(gradPool);
+}
+
+template<typename T>
+void FrameImagePool::clearPool(std::vector<Buffers<T>>& pool)
+{
+	for(Buffers<T>& buffers : pool)
+		freeBuffers(buffers);
+	pool.clear();
+}
+
+template<typename T>
+void FrameImagePool::freeBuffers(Buffers<T>& buffers)
+{
+	for(int i=0;i<buffers.numLevels;i++)
+		delete[] buffers.levels[i];
+}
+
+}
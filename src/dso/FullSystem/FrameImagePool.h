@@ -0,0 +1,82 @@
+/**
+* This file is part of DSO, written by Jakob Engel.
+* It has been modified by Lukas von Stumberg for the inclusion in DM-VIO (http://vision.in.tum.de/dm-vio).
+*
+* Copyright 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>
+* Copyright 2016 Technical University of Munich and Intel.
+* Developed by Jakob Engel <engelj at in dot tum dot de>,
+* for more information see <http://vision.in.tum.de/dso>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DSO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DSO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DSO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include "util/NumType.h"
+#include "util/settings.h"
+#include "util/CompactImage.h"
+
+namespace dso
+{
+
+// Recycles the image pyramid buffers (FrameHessian::dIp, dIpCompact and absSquaredGrad) of deleted frames, so that
+// adding a new frame does not need to allocate. Buffers are only reused if the pyramid size (wG, hG, pyrLevelsUsed) did
+// not change. Thread-safe, as frames are created in the tracking thread but deleted in the mapping thread.
+class FrameImagePool
+{
+public:
+	static FrameImagePool& instance();
+
+	// fills levels[0..pyrLevelsUsed) with buffers of size wG[lvl]*hG[lvl].
+	void acquire(Eigen::Vector3f** dIp);
+	void acquire(CompactPixel** dIpCompact);
+	void acquire(float** absSquaredGrad);
+	// takes ownership of the buffers and sets the pointers to 0. Does nothing if levels[0] is 0.
+	void release(Eigen::Vector3f** dIp);
+	void release(CompactPixel** dIpCompact);
+	void release(float** absSquaredGrad);
+
+	// frees all buffers currently in the pool.
+	void clear();
+
+private:
+	FrameImagePool() = default;
+
+	template<typename T>
+	struct Buffers
+	{
+		T* levels[PYR_LEVELS];
+		int w, h, numLevels;
+	};
+	template<typename T> void acquireImpl(std::vector<Buffers<T>>& pool, T** levels);
+	template<typename T> void releaseImpl(std::vector<Buffers<T>>& pool, T** levels);
+	template<typename T> static void freeBuffers(Buffers<T>& buffers);
+	template<typename T> static void clearPool(std::vector<Buffers<T>>& pool);
+
+	// A few more than the number of frames that are usually alive at the same time (non-keyframes are deleted right
+	// after tracking).
+	static constexpr int maxPoolSize = 8;
+
+	std::mutex mutex;
+	std::vector<Buffers<Eigen::Vector3f>> densePool;
+	std::vector<Buffers<CompactPixel>> compactPool;
+	std::vector<Buffers<float>> gradPool;
+};
+
+}
@@ -54,9 +54,12 @@
 
 #include "IOWrapper/Output3DWrapper.h"
 #include "util/ImageAndExposure.h"
+#include "util/Undistort.h"
 #include <cmath>
 
 #include "util/TimeMeasurement.h"
+#include "util/LockContention.h"
+#include "util/ThreadTopology.h"
 #include "GTSAMIntegration/ExtUtils.h"
 
 using dmvio::GravityInitializer;
@@ -69,16 +72,38 @@ int CalibHessian::instanceCounter=0;
 
 
 boost::mutex FrameShell::shellPoseMutex{};
+std::atomic<uint64_t> FrameShell::poseSeq{0};
+
+// Used by the tracking thread to read shell poses written by the mapping thread: Without waiting using the seqlock if
+// setting_nonBlockingTracking, otherwise with shellPoseMutex.
+template<typename Func> static void readShellPosesTracking(Func&& read)
+{
+	if(!setting_nonBlockingTracking)
+	{
+		auto crlock = dmvio::measuredLock(FrameShell::shellPoseMutex, "shellPoseMutex_tracking");
+		read();
+		return;
+	}
+	if(!setting_measureLockContention)
+	{
+		FrameShell::readPoses(read);
+		return;
+	}
+	// Includes the (short) time for copying, for comparison with the waiting time for the mutex.
+	dmvio::TimeMeasurement measurement("lockWait_shellPoseSeqlock_tracking");
+	FrameShell::readPoses(read);
+}
 
 FullSystem::FullSystem(bool linearizeOperationPassed, const dmvio::IMUCalibration& imuCalibration,
                        dmvio::IMUSettings& imuSettings)
-    : linearizeOperation(linearizeOperationPassed), imuIntegration(&Hcalib, imuCalibration, imuSettings,
-                                                                   linearizeOperation),
+    : linearizeOperation(linearizeOperationPassed), imuCalibration(imuCalibration), imuSettings(imuSettings),
+      imuIntegration(&Hcalib, imuCalibration, imuSettings, linearizeOperation),
                      secondKeyframeDone(false), gravityInit(imuSettings.numMeasurementsGravityInit, imuCalibration),
                      shellPoseMutex(FrameShell::shellPoseMutex)
 {
     setting_useGTSAMIntegration = setting_useIMU;
     baIntegration = imuIntegration.getBAGTSAMIntegration().get();
+    baIntegration->setThreadReduce(&treadReduce);
 
 	int retstat =0;
 	if(setting_logStuff)
@@ -148,8 +173,11 @@ FullSystem::FullSystem(bool linearizeOperationPassed, const dmvio::IMUCalibratio
 	coarseDistanceMap = new CoarseDistanceMap(wG[0], hG[0]);
 	coarseTracker = new CoarseTracker(wG[0], hG[0], imuIntegration);
 	coarseTracker_forNewKF = new CoarseTracker(wG[0], hG[0], imuIntegration);
+	coarseTracker->red = coarseTracker_forNewKF->red = &this->treadReduce;
 	coarseInitializer = new CoarseInitializer(wG[0], hG[0]);
+	coarseInitializer->red = &this->trackingReduce;
 	pixelSelector = new PixelSelector(wG[0], hG[0]);
+	pixelSelector->red = &this->treadReduce;
 
 	statistics_lastNumOptIts=0;
 	statistics_numDroppedPoints=0;
@@ -161,6 +189,7 @@ FullSystem::FullSystem(bool linearizeOperationPassed, const dmvio::IMUCalibratio
 	statistics_numMargResBwd = 0;
 
 	lastCoarseRMSE.setConstant(100);
+	lastPredictionCorrection = NAN;
 
 	currentMinActDist=2;
 	initialized=false;
@@ -189,6 +218,8 @@ FullSystem::FullSystem(bool linearizeOperationPassed, const dmvio::IMUCalibratio
 FullSystem::~FullSystem()
 {
 	blockUntilMappingIsFinished();
+	if(checkpointWriter)
+		checkpointWriter->end();
 
 	if(setting_logStuff)
 	{
@@ -219,6 +250,82 @@ FullSystem::~FullSystem()
 	delete ef;
 }
 
+void FullSystem::reset()
+{
+	dmvio::TimeMeasurement timeMeasurement("warmReset");
+
+	// Drop the queued frames and wait until the mapping thread is idle. It keeps running afterwards.
+	{
+		boost::unique_lock<boost::mutex> lock(trackMapSyncMutex);
+		for(FrameHessian* fh : unmappedTrackedFrames)
+			delete fh;
+		unmappedTrackedFrames.clear();
+		while(mappingBusy)
+		{
+			mappedFrameSignal.wait(lock);
+		}
+	}
+
+	boost::unique_lock<boost::mutex> lock(trackMutex);
+	boost::unique_lock<boost::mutex> mapLock(mapMutex);
+
+	// The CoarseTrackers keep a reference to imuIntegration, so it is reset in place.
+	setting_useGTSAMIntegration = setting_useIMU;
+	imuIntegration.reset(&Hcalib);
+	baIntegration = imuIntegration.getBAGTSAMIntegration().get();
+	baIntegration->setThreadReduce(&treadReduce);
+	gravityInit = dmvio::GravityInitializer(imuSettings.numMeasurementsGravityInit, imuCalibration);
+	imuUsedBefore = false;
+	if(imuPropagator) imuPropagator->reset();
+
+	// Delete the EF structs first, as the FrameHessians assert that they are not part of the energy functional anymore.
+	ef->reset(*baIntegration);
+	for(FrameHessian* fh : frameHessians)
+		delete fh;
+	if(!initialized && coarseInitializer->frameID >= 0)
+		delete coarseInitializer->firstFrame;
+	frameHessians.clear();
+	activeResiduals.clear();
+	activePoints.clear();
+
+	{
+		boost::unique_lock<boost::mutex> crlock(shellPoseMutex);
+		for(FrameShell* s : allFrameHistory)
+			delete s;
+		allFrameHistory.clear();
+		allKeyFramesHistory.clear();
+	}
+	gtPoses.clear();
+
+	coarseTracker->reset();
+	coarseTracker_forNewKF->reset();
+	coarseInitializer->reset();
+	pixelSelector->invalidateCache();
+	Hcalib.resetValue();
+
+	statistics_lastNumOptIts=0;
+	statistics_numDroppedPoints=0;
+	statistics_numActivatedPoints=0;
+	statistics_numCreatedPoints=0;
+	statistics_numForceDroppedResBwd = 0;
+	statistics_numForceDroppedResFwd = 0;
+	statistics_numMargResFwd = 0;
+	statistics_numMargResBwd = 0;
+
+	lastCoarseRMSE.setConstant(100);
+	lastPredictionCorrection = NAN;
+	currentMinActDist=2;
+	initialized=false;
+	isLost=false;
+	initFailed=false;
+	needNewKFAfter = -1;
+	needToKetchupMapping = false;
+	lastRefStopID=0;
+	secondKeyframeDone = false;
+	framesBetweenKFsRest = 0.0;
+	firstPose = Sophus::SE3();
+}
+
 void FullSystem::setOriginalCalib(const VecXf &originalCalib, int originalW, int originalH)
 {
 
@@ -319,10 +426,12 @@ std::pair<Vec4, bool> FullSystem::trackNewCoarse(FrameHessian* fh, Sophus::SE3 *
     {
         // We got a hint (typically from IMU) where our pose is, so we don't need the random initializations below.
         lastF_2_fh_tries.push_back(*referenceToFrameHint);
+        // read with global pose consistency (probably we don't need this for AffineLight, but just to make sure).
+        bool noWellTrackedFrame = false;
+        readShellPosesTracking([&]()
         {
-            // lock on global pose consistency (probably we don't need this for AffineLight, but just to make sure).
-            boost::unique_lock<boost::mutex> crlock(shellPoseMutex);
             // Set Affine light to last frame, where tracking was good!:
+            noWellTrackedFrame = false;
             for(int i = allFrameHistory.size() - 2; i >= 0; i--)
             {
                 FrameShell* slast = allFrameHistory[i];
@@ -333,11 +442,15 @@ std::pair<Vec4, bool> FullSystem::trackNewCoarse(FrameHessian* fh, Sophus::SE3 *
                 }
                 if(slast->trackingRef != lastF->shell)
                 {
-                    std::cout << "WARNING: No well tracked frame with the same tracking ref available!" << std::endl;
-                    aff_last_2_l = lastF->aff_g2l();
+                    noWellTrackedFrame = true;
                     break;
                 }
             }
+        });
+        if(noWellTrackedFrame)
+        {
+            std::cout << "WARNING: No well tracked frame with the same tracking ref available!" << std::endl;
+            aff_last_2_l = lastF->aff_g2l();
         }
     }
 
@@ -351,12 +464,13 @@ std::pair<Vec4, bool> FullSystem::trackNewCoarse(FrameHessian* fh, Sophus::SE3 *
             FrameShell* sprelast = allFrameHistory[allFrameHistory.size()-3];
             SE3 slast_2_sprelast;
             SE3 lastF_2_slast;
-            {	// lock on global pose consistency!
-                boost::unique_lock<boost::mutex> crlock(shellPoseMutex);
+            // read with global pose consistency!
+            readShellPosesTracking([&]()
+            {
                 slast_2_sprelast = sprelast->camToWorld.inverse() * slast->camToWorld;
                 lastF_2_slast = slast->camToWorld.inverse() * lastF->shell->camToWorld;
                 aff_last_2_l = slast->aff_g2l;
-            }
+            });
             SE3 fh_2_slast = slast_2_sprelast;// assumed to be the same as fh_2_slast.
 
 
@@ -423,14 +537,71 @@ std::pair<Vec4, bool> FullSystem::trackNewCoarse(FrameHessian* fh, Sophus::SE3 *
 	Vec5 achievedRes = Vec5::Constant(NAN);
 	bool haveOneGood = false;
 	int tryIterations=0;
+
+	// With a trusted IMU prediction the coarse levels mostly re-confirm it, so we can start at a finer level.
+	int adaptiveStartLvl = pyrLevelsUsed-1;
+	int adaptiveIterations[PYR_LEVELS];
+	Mat66 predictionCov;
+	// Time for the prediction covariance, which is an overhead of the adaptive start level.
+	double covarianceTime = 0;
+	bool haveCovariance = false;
+	if(referenceToFrameHint && setting_coarseAdaptiveStartLevel && std::isfinite(lastPredictionCorrection))
+	{
+		dmvio::TimeMeasurement covarianceMeasurement("coarseTrackingAdaptiveCovariance");
+		haveCovariance = imuIntegration.getCoarsePredictionCovariance(predictionCov);
+		covarianceTime = covarianceMeasurement.end();
+	}
+	if(haveCovariance)
+	{
+		float predictedStd = coarseTracker->pixelStdFromPoseStd(sqrt(predictionCov.topLeftCorner<3,3>().trace()),
+				sqrt(predictionCov.bottomRightCorner<3,3>().trace()) / imuIntegration.getCoarseScale());
+		float expectedError = std::max(setting_coarseAdaptiveSigmaFactor * predictedStd, lastPredictionCorrection);
+		adaptiveStartLvl = coarseTracker->chooseStartLevel(expectedError, pyrLevelsUsed-1, adaptiveIterations);
+	}
+	if(covarianceTime > 0 && adaptiveStartLvl == pyrLevelsUsed-1)
+		dmvio::TimeMeasurement::addMeasurement("coarseTrackingAdaptiveSavedTime", -covarianceTime);
+
 	for(unsigned int i=0;i<lastF_2_fh_tries.size();i++)
 	{
 		AffLight aff_g2l_this = aff_last_2_l;
 		SE3 lastF_2_fh_this = lastF_2_fh_tries[i];
-		bool trackingIsGood = coarseTracker->trackNewestCoarse(
-				fh, lastF_2_fh_this, aff_g2l_this,
-				pyrLevelsUsed-1,
-				achievedRes);	// in each level has to be at least as good as the last try.
+		bool trackingIsGood = false;
+		bool adaptiveSucceeded = false;
+		if(i == 0 && adaptiveStartLvl < pyrLevelsUsed-1)
+		{
+			dmvio::TimeMeasurement adaptiveTime("coarseTrackingAdaptive");
+			trackingIsGood = coarseTracker->trackNewestCoarse(
+					fh, lastF_2_fh_this, aff_g2l_this,
+					adaptiveStartLvl,
+					achievedRes, 0, adaptiveIterations);
+			double attemptTime = adaptiveTime.end();
+			adaptiveSucceeded = trackingIsGood && std::isfinite((float)coarseTracker->lastResiduals[0])
+					&& coarseTracker->lastResiduals[0] < lastCoarseRMSE[0]*setting_reTrackThreshold;
+
+			double savedTime = -attemptTime;
+			if(adaptiveSucceeded)
+			{
+				savedTime = 0;
+				for(int lvl=adaptiveStartLvl+1; lvl<pyrLevelsUsed; lvl++)
+					if(coarseTracker->levelTime[lvl] > 0) savedTime += coarseTracker->levelTime[lvl];
+			}else
+			{
+				if(!setting_debugout_runquiet)
+					printf("Adaptive coarse tracking from lvl %d failed (res %f), tracking all levels.\n",
+							adaptiveStartLvl, coarseTracker->lastResiduals[0]);
+				aff_g2l_this = aff_last_2_l;
+				lastF_2_fh_this = lastF_2_fh_tries[i];
+				imuIntegration.resetCoarseToPrediction();
+			}
+			dmvio::TimeMeasurement::addMeasurement("coarseTrackingAdaptiveSavedTime", savedTime - covarianceTime);
+		}
+		if(!adaptiveSucceeded)
+		{
+			trackingIsGood = coarseTracker->trackNewestCoarse(
+					fh, lastF_2_fh_this, aff_g2l_this,
+					pyrLevelsUsed-1,
+					achievedRes);	// in each level has to be at least as good as the last try.
+		}
 		tryIterations++;
 
 		if(trackingIsGood)
@@ -504,6 +675,9 @@ std::pair<Vec4, bool> FullSystem::trackNewCoarse(FrameHessian* fh, Sophus::SE3 *
 	}
 
 	lastCoarseRMSE = achievedRes;
+	// How far the tracking moved the points away from the IMU prediction (used for the adaptive start level).
+	lastPredictionCorrection = referenceToFrameHint && haveOneGood ?
+			coarseTracker->meanPixelShift(lastF_2_fh_tries[0], lastF_2_fh) : NAN;
 
 	// no lock required, as fh is not used anywhere yet.
 	fh->shell->camToTrackingRef = lastF_2_fh.inverse();
@@ -591,12 +765,22 @@ void FullSystem::activatePointsMT_Reductor(
 		std::vector<ImmaturePoint*>* toOptimize,
 		int min, int max, Vec10* stats, int tid)
 {
-	ImmaturePointTemporaryResidual* tr = new ImmaturePointTemporaryResidual[frameHessians.size()];
-	for(int k=min;k<max;k++)
+	ImmaturePointTemporaryResidual* tr = activationScratch[tid].data();
+	if(!setting_batchedPointActivation)
+	{
+		for(int k=min;k<max;k++)
+			(*optimized)[k] = optimizeImmaturePoint((*toOptimize)[k],1,tr);
+		return;
+	}
+
+	// toOptimize is ordered by host, so consecutive points can share a batch.
+	for(int k=min;k<max;)
 	{
-		(*optimized)[k] = optimizeImmaturePoint((*toOptimize)[k],1,tr);
+		int num=1;
+		while(num < 4 && k+num < max && (*toOptimize)[k+num]->host == (*toOptimize)[k]->host) num++;
+		optimizeImmaturePointsBatch(&(*toOptimize)[k], num, 1, &(*optimized)[k], tr);
+		k += num;
 	}
-	delete[] tr;
 }
 
 
@@ -722,6 +906,11 @@ void FullSystem::activatePointsMT()
 
 	std::vector<PointHessian*> optimized; optimized.resize(toOptimize.size());
 
+	// per-thread scratch for the temporary residuals (4 lanes for the batched activation), only grows.
+	activationScratch.resize(NUM_THREADS);
+	for(auto& scratch : activationScratch)
+		if(scratch.size() < 4*frameHessians.size()) scratch.resize(4*frameHessians.size());
+
 	if(multiThreading)
 		treadReduce.reduce(boost::bind(&FullSystem::activatePointsMT_Reductor, this, &optimized, &toOptimize, _1, _2, _3, _4), 0, toOptimize.size(), 50);
 
@@ -880,6 +1069,33 @@ void FullSystem::flagPointsForRemoval()
 
 // The function is passed the IMU-data from the previous frame until the current frame.
 void FullSystem::addActiveFrame(ImageAndExposure* image, int id, dmvio::IMUData* imuData, dmvio::GTData* gtData)
+{
+    addActiveFrameInternal(image->timestamp, id, imuData, gtData, [&](FrameHessian* fh)
+    {
+        fh->ab_exposure = image->exposure_time;
+        fh->makeImages(image->image, &Hcalib, setting_multiThreadedPyramid ? &trackingReduce : 0);
+    });
+}
+
+template<typename T>
+void FullSystem::addActiveFrame(const Undistort& undistorter, const ImageView<T>& image, float exposure,
+                                double timestamp, int id, dmvio::IMUData* imuData, dmvio::GTData* gtData, float factor)
+{
+    addActiveFrameInternal(timestamp, id, imuData, gtData, [&](FrameHessian* fh)
+    {
+        fh->allocateImages();
+        // Write directly into the first channel of dI.
+        fh->ab_exposure = undistorter.undistortInto(image, fh->dI[0].data(), 3, exposure, factor);
+        fh->makePyramid(&Hcalib, setting_multiThreadedPyramid ? &trackingReduce : 0);
+    });
+}
+template void FullSystem::addActiveFrame<unsigned char>(const Undistort& undistorter, const ImageView<unsigned char>& image, float exposure,
+                                                        double timestamp, int id, dmvio::IMUData* imuData, dmvio::GTData* gtData, float factor);
+template void FullSystem::addActiveFrame<unsigned short>(const Undistort& undistorter, const ImageView<unsigned short>& image, float exposure,
+                                                         double timestamp, int id, dmvio::IMUData* imuData, dmvio::GTData* gtData, float factor);
+
+void FullSystem::addActiveFrameInternal(double timestamp, int id, dmvio::IMUData* imuData, dmvio::GTData* gtData,
+                                        const std::function<void(FrameHessian*)>& makeImages)
 {
     // Measure Time of the time measurement.
     dmvio::TimeMeasurement timeMeasurementMeasurement("timeMeasurement");
@@ -888,7 +1104,7 @@ void FullSystem::addActiveFrame(ImageAndExposure* image, int id, dmvio::IMUData*
     timeMeasurementMeasurement.end();
 
     dmvio::TimeMeasurement timeMeasurement("addActiveFrame");
-	boost::unique_lock<boost::mutex> lock(trackMutex);
+	auto lock = dmvio::measuredLock(trackMutex, "trackMutex_tracking");
 
 
 	dmvio::TimeMeasurement measureInit("initObjectsAndMakeImage");
@@ -898,15 +1114,14 @@ void FullSystem::addActiveFrame(ImageAndExposure* image, int id, dmvio::IMUData*
 	shell->camToWorld = SE3(); 		// no lock required, as fh is not used anywhere yet.
 	shell->aff_g2l = AffLight(0,0);
     shell->marginalizedAt = shell->id = allFrameHistory.size();
-    shell->timestamp = image->timestamp;
+    shell->timestamp = timestamp;
     shell->incoming_id = id;
 	fh->shell = shell;
 	allFrameHistory.push_back(shell);
 
 
     // =========================== make Images / derivatives etc. =========================
-	fh->ab_exposure = image->exposure_time;
-	fh->makeImages(image->image, &Hcalib);
+	makeImages(fh);
 
     measureInit.end();
 
@@ -960,11 +1175,9 @@ void FullSystem::addActiveFrame(ImageAndExposure* image, int id, dmvio::IMUData*
                 {
                     // Do full reset so that the next frame becomes the first initializer frame.
                     setting_fullResetRequested = true;
-                }else
-                {
-                    fh->shell->poseValid = false;
-                    delete fh;
                 }
+                fh->shell->poseValid = false;
+                delete fh;
             }
         }
 		return;
@@ -977,10 +1190,25 @@ void FullSystem::addActiveFrame(ImageAndExposure* image, int id, dmvio::IMUData*
 
 		// =========================== SWAP tracking reference?. =========================
 		bool trackingRefChanged = false;
-		if(coarseTracker_forNewKF->refFrameID > coarseTracker->refFrameID)
+		bool swapRef = coarseTracker_forNewKF->refFrameID > coarseTracker->refFrameID;
+		boost::unique_lock<boost::mutex> crlock;
+		if(swapRef)
+		{
+			if(setting_nonBlockingTracking && !linearizeOperation)
+			{
+				// If the mapping thread is still preparing the new reference (including its fine levels) we keep
+				// tracking on the old one and swap with the next frame.
+				crlock = boost::unique_lock<boost::mutex>(coarseTrackerSwapMutex, boost::try_to_lock);
+				swapRef = crlock.owns_lock() && coarseTracker_forNewKF->isLevelReady(0);
+				if(!swapRef && crlock.owns_lock()) crlock.unlock();
+			}else
+			{
+				crlock = dmvio::measuredLock(coarseTrackerSwapMutex, "coarseTrackerSwapMutex_tracking");
+			}
+		}
+		if(swapRef)
 		{
             dmvio::TimeMeasurement referenceSwapTime("swapTrackingRef");
-			boost::unique_lock<boost::mutex> crlock(coarseTrackerSwapMutex);
 			CoarseTracker* tmp = coarseTracker; coarseTracker=coarseTracker_forNewKF; coarseTracker_forNewKF=tmp;
 
 			if(dso::setting_useIMU)
@@ -999,6 +1227,7 @@ void FullSystem::addActiveFrame(ImageAndExposure* image, int id, dmvio::IMUData*
 
 				trackingRefChanged = true;
 			}
+			crlock.unlock();
 		}
 
         SE3 *referenceToFramePassed = 0;
@@ -1104,6 +1333,12 @@ void FullSystem::addActiveFrame(ImageAndExposure* image, int id, dmvio::IMUData*
             imuIntegration.finishCoarseTracking(*(fh->shell), needToMakeKF);
         }
 
+        dmvio::IMUState imuState;
+        if(imuPropagator && setting_useIMU && imuIntegration.getCoarseIMUState(*(fh->shell), imuState))
+        {
+            imuPropagator->reanchor(imuState);
+        }
+
         if(needToMakeKF && setting_useIMU && linearizeOperation)
         {
             imuIntegration.setGTData(gtData, fh->shell->id);
@@ -1159,7 +1394,10 @@ void FullSystem::deliverTrackedFrame(FrameHessian* fh, bool needKF)
 	{
 		if(goStepByStep && lastRefStopID != coarseTracker->refFrameID)
 		{
-			MinimalImageF3 img(wG[0], hG[0], fh->dI);
+			MinimalImageF3 img(wG[0], hG[0]);
+			const ImageLevel dI = fh->image(0);
+			for(int i=0;i<wG[0]*hG[0];i++)
+				img.at(i) = dI[i];
 			IOWrap::displayImage("frameToTrack", &img);
 			while(true)
 			{
@@ -1215,10 +1453,12 @@ void FullSystem::deliverTrackedFrame(FrameHessian* fh, bool needKF)
 
 void FullSystem::mappingLoop()
 {
+	dmvio::ThreadTopology::applyToCurrentThread(dmvio::THREAD_MAPPING);
 	boost::unique_lock<boost::mutex> lock(trackMapSyncMutex);
 
 	while(runMapping)
 	{
+		mappingBusy = false;
 		while(unmappedTrackedFrames.size()==0)
 		{
 			trackedFrameSignal.wait(lock);
@@ -1227,6 +1467,7 @@ void FullSystem::mappingLoop()
 
 		FrameHessian* fh = unmappedTrackedFrames.front();
 		unmappedTrackedFrames.pop_front();
+		mappingBusy = true;
 
         if(!setting_debugout_runquiet)
         {
@@ -1273,9 +1514,12 @@ void FullSystem::mappingLoop()
 				FrameHessian* fh = unmappedTrackedFrames.front();
 				unmappedTrackedFrames.pop_front();
 				{
-					boost::unique_lock<boost::mutex> crlock(shellPoseMutex);
+					auto crlock = dmvio::measuredLock(shellPoseMutex, "shellPoseMutex_mapping");
 					assert(fh->shell->trackingRef != 0);
-					fh->shell->camToWorld = fh->shell->trackingRef->camToWorld * fh->shell->camToTrackingRef;
+					{
+						FrameShell::PoseWriteGuard guard;
+						fh->shell->camToWorld = fh->shell->trackingRef->camToWorld * fh->shell->camToTrackingRef;
+					}
 					fh->setEvalPT_scaled(fh->shell->camToWorld.inverse(),fh->shell->aff_g2l);
 				}
 				delete fh;
@@ -1308,6 +1552,17 @@ void FullSystem::mappingLoop()
 	printf("MAPPING FINISHED!\n");
 }
 
+int FullSystem::getNumUnmappedFrames()
+{
+	boost::unique_lock<boost::mutex> lock(trackMapSyncMutex);
+	return unmappedTrackedFrames.size();
+}
+
+double FullSystem::getMappingTimeSum() const
+{
+	return mappingTimeSum.load();
+}
+
 void FullSystem::blockUntilMappingIsFinished()
 {
 	boost::unique_lock<boost::mutex> lock(trackMapSyncMutex);
@@ -1324,14 +1579,18 @@ void FullSystem::makeNonKeyFrame( FrameHessian* fh)
     dmvio::TimeMeasurement timeMeasurement("makeNonKeyframe");
 	// needs to be set by mapping thread. no lock required since we are in mapping thread.
 	{
-		boost::unique_lock<boost::mutex> crlock(shellPoseMutex);
+		auto crlock = dmvio::measuredLock(shellPoseMutex, "shellPoseMutex_mapping");
 		assert(fh->shell->trackingRef != 0);
-		fh->shell->camToWorld = fh->shell->trackingRef->camToWorld * fh->shell->camToTrackingRef;
+		{
+			FrameShell::PoseWriteGuard guard;
+			fh->shell->camToWorld = fh->shell->trackingRef->camToWorld * fh->shell->camToTrackingRef;
+		}
 		fh->setEvalPT_scaled(fh->shell->camToWorld.inverse(),fh->shell->aff_g2l);
 	}
 
 	traceNewCoarse(fh);
 	delete fh;
+	mappingTimeSum.store(mappingTimeSum.load() + timeMeasurement.end());
 }
 
 void FullSystem::makeKeyFrame( FrameHessian* fh)
@@ -1339,9 +1598,12 @@ void FullSystem::makeKeyFrame( FrameHessian* fh)
     dmvio::TimeMeasurement timeMeasurement("makeKeyframe");
 	// needs to be set by mapping thread
 	{
-		boost::unique_lock<boost::mutex> crlock(shellPoseMutex);
+		auto crlock = dmvio::measuredLock(shellPoseMutex, "shellPoseMutex_mapping");
 		assert(fh->shell->trackingRef != 0);
-		fh->shell->camToWorld = fh->shell->trackingRef->camToWorld * fh->shell->camToTrackingRef;
+		{
+			FrameShell::PoseWriteGuard guard;
+			fh->shell->camToWorld = fh->shell->trackingRef->camToWorld * fh->shell->camToTrackingRef;
+		}
 		fh->setEvalPT_scaled(fh->shell->camToWorld.inverse(),fh->shell->aff_g2l);
 		int prevKFId = fh->shell->trackingRef->id;
 		int framesBetweenKFs = fh->shell->id - prevKFId - 1;
@@ -1445,9 +1707,10 @@ void FullSystem::makeKeyFrame( FrameHessian* fh)
     }
 
     bool imuReady = false;
+    CoarseTracker* newTrackingRef;
 	{
         dmvio::TimeMeasurement timeMeasurement("makeKeyframeChangeTrackingRef");
-		boost::unique_lock<boost::mutex> crlock(coarseTrackerSwapMutex);
+		auto crlock = dmvio::measuredLock(coarseTrackerSwapMutex, "coarseTrackerSwapMutex_mapping");
 
         if(setting_useIMU)
         {
@@ -1455,13 +1718,16 @@ void FullSystem::makeKeyFrame( FrameHessian* fh)
         }
 
         coarseTracker_forNewKF->makeK(&Hcalib);
-		coarseTracker_forNewKF->setCoarseTrackingRef(frameHessians);
-
-
-        coarseTracker_forNewKF->debugPlotIDepthMap(&minIdJetVisTracker, &maxIdJetVisTracker, outputWrapper);
-        coarseTracker_forNewKF->debugPlotIDepthMapFloat(outputWrapper);
+		coarseTracker_forNewKF->setCoarseTrackingRef(frameHessians, setting_coarseTrackerPublishLevel);
+		newTrackingRef = coarseTracker_forNewKF;
 	}
 
+	// Without setting_nonBlockingTracking the tracker might already have swapped to newTrackingRef, it waits for the
+	// fine levels if it needs them.
+	newTrackingRef->finishCoarseTrackingRef();
+    newTrackingRef->debugPlotIDepthMap(&minIdJetVisTracker, &maxIdJetVisTracker, outputWrapper);
+    newTrackingRef->debugPlotIDepthMapFloat(outputWrapper);
+
 
 	debugPlot("post Optimize");
 
@@ -1537,6 +1803,14 @@ void FullSystem::makeKeyFrame( FrameHessian* fh)
     {
         imuIntegration.finishKeyframeOperations(fh->shell->id);
     }
+
+    // Checkpoints are only written once VIO is initialized, as the IMU initializer state is not stored.
+    if(checkpointWriter && setting_checkpointInterval > 0 && fh->frameID % setting_checkpointInterval == 0 &&
+       (!setting_useIMU || imuUsedBefore))
+    {
+        checkpointWriter->addCheckpoint(createCheckpoint());
+    }
+    mappingTimeSum.store(mappingTimeSum.load() + timeMeasurement.end());
 }
 
 
@@ -1617,6 +1891,7 @@ void FullSystem::initializeFromInitializer(FrameHessian* newFrame)
 	// really no lock required, as we are initializing.
 	{
 		boost::unique_lock<boost::mutex> crlock(shellPoseMutex);
+		FrameShell::PoseWriteGuard guard;
         firstFrame->shell->camToWorld = firstPose;
 		firstFrame->shell->aff_g2l = AffLight(0,0);
 		firstFrame->setEvalPT_scaled(firstFrame->shell->camToWorld.inverse(),firstFrame->shell->aff_g2l);
@@ -28,6 +28,8 @@
 #define MAX_ACTIVE_FRAMES 100
 
 #include <deque>
+#include <atomic>
+#include <functional>
 #include "util/NumType.h"
 #include "util/globalCalib.h"
 #include "vector"
@@ -38,11 +40,13 @@
 #include "FullSystem/Residuals.h"
 #include "FullSystem/HessianBlocks.h"
 #include "util/FrameShell.h"
+#include "util/ImageView.h"
 #include "util/IndexThreadReduce.h"
 #include "OptimizationBackend/EnergyFunctional.h"
 #include "FullSystem/PixelSelector2.h"
 #include "IMU/IMUIntegration.hpp"
 #include "util/GTData.hpp"
+#include "util/SystemCheckpoint.h"
 
 #include <math.h>
 #include "IMUInitialization/GravityInitializer.h"
@@ -62,6 +66,7 @@ struct PointHessian;
 class CoarseInitializer;
 struct ImmaturePointTemporaryResidual;
 class ImageAndExposure;
+class Undistort;
 class CoarseDistanceMap;
 
 class EnergyFunctional;
@@ -144,6 +149,14 @@ public:
 	// adds a new frame, and creates point & residual structs.
     void addActiveFrame(ImageAndExposure* image, int id, dmvio::IMUData* imuData, dmvio::GTData* gtData);
 
+    // Same as above, but takes the raw caller-owned image (8 or 16 bit, possibly strided) and undistorts it directly
+    // into the (pooled) image buffers of the new frame, avoiding the intermediate ImageAndExposure.
+    // factor is applied to the raw values if there is no photometric calibration (e.g. 1/256 for 16 bit images).
+    // imuData is not copied.
+    template<typename T>
+    void addActiveFrame(const Undistort& undistorter, const ImageView<T>& image, float exposure, double timestamp,
+                        int id, dmvio::IMUData* imuData, dmvio::GTData* gtData, float factor = 1.0f);
+
 	// marginalizes a frame. drops / marginalizes points & residuals.
 	void marginalizeFrame(FrameHessian* frame);
 	void blockUntilMappingIsFinished();
@@ -158,6 +171,8 @@ public:
 	// contains pointers to active frames
 
     std::vector<IOWrap::Output3DWrapper*> outputWrapper;
+    // If set, it is re-anchored with the state of each frame tracked with IMU (see IMUPropagator.h). Not owned.
+    dmvio::IMUPropagator* imuPropagator = nullptr;
 
 	bool isLost;
 	bool initFailed;
@@ -168,11 +183,36 @@ public:
 	void setGammaFunction(float* BInv);
     void setOriginalCalib(const VecXf &originalCalib, int originalW, int originalH);
 
+    // Load indicators (e.g. for dmvio::ComputeBudgetController). Thread-safe.
+    int getNumUnmappedFrames();
+    double getMappingTimeSum() const; // Accumulated time spent in makeKeyFrame and makeNonKeyFrame.
+
+    // Write a checkpoint to filename every setting_checkpointInterval keyframes (asynchronously).
+    void enableCheckpoints(const std::string& filename);
+    // Must be called before the first frame is added. Afterwards the system continues in the restored mode
+    // (visual-inertial if the checkpoint contains IMU state) with the next frame after the last restored keyframe.
+    void restoreFromCheckpoint(const dmvio::SystemCheckpoint& checkpoint);
+
+    // Clears all frames, points and the IMU state, so that the next frame starts a new initialization. Cheaper than
+    // deleting and recreating the FullSystem as the threads, image buffers and calibration are kept.
+    // Must not be called concurrently with addActiveFrame. The output wrappers are not reset.
+    void reset();
+
 private:
+    // Creates the FrameHessian, calls makeImages on it and then does the tracking / initialization.
+    void addActiveFrameInternal(double timestamp, int id, dmvio::IMUData* imuData, dmvio::GTData* gtData,
+                                const std::function<void(FrameHessian*)>& makeImages);
 
+    // needed to recreate the imuIntegration in reset().
+    const dmvio::IMUCalibration imuCalibration;
+    dmvio::IMUSettings& imuSettings;
     dmvio::IMUIntegration imuIntegration;
     bool imuUsedBefore = false;
     dmvio::BAGTSAMIntegration* baIntegration = nullptr;
+
+    // Called by the mapping thread at the end of makeKeyFrame.
+    std::unique_ptr<dmvio::SystemCheckpoint> createCheckpoint();
+    std::unique_ptr<dmvio::CheckpointWriter> checkpointWriter;
 public:
 	dmvio::IMUIntegration &getImuIntegration();
 
@@ -190,6 +230,10 @@ private:
     // opt single point
 	int optimizePoint(PointHessian* point, int minObs, bool flagOOB);
 	PointHessian* optimizeImmaturePoint(ImmaturePoint* point, int minObs, ImmaturePointTemporaryResidual* residuals);
+	// same as optimizeImmaturePoint for up to 4 points of the same host, run in lockstep in SSE lanes.
+	// residuals needs space for 4*(frameHessians.size()-1) entries.
+	void optimizeImmaturePointsBatch(ImmaturePoint** points, int num, int minObs, PointHessian** out, ImmaturePointTemporaryResidual* residuals);
+	PointHessian* makeActivatedPoint(ImmaturePoint* point, float idepth, int minObs, ImmaturePointTemporaryResidual* residuals, int nres);
 
 	double linAllPointSinle(PointHessian* point, float outlierTHSlack, bool plot);
 
@@ -223,6 +267,9 @@ private:
 	void linearizeAll_Reductor(bool fixLinearization, std::vector<PointFrameResidual*>* toRemove, int min, int max, Vec10* stats, int tid);
 	void activatePointsMT_Reductor(std::vector<PointHessian*>* optimized,std::vector<ImmaturePoint*>* toOptimize,int min, int max, Vec10* stats, int tid);
 	void applyRes_Reductor(bool copyJacobians, int min, int max, Vec10* stats, int tid);
+	void applyResiduals();
+	Vec3 linearizeAllFused(double& energyL);
+	void linearizeAllFused_Reductor(int min, int max, Vec10* stats, int tid);
 
 	void printOptRes(const Vec3 &res, double resL, double resM, double resPrior, double LExact, float a, float b);
 
@@ -274,7 +321,11 @@ private:
 	std::vector<FrameShell*> allFrameHistory;
 	std::vector<Sophus::SE3> gtPoses;
 	CoarseInitializer* coarseInitializer;
+	// Separate pool for the tracking thread (image pyramids, coarse initializer), so that it never waits for a
+	// reduce of the mapping thread.
+	IndexThreadReduce<Vec10> trackingReduce;
 	Vec5 lastCoarseRMSE;
+	float lastPredictionCorrection; // mean pixel shift between IMU prediction and tracked pose of the last frame.
 
 
 	// ================== changed by mapper-thread. protected by mapMutex ===============
@@ -283,6 +334,7 @@ private:
 
 	EnergyFunctional* ef;
 	IndexThreadReduce<Vec10> treadReduce;
+	std::vector<std::vector<ImmaturePointTemporaryResidual>> activationScratch; // per thread, used by activatePointsMT.
 
 	float* selectionMap;
 	PixelSelector* pixelSelector;
@@ -290,6 +342,7 @@ private:
 
 	std::vector<FrameHessian*> frameHessians;	// ONLY changed in marginalizeFrame and addFrame.
 	std::vector<PointFrameResidual*> activeResiduals;
+	std::vector<PointHessian*> activePoints;
 	float currentMinActDist;
 
 
@@ -331,7 +384,9 @@ private:
 	int needNewKFAfter;	// Otherwise, a new KF is *needed that has ID bigger than [needNewKFAfter]*.
 	boost::thread mappingThread;
 	bool runMapping;
+	bool mappingBusy = false; // true while the mapping thread processes a frame it has taken from the queue.
 	bool needToKetchupMapping;
+	std::atomic<double> mappingTimeSum{0.0}; // only written by the mapping thread.
 
 	int lastRefStopID;
 
@@ -0,0 +1,330 @@
+/**
+* This file is part of DSO, written by Jakob Engel.
+* It has been modified by Lukas von Stumberg for the inclusion in DM-VIO (http://vision.in.tum.de/dm-vio).
+*
+* Copyright 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>
+* Copyright 2016 Technical University of Munich and Intel.
+* Developed by Jakob Engel <engelj at in dot tum dot de>,
+* for more information see <http://vision.in.tum.de/dso>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DSO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DSO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DSO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * Creating checkpoints of the active window and restoring the system from them.
+ */
+
+#include <util/TimeMeasurement.h>
+#include "FullSystem/FullSystem.h"
+
+#include "FullSystem/ImmaturePoint.h"
+#include "FullSystem/CoarseTracker.h"
+#include "OptimizationBackend/EnergyFunctional.h"
+#include "OptimizationBackend/EnergyFunctionalStructs.h"
+#include "IOWrapper/Output3DWrapper.h"
+#include "util/globalCalib.h"
+
+#include <stdexcept>
+
+namespace dso
+{
+
+void FullSystem::enableCheckpoints(const std::string& filename)
+{
+	checkpointWriter.reset(new dmvio::CheckpointWriter(filename));
+}
+
+// mapMutex must be locked.
+std::unique_ptr<dmvio::SystemCheckpoint> FullSystem::createCheckpoint()
+{
+	dmvio::TimeMeasurement timeMeasurement("createCheckpoint");
+	std::unique_ptr<dmvio::SystemCheckpoint> checkpoint(new dmvio::SystemCheckpoint);
+
+	checkpoint->width = wG[0];
+	checkpoint->height = hG[0];
+	checkpoint->calib = Hcalib.value;
+	checkpoint->calibZero = Hcalib.value_zero;
+	checkpoint->firstPose = firstPose.matrix();
+	// Non-keyframes after the newest keyframe are not stored, they have to be tracked again after restoring.
+	checkpoint->numFramesTotal = frameHessians.back()->shell->id + 1;
+	checkpoint->numKeyframesTotal = allKeyFramesHistory.size();
+
+	int numPixels = wG[0] * hG[0];
+	checkpoint->keyframes.resize(frameHessians.size());
+	for(unsigned int i = 0; i < frameHessians.size(); i++)
+	{
+		FrameHessian* fh = frameHessians[i];
+		dmvio::KeyframeCheckpoint& kf = checkpoint->keyframes[i];
+		kf.id = fh->shell->id;
+		kf.incomingId = fh->shell->incoming_id;
+		kf.frameId = fh->frameID;
+		kf.timestamp = fh->shell->timestamp;
+		kf.abExposure = fh->ab_exposure;
+		kf.frameEnergyTH = fh->frameEnergyTH;
+		{
+			boost::unique_lock<boost::mutex> crlock(shellPoseMutex);
+			kf.camToWorld = fh->shell->camToWorld.matrix();
+		}
+		kf.worldToCamEvalPT = fh->get_worldToCam_evalPT().matrix();
+		kf.stateZero = fh->get_state_zero();
+		kf.state = fh->get_state();
+
+		kf.image.resize(numPixels);
+		const ImageLevel dI = fh->image(0);
+		for(int idx = 0; idx < numPixels; idx++)
+			kf.image[idx] = dI[idx][0];
+
+		kf.points.reserve(fh->pointHessians.size());
+		for(PointHessian* ph : fh->pointHessians)
+		{
+			kf.points.emplace_back();
+			dmvio::PointCheckpoint& p = kf.points.back();
+			p.u = (int) ph->u;
+			p.v = (int) ph->v;
+			p.type = ph->my_type;
+			p.idepth = ph->idepth;
+			p.idepthZero = ph->idepth_zero;
+			p.maxRelBaseline = ph->maxRelBaseline;
+			p.numGoodResiduals = ph->numGoodResiduals;
+			p.hasDepthPrior = ph->hasDepthPrior;
+			p.residuals.resize(ph->residuals.size());
+			for(unsigned int r = 0; r < ph->residuals.size(); r++)
+			{
+				PointFrameResidual* res = ph->residuals[r];
+				p.residuals[r].targetIndex = res->target->idx;
+				p.residuals[r].state = res->state_state;
+				p.residuals[r].energy = res->state_energy;
+				p.residuals[r].isNew = res->isNew;
+			}
+			for(int l = 0; l < 2; l++)
+			{
+				auto it = std::find(ph->residuals.begin(), ph->residuals.end(), ph->lastResiduals[l].first);
+				p.lastResidualIndex[l] = it == ph->residuals.end() ? -1 : (int) (it - ph->residuals.begin());
+				p.lastResidualState[l] = ph->lastResiduals[l].second;
+			}
+		}
+
+		kf.immaturePoints.reserve(fh->immaturePoints.size());
+		for(ImmaturePoint* ip : fh->immaturePoints)
+		{
+			if(ip == 0) continue;
+			kf.immaturePoints.emplace_back();
+			dmvio::ImmaturePointCheckpoint& p = kf.immaturePoints.back();
+			p.u = (int) ip->u;
+			p.v = (int) ip->v;
+			p.type = ip->my_type;
+			p.idepthMin = ip->idepth_min;
+			p.idepthMax = ip->idepth_max;
+			p.quality = ip->quality;
+			p.lastTraceStatus = ip->lastTraceStatus;
+			p.lastTraceUV = ip->lastTraceUV;
+			p.lastTracePixelInterval = ip->lastTracePixelInterval;
+		}
+	}
+
+	checkpoint->HM = ef->HM;
+	checkpoint->bM = ef->bM;
+	checkpoint->HMForGTSAM = ef->HMForGTSAM;
+	checkpoint->bMForGTSAM = ef->bMForGTSAM;
+
+	if(setting_useIMU)
+	{
+		imuIntegration.fillCheckpoint(*checkpoint);
+	}else if(setting_useGTSAMIntegration)
+	{
+		baIntegration->fillCheckpoint(checkpoint->ba);
+	}
+	return checkpoint;
+}
+
+void FullSystem::restoreFromCheckpoint(const dmvio::SystemCheckpoint& checkpoint)
+{
+	boost::unique_lock<boost::mutex> lock(trackMutex);
+	boost::unique_lock<boost::mutex> mapLock(mapMutex);
+
+	if(initialized || !allFrameHistory.empty())
+		throw std::runtime_error("restoreFromCheckpoint must be called before the first frame.");
+	if(checkpoint.width != wG[0] || checkpoint.height != hG[0])
+		throw std::runtime_error("Checkpoint was created with a different image size.");
+	if(checkpoint.hasIMU != setting_useIMU || checkpoint.keyframes.empty())
+		throw std::runtime_error("Checkpoint does not match the current IMU mode.");
+
+	// =========================== restore frame history. =========================
+	// Frames which are not in the active window anymore only get placeholder shells, so that the ids stay the same.
+	std::vector<FrameShell*> keyframeShells;
+	{
+		boost::unique_lock<boost::mutex> crlock(shellPoseMutex);
+		FrameShell::PoseWriteGuard guard;
+		allFrameHistory.resize(checkpoint.numFramesTotal, nullptr);
+		for(const dmvio::KeyframeCheckpoint& kf : checkpoint.keyframes)
+		{
+			FrameShell* shell = new FrameShell();
+			shell->id = shell->marginalizedAt = kf.id;
+			shell->incoming_id = kf.incomingId;
+			shell->timestamp = kf.timestamp;
+			shell->camToWorld = SE3(kf.camToWorld);
+			shell->aff_g2l = AffLight(kf.state[6] * SCALE_A, kf.state[7] * SCALE_B);
+			shell->keyframeId = kf.frameId;
+			if(!keyframeShells.empty())
+			{
+				shell->trackingRef = keyframeShells.back();
+				shell->camToTrackingRef = shell->trackingRef->camToWorld.inverse() * shell->camToWorld;
+			}
+			keyframeShells.push_back(shell);
+			allFrameHistory[kf.id] = shell;
+		}
+
+		FrameShell* lastKFShell = keyframeShells.front();
+		for(int i = 0; i < checkpoint.numFramesTotal; i++)
+		{
+			if(allFrameHistory[i] != nullptr)
+			{
+				lastKFShell = allFrameHistory[i];
+				continue;
+			}
+			FrameShell* shell = new FrameShell();
+			shell->id = shell->marginalizedAt = i;
+			shell->camToWorld = lastKFShell->camToWorld;
+			shell->poseValid = false;
+			shell->trackingWasGood = false;
+			allFrameHistory[i] = shell;
+		}
+	}
+
+	// Only the size and the newest entries of allKeyFramesHistory are used, so marginalized keyframes are not restored.
+	allKeyFramesHistory.assign(checkpoint.numKeyframesTotal - keyframeShells.size(), nullptr);
+	for(FrameShell* shell : keyframeShells)
+		allKeyFramesHistory.push_back(shell);
+
+	Hcalib.value_zero = checkpoint.calibZero;
+	Hcalib.setValue(checkpoint.calib);
+
+	// =========================== restore frames. =========================
+	for(unsigned int i = 0; i < checkpoint.keyframes.size(); i++)
+	{
+		const dmvio::KeyframeCheckpoint& kf = checkpoint.keyframes[i];
+		FrameHessian* fh = new FrameHessian();
+		fh->shell = keyframeShells[i];
+		fh->ab_exposure = kf.abExposure;
+		std::vector<float> image(kf.image);
+		fh->makeImages(image.data(), &Hcalib);
+		fh->frameID = kf.frameId;
+		fh->idx = frameHessians.size();
+		fh->setEvalPT(SE3(kf.worldToCamEvalPT), kf.stateZero);
+		fh->setState(kf.state);
+		fh->frameEnergyTH = kf.frameEnergyTH;
+		frameHessians.push_back(fh);
+		ef->insertFrame(fh, &Hcalib);
+	}
+	setPrecalcValues();
+
+	// =========================== restore points and residuals. =========================
+	for(unsigned int i = 0; i < checkpoint.keyframes.size(); i++)
+	{
+		const dmvio::KeyframeCheckpoint& kf = checkpoint.keyframes[i];
+		FrameHessian* host = frameHessians[i];
+		host->pointHessians.reserve(kf.points.size());
+		for(const dmvio::PointCheckpoint& p : kf.points)
+		{
+			ImmaturePoint* pt = new ImmaturePoint(p.u, p.v, host, p.type, &Hcalib);
+			if(!std::isfinite(pt->energyTH)) { delete pt; continue; }
+			pt->idepth_max = pt->idepth_min = p.idepth;
+			PointHessian* ph = new PointHessian(pt, &Hcalib);
+			delete pt;
+			if(!std::isfinite(ph->energyTH)) { delete ph; continue; }
+
+			ph->setIdepthZero(p.idepthZero);
+			ph->setIdepth(p.idepth);
+			ph->hasDepthPrior = p.hasDepthPrior;
+			ph->maxRelBaseline = p.maxRelBaseline;
+			ph->numGoodResiduals = p.numGoodResiduals;
+			ph->setPointStatus(PointHessian::ACTIVE);
+			host->pointHessians.push_back(ph);
+			ef->insertPoint(ph);
+
+			for(const dmvio::ResidualCheckpoint& r : p.residuals)
+			{
+				PointFrameResidual* res = new PointFrameResidual(ph, host, frameHessians[r.targetIndex]);
+				res->setState((ResState) r.state);
+				res->state_energy = r.energy;
+				res->isNew = r.isNew;
+				ph->residuals.push_back(res);
+				ef->insertResidual(res);
+			}
+			for(int l = 0; l < 2; l++)
+			{
+				int index = p.lastResidualIndex[l];
+				ph->lastResiduals[l].first = index >= 0 ? ph->residuals[index] : 0;
+				ph->lastResiduals[l].second = (ResState) p.lastResidualState[l];
+			}
+		}
+
+		host->immaturePoints.reserve(kf.immaturePoints.size());
+		for(const dmvio::ImmaturePointCheckpoint& p : kf.immaturePoints)
+		{
+			ImmaturePoint* pt = new ImmaturePoint(p.u, p.v, host, p.type, &Hcalib);
+			if(!std::isfinite(pt->energyTH)) { delete pt; continue; }
+			pt->idepth_min = p.idepthMin;
+			pt->idepth_max = p.idepthMax;
+			pt->quality = p.quality;
+			pt->lastTraceStatus = (ImmaturePointStatus) p.lastTraceStatus;
+			pt->lastTraceUV = p.lastTraceUV;
+			pt->lastTracePixelInterval = p.lastTracePixelInterval;
+			host->immaturePoints.push_back(pt);
+		}
+	}
+
+	ef->HM = checkpoint.HM;
+	ef->bM = checkpoint.bM;
+	ef->HMForGTSAM = checkpoint.HMForGTSAM;
+	ef->bMForGTSAM = checkpoint.bMForGTSAM;
+	ef->makeIDX();
+
+	firstPose = SE3(checkpoint.firstPose);
+
+	FrameShell* lastShell = keyframeShells.back();
+	if(setting_useIMU)
+	{
+		imuIntegration.restoreFromCheckpoint(checkpoint, ef->frames, lastShell->id);
+	}else if(setting_useGTSAMIntegration)
+	{
+		baIntegration->restoreFromCheckpoint(checkpoint.ba, ef->frames);
+	}
+
+	// =========================== restore tracking reference. =========================
+	{
+		boost::unique_lock<boost::mutex> crlock(coarseTrackerSwapMutex);
+		coarseTracker_forNewKF->makeK(&Hcalib);
+		coarseTracker_forNewKF->setCoarseTrackingRef(frameHessians, setting_coarseTrackerPublishLevel);
+	}
+	coarseTracker_forNewKF->finishCoarseTrackingRef();
+
+	initialized = true;
+	secondKeyframeDone = true;
+	imuUsedBefore = checkpoint.hasIMU;
+
+	for(IOWrap::Output3DWrapper* ow : outputWrapper)
+	{
+		ow->publishSystemStatus(checkpoint.hasIMU ? dmvio::VISUAL_INERTIAL : dmvio::VISUAL_ONLY);
+		ow->publishKeyframes(frameHessians, false, &Hcalib);
+	}
+
+	printf("RESTORED FROM CHECKPOINT (%d keyframes, continuing after frame %d)!\n",
+		   (int)frameHessians.size(), lastShell->incoming_id);
+}
+
+}
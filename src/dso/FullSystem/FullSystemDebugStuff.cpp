@@ -72,7 +72,7 @@ namespace dso
 				MinimalImageB3* debugImage=f2->debugImage;
 				images.push_back(debugImage);
 
-				Eigen::Vector3f* fd = f2->dI;
+				const ImageLevel fd = f2->image(0);
 
 				Vec2 affL = AffLight::fromToVecExposure(f2->ab_exposure, f->ab_exposure, f2->aff_g2l(), f->aff_g2l());
 
@@ -178,7 +178,7 @@ namespace dso
 			MinimalImageB3* img = new MinimalImageB3(wG[0],hG[0]);
 			images.push_back(img);
 			//float* fd = frameHessians[f]->I;
-			Eigen::Vector3f* fd = frameHessians[f]->dI;
+			const ImageLevel fd = frameHessians[f]->image(0);
 
 
 			for(int i=0;i<wh;i++)
@@ -328,7 +328,7 @@ namespace dso
 			for(unsigned int f=0;f<frameHessians.size();f++)
 			{
 				MinimalImageB3* img = new MinimalImageB3(wG[0],hG[0]);
-				Eigen::Vector3f* fd = frameHessians[f]->dI;
+				const ImageLevel fd = frameHessians[f]->image(0);
 
 				for(int i=0;i<wh;i++)
 				{
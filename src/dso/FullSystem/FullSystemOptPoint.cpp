@@ -52,101 +52,18 @@ PointHessian* FullSystem::optimizeImmaturePoint(
 		ImmaturePoint* point, int minObs,
 		ImmaturePointTemporaryResidual* residuals)
 {
-	int nres = 0;
-	for(FrameHessian* fh : frameHessians)
-	{
-		if(fh != point->host)
-		{
-			residuals[nres].state_NewEnergy = residuals[nres].state_energy = 0;
-			residuals[nres].state_NewState = ResState::OUTLIER;
-			residuals[nres].state_state = ResState::IN;
-			residuals[nres].target = fh;
-			nres++;
-		}
-	}
-	assert(nres == ((int)frameHessians.size())-1);
-
-	bool print = false;//rand()%50==0;
-
-	float lastEnergy = 0;
-	float lastHdd=0;
-	float lastbd=0;
-	float currentIdepth=(point->idepth_max+point->idepth_min)*0.5f;
-
-
-
-
-
-
-	for(int i=0;i<nres;i++)
-	{
-		lastEnergy += point->linearizeResidual(&Hcalib, 1000, residuals+i,lastHdd, lastbd, currentIdepth);
-		residuals[i].state_state = residuals[i].state_NewState;
-		residuals[i].state_energy = residuals[i].state_NewEnergy;
-	}
-
-	if(!std::isfinite(lastEnergy) || lastHdd < setting_minIdepthH_act)
-	{
-		if(print)
-			printf("OptPoint: Not well-constrained (%d res, H=%.1f). E=%f. SKIP!\n",
-				nres, lastHdd, lastEnergy);
+	float currentIdepth;
+	if(!point->optimizeIdepth(frameHessians, &Hcalib, residuals, currentIdepth))
 		return 0;
-	}
-
-	if(print) printf("Activate point. %d residuals. H=%f. Initial Energy: %f. Initial Id=%f\n" ,
-			nres, lastHdd,lastEnergy,currentIdepth);
-
-	float lambda = 0.1;
-	for(int iteration=0;iteration<setting_GNItsOnPointActivation;iteration++)
-	{
-		float H = lastHdd;
-		H *= 1+lambda;
-		float step = (1.0/H) * lastbd;
-		float newIdepth = currentIdepth - step;
-
-		float newHdd=0; float newbd=0; float newEnergy=0;
-		for(int i=0;i<nres;i++)
-			newEnergy += point->linearizeResidual(&Hcalib, 1, residuals+i,newHdd, newbd, newIdepth);
-
-		if(!std::isfinite(lastEnergy) || newHdd < setting_minIdepthH_act)
-		{
-			if(print) printf("OptPoint: Not well-constrained (%d res, H=%.1f). E=%f. SKIP!\n",
-					nres,
-					newHdd,
-					lastEnergy);
-			return 0;
-		}
-
-		if(print) printf("%s %d (L %.2f) %s: %f -> %f (idepth %f)!\n",
-				(true || newEnergy < lastEnergy) ? "ACCEPT" : "REJECT",
-				iteration,
-				log10(lambda),
-				"",
-				lastEnergy, newEnergy, newIdepth);
-
-		if(newEnergy < lastEnergy)
-		{
-			currentIdepth = newIdepth;
-			lastHdd = newHdd;
-			lastbd = newbd;
-			lastEnergy = newEnergy;
-			for(int i=0;i<nres;i++)
-			{
-				residuals[i].state_state = residuals[i].state_NewState;
-				residuals[i].state_energy = residuals[i].state_NewEnergy;
-			}
+	return makeActivatedPoint(point, currentIdepth, minObs, residuals, ((int)frameHessians.size())-1);
+}
 
-			lambda *= 0.5;
-		}
-		else
-		{
-			lambda *= 5;
-		}
-
-		if(fabsf(step) < 0.0001*currentIdepth)
-			break;
-	}
 
+PointHessian* FullSystem::makeActivatedPoint(
+		ImmaturePoint* point, float currentIdepth, int minObs,
+		ImmaturePointTemporaryResidual* residuals, int nres)
+{
+	bool print = false;
 	if(!std::isfinite(currentIdepth))
 	{
 		printf("MAJOR ERROR! point idepth is nan after initialization (%f).\n", currentIdepth);
@@ -205,5 +122,16 @@ PointHessian* FullSystem::optimizeImmaturePoint(
 }
 
 
+void FullSystem::optimizeImmaturePointsBatch(
+		ImmaturePoint** points, int num, int minObs,
+		PointHessian** out, ImmaturePointTemporaryResidual* residuals)
+{
+	int nres = ((int)frameHessians.size())-1;
+	float currentIdepth[4];
+	bool converged[4];
+	ImmaturePoint::optimizeIdepthBatch(points, num, frameHessians, &Hcalib, residuals, currentIdepth, converged);
+	for(int l=0;l<num;l++)
+		out[l] = converged[l] ? makeActivatedPoint(points[l], currentIdepth[l], minObs, residuals + l*nres, nres) : 0;
+}
 
 }
@@ -39,7 +39,9 @@
 
 #include "OptimizationBackend/EnergyFunctional.h"
 #include "OptimizationBackend/EnergyFunctionalStructs.h"
+#include "OptimizationBackend/MatrixAccumulators.h"
 #include "util/TimeMeasurement.h"
+#include "util/LockContention.h"
 
 #include <cmath>
 
@@ -93,6 +95,24 @@ void FullSystem::applyRes_Reductor(bool copyJacobians, int min, int max, Vec10*
 	for(int k=min;k<max;k++)
 		activeResiduals[k]->applyRes(true);
 }
+void FullSystem::linearizeAllFused_Reductor(int min, int max, Vec10* stats, int tid)
+{
+	Accumulator11 E;
+	E.initialize();
+	for(int k=min;k<max;k++)
+	{
+		PointHessian* ph = activePoints[k];
+		for(PointFrameResidual* r : ph->residuals)
+			if(!r->efResidual->isLinearized)
+				(*stats)[0] += r->linearize(&Hcalib);
+
+		if(!setting_forceAceptStep)
+			ef->addLEnergyPoint(ph->efPoint, E);
+	}
+	E.finish();
+	(*stats)[1] += E.A;
+}
+
 void FullSystem::setNewFrameEnergyTH()
 {
 
@@ -147,6 +167,29 @@ void FullSystem::setNewFrameEnergyTH()
 //			meanElement, nthElement, sqrtf(newFrame->frameEnergyTH),
 //			good, bad);
 }
+// Same as linearizeAll(false) followed by calcLEnergy, but in one pass over the points.
+Vec3 FullSystem::linearizeAllFused(double& energyL)
+{
+	assert(EFDeltaValid);
+	assert(EFAdjointsValid);
+	assert(EFIndicesValid);
+
+	Vec10 stats = Vec10::Zero();
+	if(multiThreading)
+	{
+		stats = treadReduce.reduce(boost::bind(&FullSystem::linearizeAllFused_Reductor, this, _1, _2, _3, _4), 0, activePoints.size(), 50);
+	}
+	else
+	{
+		linearizeAllFused_Reductor(0, activePoints.size(), &stats, 0);
+	}
+
+	setNewFrameEnergyTH();
+
+	energyL = setting_forceAceptStep ? 0 : ef->calcLEnergyPriorsF() + stats[1];
+	return Vec3(stats[0], 0, 0);
+}
+
 Vec3 FullSystem::linearizeAll(bool fixLinearization)
 {
 	double lastEnergyP = 0;
@@ -159,8 +202,7 @@ Vec3 FullSystem::linearizeAll(bool fixLinearization)
 
 	if(multiThreading)
 	{
-		treadReduce.reduce(boost::bind(&FullSystem::linearizeAll_Reductor, this, fixLinearization, toRemove, _1, _2, _3, _4), 0, activeResiduals.size(), 0);
-		lastEnergyP = treadReduce.stats[0];
+		lastEnergyP = treadReduce.reduce(boost::bind(&FullSystem::linearizeAll_Reductor, this, fixLinearization, toRemove, _1, _2, _3, _4), 0, activeResiduals.size(), 0)[0];
 	}
 	else
 	{
@@ -275,6 +317,7 @@ bool FullSystem::doStepFromBackup(float stepfacC,float stepfacT,float stepfacR,f
 
 			for(PointHessian* ph : fh->pointHessians)
 			{
+				ph->idepth_backup = ph->idepth;
 				ph->setIdepth(ph->idepth_backup + stepfacD*ph->step);
 				sumID += ph->step*ph->step;
 				sumNID += fabsf(ph->idepth_backup);
@@ -326,11 +369,11 @@ void FullSystem::backupState(bool backupLastStep)
 		if(backupLastStep)
 		{
 			Hcalib.step_backup = Hcalib.step;
-			Hcalib.value_backup = Hcalib.value;
+			Hcalib.backupValue();
 			for(FrameHessian* fh : frameHessians)
 			{
 				fh->step_backup = fh->step;
-				fh->state_backup = fh->get_state();
+				fh->backupStateValues();
 				for(PointHessian* ph : fh->pointHessians)
 				{
 					ph->idepth_backup = ph->idepth;
@@ -341,11 +384,11 @@ void FullSystem::backupState(bool backupLastStep)
 		else
 		{
 			Hcalib.step_backup.setZero();
-			Hcalib.value_backup = Hcalib.value;
+			Hcalib.backupValue();
 			for(FrameHessian* fh : frameHessians)
 			{
 				fh->step_backup.setZero();
-				fh->state_backup = fh->get_state();
+				fh->backupStateValues();
 				for(PointHessian* ph : fh->pointHessians)
 				{
 					ph->idepth_backup = ph->idepth;
@@ -356,23 +399,20 @@ void FullSystem::backupState(bool backupLastStep)
 	}
 	else
 	{
-		Hcalib.value_backup = Hcalib.value;
+		// point idepths are backed up in doStepFromBackup, which visits all points anyway.
+		Hcalib.backupValue();
 		for(FrameHessian* fh : frameHessians)
-		{
-			fh->state_backup = fh->get_state();
-			for(PointHessian* ph : fh->pointHessians)
-				ph->idepth_backup = ph->idepth;
-		}
+			fh->backupStateValues();
 	}
 }
 
 // sets linearization point.
 void FullSystem::loadSateBackup()
 {
-	Hcalib.setValue(Hcalib.value_backup);
+	Hcalib.restoreValue();
 	for(FrameHessian* fh : frameHessians)
 	{
-		fh->setState(fh->state_backup);
+		fh->restoreStateValues();
 		for(PointHessian* ph : fh->pointHessians)
 		{
 			ph->setIdepth(ph->idepth_backup);
@@ -429,6 +469,7 @@ float FullSystem::optimize(int mnumOptIts)
 	// get statistics and active residuals.
 
 	activeResiduals.clear();
+	activePoints.clear();
 	int numPoints = 0;
 	int numLRes = 0;
 	for(FrameHessian* fh : frameHessians)
@@ -444,6 +485,7 @@ float FullSystem::optimize(int mnumOptIts)
 				else
 					numLRes++;
 			}
+			activePoints.push_back(ph);
 			numPoints++;
 		}
 
@@ -451,18 +493,23 @@ float FullSystem::optimize(int mnumOptIts)
         printf("OPTIMIZE %d pts, %d active res, %d lin res!\n",ef->nPoints,(int)activeResiduals.size(), numLRes);
 
 
-	Vec3 lastEnergy = linearizeAll(false);
-	double lastEnergyL = calcLEnergy();
+	Vec3 lastEnergy;
+	double lastEnergyL;
+	if(setting_fusedOptimization)
+	{
+		lastEnergy = linearizeAllFused(lastEnergyL);
+	}
+	else
+	{
+		lastEnergy = linearizeAll(false);
+		lastEnergyL = calcLEnergy();
+	}
 	double lastEnergyM = calcMEnergy(false);
 
 
 
 
-
-	if(multiThreading)
-		treadReduce.reduce(boost::bind(&FullSystem::applyRes_Reductor, this, true, _1, _2, _3, _4), 0, activeResiduals.size(), 50);
-	else
-		applyRes_Reductor(true,0,activeResiduals.size(),0,0);
+	applyResiduals();
 
 
     if(!setting_debugout_runquiet)
@@ -526,8 +573,17 @@ float FullSystem::optimize(int mnumOptIts)
 
 
 		// eval new energy!
-		Vec3 newEnergy = linearizeAll(false);
-		double newEnergyL = calcLEnergy();
+		Vec3 newEnergy;
+		double newEnergyL;
+		if(setting_fusedOptimization)
+		{
+			newEnergy = linearizeAllFused(newEnergyL);
+		}
+		else
+		{
+			newEnergy = linearizeAll(false);
+			newEnergyL = calcLEnergy();
+		}
 		double newEnergyM = calcMEnergy(true);
 
 
@@ -553,11 +609,7 @@ float FullSystem::optimize(int mnumOptIts)
 		if(setting_forceAceptStep || (newEnergy[0] +  newEnergy[1] +  newEnergyL + newEnergyM / dynamicGTSAMWeight <
 				lastEnergy[0] + lastEnergy[1] + lastEnergyL + lastEnergyM / dynamicGTSAMWeight))
 		{
-
-			if(multiThreading)
-				treadReduce.reduce(boost::bind(&FullSystem::applyRes_Reductor, this, true, _1, _2, _3, _4), 0, activeResiduals.size(), 50);
-			else
-				applyRes_Reductor(true,0,activeResiduals.size(),0,0);
+			applyResiduals();
 
 			lastEnergy = newEnergy;
 			lastEnergyL = newEnergyL;
@@ -574,8 +626,15 @@ float FullSystem::optimize(int mnumOptIts)
 		else
 		{
 			loadSateBackup();
-			lastEnergy = linearizeAll(false);
-			lastEnergyL = calcLEnergy();
+			if(setting_fusedOptimization)
+			{
+				lastEnergy = linearizeAllFused(lastEnergyL);
+			}
+			else
+			{
+				lastEnergy = linearizeAll(false);
+				lastEnergyL = calcLEnergy();
+			}
 			lastEnergyM = calcMEnergy(false);
 			lambda *= 1e2;
 		}
@@ -590,6 +649,24 @@ float FullSystem::optimize(int mnumOptIts)
         std::cout << "Num BA Iterations done: " << numIterations << "\n";
     }
 
+    if(numIterations > 0)
+    {
+        // Estimated (not measured) memory traffic per iteration: bytes of residual and point data streamed by the
+        // sweeps. Separate passes: linearize, applyRes, 3x accumulate and L-energy; fused: two passes.
+        double resBytes = activeResiduals.size() * (double) (sizeof(PointFrameResidual) + sizeof(EFResidual) +
+                                                              sizeof(RawResidualJacobian));
+        double pointBytes = activePoints.size() * (double) (sizeof(PointHessian) + sizeof(EFPoint));
+        double separateMB = (6 * resBytes + 4 * pointBytes) / (1024.0 * 1024.0);
+        double fusedMB = (2 * resBytes + 2 * pointBytes) / (1024.0 * 1024.0);
+        dmvio::TimeMeasurement::addMeasurement("baStreamedMBPerIteration",
+                                               setting_fusedOptimization ? fusedMB : separateMB);
+        if(!setting_debugout_runquiet)
+        {
+            printf("Estimated BA memory traffic per iteration: %.2f MB (separate passes: %.2f MB, fused: %.2f MB)\n",
+                   setting_fusedOptimization ? fusedMB : separateMB, separateMB, fusedMB);
+        }
+    }
+
     // Update again!
     baIntegration->updateDynamicWeight(lastEnergy[0], sqrtf((float)(lastEnergy[0] / (patternNum*ef->resInA))), frameHessians.back()->shell->trackingWasGood);
 
@@ -629,7 +706,8 @@ float FullSystem::optimize(int mnumOptIts)
 	}
 
 	{
-		boost::unique_lock<boost::mutex> crlock(shellPoseMutex);
+		auto crlock = dmvio::measuredLock(shellPoseMutex, "shellPoseMutex_mapping");
+		FrameShell::PoseWriteGuard guard;
 		for(FrameHessian* fh : frameHessians)
 		{
 			fh->shell->camToWorld = fh->PRE_camToWorld;
@@ -663,6 +741,22 @@ void FullSystem::solveSystem(int iteration, double lambda)
 
 
 
+void FullSystem::applyResiduals()
+{
+	// In fused mode the linearization is applied during the accumulation of the next solveSystem. If no further
+	// solve follows, the final linearizeAll(true) applies all residuals anyway.
+	if(setting_fusedOptimization)
+	{
+		ef->applyResidualsInSolve = true;
+		return;
+	}
+
+	if(multiThreading)
+		treadReduce.reduce(boost::bind(&FullSystem::applyRes_Reductor, this, true, _1, _2, _3, _4), 0, activeResiduals.size(), 50);
+	else
+		applyRes_Reductor(true,0,activeResiduals.size(),0,0);
+}
+
 double FullSystem::calcLEnergy()
 {
 	if(setting_forceAceptStep) return 0;
@@ -76,6 +76,7 @@ void FrameHessian::setStateZero(const Vec10 &state_zero)
 	assert(state_zero.head<6>().squaredNorm() < 1e-20);
 
 	this->state_zero = state_zero;
+	stateVersion = nextStateVersion();
 
 
 	for(int i=0;i<6;i++)
@@ -125,16 +126,16 @@ void FrameHessian::release()
 }
 
 
-void FrameHessian::makeImages(float* color, CalibHessian* HCalib)
+void FrameHessian::allocateImages()
 {
-
-	for(int i=0;i<pyrLevelsUsed;i++)
-	{
-		dIp[i] = new Eigen::Vector3f[wG[i]*hG[i]];
-		absSquaredGrad[i] = new float[wG[i]*hG[i]];
-	}
+	FrameImagePool::instance().acquire(dIp);
+	FrameImagePool::instance().acquire(absSquaredGrad);
 	dI = dIp[0];
+}
 
+void FrameHessian::makeImages(float* color, CalibHessian* HCalib, IndexThreadReduce<Vec10>* red)
+{
+	allocateImages();
 
 	// make d0
 	int w=wG[0];
@@ -142,58 +143,40 @@ void FrameHessian::makeImages(float* color, CalibHessian* HCalib)
 	for(int i=0;i<w*h;i++)
 		dI[i][0] = color[i];
 
-	for(int lvl=0; lvl<pyrLevelsUsed; lvl++)
-	{
-		int wl = wG[lvl], hl = hG[lvl];
-		Eigen::Vector3f* dI_l = dIp[lvl];
-
-		float* dabs_l = absSquaredGrad[lvl];
-		if(lvl>0)
-		{
-			int lvlm1 = lvl-1;
-			int wlm1 = wG[lvlm1];
-			Eigen::Vector3f* dI_lm = dIp[lvlm1];
-
-
+	makePyramid(HCalib, red);
+}
 
-			for(int y=0;y<hl;y++)
-				for(int x=0;x<wl;x++)
-				{
-					dI_l[x + y*wl][0] = 0.25f * (dI_lm[2*x   + 2*y*wlm1][0] +
-												dI_lm[2*x+1 + 2*y*wlm1][0] +
-												dI_lm[2*x   + 2*y*wlm1+wlm1][0] +
-												dI_lm[2*x+1 + 2*y*wlm1+wlm1][0]);
-				}
-		}
+void FrameHessian::makePyramid(CalibHessian* HCalib, IndexThreadReduce<Vec10>* red)
+{
+	makeImagePyramid(dIp, absSquaredGrad, wG, hG, pyrLevelsUsed, setting_gammaWeightsPixelSelect==1 ? HCalib : 0, red);
 
-		for(int idx=wl;idx < wl*(hl-1);idx++)
+	if(setting_compactImages)
+	{
+		FrameImagePool::instance().acquire(dIpCompact);
+		for(int lvl=0; lvl<pyrLevelsUsed; lvl++)
 		{
-			float dx = 0.5f*(dI_l[idx+1][0] - dI_l[idx-1][0]);
-			float dy = 0.5f*(dI_l[idx+wl][0] - dI_l[idx-wl][0]);
-
-
-			if(!std::isfinite(dx)) dx=0;
-			if(!std::isfinite(dy)) dy=0;
-
-			dI_l[idx][1] = dx;
-			dI_l[idx][2] = dy;
-
-
-			dabs_l[idx] = dx*dx+dy*dy;
-
-			if(setting_gammaWeightsPixelSelect==1 && HCalib!=0)
-			{
-				float gw = HCalib->getBGradOnly((float)(dI_l[idx][0]));
-				dabs_l[idx] *= gw*gw;	// convert to gradient of original color space (before removing response).
-			}
+			const Eigen::Vector3f* dI_l = dIp[lvl];
+			CompactPixel* dIc_l = dIpCompact[lvl];
+			int wh = wG[lvl]*hG[lvl];
+			for(int idx=0;idx<wh;idx++)
+				dIc_l[idx] = packPixel(dI_l[idx]);
 		}
+		FrameImagePool::instance().release(dIp);
+		dI = 0;
 	}
 }
 
 void FrameFramePrecalc::set(FrameHessian* host, FrameHessian* target, CalibHessian* HCalib )
 {
+	if(this->host == host && this->target == target && hostVersion == host->stateVersion
+	   && targetVersion == target->stateVersion && calibVersion == HCalib->valueVersion)
+		return;
+
 	this->host = host;
 	this->target = target;
+	hostVersion = host->stateVersion;
+	targetVersion = target->stateVersion;
+	calibVersion = HCalib->valueVersion;
 
 	SE3 leftToLeft_0 = target->get_worldToCam_evalPT() * host->get_worldToCam_evalPT().inverse();
 	PRE_RTll_0 = (leftToLeft_0.rotationMatrix()).cast<float>();
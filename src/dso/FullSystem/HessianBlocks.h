@@ -36,6 +36,9 @@
 #include "util/NumType.h"
 #include "FullSystem/Residuals.h"
 #include "util/ImageAndExposure.h"
+#include "FullSystem/FrameImagePool.h"
+#include "FullSystem/ImagePyramid.h"
+#include <atomic>
 
 
 namespace dso
@@ -57,6 +60,13 @@ class FrameShell;
 class EFFrame;
 class EFPoint;
 
+// unique id for every change of an optimized state, used to skip recomputing precalcs which did not change.
+inline long nextStateVersion()
+{
+	static std::atomic<long> counter(0);
+	return ++counter;
+}
+
 #define SCALE_IDEPTH 1.0f		// scales internal value to idepth.
 #define SCALE_XI_ROT 1.0f
 // #define SCALE_XI_TRANS 0.5f
@@ -100,9 +110,13 @@ struct FrameFramePrecalc
 
 	float distanceLL;
 
+	// state versions the values were computed for.
+	long hostVersion, targetVersion, calibVersion;
+
 
     inline ~FrameFramePrecalc() {}
-    inline FrameFramePrecalc() {host=target=0;}
+    inline FrameFramePrecalc() {host=target=0; hostVersion=targetVersion=calibVersion=-1;}
+	// does nothing if host, target and calibration did not change since the last call.
 	void set(FrameHessian* host, FrameHessian* target, CalibHessian* HCalib);
 };
 
@@ -121,8 +135,11 @@ struct FrameHessian
 
 	Eigen::Vector3f* dI;				 // trace, fine tracking. Used for direction select (not for gradient histograms etc.)
 	Eigen::Vector3f* dIp[PYR_LEVELS];	 // coarse tracking / coarse initializer. NAN in [0] only.
+	CompactPixel* dIpCompact[PYR_LEVELS]; // replaces dIp (which is 0 then) if setting_compactImages. Read both via image(lvl).
 	float* absSquaredGrad[PYR_LEVELS];  // only used for pixel select (histograms etc.). no NAN.
 
+	inline ImageLevel image(int lvl) const {return ImageLevel(dIp[lvl], dIpCompact[lvl]);}
+
     bool addCamPrior;
 
 	int frameID;						// incremental ID for keyframes only!
@@ -153,6 +170,13 @@ struct FrameHessian
 	Vec10 step;
 	Vec10 step_backup;
 	Vec10 state_backup;
+	long stateVersion;	// changes whenever state or state_zero / evalPT change.
+
+	// values derived from state_backup, so that restoring the backup does not need to recompute anything.
+	Vec10 state_scaled_backup;
+	SE3 PRE_worldToCam_backup;
+	SE3 PRE_camToWorld_backup;
+	long stateVersion_backup;
 
 
     EIGEN_STRONG_INLINE const SE3 &get_worldToCam_evalPT() const {return worldToCam_evalPT;}
@@ -166,6 +190,7 @@ struct FrameHessian
 	SE3 PRE_worldToCam;
 	SE3 PRE_camToWorld;
 	std::vector<FrameFramePrecalc,Eigen::aligned_allocator<FrameFramePrecalc>> targetPrecalc;
+	std::vector<FrameFramePrecalc,Eigen::aligned_allocator<FrameFramePrecalc>> targetPrecalc_backup;
 	MinimalImageB3* debugImage;
 
 
@@ -178,7 +203,7 @@ struct FrameHessian
 	void setStateZero(const Vec10 &state_zero);
 	inline void setState(const Vec10 &state)
 	{
-
+		if(state != this->state) stateVersion = nextStateVersion();
 		this->state = state;
 		state_scaled.segment<3>(0) = SCALE_XI_TRANS * state.segment<3>(0);
 		state_scaled.segment<3>(3) = SCALE_XI_ROT * state.segment<3>(3);
@@ -193,7 +218,7 @@ struct FrameHessian
 	};
 	inline void setStateScaled(const Vec10 &state_scaled)
 	{
-
+		stateVersion = nextStateVersion();
 		this->state_scaled = state_scaled;
 		state.segment<3>(0) = SCALE_XI_TRANS_INVERSE * state_scaled.segment<3>(0);
 		state.segment<3>(3) = SCALE_XI_ROT_INVERSE * state_scaled.segment<3>(3);
@@ -226,18 +251,35 @@ struct FrameHessian
 		setStateZero(this->get_state());
 	};
 
+	// Double buffer for the optimizer: restoring swaps back the state, its derived values and the precalcs.
+	inline void backupStateValues()
+	{
+		state_backup = state;
+		state_scaled_backup = state_scaled;
+		PRE_worldToCam_backup = PRE_worldToCam;
+		PRE_camToWorld_backup = PRE_camToWorld;
+		stateVersion_backup = stateVersion;
+		targetPrecalc_backup = targetPrecalc;
+	}
+	inline void restoreStateValues()
+	{
+		state = state_backup;
+		state_scaled = state_scaled_backup;
+		PRE_worldToCam = PRE_worldToCam_backup;
+		PRE_camToWorld = PRE_camToWorld_backup;
+		stateVersion = stateVersion_backup;
+		std::swap(targetPrecalc, targetPrecalc_backup);
+	}
+
 	void release();
 
 	inline ~FrameHessian()
 	{
 		assert(efFrame==0);
 		release(); instanceCounter--;
-		for(int i=0;i<pyrLevelsUsed;i++)
-		{
-			delete[] dIp[i];
-			delete[]  absSquaredGrad[i];
-
-		}
+		FrameImagePool::instance().release(dIp);
+		FrameImagePool::instance().release(dIpCompact);
+		FrameImagePool::instance().release(absSquaredGrad);
 
 
 
@@ -250,16 +292,31 @@ struct FrameHessian
 		frameID = -1;
 		efFrame = 0;
 		frameEnergyTH = 8*8*patternNum;
+		stateVersion = stateVersion_backup = nextStateVersion();
 
 
 
 		debugImage=0;
+		dI=0;
+		for(int i=0;i<PYR_LEVELS;i++)
+		{
+			dIp[i]=0;
+			dIpCompact[i]=0;
+			absSquaredGrad[i]=0;
+		}
 
         addCamPrior = false;
 	};
 
 
-    void makeImages(float* color, CalibHessian* HCalib);
+    // If red is given, large pyramid levels are computed in row stripes on its threads (see makeImagePyramid).
+    void makeImages(float* color, CalibHessian* HCalib, IndexThreadReduce<Vec10>* red = 0);
+
+	// Alternative to makeImages which avoids the copy of the input image: allocateImages gets (pooled) buffers, then
+	// the caller writes the image to dI[i][0] (e.g. with Undistort::undistortInto), then makePyramid computes the rest.
+	// With setting_compactImages makePyramid converts the pyramid to dIpCompact and returns the dense buffers to the pool.
+	void allocateImages();
+	void makePyramid(CalibHessian* HCalib, IndexThreadReduce<Vec10>* red = 0);
 
 	inline Vec10 getPrior()
 	{
@@ -320,11 +377,22 @@ struct CalibHessian
 	VecC step_backup;
 	VecC value_backup;
 	VecC value_minus_value_zero;
+	long valueVersion;	// changes whenever value changes.
+	long valueVersion_backup;
 
     inline ~CalibHessian() {instanceCounter--;}
 	inline CalibHessian()
 	{
+		resetValue();
 
+		instanceCounter++;
+		for(int i=0;i<256;i++)
+			Binv[i] = B[i] = i;		// set gamma function to identity
+	};
+
+	// sets the intrinsics back to the initial calibration. The gamma function is kept.
+	inline void resetValue()
+	{
 		VecC initial_value = VecC::Zero();
 		initial_value[0] = fxG[0];
 		initial_value[1] = fyG[0];
@@ -332,13 +400,10 @@ struct CalibHessian
 		initial_value[3] = cyG[0];
 
 		setValueScaled(initial_value);
+		valueVersion_backup = valueVersion;
 		value_zero = value;
 		value_minus_value_zero.setZero();
-
-		instanceCounter++;
-		for(int i=0;i<256;i++)
-			Binv[i] = B[i] = i;		// set gamma function to identity
-	};
+	}
 
 
 	// normal mode: use the optimized parameters everywhere!
@@ -356,6 +421,7 @@ struct CalibHessian
 	inline void setValue(const VecC &value)
 	{
 		// [0-3: Kl, 4-7: Kr, 8-12: l2r]
+		if(value != this->value) valueVersion = nextStateVersion();
 		this->value = value;
 		value_scaled[0] = SCALE_F * value[0];
 		value_scaled[1] = SCALE_F * value[1];
@@ -372,6 +438,7 @@ struct CalibHessian
 
 	inline void setValueScaled(const VecC &value_scaled)
 	{
+		valueVersion = nextStateVersion();
 		this->value_scaled = value_scaled;
 		this->value_scaledf = this->value_scaled.cast<float>();
 		value[0] = SCALE_F_INVERSE * value_scaled[0];
@@ -387,6 +454,18 @@ struct CalibHessian
 	};
 
 
+	inline void backupValue()
+	{
+		value_backup = value;
+		valueVersion_backup = valueVersion;
+	}
+	inline void restoreValue()
+	{
+		setValue(value_backup);
+		valueVersion = valueVersion_backup;
+	}
+
+
 	float Binv[256];
 	float B[256];
 
@@ -0,0 +1,262 @@
+/**
+* This file is part of DSO, written by Jakob Engel.
+* It has been modified by Lukas von Stumberg for the inclusion in DM-VIO (http://vision.in.tum.de/dm-vio).
+*
+* Copyright 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>
+* Copyright 2016 Technical University of Munich and Intel.
+* Developed by Jakob Engel <engelj at in dot tum dot de>,
+* for more information see <http://vision.in.tum.de/dso>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DSO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DSO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DSO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "FullSystem/ImagePyramid.h"
+#include "FullSystem/HessianBlocks.h"
+#include "util/IndexThreadReduce.h"
+#include <vector>
+
+#if !defined(__SSE3__) && !defined(__SSE2__) && !defined(__SSE1__)
+#include "SSE2NEON.h"
+#endif
+
+namespace dso
+{
+
+namespace
+{
+// Levels with fewer pixels are not worth splitting over threads.
+constexpr int minPixelsForStripes = 100000;
+// Must be even, so that both source rows of a downsampled row are in the same stripe.
+constexpr int rowsPerStripe = 32;
+static_assert(rowsPerStripe % 2 == 0, "rowsPerStripe must be even");
+
+// channel 0 of the 4 pixels starting at p (reads the 12 floats of these pixels).
+EIGEN_ALWAYS_INLINE __m128 loadIntensity4(const Eigen::Vector3f* p)
+{
+	const float* f = p->data();
+	__m128 v0 = _mm_loadu_ps(f);
+	__m128 v1 = _mm_loadu_ps(f+4);
+	__m128 v2 = _mm_loadu_ps(f+8);
+	// intensities are f[0], f[3], f[6], f[9].
+	__m128 a = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2,2,3,0));	// f0 f3 f6 f6
+	__m128 b = _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(1,1,2,2));	// f6 f6 f9 f9
+	return _mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,1,0));
+}
+
+// channel 0 of the even and odd pixels of the 8 pixels starting at p.
+EIGEN_ALWAYS_INLINE void loadIntensityEvenOdd8(const Eigen::Vector3f* p, __m128& even, __m128& odd)
+{
+	const float* f = p->data();
+	__m128 v0 = _mm_loadu_ps(f);
+	__m128 v1 = _mm_loadu_ps(f+4);
+	__m128 v2 = _mm_loadu_ps(f+8);
+	__m128 v3 = _mm_loadu_ps(f+12);
+	__m128 v4 = _mm_loadu_ps(f+16);
+	__m128 v5 = _mm_loadu_ps(f+20);
+	// even: f0 f6 f12 f18, odd: f3 f9 f15 f21.
+	even = _mm_shuffle_ps(_mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2,2,0,0)), _mm_shuffle_ps(v3, v4, _MM_SHUFFLE(2,2,0,0)),
+						  _MM_SHUFFLE(2,0,2,0));
+	odd = _mm_shuffle_ps(_mm_shuffle_ps(v0, v2, _MM_SHUFFLE(1,1,3,3)), _mm_shuffle_ps(v3, v5, _MM_SHUFFLE(1,1,3,3)),
+						 _MM_SHUFFLE(2,0,2,0));
+}
+
+// channel 0 of the n pixels starting at p to out.
+EIGEN_ALWAYS_INLINE void copyIntensity(const Eigen::Vector3f* p, int n, float* out, bool vectorized)
+{
+	int i=0;
+	if(vectorized)
+		for(;i+3<n;i+=4)
+			_mm_storeu_ps(out+i, loadIntensity4(p+i));
+	for(;i<n;i++)
+		out[i] = p[i][0];
+}
+
+// writes the 4 pixels (intensity, dx, dy) to the 12 floats starting at out.
+EIGEN_ALWAYS_INLINE void storePixels4(float* out, __m128 intensity, __m128 dx, __m128 dy)
+{
+	__m128 idxLo = _mm_unpacklo_ps(intensity, dx);	// i0 dx0 i1 dx1
+	__m128 idxHi = _mm_unpackhi_ps(intensity, dx);	// i2 dx2 i3 dx3
+	__m128 dyiLo = _mm_unpacklo_ps(dy, intensity);	// dy0 i0 dy1 i1
+	__m128 dyiHi = _mm_unpackhi_ps(dy, intensity);	// dy2 i2 dy3 i3
+	__m128 dxyLo = _mm_unpacklo_ps(dx, dy);			// dx0 dy0 dx1 dy1
+	__m128 dxyHi = _mm_unpackhi_ps(dx, dy);			// dx2 dy2 dx3 dy3
+	_mm_storeu_ps(out, _mm_shuffle_ps(idxLo, dyiLo, _MM_SHUFFLE(3,0,1,0)));
+	_mm_storeu_ps(out+4, _mm_shuffle_ps(dxyLo, idxHi, _MM_SHUFFLE(1,0,3,2)));
+	_mm_storeu_ps(out+8, _mm_shuffle_ps(dyiHi, dxyHi, _MM_SHUFFLE(3,2,3,0)));
+}
+
+// sets non-finite lanes to 0.
+EIGEN_ALWAYS_INLINE __m128 zeroIfNotFinite(__m128 v)
+{
+	__m128 finite = _mm_cmpeq_ps(_mm_sub_ps(v, v), _mm_setzero_ps());
+	return _mm_and_ps(v, finite);
+}
+
+EIGEN_ALWAYS_INLINE void gradientPixel(Eigen::Vector3f* img, float* absSquaredGrad, int w, int idx, CalibHessian* gammaCalib)
+{
+	float dx = 0.5f*(img[idx+1][0] - img[idx-1][0]);
+	float dy = 0.5f*(img[idx+w][0] - img[idx-w][0]);
+
+	if(!std::isfinite(dx)) dx=0;
+	if(!std::isfinite(dy)) dy=0;
+
+	img[idx][1] = dx;
+	img[idx][2] = dy;
+
+	if(absSquaredGrad != 0)
+	{
+		absSquaredGrad[idx] = dx*dx+dy*dy;
+		if(gammaCalib != 0)
+		{
+			float gw = gammaCalib->getBGradOnly((float)(img[idx][0]));
+			absSquaredGrad[idx] *= gw*gw;	// convert to gradient of original color space (before removing response).
+		}
+	}
+}
+}
+
+void downsampleRows(const Eigen::Vector3f* src, int wSrc, Eigen::Vector3f* dst, int wDst, int yMin, int yMax)
+{
+	const __m128 quarter = _mm_set1_ps(0.25f);
+	for(int y=yMin;y<yMax;y++)
+	{
+		const Eigen::Vector3f* top = src + 2*y*wSrc;
+		const Eigen::Vector3f* bottom = top + wSrc;
+		Eigen::Vector3f* out = dst + y*wDst;
+
+		int x=0;
+		// 8 source pixels per step, the last load of a step reads up to pixel 2*x+7 < wSrc.
+		for(;x+3<wDst && 2*x+7<wSrc;x+=4)
+		{
+			__m128 tl, tr, bl, br;
+			loadIntensityEvenOdd8(top+2*x, tl, tr);
+			loadIntensityEvenOdd8(bottom+2*x, bl, br);
+			// same order of additions as the scalar version.
+			__m128 res = _mm_mul_ps(quarter, _mm_add_ps(_mm_add_ps(_mm_add_ps(tl, tr), bl), br));
+			float resF[4];
+			_mm_storeu_ps(resF, res);
+			out[x][0] = resF[0];
+			out[x+1][0] = resF[1];
+			out[x+2][0] = resF[2];
+			out[x+3][0] = resF[3];
+		}
+		for(;x<wDst;x++)
+			out[x][0] = 0.25f * (top[2*x][0] + top[2*x+1][0] + bottom[2*x][0] + bottom[2*x+1][0]);
+	}
+}
+
+void gradientRows(Eigen::Vector3f* img, float* absSquaredGrad, int w, int h, int yMin, int yMax, CalibHessian* gammaCalib)
+{
+	int yFirst = std::max(yMin, 1);
+	int yLast = std::min(yMax, h-1);
+	const __m128 half = _mm_set1_ps(0.5f);
+
+	// squared gamma derivative per (rounded) intensity.
+	float gradWeights[256];
+	if(gammaCalib != 0)
+		for(int i=5;i<=250;i++)
+		{
+			float gw = gammaCalib->B[i+1] - gammaCalib->B[i];
+			gradWeights[i] = gw*gw;
+		}
+
+	// Intensities of the rows of a block plus one row above and below, as contiguous floats. Neighbours are addressed by
+	// flat index like before, so dx of the first and last column uses the neighbouring row.
+	std::vector<float> intensity((rowsPerStripe+2)*w);
+	for(int yBlock=yFirst; yBlock<yLast; yBlock+=rowsPerStripe)
+	{
+		int yBlockEnd = std::min(yBlock+rowsPerStripe, yLast);
+		// Rows outside of [yMin, yMax) may be written by another thread, vector loads would also read their gradients.
+		for(int y=yBlock-1;y<=yBlockEnd;y++)
+			copyIntensity(img+y*w, w, intensity.data()+(y-yBlock+1)*w, y>=yMin && y<yMax);
+
+		for(int y=yBlock;y<yBlockEnd;y++)
+		{
+			const float* c = intensity.data()+(y-yBlock+1)*w;
+			float* out = img[y*w].data();
+			float* outAbs = absSquaredGrad != 0 ? absSquaredGrad+y*w : 0;
+			// The border rows of the stripe are read by other threads, so channel 0 is not written there.
+			bool storeInterleaved = y != yMin && y != yMax-1;
+
+			int x=0;
+			for(;x+3<w;x+=4)
+			{
+				__m128 dx = zeroIfNotFinite(_mm_mul_ps(half, _mm_sub_ps(_mm_loadu_ps(c+x+1), _mm_loadu_ps(c+x-1))));
+				__m128 dy = zeroIfNotFinite(_mm_mul_ps(half, _mm_sub_ps(_mm_loadu_ps(c+x+w), _mm_loadu_ps(c+x-w))));
+
+				if(storeInterleaved)
+					storePixels4(out+3*x, _mm_loadu_ps(c+x), dx, dy);
+				else
+				{
+					float dxF[4], dyF[4];
+					_mm_storeu_ps(dxF, dx);
+					_mm_storeu_ps(dyF, dy);
+					for(int i=0;i<4;i++)
+					{
+						out[3*(x+i)+1] = dxF[i];
+						out[3*(x+i)+2] = dyF[i];
+					}
+				}
+
+				if(outAbs != 0)
+				{
+					__m128 dabs = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+					if(gammaCalib != 0)
+					{
+						// same rounding and clamping as getBGradOnly (also for NaN, which is clamped to 5).
+						__m128 color = _mm_add_ps(_mm_loadu_ps(c+x), _mm_set1_ps(0.5f));
+						color = _mm_min_ps(_mm_max_ps(color, _mm_set1_ps(5.0f)), _mm_set1_ps(250.0f));
+						int colorI[4];
+						_mm_storeu_si128((__m128i*)colorI, _mm_cvttps_epi32(color));
+						__m128 gw2 = _mm_setr_ps(gradWeights[colorI[0]], gradWeights[colorI[1]],
+												 gradWeights[colorI[2]], gradWeights[colorI[3]]);
+						dabs = _mm_mul_ps(dabs, gw2);
+					}
+					_mm_storeu_ps(outAbs+x, dabs);
+				}
+			}
+
+			for(;x<w;x++)
+				gradientPixel(img, absSquaredGrad, w, y*w+x, gammaCalib);
+		}
+	}
+}
+
+void makeImagePyramid(Eigen::Vector3f** levels, float** absSquaredGrad, const int* w, const int* h, int numLevels,
+					  CalibHessian* gammaCalib, IndexThreadReduce<Vec10>* red)
+{
+	// Each pass computes the gradients of level lvl-1 and downsamples level lvl, which both only read the intensities
+	// of level lvl-1. Row y of level lvl belongs to the stripe containing row 2*y of level lvl-1.
+	for(int lvl=1; lvl<=numLevels; lvl++)
+	{
+		int lvlm1 = lvl-1;
+		auto stripe = [&](int yMin, int yMax, Vec10* stats, int tid)
+		{
+			gradientRows(levels[lvlm1], absSquaredGrad ? absSquaredGrad[lvlm1] : 0, w[lvlm1], h[lvlm1], yMin, yMax,
+						 gammaCalib);
+			if(lvl < numLevels)
+				downsampleRows(levels[lvlm1], w[lvlm1], levels[lvl], w[lvl], (yMin+1)/2, std::min((yMax+1)/2, h[lvl]));
+		};
+
+		if(red != 0 && multiThreading && w[lvlm1]*h[lvlm1] >= minPixelsForStripes)
+			red->reduce(stripe, 0, h[lvlm1], rowsPerStripe);
+		else
+			stripe(0, h[lvlm1], 0, 0);
+	}
+}
+
+}
@@ -0,0 +1,49 @@
+/**
+* This file is part of DSO, written by Jakob Engel.
+* It has been modified by Lukas von Stumberg for the inclusion in DM-VIO (http://vision.in.tum.de/dm-vio).
+*
+* Copyright 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>
+* Copyright 2016 Technical University of Munich and Intel.
+* Developed by Jakob Engel <engelj at in dot tum dot de>,
+* for more information see <http://vision.in.tum.de/dso>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DSO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DSO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DSO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "util/NumType.h"
+
+namespace dso
+{
+struct CalibHessian;
+template<typename Running> class IndexThreadReduce;
+
+// Builds the image pyramid levels[0..numLevels) (intensity, dx, dy) from the intensities in channel 0 of levels[0]:
+// coarser levels are 2x2 box filtered, gradients are central differences (not computed for the first and last row).
+// If absSquaredGrad is not 0 it is set to dx^2+dy^2, multiplied with the squared gamma derivative if gammaCalib is not 0.
+// Uses SSE (NEON via SSE2NEON). If red is not 0 (and multiThreading is set) large levels are split into row stripes.
+void makeImagePyramid(Eigen::Vector3f** levels, float** absSquaredGrad, const int* w, const int* h, int numLevels,
+					  CalibHessian* gammaCalib, IndexThreadReduce<Vec10>* red = 0);
+
+// Kernels for the rows [yMin, yMax) of one level, can be called in parallel for disjoint row stripes.
+// downsampleRows writes channel 0 of dst from src (which has twice the width).
+void downsampleRows(const Eigen::Vector3f* src, int wSrc, Eigen::Vector3f* dst, int wDst, int yMin, int yMax);
+// gradientRows writes channel 1 and 2 (and absSquaredGrad if not 0). Rows outside of [1, h-1) are skipped.
+void gradientRows(Eigen::Vector3f* img, float* absSquaredGrad, int w, int h, int yMin, int yMax, CalibHessian* gammaCalib);
+
+}
@@ -29,6 +29,10 @@
 #include "util/FrameShell.h"
 #include "FullSystem/ResidualProjections.h"
 
+#if !defined(__SSE3__) && !defined(__SSE2__) && !defined(__SSE1__)
+#include "SSE2NEON.h"
+#endif
+
 namespace dso
 {
 ImmaturePoint::ImmaturePoint(int u_, int v_, FrameHessian* host_, float type, CalibHessian* HCalib)
@@ -42,7 +46,7 @@ ImmaturePoint::ImmaturePoint(int u_, int v_, FrameHessian* host_, float type, Ca
 		int dx = patternP[idx][0];
 		int dy = patternP[idx][1];
 
-        Vec3f ptc = getInterpolatedElement33BiLin(host->dI, u+dx, v+dy,wG[0]);
+        Vec3f ptc = getInterpolatedElement33BiLin(host->image(0), u+dx, v+dy,wG[0]);
 
 
 
@@ -75,6 +79,15 @@ ImmaturePoint::~ImmaturePoint()
  * * SKIP -> point has not been updated.
  */
 ImmaturePointStatus ImmaturePoint::traceOn(FrameHessian* frame,const Mat33f &hostToFrame_KRKi, const Vec3f &hostToFrame_Kt, const Vec2f& hostToFrame_affine, CalibHessian* HCalib, bool debugPrint)
+{
+	return withImageLevel(frame->image(0), [&](auto dIl)
+	{
+		return traceOnImpl(dIl, frame, hostToFrame_KRKi, hostToFrame_Kt, hostToFrame_affine, HCalib, debugPrint);
+	});
+}
+
+template<typename ImageT>
+ImmaturePointStatus ImmaturePoint::traceOnImpl(const ImageT& dIl, FrameHessian* frame,const Mat33f &hostToFrame_KRKi, const Vec3f &hostToFrame_Kt, const Vec2f& hostToFrame_affine, CalibHessian* HCalib, bool debugPrint)
 {
 	if(lastTraceStatus == ImmaturePointStatus::IPS_OOB) return lastTraceStatus;
 
@@ -275,7 +288,7 @@ ImmaturePointStatus ImmaturePoint::traceOn(FrameHessian* frame,const Mat33f &hos
 		float energy=0;
 		for(int idx=0;idx<patternNum;idx++)
 		{
-			float hitColor = getInterpolatedElement31(frame->dI,
+			float hitColor = getInterpolatedElement31(dIl,
 										(float)(ptx+rotatetPattern[idx][0]),
 										(float)(pty+rotatetPattern[idx][1]),
 										wG[0]);
@@ -332,7 +345,7 @@ ImmaturePointStatus ImmaturePoint::traceOn(FrameHessian* frame,const Mat33f &hos
                 return lastTraceStatus = ImmaturePointStatus::IPS_OOB;
             }
 
-			Vec3f hitColor = getInterpolatedElement33(frame->dI, posU, posV, wG[0]);
+			Vec3f hitColor = getInterpolatedElement33(dIl, posU, posV, wG[0]);
 
 			if(!std::isfinite((float)hitColor[0])) {energy+=1e5; continue;}
 			float residual = hitColor[0] - (hostToFrame_affine[0] * color[idx] + hostToFrame_affine[1]);
@@ -464,7 +477,7 @@ float ImmaturePoint::calcResidual(
 	FrameFramePrecalc* precalc = &(host->targetPrecalc[tmpRes->target->idx]);
 
 	float energyLeft=0;
-	const Eigen::Vector3f* dIl = tmpRes->target->dI;
+	const ImageLevel dIl = tmpRes->target->image(0);
 	const Mat33f &PRE_KRKiTll = precalc->PRE_KRKiTll;
 	const Vec3f &PRE_KtTll = precalc->PRE_KtTll;
 	Vec2f affLL = precalc->PRE_aff_mode;
@@ -509,7 +522,7 @@ double ImmaturePoint::linearizeResidual(
 	// check OOB due to scale angle change.
 
 	float energyLeft=0;
-	const Eigen::Vector3f* dIl = tmpRes->target->dI;
+	const ImageLevel dIl = tmpRes->target->image(0);
 	const Mat33f &PRE_RTll = precalc->PRE_RTll;
 	const Vec3f &PRE_tTll = precalc->PRE_tTll;
 	//const float * const Il = tmpRes->target->I;
@@ -565,5 +578,353 @@ double ImmaturePoint::linearizeResidual(
 }
 
 
+bool ImmaturePoint::optimizeIdepth(
+		const std::vector<FrameHessian*>& frames, CalibHessian* HCalib,
+		ImmaturePointTemporaryResidual* residuals, float& idepth)
+{
+	int nres = 0;
+	for(FrameHessian* fh : frames)
+	{
+		if(fh != host)
+		{
+			residuals[nres].state_NewEnergy = residuals[nres].state_energy = 0;
+			residuals[nres].state_NewState = ResState::OUTLIER;
+			residuals[nres].state_state = ResState::IN;
+			residuals[nres].target = fh;
+			nres++;
+		}
+	}
+	assert(nres == ((int)frames.size())-1);
+
+	bool print = false;//rand()%50==0;
+
+	float lastEnergy = 0;
+	float lastHdd=0;
+	float lastbd=0;
+	float currentIdepth=(idepth_max+idepth_min)*0.5f;
+
+
+
+
+
+
+	for(int i=0;i<nres;i++)
+	{
+		lastEnergy += linearizeResidual(HCalib, 1000, residuals+i,lastHdd, lastbd, currentIdepth);
+		residuals[i].state_state = residuals[i].state_NewState;
+		residuals[i].state_energy = residuals[i].state_NewEnergy;
+	}
+
+	if(!std::isfinite(lastEnergy) || lastHdd < setting_minIdepthH_act)
+	{
+		if(print)
+			printf("OptPoint: Not well-constrained (%d res, H=%.1f). E=%f. SKIP!\n",
+				nres, lastHdd, lastEnergy);
+		return false;
+	}
+
+	if(print) printf("Activate point. %d residuals. H=%f. Initial Energy: %f. Initial Id=%f\n" ,
+			nres, lastHdd,lastEnergy,currentIdepth);
+
+	float lambda = 0.1;
+	for(int iteration=0;iteration<setting_GNItsOnPointActivation;iteration++)
+	{
+		float H = lastHdd;
+		H *= 1+lambda;
+		float step = (1.0/H) * lastbd;
+		float newIdepth = currentIdepth - step;
+
+		float newHdd=0; float newbd=0; float newEnergy=0;
+		for(int i=0;i<nres;i++)
+			newEnergy += linearizeResidual(HCalib, 1, residuals+i,newHdd, newbd, newIdepth);
+
+		if(!std::isfinite(lastEnergy) || newHdd < setting_minIdepthH_act)
+		{
+			if(print) printf("OptPoint: Not well-constrained (%d res, H=%.1f). E=%f. SKIP!\n",
+					nres,
+					newHdd,
+					lastEnergy);
+			return false;
+		}
+
+		if(print) printf("%s %d (L %.2f) %s: %f -> %f (idepth %f)!\n",
+				(true || newEnergy < lastEnergy) ? "ACCEPT" : "REJECT",
+				iteration,
+				log10(lambda),
+				"",
+				lastEnergy, newEnergy, newIdepth);
+
+		if(newEnergy < lastEnergy)
+		{
+			currentIdepth = newIdepth;
+			lastHdd = newHdd;
+			lastbd = newbd;
+			lastEnergy = newEnergy;
+			for(int i=0;i<nres;i++)
+			{
+				residuals[i].state_state = residuals[i].state_NewState;
+				residuals[i].state_energy = residuals[i].state_NewEnergy;
+			}
+
+			lambda *= 0.5;
+		}
+		else
+		{
+			lambda *= 5;
+		}
+
+		if(fabsf(step) < 0.0001*currentIdepth)
+			break;
+	}
+
+	idepth = currentIdepth;
+	return true;
+}
+
+
+// Same as ImmaturePoint::linearizeResidual, but for all residuals of up to 4 points with the same host, one point per
+// SSE lane. Lanes with active[l]==false are left untouched. The accumulation order per lane matches the scalar version.
+static void linearizeResidualsBatch(
+		ImmaturePoint* const* points, const bool* active,
+		ImmaturePointTemporaryResidual* const* res, int nres,
+		CalibHessian* HCalib, float outlierTHSlack, const float* idepth,
+		float* energyOut, float* HddOut, float* bdOut)
+{
+	FrameHessian* host = points[0]->host;
+	const __m128 fxl = _mm_set1_ps(HCalib->fxl()), fyl = _mm_set1_ps(HCalib->fyl());
+	const __m128 cxl = _mm_set1_ps(HCalib->cxl()), cyl = _mm_set1_ps(HCalib->cyl());
+	const __m128 fxli = _mm_set1_ps(HCalib->fxli()), fyli = _mm_set1_ps(HCalib->fyli());
+	const __m128 minBound = _mm_set1_ps(1.1f);
+	const __m128 maxU = _mm_set1_ps(wM3G), maxV = _mm_set1_ps(hM3G);
+	const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1), two = _mm_set1_ps(2);
+	const __m128 huberTH = _mm_set1_ps(setting_huberTH);
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+
+	const __m128 pu = _mm_setr_ps(points[0]->u, points[1]->u, points[2]->u, points[3]->u);
+	const __m128 pv = _mm_setr_ps(points[0]->v, points[1]->v, points[2]->v, points[3]->v);
+	const __m128 id = _mm_loadu_ps(idepth);
+
+	__m128 Hdd = _mm_loadu_ps(HddOut);
+	__m128 bd = _mm_loadu_ps(bdOut);
+
+	EIGEN_ALIGN16 float Ku[4], Kv[4], valid[4], hc0[4], hc1[4], hc2[4], aliveF[4], energyLeft[4];
+	for(int i=0;i<nres;i++)
+	{
+		FrameHessian* target = res[0][i].target;
+		const FrameFramePrecalc* precalc = &(host->targetPrecalc[target->idx]);
+		const Mat33f &R = precalc->PRE_RTll;
+		const Vec3f &t = precalc->PRE_tTll;
+		const ImageLevel dIl = target->image(0);
+		const __m128 aff0 = _mm_set1_ps(precalc->PRE_aff_mode[0]), aff1 = _mm_set1_ps(precalc->PRE_aff_mode[1]);
+		const __m128 t0 = _mm_set1_ps(t[0]), t1 = _mm_set1_ps(t[1]), t2 = _mm_set1_ps(t[2]);
+
+		bool alive[4];
+		for(int l=0;l<4;l++)
+		{
+			alive[l] = active[l];
+			if(active[l] && res[l][i].state_state == ResState::OOB)
+			{
+				res[l][i].state_NewState = ResState::OOB;
+				energyOut[l] += res[l][i].state_energy;
+				alive[l] = false;
+			}
+		}
+
+		__m128 energy = zero;
+		for(int idx=0;idx<patternNum;idx++)
+		{
+			if(!(alive[0] || alive[1] || alive[2] || alive[3])) break;
+
+			// projectPoint.
+			__m128 x = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(pu, _mm_set1_ps(patternP[idx][0])), cxl), fxli);
+			__m128 y = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(pv, _mm_set1_ps(patternP[idx][1])), cyl), fyli);
+			__m128 ptp0 = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(R(0,0)), x), _mm_mul_ps(_mm_set1_ps(R(0,1)), y)), _mm_set1_ps(R(0,2))), _mm_mul_ps(t0, id));
+			__m128 ptp1 = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(R(1,0)), x), _mm_mul_ps(_mm_set1_ps(R(1,1)), y)), _mm_set1_ps(R(1,2))), _mm_mul_ps(t1, id));
+			__m128 ptp2 = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(R(2,0)), x), _mm_mul_ps(_mm_set1_ps(R(2,1)), y)), _mm_set1_ps(R(2,2))), _mm_mul_ps(t2, id));
+			__m128 drescale = _mm_div_ps(one, ptp2);
+			__m128 u = _mm_mul_ps(ptp0, drescale);
+			__m128 v = _mm_mul_ps(ptp1, drescale);
+			__m128 ku = _mm_add_ps(_mm_mul_ps(u, fxl), cxl);
+			__m128 kv = _mm_add_ps(_mm_mul_ps(v, fyl), cyl);
+			__m128 inBounds = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(drescale, zero),
+					_mm_and_ps(_mm_cmpgt_ps(ku, minBound), _mm_cmpgt_ps(kv, minBound))),
+					_mm_and_ps(_mm_cmplt_ps(ku, maxU), _mm_cmplt_ps(kv, maxV)));
+			_mm_store_ps(Ku, ku);
+			_mm_store_ps(Kv, kv);
+			_mm_store_ps(valid, inBounds);
+
+			// gather the interpolated target values (scalar), lanes that leave the image become OOB.
+			for(int l=0;l<4;l++)
+			{
+				hc0[l] = hc1[l] = hc2[l] = 0;
+				if(!alive[l]) continue;
+				Vec3f hitColor;
+				if(valid[l] != 0)
+					hitColor = getInterpolatedElement33(dIl, Ku[l], Kv[l], wG[0]);
+				if(valid[l] == 0 || !std::isfinite((float)hitColor[0]))
+				{
+					res[l][i].state_NewState = ResState::OOB;
+					energyOut[l] += res[l][i].state_energy;
+					alive[l] = false;
+					continue;
+				}
+				hc0[l] = hitColor[0]; hc1[l] = hitColor[1]; hc2[l] = hitColor[2];
+			}
+			for(int l=0;l<4;l++) aliveF[l] = alive[l] ? 1.0f : 0.0f;
+			__m128 aliveMask = _mm_cmpgt_ps(_mm_load_ps(aliveF), zero);
+
+			__m128 color = _mm_setr_ps(points[0]->color[idx], points[1]->color[idx], points[2]->color[idx], points[3]->color[idx]);
+			__m128 weight = _mm_setr_ps(points[0]->weights[idx], points[1]->weights[idx], points[2]->weights[idx], points[3]->weights[idx]);
+			__m128 w2 = _mm_mul_ps(weight, weight);
+
+			__m128 residual = _mm_sub_ps(_mm_load_ps(hc0), _mm_add_ps(_mm_mul_ps(aff0, color), aff1));
+			__m128 absRes = _mm_andnot_ps(signMask, residual);
+			__m128 isSmall = _mm_cmplt_ps(absRes, huberTH);
+			__m128 hw = _mm_or_ps(_mm_and_ps(isSmall, one), _mm_andnot_ps(isSmall, _mm_div_ps(huberTH, absRes)));
+			energy = _mm_add_ps(energy, _mm_and_ps(aliveMask,
+					_mm_mul_ps(_mm_mul_ps(_mm_mul_ps(_mm_mul_ps(w2, hw), residual), residual), _mm_sub_ps(two, hw))));
+
+			// depth derivatives (derive_idepth).
+			__m128 dxInterp = _mm_mul_ps(_mm_load_ps(hc1), fxl);
+			__m128 dyInterp = _mm_mul_ps(_mm_load_ps(hc2), fyl);
+			__m128 dIdepth = _mm_mul_ps(_mm_add_ps(
+					_mm_mul_ps(_mm_mul_ps(dxInterp, drescale), _mm_sub_ps(t0, _mm_mul_ps(t2, u))),
+					_mm_mul_ps(_mm_mul_ps(dyInterp, drescale), _mm_sub_ps(t1, _mm_mul_ps(t2, v)))),
+					_mm_set1_ps(SCALE_IDEPTH));
+
+			hw = _mm_mul_ps(hw, w2);
+			Hdd = _mm_add_ps(Hdd, _mm_and_ps(aliveMask, _mm_mul_ps(_mm_mul_ps(hw, dIdepth), dIdepth)));
+			bd = _mm_add_ps(bd, _mm_and_ps(aliveMask, _mm_mul_ps(_mm_mul_ps(hw, residual), dIdepth)));
+		}
+
+		_mm_store_ps(energyLeft, energy);
+		for(int l=0;l<4;l++)
+		{
+			if(!alive[l]) continue;
+			float energyTH = points[l]->energyTH*outlierTHSlack;
+			if(energyLeft[l] > energyTH)
+			{
+				energyLeft[l] = energyTH;
+				res[l][i].state_NewState = ResState::OUTLIER;
+			}
+			else
+			{
+				res[l][i].state_NewState = ResState::IN;
+			}
+			res[l][i].state_NewEnergy = energyLeft[l];
+			energyOut[l] += energyLeft[l];
+		}
+	}
+
+	_mm_storeu_ps(HddOut, Hdd);
+	_mm_storeu_ps(bdOut, bd);
+}
+
+void ImmaturePoint::optimizeIdepthBatch(
+		ImmaturePoint** points, int num, const std::vector<FrameHessian*>& frames, CalibHessian* HCalib,
+		ImmaturePointTemporaryResidual* residuals, float* idepth, bool* converged)
+{
+	assert(num > 0 && num <= 4);
+	int nres = ((int)frames.size())-1;
+
+	// unused lanes repeat the first point but stay inactive.
+	ImmaturePoint* lanePoints[4];
+	ImmaturePointTemporaryResidual* res[4];
+	bool active[4];
+	EIGEN_ALIGN16 float currentIdepth[4], newIdepth[4], lastEnergy[4], lastHdd[4], lastbd[4];
+	EIGEN_ALIGN16 float newEnergy[4], newHdd[4], newbd[4], lambda[4], step[4];
+	for(int l=0;l<4;l++)
+	{
+		lanePoints[l] = points[l < num ? l : 0];
+		assert(lanePoints[l]->host == points[0]->host);
+		res[l] = residuals + l*nres;
+		active[l] = l < num;
+		currentIdepth[l] = (lanePoints[l]->idepth_max+lanePoints[l]->idepth_min)*0.5f;
+		lastEnergy[l] = lastHdd[l] = lastbd[l] = 0;
+		lambda[l] = 0.1;
+
+		int n = 0;
+		for(FrameHessian* fh : frames)
+		{
+			if(fh == points[0]->host) continue;
+			res[l][n].state_NewEnergy = res[l][n].state_energy = 0;
+			res[l][n].state_NewState = ResState::OUTLIER;
+			res[l][n].state_state = ResState::IN;
+			res[l][n].target = fh;
+			n++;
+		}
+	}
+
+	linearizeResidualsBatch(lanePoints, active, res, nres, HCalib, 1000, currentIdepth, lastEnergy, lastHdd, lastbd);
+
+	// converged[l]: lane finished its iterations (the point is well-constrained).
+	for(int l=0;l<num;l++) converged[l] = false;
+	for(int l=0;l<num;l++)
+	{
+		for(int i=0;i<nres;i++)
+		{
+			res[l][i].state_state = res[l][i].state_NewState;
+			res[l][i].state_energy = res[l][i].state_NewEnergy;
+		}
+		if(!std::isfinite(lastEnergy[l]) || lastHdd[l] < setting_minIdepthH_act)
+			active[l] = false;
+	}
+
+	for(int iteration=0;iteration<setting_GNItsOnPointActivation;iteration++)
+	{
+		if(!(active[0] || active[1] || active[2] || active[3])) break;
+
+		for(int l=0;l<4;l++)
+		{
+			float H = lastHdd[l];
+			H *= 1+lambda[l];
+			step[l] = (1.0/H) * lastbd[l];
+			newIdepth[l] = currentIdepth[l] - step[l];
+			newEnergy[l] = newHdd[l] = newbd[l] = 0;
+		}
+
+		linearizeResidualsBatch(lanePoints, active, res, nres, HCalib, 1, newIdepth, newEnergy, newHdd, newbd);
+
+		for(int l=0;l<num;l++)
+		{
+			if(!active[l]) continue;
+			if(!std::isfinite(lastEnergy[l]) || newHdd[l] < setting_minIdepthH_act)
+			{
+				active[l] = false;
+				continue;
+			}
+
+			if(newEnergy[l] < lastEnergy[l])
+			{
+				currentIdepth[l] = newIdepth[l];
+				lastHdd[l] = newHdd[l];
+				lastbd[l] = newbd[l];
+				lastEnergy[l] = newEnergy[l];
+				for(int i=0;i<nres;i++)
+				{
+					res[l][i].state_state = res[l][i].state_NewState;
+					res[l][i].state_energy = res[l][i].state_NewEnergy;
+				}
+				lambda[l] *= 0.5;
+			}
+			else
+			{
+				lambda[l] *= 5;
+			}
+
+			if(fabsf(step[l]) < 0.0001*currentIdepth[l])
+			{
+				active[l] = false;
+				converged[l] = true;
+			}
+		}
+	}
+
+	for(int l=0;l<num;l++)
+	{
+		if(active[l]) converged[l] = true; // ran out of iterations.
+		idepth[l] = currentIdepth[l];
+	}
+}
 
 }
@@ -104,7 +104,23 @@ public:
 			ImmaturePointTemporaryResidual* tmpRes,
 			float idepth);
 
+	// Gauss-Newton on the inverse depth for the activation, with one residual for each frame in frames except the host
+	// (residuals needs frames.size()-1 entries). Returns false if the point is not well-constrained, otherwise sets
+	// idepth, and the states of residuals tell which observations are inliers.
+	bool optimizeIdepth(
+			const std::vector<FrameHessian*>& frames, CalibHessian* HCalib,
+			ImmaturePointTemporaryResidual* residuals, float& idepth);
+
+	// Same as optimizeIdepth for up to 4 points of the same host, run in lockstep in SSE lanes. residuals needs space
+	// for 4*(frames.size()-1) entries (frames.size()-1 per lane), converged[l] is the return value for points[l].
+	static void optimizeIdepthBatch(
+			ImmaturePoint** points, int num, const std::vector<FrameHessian*>& frames, CalibHessian* HCalib,
+			ImmaturePointTemporaryResidual* residuals, float* idepth, bool* converged);
+
 private:
+	// traceOn for one image layout (const Eigen::Vector3f* or CompactLevel), see withImageLevel.
+	template<typename ImageT>
+	ImmaturePointStatus traceOnImpl(const ImageT& dIl, FrameHessian* frame, const Mat33f &hostToFrame_KRKi, const Vec3f &hostToFrame_Kt, const Vec2f &hostToFrame_affine, CalibHessian* HCalib, bool debugPrint);
 };
 
 }
@@ -26,6 +26,7 @@
 
 
 #include "util/NumType.h"
+#include "util/CompactImage.h"
 
 
  
@@ -38,7 +39,7 @@ const float minUseGrad_pixsel = 10;
 
 
 template<int pot>
-inline int gridMaxSelection(Eigen::Vector3f* grads, bool* map_out, int w, int h, float THFac)
+inline int gridMaxSelection(const ImageLevel& grads, bool* map_out, int w, int h, float THFac)
 {
 
 	memset(map_out, 0, sizeof(bool)*w*h);
@@ -55,12 +56,12 @@ inline int gridMaxSelection(Eigen::Vector3f* grads, bool* map_out, int w, int h,
 
 			float bestXX=0, bestYY=0, bestXY=0, bestYX=0;
 
-			Eigen::Vector3f* grads0 = grads+x+y*w;
+			int grads0 = x+y*w;
 			for(int dx=0;dx<pot;dx++)
 				for(int dy=0;dy<pot;dy++)
 				{
 					int idx = dx+dy*w;
-					Eigen::Vector3f g=grads0[idx];
+					Eigen::Vector3f g=grads[grads0+idx];
 					float sqgd = g.tail<2>().squaredNorm();
 					float TH = THFac*minUseGrad_pixsel * (0.75f);
 
@@ -117,7 +118,7 @@ inline int gridMaxSelection(Eigen::Vector3f* grads, bool* map_out, int w, int h,
 }
 
 
-inline int gridMaxSelection(Eigen::Vector3f* grads, bool* map_out, int w, int h, int pot, float THFac)
+inline int gridMaxSelection(const ImageLevel& grads, bool* map_out, int w, int h, int pot, float THFac)
 {
 
 	memset(map_out, 0, sizeof(bool)*w*h);
@@ -134,12 +135,12 @@ inline int gridMaxSelection(Eigen::Vector3f* grads, bool* map_out, int w, int h,
 
 			float bestXX=0, bestYY=0, bestXY=0, bestYX=0;
 
-			Eigen::Vector3f* grads0 = grads+x+y*w;
+			int grads0 = x+y*w;
 			for(int dx=0;dx<pot;dx++)
 				for(int dy=0;dy<pot;dy++)
 				{
 					int idx = dx+dy*w;
-					Eigen::Vector3f g=grads0[idx];
+					Eigen::Vector3f g=grads[grads0+idx];
 					float sqgd = g.tail<2>().squaredNorm();
 					float TH = THFac*minUseGrad_pixsel * (0.75f);
 
@@ -196,7 +197,7 @@ inline int gridMaxSelection(Eigen::Vector3f* grads, bool* map_out, int w, int h,
 }
 
 
-inline int makePixelStatus(Eigen::Vector3f* grads, bool* map, int w, int h, float desiredDensity, int recsLeft=5, float THFac = 1)
+inline int makePixelStatus(const ImageLevel& grads, bool* map, int w, int h, float desiredDensity, int recsLeft=5, float THFac = 1)
 {
 	if(sparsityFactor < 1) sparsityFactor = 1;
 
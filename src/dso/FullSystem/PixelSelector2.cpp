@@ -35,6 +35,11 @@
 #include "util/globalCalib.h"
 #include "FullSystem/HessianBlocks.h"
 #include "util/globalFuncs.h"
+#include <algorithm>
+
+#if !defined(__SSE3__) && !defined(__SSE2__) && !defined(__SSE1__)
+#include "SSE2NEON.h"
+#endif
 
 namespace dso
 {
@@ -62,21 +67,24 @@ PixelSelector::PixelSelector(int w, int h)
 
     std::cout << "PixelSelector: Using block sizes: " << bW << ", " << bH << '\n';
 
-	gradHist = new int[100*(1+nbW)*(1+nbH)];
 	ths = new float[(nbW)*(nbH)+100];
 	thsSmoothed = new float[(nbW)*(nbH)+100];
+	for(int i=0;i<3;i++)
+		scores[i] = new float[w*h];
 
 
 	allowFast=false;
 	gradHistFrame=0;
+	red=0;
 }
 
 PixelSelector::~PixelSelector()
 {
 	delete[] randomPattern;
-	delete[] gradHist;
 	delete[] ths;
 	delete[] thsSmoothed;
+	for(int i=0;i<3;i++)
+		delete[] scores[i];
 }
 
 int computeHistQuantil(int* hist, float below)
@@ -91,23 +99,20 @@ int computeHistQuantil(int* hist, float below)
 }
 
 
-void PixelSelector::makeHists(const FrameHessian* const fh)
+void PixelSelector::makeHists_Reductor(int min, int max, Vec10* stats, int tid)
 {
-	gradHistFrame = fh;
-	float * mapmax0 = fh->absSquaredGrad[0];
+	float * mapmax0 = gradHistFrame->absSquaredGrad[0];
 
 	int w = wG[0];
 	int h = hG[0];
 
 	int w32 = nbW;
-	int h32 = nbH;
-	thsStep = w32;
 
-	for(int y=0;y<h32;y++)
+	int hist0[50];
+	for(int y=min;y<max;y++)
 		for(int x=0;x<w32;x++)
 		{
 			float* map0 = mapmax0+bW*x+bH*y*w;
-			int* hist0 = gradHist;// + 50*(x+y*w32);
 			memset(hist0,0,sizeof(int)*50);
 
 			for(int j=0;j<bH;j++) for(int i=0;i<bW;i++)
@@ -123,6 +128,72 @@ void PixelSelector::makeHists(const FrameHessian* const fh)
 
 			ths[x+y*w32] = computeHistQuantil(hist0,setting_minGradHistCut) + setting_minGradHistAdd;
 		}
+}
+
+void PixelSelector::makeScores_Reductor(int min, int max, Vec10* stats, int tid)
+{
+	int w = wG[0];
+	int w1 = wG[1];
+	int w2 = wG[2];
+	int h = hG[0];
+
+	float dw1 = setting_gradDownweightPerLevel;
+	float dw2 = dw1*dw1;
+
+	for(int y=min;y<max;y++)
+	{
+		float* s0 = scores[0] + y*w;
+		float* s1 = scores[1] + y*w;
+		float* s2 = scores[2] + y*w;
+
+		if(y<4 || y>h-4)
+		{
+			for(int x=0;x<w;x++) s0[x] = s1[x] = s2[x] = -1;
+			continue;
+		}
+
+		// the level 1 / 2 pixels used for pixel (x,y) are (x>>1, y>>1) and (x>>2, y>>2).
+		const float* ag0 = gradHistFrame->absSquaredGrad[0] + y*w;
+		const float* ag1 = gradHistFrame->absSquaredGrad[1] + (y>>1)*w1;
+		const float* ag2 = gradHistFrame->absSquaredGrad[2] + (y>>2)*w2;
+		const float* thRow = thsSmoothed + (y / bH) * thsStep;
+
+		// bW is a multiple of 4, so all 4 pixels share the same threshold.
+		for(int x=0;x<w;x+=4)
+		{
+			float pixelTH0 = thRow[x / bW];
+			float pixelTH1 = pixelTH0*dw1;
+			float pixelTH2 = pixelTH1*dw2;
+
+			_mm_storeu_ps(s0+x, _mm_div_ps(_mm_loadu_ps(ag0+x), _mm_set1_ps(pixelTH0)));
+			_mm_storeu_ps(s1+x, _mm_div_ps(_mm_setr_ps(ag1[x>>1], ag1[x>>1], ag1[(x>>1)+1], ag1[(x>>1)+1]), _mm_set1_ps(pixelTH1)));
+			_mm_storeu_ps(s2+x, _mm_div_ps(_mm_set1_ps(ag2[x>>2]), _mm_set1_ps(pixelTH2)));
+		}
+
+		for(int x=0;x<4;x++) s0[x] = s1[x] = s2[x] = -1;
+		for(int x=w-5;x<w;x++) s0[x] = s1[x] = s2[x] = -1;
+	}
+}
+
+void PixelSelector::invalidateCache()
+{
+	gradHistFrame = 0;
+	selectionCache.clear();
+}
+
+void PixelSelector::makeHists(const FrameHessian* const fh)
+{
+	gradHistFrame = fh;
+	selectionCache.clear();
+
+	int w32 = nbW;
+	int h32 = nbH;
+	thsStep = w32;
+
+	if(multiThreading && red != 0)
+		red->reduce(boost::bind(&PixelSelector::makeHists_Reductor, this, _1, _2, _3, _4), 0, h32, 0);
+	else
+		makeHists_Reductor(0, h32, 0, 0);
 
 	for(int y=0;y<h32;y++)
 		for(int x=0;x<w32;x++)
@@ -150,11 +221,26 @@ void PixelSelector::makeHists(const FrameHessian* const fh)
 
 		}
 
+	if(multiThreading && red != 0)
+		red->reduce(boost::bind(&PixelSelector::makeScores_Reductor, this, _1, _2, _3, _4), 0, hG[0], 0);
+	else
+		makeScores_Reductor(0, hG[0], 0, 0);
+}
 
-
-
-
+const PixelSelector::SelectionCandidates& PixelSelector::getCandidates(int pot, float thFactor)
+{
+	for(const SelectionCandidates& c : selectionCache)
+		if(c.pot == pot && c.thFactor == thFactor)
+			return c;
+
+	selectionCache.emplace_back();
+	SelectionCandidates& candidates = selectionCache.back();
+	candidates.pot = pot;
+	candidates.thFactor = thFactor;
+	select(candidates);
+	return candidates;
 }
+
 int PixelSelector::makeMaps(
 		const FrameHessian* const fh,
 		float* map_out, float density, int recursionsLeft, bool plot, float thFactor)
@@ -164,43 +250,20 @@ int PixelSelector::makeMaps(
 	float quotia;
 	int idealPotential = currentPotential;
 
+	// the number of selected pixels behaves approximately as
+	// K / (pot+1)^2, where K is a scene-dependent constant.
+	// we will allow sub-selecting pixels by up to a quotia of 0.25, otherwise we will re-select.
 
-//	if(setting_pixelSelectionUseFast>0 && allowFast)
-//	{
-//		memset(map_out, 0, sizeof(float)*wG[0]*hG[0]);
-//		std::vector<cv::KeyPoint> pts;
-//		cv::Mat img8u(hG[0],wG[0],CV_8U);
-//		for(int i=0;i<wG[0]*hG[0];i++)
-//		{
-//			float v = fh->dI[i][0]*0.8;
-//			img8u.at<uchar>(i) = (!std::isfinite(v) || v>255) ? 255 : v;
-//		}
-//		cv::FAST(img8u, pts, setting_pixelSelectionUseFast, true);
-//		for(unsigned int i=0;i<pts.size();i++)
-//		{
-//			int x = pts[i].pt.x+0.5;
-//			int y = pts[i].pt.y+0.5;
-//			map_out[x+y*wG[0]]=1;
-//			numHave++;
-//		}
-//
-//		printf("FAST selection: got %f / %f!\n", numHave, numWant);
-//		quotia = numWant / numHave;
-//	}
-//	else
-	{
-
-
-
-
-		// the number of selected pixels behaves approximately as
-		// K / (pot+1)^2, where K is a scene-dependent constant.
-		// we will allow sub-selecting pixels by up to a quotia of 0.25, otherwise we will re-select.
-
-		if(fh != gradHistFrame) makeHists(fh);
+	// histograms and per-pixel scores are computed once per frame. Re-selecting with a different potential only
+	// scans the cached scores, and a potential that was already tried for this frame is not selected again.
+	if(fh != gradHistFrame) makeHists(fh);
 
+	const SelectionCandidates* candidates;
+	while(true)
+	{
 		// select!
-		Eigen::Vector3i n = this->select(fh, map_out,currentPotential, thFactor);
+		candidates = &getCandidates(currentPotential, thFactor);
+		const Eigen::Vector3i& n = candidates->n;
 
 		// sub-select!
 		numHave = n[0]+n[1]+n[2];
@@ -218,13 +281,8 @@ int PixelSelector::makeMaps(
 			if(idealPotential>=currentPotential)
 				idealPotential = currentPotential-1;
 
-	//		printf("PixelSelector: have %.2f%%, need %.2f%%. RESAMPLE with pot %d -> %d.\n",
-	//				100*numHave/(float)(wG[0]*hG[0]),
-	//				100*numWant/(float)(wG[0]*hG[0]),
-	//				currentPotential,
-	//				idealPotential);
 			currentPotential = idealPotential;
-			return makeMaps(fh,map_out, density, recursionsLeft-1, plot,thFactor);
+			recursionsLeft--;
 		}
 		else if(recursionsLeft>0 && quotia < 0.25)
 		{
@@ -233,35 +291,28 @@ int PixelSelector::makeMaps(
 			if(idealPotential<=currentPotential)
 				idealPotential = currentPotential+1;
 
-	//		printf("PixelSelector: have %.2f%%, need %.2f%%. RESAMPLE with pot %d -> %d.\n",
-	//				100*numHave/(float)(wG[0]*hG[0]),
-	//				100*numWant/(float)(wG[0]*hG[0]),
-	//				currentPotential,
-	//				idealPotential);
 			currentPotential = idealPotential;
-			return makeMaps(fh,map_out, density, recursionsLeft-1, plot,thFactor);
-
+			recursionsLeft--;
+		}
+		else
+		{
+			break;
 		}
 	}
 
+	// write the (randomly sub-sampled) candidates. They are sorted by pixel index, so this is the same as
+	// sub-selecting in raster order.
+	memset(map_out,0,wG[0]*hG[0]*sizeof(PixelSelectorStatus));
 	int numHaveSub = numHave;
-	if(quotia < 0.95)
+	unsigned char charTH = quotia < 0.95 ? 255*quotia : 255;
+	for(unsigned int rn=0;rn<candidates->points.size();rn++)
 	{
-		int wh=wG[0]*hG[0];
-		int rn=0;
-		unsigned char charTH = 255*quotia;
-		for(int i=0;i<wh;i++)
+		if(quotia < 0.95 && randomPattern[rn] > charTH)
 		{
-			if(map_out[i] != 0)
-			{
-				if(randomPattern[rn] > charTH )
-				{
-					map_out[i]=0;
-					numHaveSub--;
-				}
-				rn++;
-			}
+			numHaveSub--;
+			continue;
 		}
+		map_out[candidates->points[rn].first] = candidates->points[rn].second;
 	}
 
 //	printf("PixelSelector: have %.2f%%, need %.2f%%. KEEPCURR with pot %d -> %d. Subsampled to %.2f%%\n",
@@ -280,10 +331,11 @@ int PixelSelector::makeMaps(
 
 
 		MinimalImageB3 img(w,h);
+		const ImageLevel dI = fh->image(0);
 
 		for(int i=0;i<w*h;i++)
 		{
-			float c = fh->dI[i][0]*0.7;
+			float c = dI[i][0]*0.7;
 			if(c>255) c=255;
 			img.at(i) = Vec3b(c,c,c);
 		}
@@ -308,15 +360,44 @@ int PixelSelector::makeMaps(
 
 
 
-Eigen::Vector3i PixelSelector::select(const FrameHessian* const fh,
-		float* map_out, int pot, float thFactor)
+void PixelSelector::select(SelectionCandidates& candidates)
+{
+	int pot = candidates.pot;
+	int h = hG[0];
+
+	// each row of (4*pot x 4*pot)-blocks is independent, so they are processed in parallel.
+	int numRows = (h + 4*pot - 1) / (4*pot);
+	rowCandidates.resize(numRows);
+
+	Vec10 stats = Vec10::Zero();
+	if(multiThreading && red != 0)
+	{
+		stats = red->reduce(boost::bind(&PixelSelector::select_Reductor, this, pot, candidates.thFactor, _1, _2, _3, _4), 0, numRows, 0);
+	}
+	else
+		select_Reductor(pot, candidates.thFactor, 0, numRows, &stats, 0);
+
+	candidates.n = Eigen::Vector3i((int)stats[0], (int)stats[1], (int)stats[2]);
+	candidates.points.clear();
+	candidates.points.reserve(candidates.n.sum());
+	for(int row=0;row<numRows;row++)
+		candidates.points.insert(candidates.points.end(), rowCandidates[row].begin(), rowCandidates[row].end());
+}
+
+
+void PixelSelector::select_Reductor(int pot, float thFactor, int min, int max, Vec10* stats, int tid)
 {
 
-	Eigen::Vector3f const * const map0 = fh->dI;
+	const ImageLevel map0 = gradHistFrame->image(0);
+
+	const float * score0 = scores[0];
+	const float * score1 = scores[1];
+	const float * score2 = scores[2];
 
-	float * mapmax0 = fh->absSquaredGrad[0];
-	float * mapmax1 = fh->absSquaredGrad[1];
-	float * mapmax2 = fh->absSquaredGrad[2];
+	// raw squared gradients, only needed if !setting_selectDirectionDistribution.
+	const float * mapmax0 = gradHistFrame->absSquaredGrad[0];
+	const float * mapmax1 = gradHistFrame->absSquaredGrad[1];
+	const float * mapmax2 = gradHistFrame->absSquaredGrad[2];
 
 
 	int w = wG[0];
@@ -343,116 +424,111 @@ Eigen::Vector3i PixelSelector::select(const FrameHessian* const fh,
 	         Vec2f(1.0000,    0.0000),
 	         Vec2f(0.1951,   -0.9808)};
 
-	memset(map_out,0,w*h*sizeof(PixelSelectorStatus));
 
-
-
-	float dw1 = setting_gradDownweightPerLevel;
-	float dw2 = dw1*dw1;
-
-
-	int n3=0, n2=0, n4=0;
-	for(int y4=0;y4<h;y4+=(4*pot)) for(int x4=0;x4<w;x4+=(4*pot))
+	for(int row=min;row<max;row++)
 	{
-		int my3 = std::min((4*pot), h-y4);
-		int mx3 = std::min((4*pot), w-x4);
-		int bestIdx4=-1; float bestVal4=0;
-		Vec2f dir4 = directions[randomPattern[n2] & 0xF];
-		for(int y3=0;y3<my3;y3+=(2*pot)) for(int x3=0;x3<mx3;x3+=(2*pot))
+		std::vector<std::pair<int, unsigned char>>& out = rowCandidates[row];
+		out.clear();
+
+		int y4 = row*(4*pot);
+		for(int x4=0;x4<w;x4+=(4*pot))
 		{
-			int x34 = x3+x4;
-			int y34 = y3+y4;
-			int my2 = std::min((2*pot), h-y34);
-			int mx2 = std::min((2*pot), w-x34);
-			int bestIdx3=-1; float bestVal3=0;
-			Vec2f dir3 = directions[randomPattern[n2] & 0xF];
-			for(int y2=0;y2<my2;y2+=pot) for(int x2=0;x2<mx2;x2+=pot)
+			int my3 = std::min((4*pot), h-y4);
+			int mx3 = std::min((4*pot), w-x4);
+			int bestIdx4=-1; float bestVal4=0;
+			// the random direction of a block only depends on its position (and not on the number of points
+			// selected before), so that blocks can be processed in any order.
+			Vec2f dir4 = directions[randomPattern[w*h-1 - (x4+y4*w)] & 0xF];
+			for(int y3=0;y3<my3;y3+=(2*pot)) for(int x3=0;x3<mx3;x3+=(2*pot))
 			{
-				int x234 = x2+x34;
-				int y234 = y2+y34;
-				int my1 = std::min(pot, h-y234);
-				int mx1 = std::min(pot, w-x234);
-				int bestIdx2=-1; float bestVal2=0;
-				Vec2f dir2 = directions[randomPattern[n2] & 0xF];
-				for(int y1=0;y1<my1;y1+=1) for(int x1=0;x1<mx1;x1+=1)
+				int x34 = x3+x4;
+				int y34 = y3+y4;
+				int my2 = std::min((2*pot), h-y34);
+				int mx2 = std::min((2*pot), w-x34);
+				int bestIdx3=-1; float bestVal3=0;
+				Vec2f dir3 = directions[randomPattern[x34+y34*w] >> 4];
+				for(int y2=0;y2<my2;y2+=pot) for(int x2=0;x2<mx2;x2+=pot)
 				{
-					assert(x1+x234 < w);
-					assert(y1+y234 < h);
-					int idx = x1+x234 + w*(y1+y234);
-					int xf = x1+x234;
-					int yf = y1+y234;
-
-					if(xf<4 || xf>=w-5 || yf<4 || yf>h-4) continue;
-
-
-                    float pixelTH0 = thsSmoothed[xf / bW + (yf / bH) * thsStep];
-					float pixelTH1 = pixelTH0*dw1;
-					float pixelTH2 = pixelTH1*dw2;
-
-
-					float ag0 = mapmax0[idx];
-					if(ag0 > pixelTH0*thFactor)
+					int x234 = x2+x34;
+					int y234 = y2+y34;
+					int my1 = std::min(pot, h-y234);
+					int mx1 = std::min(pot, w-x234);
+					int bestIdx2=-1; float bestVal2=0;
+					Vec2f dir2 = directions[randomPattern[x234+y234*w] & 0xF];
+					for(int y1=0;y1<my1;y1+=1) for(int x1=0;x1<mx1;x1+=1)
 					{
-						Vec2f ag0d = map0[idx].tail<2>();
-						float dirNorm = fabsf((float)(ag0d.dot(dir2)));
-						if(!setting_selectDirectionDistribution) dirNorm = ag0;
-
-						if(dirNorm > bestVal2)
-						{ bestVal2 = dirNorm; bestIdx2 = idx; bestIdx3 = -2; bestIdx4 = -2;}
-					}
-					if(bestIdx3==-2) continue;
-
-					float ag1 = mapmax1[(int)(xf*0.5f+0.25f) + (int)(yf*0.5f+0.25f)*w1];
-					if(ag1 > pixelTH1*thFactor)
-					{
-						Vec2f ag0d = map0[idx].tail<2>();
-						float dirNorm = fabsf((float)(ag0d.dot(dir3)));
-						if(!setting_selectDirectionDistribution) dirNorm = ag1;
-
-						if(dirNorm > bestVal3)
-						{ bestVal3 = dirNorm; bestIdx3 = idx; bestIdx4 = -2;}
+						assert(x1+x234 < w);
+						assert(y1+y234 < h);
+						int idx = x1+x234 + w*(y1+y234);
+						int xf = x1+x234;
+						int yf = y1+y234;
+
+						// border pixels have a negative score.
+						float ag0 = score0[idx];
+						if(ag0 < 0) continue;
+
+						if(ag0 > thFactor)
+						{
+							Vec2f ag0d = map0[idx].tail<2>();
+							float dirNorm = fabsf((float)(ag0d.dot(dir2)));
+							if(!setting_selectDirectionDistribution) dirNorm = mapmax0[idx];
+
+							if(dirNorm > bestVal2)
+							{ bestVal2 = dirNorm; bestIdx2 = idx; bestIdx3 = -2; bestIdx4 = -2;}
+						}
+						if(bestIdx3==-2) continue;
+
+						float ag1 = score1[idx];
+						if(ag1 > thFactor)
+						{
+							Vec2f ag0d = map0[idx].tail<2>();
+							float dirNorm = fabsf((float)(ag0d.dot(dir3)));
+							if(!setting_selectDirectionDistribution) dirNorm = mapmax1[(xf>>1) + (yf>>1)*w1];
+
+							if(dirNorm > bestVal3)
+							{ bestVal3 = dirNorm; bestIdx3 = idx; bestIdx4 = -2;}
+						}
+						if(bestIdx4==-2) continue;
+
+						float ag2 = score2[idx];
+						if(ag2 > thFactor)
+						{
+							Vec2f ag0d = map0[idx].tail<2>();
+							float dirNorm = fabsf((float)(ag0d.dot(dir4)));
+							if(!setting_selectDirectionDistribution) dirNorm = mapmax2[(xf>>2) + (yf>>2)*w2];
+
+							if(dirNorm > bestVal4)
+							{ bestVal4 = dirNorm; bestIdx4 = idx; }
+						}
 					}
-					if(bestIdx4==-2) continue;
 
-					float ag2 = mapmax2[(int)(xf*0.25f+0.125) + (int)(yf*0.25f+0.125)*w2];
-					if(ag2 > pixelTH2*thFactor)
+					if(bestIdx2>0)
 					{
-						Vec2f ag0d = map0[idx].tail<2>();
-						float dirNorm = fabsf((float)(ag0d.dot(dir4)));
-						if(!setting_selectDirectionDistribution) dirNorm = ag2;
-
-						if(dirNorm > bestVal4)
-						{ bestVal4 = dirNorm; bestIdx4 = idx; }
+						out.push_back(std::make_pair(bestIdx2, (unsigned char)1));
+						bestVal3 = 1e10;
+						(*stats)[0]++;
 					}
 				}
 
-				if(bestIdx2>0)
+				if(bestIdx3>0)
 				{
-					map_out[bestIdx2] = 1;
-					bestVal3 = 1e10;
-					n2++;
+					out.push_back(std::make_pair(bestIdx3, (unsigned char)2));
+					bestVal4 = 1e10;
+					(*stats)[1]++;
 				}
 			}
 
-			if(bestIdx3>0)
+			if(bestIdx4>0)
 			{
-				map_out[bestIdx3] = 2;
-				bestVal4 = 1e10;
-				n3++;
+				out.push_back(std::make_pair(bestIdx4, (unsigned char)4));
+				(*stats)[2]++;
 			}
 		}
 
-		if(bestIdx4>0)
-		{
-			map_out[bestIdx4] = 4;
-			n4++;
-		}
+		// all candidates of this row lie in the pixel rows [y4, y4+4*pot), so sorting each row sorts all of them.
+		std::sort(out.begin(), out.end());
 	}
-
-
-	return Eigen::Vector3i(n2,n3,n4);
 }
 
 
 }
-
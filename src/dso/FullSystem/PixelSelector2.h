@@ -27,6 +27,8 @@
 #pragma once
  
 #include "util/NumType.h"
+#include "util/IndexThreadReduce.h"
+#include <vector>
 
 namespace dso
 {
@@ -51,21 +53,49 @@ public:
 
 	bool allowFast;
 	void makeHists(const FrameHessian* const fh);
+	// forget the histograms and cached selections, e.g. after the frames have been deleted (their address can be reused).
+	void invalidateCache();
+
+	// optional thread pool (not owned). If set, histograms, pixel scores and selection are computed in parallel.
+	IndexThreadReduce<Vec10>* red;
 private:
 
-	Eigen::Vector3i select(const FrameHessian* const fh,
-			float* map_out, int pot, float thFactor=1);
+	// Selected pixels for one (potential, thFactor) combination, sorted by pixel index.
+	struct SelectionCandidates
+	{
+		int pot;
+		float thFactor;
+		std::vector<std::pair<int, unsigned char>> points;	// pixel index and type (1, 2 or 4, as written to map_out).
+		Eigen::Vector3i n;
+	};
+
+	const SelectionCandidates& getCandidates(int pot, float thFactor);
+	void select(SelectionCandidates& candidates);
+
+	void makeHists_Reductor(int min, int max, Vec10* stats, int tid);
+	void makeScores_Reductor(int min, int max, Vec10* stats, int tid);
+	void select_Reductor(int pot, float thFactor, int min, int max, Vec10* stats, int tid);
 
 
 	unsigned char* randomPattern;
 
 
-	int* gradHist;
 	float* ths;
 	float* thsSmoothed;
 	int thsStep;
 	const FrameHessian* gradHistFrame;
 
+	// per-pixel ratio between the squared gradient on pyramid level 0, 1, 2 and the respective block threshold.
+	// A pixel passes the threshold of a level iff score > thFactor. Invalid (border) pixels have a negative score.
+	// Computed once per frame together with the histograms.
+	float* scores[3];
+
+	// candidates of all selections done for gradHistFrame, so that re-selecting with a potential that has already been
+	// tried only is a (sub-sampling) filter over the cached candidates.
+	std::vector<SelectionCandidates> selectionCache;
+	// per block-row results of the currently running (parallel) selection.
+	std::vector<std::vector<std::pair<int, unsigned char>>> rowCandidates;
+
 	// block width, and block height.
 	int bW, bH;
 	// number of blocks in x and y dimension.
@@ -76,6 +76,12 @@ PointFrameResidual::PointFrameResidual(PointHessian* point_, FrameHessian* host_
 
 
 double PointFrameResidual::linearize(CalibHessian* HCalib)
+{
+	return withImageLevel(target->image(0), [&](auto dIl) { return linearizeImpl(dIl, HCalib); });
+}
+
+template<typename ImageT>
+double PointFrameResidual::linearizeImpl(const ImageT& dIl, CalibHessian* HCalib)
 {
 	state_NewEnergyWithOutlier=-1;
 
@@ -84,7 +90,6 @@ double PointFrameResidual::linearize(CalibHessian* HCalib)
 
 	FrameFramePrecalc* precalc = &(host->targetPrecalc[target->idx]);
 	float energyLeft=0;
-	const Eigen::Vector3f* dIl = target->dI;
 	//const float* const Il = target->I;
 	const Mat33f &PRE_KRKiTll = precalc->PRE_KRKiTll;
 	const Vec3f &PRE_KtTll = precalc->PRE_KtTll;
@@ -87,6 +87,9 @@ public:
 	PointFrameResidual();
 	PointFrameResidual(PointHessian* point_, FrameHessian* host_, FrameHessian* target_);
 	double linearize(CalibHessian* HCalib);
+	// linearize for one image layout (const Eigen::Vector3f* or CompactLevel), see withImageLevel.
+	template<typename ImageT>
+	double linearizeImpl(const ImageT& dIl, CalibHessian* HCalib);
 
 
 	void resetOOB()
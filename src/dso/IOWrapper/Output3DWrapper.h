@@ -41,6 +41,7 @@ namespace cv {
 namespace dmvio
 {
 class TransformDSOToIMU;
+class IMUState;
 
 // Status of the system.
 enum SystemStatus
@@ -214,6 +215,20 @@ public:
 
 
 
+        /* Usage:
+         * Called for each IMU measurement with the state obtained by integrating the IMU data since the last tracked
+         * frame (only in visual-inertial mode and if a dmvio::IMUPropagator is used, see IMUPropagator.h).
+         * In contrast to the other methods the state is metric and in the IMU world frame (imuToWorld).
+         *
+         * Calling:
+         * Called from the thread which delivers the IMU data, so it should return quickly.
+         */
+        virtual void publishIMURatePose(const dmvio::IMUState& state) {}
+
+
+
+
+
         /* Usage:
          * Called once for each new frame, before it is tracked (i.e., it doesn't have a pose yet).
          *
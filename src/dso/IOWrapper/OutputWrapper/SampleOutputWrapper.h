@@ -31,6 +31,8 @@
 
 #include "FullSystem/HessianBlocks.h"
 #include "util/FrameShell.h"
+#include "IMU/IMUPropagator.h"
+#include "util/AsyncOutputWrapper.h"
 
 namespace dso
 {
@@ -107,6 +109,12 @@ public:
             std::cout << frame->camToWorld.matrix3x4() << "\n";
         }
 
+        virtual void publishIMURatePose(const dmvio::IMUState& state) override
+        {
+            printf("OUT: IMU-rate pose (time %f). IMUToWorld (metric):\n", state.timestamp);
+            std::cout << state.imuToWorld.matrix3x4() << "\n";
+        }
+
 
         virtual void pushLiveFrame(FrameHessian* image) override
         {
@@ -149,6 +157,45 @@ public:
 
 };
 
+// Same output as SampleOutputWrapper, but consumes the snapshots of dmvio::AsyncOutputWrapper in its own thread.
+class SampleSnapshotConsumer : public dmvio::OutputSnapshotConsumer
+{
+public:
+        virtual void consumeGraph(const std::vector<dmvio::GraphEdgeSnapshot>& edges) override
+        {
+            printf("OUT: got graph with %d edges\n", (int)edges.size());
+        }
+
+        virtual void consumeKeyframes(const std::vector<dmvio::KeyframeSnapshot, Eigen::aligned_allocator<dmvio::KeyframeSnapshot>>& frames, bool final) override
+        {
+            for(const dmvio::KeyframeSnapshot& f : frames)
+            {
+                printf("OUT: KF %d (%s) (id %d, tme %f): %d points. CameraToWorld:\n",
+                       f.frameID,
+                       final ? "final" : "non-final",
+                       f.incomingId,
+                       f.timestamp,
+                       (int)f.points.size());
+                std::cout << f.camToWorld.topRows<3>() << "\n";
+            }
+        }
+
+        virtual void consumeCamPose(const dmvio::CamPoseSnapshot& pose) override
+        {
+            printf("OUT: Current Frame %d (time %f, internal ID %d). CameraToWorld:\n",
+                   pose.incomingId,
+                   pose.timestamp,
+                   pose.id);
+            std::cout << pose.camToWorld.topRows<3>() << "\n";
+        }
+
+        virtual void consumeIMURatePose(const dmvio::IMUState& state) override
+        {
+            printf("OUT: IMU-rate pose (time %f). IMUToWorld (metric):\n", state.timestamp);
+            std::cout << state.imuToWorld.matrix3x4() << "\n";
+        }
+};
+
 
 
 }
@@ -33,6 +33,7 @@
 #include "FullSystem/HessianBlocks.h"
 #include "FullSystem/FullSystem.h"
 #include "FullSystem/ImmaturePoint.h"
+#include "util/ThreadTopology.h"
 
 namespace dso
 {
@@ -88,6 +89,7 @@ PangolinDSOViewer::~PangolinDSOViewer()
 void PangolinDSOViewer::run()
 {
 	printf("START PANGOLIN!\n");
+	dmvio::ThreadTopology::applyToCurrentThread(dmvio::THREAD_VIEWER);
 
 	pangolin::CreateWindowAndBind("Main",2*w,2*h);
 	const int UI_WIDTH = 180;
@@ -325,8 +327,12 @@ void PangolinDSOViewer::run()
 	    this->settings_minRelBS = settings_minRelBS.Get();
 	    this->settings_sparsity = settings_sparsity.Get();
 
-	    setting_desiredPointDensity = settings_nPts.Get();
-	    setting_desiredImmatureDensity = settings_nCandidates.Get();
+	    // Only take over the sliders if they were changed, the settings might also be adapted at runtime
+	    // (see ComputeBudgetController).
+	    if(settings_nPts.GuiChanged()) setting_desiredPointDensity = settings_nPts.Get();
+	    else settings_nPts = setting_desiredPointDensity;
+	    if(settings_nCandidates.GuiChanged()) setting_desiredImmatureDensity = settings_nCandidates.Get();
+	    else settings_nCandidates = setting_desiredImmatureDensity;
 	    setting_maxFrames = settings_nMaxFrames.Get();
 	    setting_kfGlobalWeight = settings_kfFrequency.Get();
 	    setting_minGradHistAdd = settings_gradHistAdd.Get();
@@ -581,11 +587,12 @@ void PangolinDSOViewer::pushLiveFrame(FrameHessian* image)
 
 	boost::unique_lock<boost::mutex> lk(openImagesMutex);
 
+	const ImageLevel dI = image->image(0);
 	for(int i=0;i<w*h;i++)
 		internalVideoImg->data[i][0] =
 		internalVideoImg->data[i][1] =
 		internalVideoImg->data[i][2] =
-			image->dI[i][0]*0.8 > 255.0f ? 255.0 : image->dI[i][0]*0.8;
+			dI[i][0]*0.8 > 255.0f ? 255.0 : dI[i][0]*0.8;
 
 	videoImgChanged=true;
 }
@@ -109,7 +109,7 @@ void EnergyFunctional::setAdjointsF(CalibHessian* Hcalib)
 
 
 
-EnergyFunctional::EnergyFunctional(dmvio::BAGTSAMIntegration &gtsamIntegration) : gtsamIntegration(gtsamIntegration)
+EnergyFunctional::EnergyFunctional(dmvio::BAGTSAMIntegration &gtsamIntegration) : gtsamIntegration(&gtsamIntegration)
 {
 	adHost=0;
 	adTarget=0;
@@ -137,6 +137,15 @@ EnergyFunctional::EnergyFunctional(dmvio::BAGTSAMIntegration &gtsamIntegration)
 	currentLambda=0;
 }
 EnergyFunctional::~EnergyFunctional()
+{
+	deleteEFStructs();
+
+	delete accSSE_top_L;
+	delete accSSE_top_A;
+	delete accSSE_bot;
+}
+
+void EnergyFunctional::deleteEFStructs()
 {
 	for(EFFrame* f : frames)
 	{
@@ -161,12 +170,45 @@ EnergyFunctional::~EnergyFunctional()
 	if(adHostF != 0) delete[] adHostF;
 	if(adTargetF != 0) delete[] adTargetF;
 	if(adHTdeltaF != 0) delete[] adHTdeltaF;
+}
 
+void EnergyFunctional::reset(dmvio::BAGTSAMIntegration &gtsamIntegration)
+{
+	deleteEFStructs();
+	adHost=0;
+	adTarget=0;
+	adHostF=0;
+	adTargetF=0;
+	adHTdeltaF=0;
 
+	frames.clear();
+	allPoints.clear();
+	allPointsToMarg.clear();
+	connectivityMap.clear();
+	nFrames = nResiduals = nPoints = 0;
 
-	delete accSSE_top_L;
-	delete accSSE_top_A;
-	delete accSSE_bot;
+	HM = MatXX::Zero(CPARS,CPARS);
+	HMForGTSAM = MatXX::Zero(CPARS, CPARS);
+	bM = VecX::Zero(CPARS);
+	bMForGTSAM = VecX::Zero(CPARS);
+
+	lastHS.resize(0,0);
+	lastbS.resize(0);
+	lastX.resize(0);
+	lastNullspaces_forLogging.clear();
+	lastNullspaces_pose.clear();
+	lastNullspaces_scale.clear();
+	lastNullspaces_affA.clear();
+	lastNullspaces_affB.clear();
+
+	resInA = resInL = resInM = 0;
+	currentLambda=0;
+	applyResidualsInSolve = false;
+	EFAdjointsValid = false;
+	EFIndicesValid = false;
+	EFDeltaValid = false;
+
+	this->gtsamIntegration = &gtsamIntegration;
 }
 
 
@@ -264,6 +306,49 @@ void EnergyFunctional::accumulateSCF_MT(MatXX &H, VecX &b, bool MT)
 	}
 }
 
+// accumulates A, L and the Schur complement in a single pass over the points.
+void EnergyFunctional::accumulateFusedF_MT(MatXX &HA, VecX &bA, MatXX &HL, VecX &bL, MatXX &Hsc, VecX &bsc,
+										   bool applyResiduals, bool MT)
+{
+	if(MT)
+	{
+		red->reduce(boost::bind(&AccumulatedTopHessianSSE::setZero, accSSE_top_A, nFrames,  _1, _2, _3, _4), 0, 0, 0);
+		red->reduce(boost::bind(&AccumulatedTopHessianSSE::setZero, accSSE_top_L, nFrames,  _1, _2, _3, _4), 0, 0, 0);
+		red->reduce(boost::bind(&AccumulatedSCHessianSSE::setZero, accSSE_bot, nFrames,  _1, _2, _3, _4), 0, 0, 0);
+		red->reduce(boost::bind(&EnergyFunctional::accumulateFusedPt,
+				this, applyResiduals,  _1, _2, _3, _4), 0, allPoints.size(), 50);
+	}
+	else
+	{
+		accSSE_top_A->setZero(nFrames);
+		accSSE_top_L->setZero(nFrames);
+		accSSE_bot->setZero(nFrames);
+		accumulateFusedPt(applyResiduals, 0, allPoints.size(), 0, 0);
+	}
+	accSSE_top_A->stitchDoubleMT(red,HA,bA,this,false,MT);
+	accSSE_top_L->stitchDoubleMT(red,HL,bL,this,true,MT);
+	accSSE_bot->stitchDoubleMT(red,Hsc,bsc,this,MT);
+	resInA = accSSE_top_A->nres[0];
+	resInL = accSSE_top_L->nres[0];
+}
+
+void EnergyFunctional::accumulateFusedPt(bool applyResiduals, int min, int max, Vec10* stats, int tid)
+{
+	for(int k=min;k<max;k++)
+	{
+		EFPoint* p = allPoints[k];
+		// the residuals of a point are only touched by the thread owning the point, so the pending
+		// linearization can be applied right before it is accumulated.
+		if(applyResiduals)
+			for(EFResidual* r : p->residualsAll)
+				if(!r->isLinearized) r->data->applyRes(true);
+
+		accSSE_top_A->addPoint<0>(p,this,tid);
+		accSSE_top_L->addPoint<1>(p,this,tid);
+		accSSE_bot->addPoint(p,true,tid);
+	}
+}
+
 void EnergyFunctional::resubstituteF_MT(VecX x, CalibHessian* HCalib, bool MT)
 {
 	assert(x.size() == CPARS+nFrames*8);
@@ -336,9 +421,9 @@ double EnergyFunctional::calcMEnergyF(bool useNewValues)
     {
         if(!useNewValues)
         {
-            gtsamIntegration.updateBAValues(frames);
+            gtsamIntegration->updateBAValues(frames);
         }
-        double secondVal = gtsamIntegration.getBAEnergy(useNewValues) + delta.dot(2 * bMForGTSAM + HMForGTSAM * delta);
+        double secondVal = gtsamIntegration->getBAEnergy(useNewValues) + delta.dot(2 * bMForGTSAM + HMForGTSAM * delta);
         return secondVal;
     }
 
@@ -351,83 +436,91 @@ void EnergyFunctional::calcLEnergyPt(int min, int max, Vec10* stats, int tid)
 
 	Accumulator11 E;
 	E.initialize();
-	VecCf dc = cDeltaF;
 
 	for(int i=min;i<max;i++)
-	{
-		EFPoint* p = allPoints[i];
-		float dd = p->deltaF;
+		addLEnergyPoint(allPoints[i], E);
+	E.finish();
+	(*stats)[0] += E.A;
+}
 
-		for(EFResidual* r : p->residualsAll)
-		{
-			if(!r->isLinearized || !r->isActive()) continue;
+void EnergyFunctional::addLEnergyPoint(EFPoint* p, Accumulator11& E) const
+{
+	const VecCf& dc = cDeltaF;
+	float dd = p->deltaF;
 
-			Mat18f dp = adHTdeltaF[r->hostIDX+nFrames*r->targetIDX];
-			RawResidualJacobian* rJ = r->J;
+	for(EFResidual* r : p->residualsAll)
+	{
+		if(!r->isLinearized || !r->isActive()) continue;
 
+		Mat18f dp = adHTdeltaF[r->hostIDX+nFrames*r->targetIDX];
+		RawResidualJacobian* rJ = r->J;
 
 
-			// compute Jp*delta
-			float Jp_delta_x_1 =  rJ->Jpdxi[0].dot(dp.head<6>())
-						   +rJ->Jpdc[0].dot(dc)
-						   +rJ->Jpdd[0]*dd;
 
-			float Jp_delta_y_1 =  rJ->Jpdxi[1].dot(dp.head<6>())
-						   +rJ->Jpdc[1].dot(dc)
-						   +rJ->Jpdd[1]*dd;
+		// compute Jp*delta
+		float Jp_delta_x_1 =  rJ->Jpdxi[0].dot(dp.head<6>())
+					   +rJ->Jpdc[0].dot(dc)
+					   +rJ->Jpdd[0]*dd;
 
-			__m128 Jp_delta_x = _mm_set1_ps(Jp_delta_x_1);
-			__m128 Jp_delta_y = _mm_set1_ps(Jp_delta_y_1);
-			__m128 delta_a = _mm_set1_ps((float)(dp[6]));
-			__m128 delta_b = _mm_set1_ps((float)(dp[7]));
+		float Jp_delta_y_1 =  rJ->Jpdxi[1].dot(dp.head<6>())
+					   +rJ->Jpdc[1].dot(dc)
+					   +rJ->Jpdd[1]*dd;
 
-			for(int i=0;i+3<patternNum;i+=4)
-			{
-				// PATTERN: E = (2*res_toZeroF + J*delta) * J*delta.
-				__m128 Jdelta =            _mm_mul_ps(_mm_load_ps(((float*)(rJ->JIdx))+i),Jp_delta_x);
-				Jdelta = _mm_add_ps(Jdelta,_mm_mul_ps(_mm_load_ps(((float*)(rJ->JIdx+1))+i),Jp_delta_y));
-				Jdelta = _mm_add_ps(Jdelta,_mm_mul_ps(_mm_load_ps(((float*)(rJ->JabF))+i),delta_a));
-				Jdelta = _mm_add_ps(Jdelta,_mm_mul_ps(_mm_load_ps(((float*)(rJ->JabF+1))+i),delta_b));
-
-				__m128 r0 = _mm_load_ps(((float*)&r->res_toZeroF)+i);
-				r0 = _mm_add_ps(r0,r0);
-				r0 = _mm_add_ps(r0,Jdelta);
-				Jdelta = _mm_mul_ps(Jdelta,r0);
-				E.updateSSENoShift(Jdelta);
-			}
-			for(int i=((patternNum>>2)<<2); i < patternNum; i++)
-			{
-				float Jdelta = rJ->JIdx[0][i]*Jp_delta_x_1 + rJ->JIdx[1][i]*Jp_delta_y_1 +
-								rJ->JabF[0][i]*dp[6] + rJ->JabF[1][i]*dp[7];
-				E.updateSingleNoShift((float)(Jdelta * (Jdelta + 2*r->res_toZeroF[i])));
-			}
+		__m128 Jp_delta_x = _mm_set1_ps(Jp_delta_x_1);
+		__m128 Jp_delta_y = _mm_set1_ps(Jp_delta_y_1);
+		__m128 delta_a = _mm_set1_ps((float)(dp[6]));
+		__m128 delta_b = _mm_set1_ps((float)(dp[7]));
+
+		for(int i=0;i+3<patternNum;i+=4)
+		{
+			// PATTERN: E = (2*res_toZeroF + J*delta) * J*delta.
+			__m128 Jdelta =            _mm_mul_ps(_mm_load_ps(((float*)(rJ->JIdx))+i),Jp_delta_x);
+			Jdelta = _mm_add_ps(Jdelta,_mm_mul_ps(_mm_load_ps(((float*)(rJ->JIdx+1))+i),Jp_delta_y));
+			Jdelta = _mm_add_ps(Jdelta,_mm_mul_ps(_mm_load_ps(((float*)(rJ->JabF))+i),delta_a));
+			Jdelta = _mm_add_ps(Jdelta,_mm_mul_ps(_mm_load_ps(((float*)(rJ->JabF+1))+i),delta_b));
+
+			__m128 r0 = _mm_load_ps(((float*)&r->res_toZeroF)+i);
+			r0 = _mm_add_ps(r0,r0);
+			r0 = _mm_add_ps(r0,Jdelta);
+			Jdelta = _mm_mul_ps(Jdelta,r0);
+			E.updateSSENoShift(Jdelta);
+		}
+		for(int i=((patternNum>>2)<<2); i < patternNum; i++)
+		{
+			float Jdelta = rJ->JIdx[0][i]*Jp_delta_x_1 + rJ->JIdx[1][i]*Jp_delta_y_1 +
+							rJ->JabF[0][i]*dp[6] + rJ->JabF[1][i]*dp[7];
+			E.updateSingleNoShift((float)(Jdelta * (Jdelta + 2*r->res_toZeroF[i])));
 		}
-		E.updateSingle(p->deltaF*p->deltaF*p->priorF);
 	}
-	E.finish();
-	(*stats)[0] += E.A;
+	E.updateSingle(p->deltaF*p->deltaF*p->priorF);
 }
 
 
 
 
-double EnergyFunctional::calcLEnergyF_MT()
+double EnergyFunctional::calcLEnergyPriorsF() const
 {
-	assert(EFDeltaValid);
-	assert(EFAdjointsValid);
-	assert(EFIndicesValid);
-
 	double E = 0;
 	for(EFFrame* f : frames)
 	{
         E += f->delta_prior.cwiseProduct(f->prior).dot(f->delta_prior);
 	}
 	E += cDeltaF.cwiseProduct(cPriorF).dot(cDeltaF);
+	return E;
+}
+
+double EnergyFunctional::calcLEnergyF_MT()
+{
+	assert(EFDeltaValid);
+	assert(EFAdjointsValid);
+	assert(EFIndicesValid);
 
-	red->reduce(boost::bind(&EnergyFunctional::calcLEnergyPt,
+	double E = calcLEnergyPriorsF();
+
+	Vec10 stats = red->reduce(boost::bind(&EnergyFunctional::calcLEnergyPt,
 			this, _1, _2, _3, _4), 0, allPoints.size(), 50);
 
-	return E+red->stats[0];
+	return E+stats[0];
 }
 
 
@@ -545,17 +638,17 @@ void EnergyFunctional::marginalizeFrame(EFFrame* fh)
         assert(odim == (int)bM.size());
 
         // Adds H and b from the last points to the graph. Needs the current evaluation point for each frames.
-        gtsamIntegration.addMarginalizedPointsBA(HMForGTSAM, bMForGTSAM, frames);
+        gtsamIntegration->addMarginalizedPointsBA(HMForGTSAM, bMForGTSAM, frames);
 
         Vec8 priorH;
         Vec8 priorB;
         priorH = fh->prior;
         priorB = fh->prior.cwiseProduct(fh->delta_prior);
 
-        gtsamIntegration.addPriorBA(fh, priorH, priorB);
+        gtsamIntegration->addPriorBA(fh, priorH, priorB);
 
         // Marginalizes out the frame. Adds the symbols of this frame and then calls marginalize out.
-        gtsamIntegration.marginalizeBAFrame(fh);
+        gtsamIntegration->marginalizeBAFrame(fh);
 
         HMForGTSAM.resize(ndim, ndim);
         bMForGTSAM.resize(ndim);
@@ -850,14 +943,17 @@ void EnergyFunctional::solveSystemF(int iteration, double lambda, CalibHessian*
     MatXX HL_top, HA_top, H_sc;
     VecX  bL_top, bA_top, bM_top, b_sc;
 
-    accumulateAF_MT(HA_top, bA_top,multiThreading);
-
-
-    accumulateLF_MT(HL_top, bL_top,multiThreading);
-
-
-
-    accumulateSCF_MT(H_sc, b_sc,multiThreading);
+    if(setting_fusedOptimization)
+    {
+        accumulateFusedF_MT(HA_top, bA_top, HL_top, bL_top, H_sc, b_sc, applyResidualsInSolve, multiThreading);
+        applyResidualsInSolve = false;
+    }
+    else
+    {
+        accumulateAF_MT(HA_top, bA_top, multiThreading);
+        accumulateLF_MT(HL_top, bL_top, multiThreading);
+        accumulateSCF_MT(H_sc, b_sc, multiThreading);
+    }
 
 
 
@@ -964,7 +1060,7 @@ void EnergyFunctional::solveSystemF(int iteration, double lambda, CalibHessian*
             MatXX HPassed = HL_top + HMForGTSAM + HA_top;
             for(int i=0;i<8*nFrames+CPARS;i++) HPassed(i,i) *= (1+lambda);
             HPassed -= H_sc * (1.0f/(1+lambda));
-            x = gtsamIntegration.computeBAUpdate(HPassed, bL_top + bMGTSAM_top + bA_top - b_sc, lambda,
+            x = gtsamIntegration->computeBAUpdate(HPassed, bL_top + bMGTSAM_top + bA_top - b_sc, lambda,
                                                  frames, HL_top + HMForGTSAM + HA_top - H_sc);
         }else
         {
@@ -56,6 +56,7 @@ class AccumulatedTopHessian;
 class AccumulatedTopHessianSSE;
 class AccumulatedSCHessian;
 class AccumulatedSCHessianSSE;
+class Accumulator11;
 
 
 extern bool EFAdjointsValid;
@@ -78,6 +79,10 @@ public:
     EnergyFunctional(dmvio::BAGTSAMIntegration &gtsamIntegration);
 	~EnergyFunctional();
 
+	// Deletes all EF structs (without touching the FrameHessians etc.) and clears the marginalization prior so that
+	// the object can be reused with a new gtsamIntegration. The accumulators are kept.
+	void reset(dmvio::BAGTSAMIntegration &gtsamIntegration);
+
 
 	EFResidual* insertResidual(PointFrameResidual* r);
 	EFFrame* insertFrame(FrameHessian* fh, CalibHessian* Hcalib);
@@ -95,6 +100,10 @@ public:
 	double calcMEnergyF(bool useNewValues);
 	double calcLEnergyF_MT();
 
+	// Per-point part of calcLEnergyF_MT (used by the fused optimization pass) and the remaining prior part.
+	void addLEnergyPoint(EFPoint* p, Accumulator11& E) const;
+	double calcLEnergyPriorsF() const;
+
 
 	void makeIDX();
 
@@ -122,6 +131,10 @@ public:
 
 	IndexThreadReduce<Vec10>* red;
 
+	// With setting_fusedOptimization: if set, the next solveSystemF applies the pending linearization of all
+	// active residuals while accumulating (replaces the separate applyRes pass). Reset by solveSystemF.
+	bool applyResidualsInSolve = false;
+
 
 	std::map<uint64_t,
 	  Eigen::Vector2i,
@@ -132,6 +145,7 @@ public:
 private:
 
 	VecX getStitchedDeltaF() const;
+	void deleteEFStructs();
 
 	void resubstituteF_MT(VecX x, CalibHessian* HCalib, bool MT);
     void resubstituteFPt(const VecCf &xc, Mat18f* xAd, int min, int max, Vec10* stats, int tid);
@@ -139,6 +153,9 @@ private:
 	void accumulateAF_MT(MatXX &H, VecX &b, bool MT);
 	void accumulateLF_MT(MatXX &H, VecX &b, bool MT);
 	void accumulateSCF_MT(MatXX &H, VecX &b, bool MT);
+	void accumulateFusedF_MT(MatXX &HA, VecX &bA, MatXX &HL, VecX &bL, MatXX &Hsc, VecX &bsc, bool applyResiduals,
+							 bool MT);
+	void accumulateFusedPt(bool applyResiduals, int min, int max, Vec10* stats, int tid);
 
 	void calcLEnergyPt(int min, int max, Vec10* stats, int tid);
 
@@ -167,7 +184,7 @@ private:
 
 	float currentLambda;
 
-    dmvio::BAGTSAMIntegration &gtsamIntegration;
+    dmvio::BAGTSAMIntegration* gtsamIntegration;
 };
 }
 
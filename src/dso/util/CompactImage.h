@@ -0,0 +1,187 @@
+/**
+* This file is part of DSO, written by Jakob Engel.
+* It has been modified by Lukas von Stumberg for the inclusion in DM-VIO (http://vision.in.tum.de/dm-vio).
+*
+* Copyright 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>
+* Copyright 2016 Technical University of Munich and Intel.
+* Developed by Jakob Engel <engelj at in dot tum dot de>,
+* for more information see <http://vision.in.tum.de/dso>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DSO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DSO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DSO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "util/NumType.h"
+#include "util/globalFuncs.h"
+
+namespace dso
+{
+
+// Intensity, dx and dy of one pixel in fixed point (6 instead of 12 bytes). Used for the image pyramids of all frames
+// if setting_compactImages is set.
+struct CompactPixel
+{
+	int16_t data[3];
+};
+
+// Fixed point units per intensity value: resolution 1/16, range +-2048.
+constexpr float compactImageScale = 16.0f;
+constexpr float compactImageScaleInv = 1.0f / compactImageScale;
+
+// Non-finite values (which the dense pyramid would keep as NAN) are stored as 0.
+EIGEN_ALWAYS_INLINE int16_t toFixedPoint(float value)
+{
+	if(!std::isfinite(value)) return 0;
+	float scaled = std::min(std::max(value * compactImageScale, -32767.0f), 32767.0f);
+	return (int16_t)lrintf(scaled);
+}
+
+EIGEN_ALWAYS_INLINE CompactPixel packPixel(const Eigen::Vector3f& pixel)
+{
+	return CompactPixel{{toFixedPoint(pixel[0]), toFixedPoint(pixel[1]), toFixedPoint(pixel[2])}};
+}
+
+EIGEN_ALWAYS_INLINE Eigen::Vector3f unpackPixel(const CompactPixel& pixel)
+{
+	return Eigen::Vector3f(pixel.data[0], pixel.data[1], pixel.data[2]) * compactImageScaleInv;
+}
+
+// Accessor for one compact pyramid level with the interface of the const Eigen::Vector3f* of a dense level, so that
+// kernels can be templated on the layout (see withImageLevel). operator[] returns by value.
+struct CompactLevel
+{
+	EIGEN_ALWAYS_INLINE Eigen::Vector3f operator[](int idx) const
+	{
+		return unpackPixel(data[idx]);
+	}
+
+	const CompactPixel* data;
+};
+
+// Read-only view of one pyramid level of a FrameHessian, which is stored either dense (Eigen::Vector3f) or compact.
+// Can be used like the Eigen::Vector3f* it replaces, but checks the layout on each access. Per-pixel loops should
+// use withImageLevel instead.
+struct ImageLevel
+{
+	ImageLevel(const Eigen::Vector3f* dense, const CompactPixel* compact) : dense(dense), compact(compact) {}
+
+	EIGEN_ALWAYS_INLINE Eigen::Vector3f operator[](int idx) const
+	{
+		return compact ? unpackPixel(compact[idx]) : dense[idx];
+	}
+
+	const Eigen::Vector3f* dense;
+	const CompactPixel* compact;
+};
+
+// Calls func with the dense pointer or the CompactLevel of level, so that the layout is checked once per kernel.
+// func is usually a generic lambda, both calls have to return the same type.
+template<typename Func>
+EIGEN_ALWAYS_INLINE auto withImageLevel(const ImageLevel& level, Func&& func) -> decltype(func(level.dense))
+{
+	if(level.compact) return func(CompactLevel{level.compact});
+	return func(level.dense);
+}
+
+// Overloads of the interpolation functions in globalFuncs.h. The compact versions interpolate the fixed point values and
+// scale the result once.
+EIGEN_ALWAYS_INLINE Eigen::Vector3f getInterpolatedElement33(const CompactLevel& mat, const float x, const float y, const int width)
+{
+	int ix = (int)x;
+	int iy = (int)y;
+	float dx = x - ix;
+	float dy = y - iy;
+	float dxdy = dx*dy;
+	const CompactPixel* bp = mat.data +ix+iy*width;
+
+	checkBoundsPlus1(ix, iy, width);
+
+	Eigen::Vector3f res;
+	for(int i=0;i<3;i++)
+		res[i] = dxdy * bp[1+width].data[i]
+				+ (dy-dxdy) * bp[width].data[i]
+				+ (dx-dxdy) * bp[1].data[i]
+				+ (1-dx-dy+dxdy) * bp[0].data[i];
+	return res * compactImageScaleInv;
+}
+
+EIGEN_ALWAYS_INLINE float getInterpolatedElement31(const CompactLevel& mat, const float x, const float y, const int width)
+{
+	int ix = (int)x;
+	int iy = (int)y;
+	float dx = x - ix;
+	float dy = y - iy;
+	float dxdy = dx*dy;
+	const CompactPixel* bp = mat.data +ix+iy*width;
+
+	checkBoundsPlus1(ix, iy, width);
+
+	return (dxdy * bp[1+width].data[0]
+			+ (dy-dxdy) * bp[width].data[0]
+			+ (dx-dxdy) * bp[1].data[0]
+			+ (1-dx-dy+dxdy) * bp[0].data[0]) * compactImageScaleInv;
+}
+
+EIGEN_ALWAYS_INLINE Eigen::Vector3f getInterpolatedElement33BiLin(const CompactLevel& mat, const float x, const float y, const int width)
+{
+	int ix = (int)x;
+	int iy = (int)y;
+	const CompactPixel* bp = mat.data +ix+iy*width;
+
+	checkBoundsPlus1(ix, iy, width);
+
+	float tl = bp[0].data[0] * compactImageScaleInv;
+	float tr = bp[1].data[0] * compactImageScaleInv;
+	float bl = bp[width].data[0] * compactImageScaleInv;
+	float br = bp[width+1].data[0] * compactImageScaleInv;
+
+	float dx = x - ix;
+	float dy = y - iy;
+	float topInt = dx * tr + (1-dx) * tl;
+	float botInt = dx * br + (1-dx) * bl;
+	float leftInt = dy * bl + (1-dy) * tl;
+	float rightInt = dy * br + (1-dy) * tr;
+
+	return Eigen::Vector3f(
+			dx * rightInt + (1-dx) * leftInt,
+			rightInt-leftInt,
+			botInt-topInt);
+}
+
+EIGEN_ALWAYS_INLINE Eigen::Vector3f getInterpolatedElement33(const ImageLevel& mat, const float x, const float y, const int width)
+{
+	if(mat.compact) return getInterpolatedElement33(CompactLevel{mat.compact}, x, y, width);
+	return getInterpolatedElement33(mat.dense, x, y, width);
+}
+
+EIGEN_ALWAYS_INLINE float getInterpolatedElement31(const ImageLevel& mat, const float x, const float y, const int width)
+{
+	if(mat.compact) return getInterpolatedElement31(CompactLevel{mat.compact}, x, y, width);
+	return getInterpolatedElement31(mat.dense, x, y, width);
+}
+
+EIGEN_ALWAYS_INLINE Eigen::Vector3f getInterpolatedElement33BiLin(const ImageLevel& mat, const float x, const float y, const int width)
+{
+	if(mat.compact) return getInterpolatedElement33BiLin(CompactLevel{mat.compact}, x, y, width);
+	return getInterpolatedElement33BiLin(mat.dense, x, y, width);
+}
+
+}
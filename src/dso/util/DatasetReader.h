@@ -235,6 +235,22 @@ public:
 			return getImageRaw_internal(id,0);
 	}
 
+	MinimalImage<unsigned short>* getImageRaw16(int id)
+	{
+		assert(use16Bit);
+		return IOWrap::readImageBW_16U(files[id]);
+	}
+
+	float getExposure(int id)
+	{
+		return exposures.size() == 0 ? 1.0f : exposures[id];
+	}
+
+	bool is16Bit() const
+	{
+		return use16Bit;
+	}
+
 	ImageAndExposure* getImage(int id, bool forceLoadDirectly=false)
 	{
 		return getImage_internal(id, 0);
@@ -496,11 +512,11 @@ private:
 	{
 	    if(use16Bit)
         {
-            MinimalImage<unsigned short>* minimg = IOWrap::readImageBW_16U(files[id]);
+            MinimalImage<unsigned short>* minimg = getImageRaw16(id);
             assert(minimg);
             ImageAndExposure* ret2 = undistort->undistort<unsigned short>(
                     minimg,
-                    (exposures.size() == 0 ? 1.0f : exposures[id]),
+                    getExposure(id),
                     (timestamps.size() == 0 ? 0.0 : timestamps[id]),
                     1.0f / 256.0f);
             delete minimg;
@@ -510,7 +526,7 @@ private:
             MinimalImageB* minimg = getImageRaw_internal(id, 0);
             ImageAndExposure* ret2 = undistort->undistort<unsigned char>(
                     minimg,
-                    (exposures.size() == 0 ? 1.0f : exposures[id]),
+                    getExposure(id),
                     (timestamps.size() == 0 ? 0.0 : timestamps[id]));
             delete minimg;
             return ret2;
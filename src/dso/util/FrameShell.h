@@ -29,6 +29,7 @@
 #include "util/NumType.h"
 #include "algorithm"
 #include <boost/thread/mutex.hpp>
+#include <atomic>
 
 namespace dso
 {
@@ -62,6 +63,38 @@ public:
 
     static boost::mutex shellPoseMutex;
 
+	// Seqlock on top of shellPoseMutex for camToWorld and aff_g2l: Writers lock shellPoseMutex and additionally hold a
+	// PoseWriteGuard while writing. The tracking thread can then use readPoses instead of the mutex, so it never waits
+	// for the mapping thread (it only retries if it overlapped with a write).
+	static std::atomic<uint64_t> poseSeq;
+
+	struct PoseWriteGuard
+	{
+		inline PoseWriteGuard()
+		{
+			poseSeq.store(poseSeq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+		}
+		inline ~PoseWriteGuard()
+		{
+			poseSeq.store(poseSeq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+	};
+
+	// read must only copy values (it can be called multiple times and can see inconsistent values, which are discarded).
+	// Returns the number of retries.
+	template<typename Func> static int readPoses(Func&& read)
+	{
+		for(int retries = 0;; retries++)
+		{
+			uint64_t before = poseSeq.load(std::memory_order_acquire);
+			if(before & 1) continue;
+			read();
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if(poseSeq.load(std::memory_order_relaxed) == before) return retries;
+		}
+	}
+
 	inline FrameShell()
 	{
 		id=0;
@@ -0,0 +1,57 @@
+/**
+* This file is part of DSO.
+*
+* Copyright 2016 Technical University of Munich and Intel.
+* Developed by Jakob Engel <engelj at in dot tum dot de>,
+* for more information see <http://vision.in.tum.de/dso>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DSO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DSO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DSO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include "util/MinimalImage.h"
+
+namespace dso
+{
+
+// Non-owning view on a caller-owned grayscale image (8 or 16 bit), e.g. the buffer of a cv::Mat or a camera driver.
+// Rows may be padded: stride is the distance between two rows in bytes.
+template<typename T>
+struct ImageView
+{
+	const T* data;
+	int w, h;
+	int stride;
+
+	inline ImageView(const T* data_, int w_, int h_, int stride_=0)
+		: data(data_), w(w_), h(h_), stride(stride_ > 0 ? stride_ : w_*(int)sizeof(T)) {}
+	inline explicit ImageView(const MinimalImage<T>& img)
+		: data(img.data), w(img.w), h(img.h), stride(img.w*(int)sizeof(T)) {}
+
+	inline const T* row(int y) const
+	{
+		return reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(data) + (size_t)y*stride);
+	}
+	inline bool isContiguous() const {return stride == w*(int)sizeof(T);}
+};
+
+typedef ImageView<unsigned char> ImageViewB;
+typedef ImageView<unsigned short> ImageViewW;
+
+}
@@ -30,6 +30,7 @@
 #include "boost/thread.hpp"
 #include <stdio.h>
 #include <iostream>
+#include "util/ThreadTopology.h"
 
 
 
@@ -51,7 +52,8 @@ public:
 		callPerIndex = boost::bind(&IndexThreadReduce::callPerIndexDefault, this, _1, _2, _3, _4);
 
 		running = true;
-		for(int i=0;i<NUM_THREADS;i++)
+		numThreads = dmvio::ThreadTopology::getReducePoolSize(NUM_THREADS);
+		for(int i=0;i<numThreads;i++)
 		{
 			isDone[i] = false;
 			gotOne[i] = true;
@@ -67,7 +69,7 @@ public:
 		todo_signal.notify_all();
 		exMutex.unlock();
 
-		for(int i=0;i<NUM_THREADS;i++)
+		for(int i=0;i<numThreads;i++)
 			workerThreads[i].join();
 
 
@@ -75,8 +77,11 @@ public:
 
 	}
 
-	inline void reduce(boost::function<void(int,int,Running*,int)> callPerIndex, int first, int end, int stepSize = 0)
+	// Can be called from several threads (e.g. tracking and mapping), the calls are serialized.
+	// Returns the sum of the stats of all calls of callPerIndex, copied while still holding the lock.
+	inline Running reduce(boost::function<void(int,int,Running*,int)> callPerIndex, int first, int end, int stepSize = 0)
 	{
+		boost::unique_lock<boost::mutex> reduceLock(reduceMutex);
 
 		memset(&stats, 0, sizeof(Running));
 
@@ -89,7 +94,7 @@ public:
 
 
 		if(stepSize == 0)
-			stepSize = ((end-first)+NUM_THREADS-1)/NUM_THREADS;
+			stepSize = ((end-first)+numThreads-1)/numThreads;
 
 
 		//printf("reduce called\n");
@@ -103,7 +108,7 @@ public:
 		this->stepSize = stepSize;
 
 		// go worker threads!
-		for(int i=0;i<NUM_THREADS;i++)
+		for(int i=0;i<numThreads;i++)
 		{
 			isDone[i] = false;
 			gotOne[i] = false;
@@ -123,7 +128,7 @@ public:
 
 			// check if actually all are finished.
 			bool allDone = true;
-			for(int i=0;i<NUM_THREADS;i++)
+			for(int i=0;i<numThreads;i++)
 				allDone = allDone && isDone[i];
 
 			// all are finished! exit.
@@ -136,15 +141,18 @@ public:
 		this->callPerIndex = boost::bind(&IndexThreadReduce::callPerIndexDefault, this, _1, _2, _3, _4);
 
 		//printf("reduce done (all threads finished)\n");
+		return stats;
 	}
 
-	Running stats;
-
 private:
+	Running stats; // only valid while reduceMutex is held.
+
+	int numThreads; // <= NUM_THREADS, so the per-thread buffers of the callers indexed by tid are large enough.
 	boost::thread workerThreads[NUM_THREADS];
 	bool isDone[NUM_THREADS];
 	bool gotOne[NUM_THREADS];
 
+	boost::mutex reduceMutex;
 	boost::mutex exMutex;
 	boost::condition_variable todo_signal;
 	boost::condition_variable done_signal;
@@ -165,6 +173,7 @@ private:
 
 	void workerLoop(int idx)
 	{
+		dmvio::ThreadTopology::applyToCurrentThread(dmvio::THREAD_REDUCE);
 		boost::unique_lock<boost::mutex> lock(exMutex);
 
 		while(running)
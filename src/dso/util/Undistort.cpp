@@ -213,45 +213,48 @@ void PhotometricUndistorter::unMapFloatImage(float* image)
 template<typename T>
 void PhotometricUndistorter::processFrame(T* image_in, float exposure_time, float factor)
 {
-	int wh=w*h;
-    float* data = output->image;
 	assert(output->w == w && output->h == h);
-	assert(data != 0);
+	assert(output->image != 0);
+	output->exposure_time = processFrameInto(ImageView<T>(image_in, w, h), exposure_time, output->image, 1, factor);
+	output->timestamp = 0;
+}
 
+template<typename T>
+float PhotometricUndistorter::processFrameInto(const ImageView<T>& image_in, float exposure_time, float* out, int outStride, float factor) const
+{
+	assert(image_in.w == w && image_in.h == h);
+	bool usePhotometric = valid && exposure_time > 0 && setting_photometricCalibration!=0;
 
-	if(!valid || exposure_time <= 0 || setting_photometricCalibration==0) // disable full photometric calibration.
+	for(int y=0;y<h;y++)
 	{
-		for(int i=0; i<wh;i++)
+		const T* row = image_in.row(y);
+		float* data = out + y*w*outStride;
+		if(!usePhotometric) // disable full photometric calibration.
 		{
-			data[i] = factor*image_in[i];
+			for(int x=0;x<w;x++)
+				data[x*outStride] = factor*row[x];
 		}
-		output->exposure_time = exposure_time;
-		output->timestamp = 0;
-	}
-	else
-	{
-		for(int i=0; i<wh;i++)
+		else if(setting_photometricCalibration==2)
 		{
-			data[i] = G[image_in[i]];
+			const float* vignetteRow = vignetteMapInv + y*w;
+			for(int x=0;x<w;x++)
+				data[x*outStride] = G[row[x]] * vignetteRow[x];
 		}
-
-		if(setting_photometricCalibration==2)
+		else
 		{
-			for(int i=0; i<wh;i++)
-				data[i] *= vignetteMapInv[i];
+			for(int x=0;x<w;x++)
+				data[x*outStride] = G[row[x]];
 		}
-
-		output->exposure_time = exposure_time;
-		output->timestamp = 0;
 	}
 
-
 	if(!setting_useExposure)
-		output->exposure_time = 1;
-
+		return 1;
+	return exposure_time;
 }
 template void PhotometricUndistorter::processFrame<unsigned char>(unsigned char* image_in, float exposure_time, float factor);
 template void PhotometricUndistorter::processFrame<unsigned short>(unsigned short* image_in, float exposure_time, float factor);
+template float PhotometricUndistorter::processFrameInto<unsigned char>(const ImageView<unsigned char>& image_in, float exposure_time, float* out, int outStride, float factor) const;
+template float PhotometricUndistorter::processFrameInto<unsigned short>(const ImageView<unsigned short>& image_in, float exposure_time, float* out, int outStride, float factor) const;
 
 
 
@@ -385,19 +388,30 @@ void Undistort::loadPhotometricCalibration(std::string file, std::string noiseIm
 template<typename T>
 ImageAndExposure* Undistort::undistort(const MinimalImage<T>* image_raw, float exposure, double timestamp, float factor) const
 {
-	if(image_raw->w != wOrg || image_raw->h != hOrg)
+	return undistort(ImageView<T>(*image_raw), exposure, timestamp, factor);
+}
+
+template<typename T>
+ImageAndExposure* Undistort::undistort(const ImageView<T>& image_raw, float exposure, double timestamp, float factor) const
+{
+	ImageAndExposure* result = new ImageAndExposure(w, h, timestamp);
+	result->exposure_time = undistortInto(image_raw, result->image, 1, exposure, factor);
+	return result;
+}
+
+template<typename T>
+float Undistort::undistortInto(const ImageView<T>& image_raw, float* out_data, int outStride, float exposure, float factor) const
+{
+	if(image_raw.w != wOrg || image_raw.h != hOrg)
 	{
-		printf("Undistort::undistort: wrong image size (%d %d instead of %d %d) \n", image_raw->w, image_raw->h, w, h);
+		printf("Undistort::undistort: wrong image size (%d %d instead of %d %d) \n", image_raw.w, image_raw.h, w, h);
 		exit(1);
 	}
 
-	photometricUndist->processFrame<T>(image_raw->data, exposure, factor);
-	ImageAndExposure* result = new ImageAndExposure(w, h, timestamp);
-	photometricUndist->output->copyMetaTo(*result);
-
+	float exposureOut;
 	if (!passthrough)
 	{
-		float* out_data = result->image;
+		exposureOut = photometricUndist->processFrameInto<T>(image_raw, exposure, photometricUndist->output->image, 1, factor);
 		float* in_data = photometricUndist->output->image;
 
 		float* noiseMapX=0;
@@ -443,7 +457,7 @@ ImageAndExposure* Undistort::undistort(const MinimalImage<T>* image_raw, float e
 
 
 			if(xx<0)
-				out_data[idx] = 0;
+				out_data[idx*outStride] = 0;
 			else
 			{
 				// get integer and rational parts
@@ -457,7 +471,7 @@ ImageAndExposure* Undistort::undistort(const MinimalImage<T>* image_raw, float e
 				const float* src = in_data + xxi + yyi * wOrg;
 
 				// interpolate (bilinear)
-				out_data[idx] =  xxyy * src[1+wOrg]
+				out_data[idx*outStride] =  xxyy * src[1+wOrg]
 									+ (yy-xxyy) * src[wOrg]
 									+ (xx-xxyy) * src[1]
 									+ (1-xx-yy+xxyy) * src[0];
@@ -473,18 +487,23 @@ ImageAndExposure* Undistort::undistort(const MinimalImage<T>* image_raw, float e
 	}
 	else
 	{
-		memcpy(result->image, photometricUndist->output->image, sizeof(float)*w*h);
+		// Without geometric undistortion the photometric correction can directly write the output.
+		exposureOut = photometricUndist->processFrameInto<T>(image_raw, exposure, out_data, outStride, factor);
 	}
 
-	applyBlurNoise(result->image);
+	applyBlurNoise(out_data, outStride);
 
-	return result;
+	return exposureOut;
 }
 template ImageAndExposure* Undistort::undistort<unsigned char>(const MinimalImage<unsigned char>* image_raw, float exposure, double timestamp, float factor) const;
 template ImageAndExposure* Undistort::undistort<unsigned short>(const MinimalImage<unsigned short>* image_raw, float exposure, double timestamp, float factor) const;
+template ImageAndExposure* Undistort::undistort<unsigned char>(const ImageView<unsigned char>& image_raw, float exposure, double timestamp, float factor) const;
+template ImageAndExposure* Undistort::undistort<unsigned short>(const ImageView<unsigned short>& image_raw, float exposure, double timestamp, float factor) const;
+template float Undistort::undistortInto<unsigned char>(const ImageView<unsigned char>& image_raw, float* out_data, int outStride, float exposure, float factor) const;
+template float Undistort::undistortInto<unsigned short>(const ImageView<unsigned short>& image_raw, float* out_data, int outStride, float exposure, float factor) const;
 
 
-void Undistort::applyBlurNoise(float* img) const
+void Undistort::applyBlurNoise(float* img, int stride) const
 {
 	if(benchmark_varBlurNoise==0) return;
 
@@ -531,13 +550,13 @@ void Undistort::applyBlurNoise(float* img) const
 				if(x+dx>0 && x+dx<w)
 				{
 					sumW += gw;
-					sumCW += gw * img[x+dx+y*this->w];
+					sumCW += gw * img[(x+dx+y*this->w)*stride];
 				}
 
 				if(x-dx>0 && x-dx<w && dx!=0)
 				{
 					sumW += gw;
-					sumCW += gw * img[x-dx+y*this->w];
+					sumCW += gw * img[(x-dx+y*this->w)*stride];
 				}
 			}
 
@@ -576,7 +595,7 @@ void Undistort::applyBlurNoise(float* img) const
 					sumCW += gw * blutTmp[x+(y-dy)*this->w];
 				}
 			}
-			img[x+y*this->w] = sumCW / sumW;
+			img[(x+y*this->w)*stride] = sumCW / sumW;
 		}
 
 
@@ -26,6 +26,7 @@
 
 #include "util/ImageAndExposure.h"
 #include "util/MinimalImage.h"
+#include "util/ImageView.h"
 #include "util/NumType.h"
 #include "Eigen/Core"
 
@@ -49,6 +50,9 @@ public:
 	// raw irradiance = a*I + b.
 	// output will be written in [output].
 	template<typename T> void processFrame(T* image_in, float exposure_time, float factor=1);
+	// same as processFrame, but reads a (strided) caller-owned image and writes to out[i*outStride] instead of output.
+	// returns the exposure time to use.
+	template<typename T> float processFrameInto(const ImageView<T>& image_in, float exposure_time, float* out, int outStride, float factor=1) const;
 	void unMapFloatImage(float* image);
 
 	ImageAndExposure* output;
@@ -81,6 +85,12 @@ public:
 
 	template<typename T>
 	ImageAndExposure* undistort(const MinimalImage<T>* image_raw, float exposure=0, double timestamp=0, float factor=1) const;
+	template<typename T>
+	ImageAndExposure* undistort(const ImageView<T>& image_raw, float exposure=0, double timestamp=0, float factor=1) const;
+	// undistorts a caller-owned image directly into out_data, writing pixel i to out_data[i*outStride] (e.g. outStride=3
+	// to write into FrameHessian::dI). Does not allocate. Returns the exposure time to use for the frame.
+	template<typename T>
+	float undistortInto(const ImageView<T>& image_raw, float* out_data, int outStride, float exposure=0, float factor=1) const;
 	static Undistort* getUndistorterForFile(std::string configFilename, std::string gammaFilename, std::string vignetteFilename);
 
 	void loadPhotometricCalibration(std::string file, std::string noiseImage, std::string vignetteImage);
@@ -98,7 +108,7 @@ protected:
 	float* remapX;
 	float* remapY;
 
-	void applyBlurNoise(float* img) const;
+	void applyBlurNoise(float* img, int stride=1) const;
 
 	void makeOptimalK_crop();
 	void makeOptimalK_full();
@@ -158,6 +158,15 @@ float setting_frameEnergyTHN = 0.7f;
 float setting_frameEnergyTHFacMedian = 1.5;
 float setting_overallEnergyTHWeight = 1;
 float setting_coarseCutoffTH = 20;
+// pyramid levels >= this are computed before a new coarse tracking reference is handed to the tracker,
+// the finer ones afterwards (outside of the swap lock). 0 publishes the reference only when it is complete.
+int setting_coarseTrackerPublishLevel = 2;
+// with a trusted IMU prediction, start the coarse tracking at the finest level whose convergence basin covers the
+// expected pixel error (falls back to all levels if the result is worse than the re-track threshold).
+bool setting_coarseAdaptiveStartLevel = false;
+float setting_coarseAdaptiveBasin = 1.5; // pixels (at the respective level) assumed to be within the basin.
+float setting_coarseAdaptiveSigmaFactor = 3; // expected pixel error = this * predicted pixel std.
+int setting_coarseAdaptiveMinIterations = 3; // lower bound for the reduced per-level iteration caps.
 
 
 
@@ -179,6 +188,13 @@ float setting_maxPixSearch = 0.027; // max length of the ep. line segment search
 float setting_minTraceQuality = 3;
 int setting_minTraceTestRadius = 2;
 int setting_GNItsOnPointActivation = 3;
+bool setting_batchedPointActivation = true; // activate 4 points of the same host at once in SSE lanes.
+bool setting_fusedOptimization = false; // fuse linearization+L-energy and applyRes+accumulation into single passes over the points.
+int setting_checkpointInterval = 5; // write a checkpoint every n keyframes (if a checkpoint file is set). 0 disables checkpoints.
+bool setting_nonBlockingTracking = true; // tracking reads shell poses via seqlock and only swaps the tracking reference once it is complete (so it never waits for the mapping thread there).
+bool setting_measureLockContention = false; // log the time threads wait for shellPoseMutex, coarseTrackerSwapMutex and trackMutex (as lockWait_*).
+bool setting_compactImages = false; // store the image pyramids of frames as int16 fixed point (CompactPixel) instead of float.
+bool setting_multiThreadedPyramid = false; // compute large pyramid levels of new frames in row stripes on the reduce pool of the tracking thread.
 float setting_trace_stepsize = 1.0;				// stepsize for initial discrete search.
 int setting_trace_GNIterations = 3;				// max # GN iterations
 float setting_trace_GNThreshold = 0.1;				// GN stop after this stepsize.
@@ -111,6 +111,13 @@ extern float setting_outlierTHSumComponent;
 extern int setting_pattern;
 extern float setting_margWeightFac;
 extern int setting_GNItsOnPointActivation;
+extern bool setting_batchedPointActivation;
+extern bool setting_fusedOptimization;
+extern int setting_checkpointInterval;
+extern bool setting_nonBlockingTracking;
+extern bool setting_measureLockContention;
+extern bool setting_compactImages;
+extern bool setting_multiThreadedPyramid;
 
 
 extern float setting_minTraceQuality;
@@ -157,6 +164,11 @@ extern float setting_frameEnergyTHN;
 extern float setting_frameEnergyTHFacMedian;
 extern float setting_overallEnergyTHWeight;
 extern float setting_coarseCutoffTH;
+extern int setting_coarseTrackerPublishLevel;
+extern bool setting_coarseAdaptiveStartLevel;
+extern float setting_coarseAdaptiveBasin;
+extern float setting_coarseAdaptiveSigmaFactor;
+extern int setting_coarseAdaptiveMinIterations;
 
 extern float setting_minGradHistCut;
 extern float setting_minGradHistAdd;
@@ -225,9 +237,14 @@ extern int staticPatternPadding[10];
 
 //
 #define patternNum 8
-#define patternP staticPattern[8]
+#define patternP fixedPattern
 #define patternPadding 2
 
+// staticPattern[8] as compile-time constant. Together with the constant patternNum the loops over the pattern in the
+// residual, trace and accumulation kernels are unrolled with constant pixel offsets.
+constexpr int fixedPattern[patternNum][2] = {{0,-2}, {-1,-1}, {1,-1}, {-2,0}, {0,0}, {2,0}, {-1,1}, {0,2}};
+static_assert(patternNum % 4 == 0, "AccumulatedTopHessianSSE processes the pattern in groups of 4");
+
 
 
 
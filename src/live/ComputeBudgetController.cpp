@@ -0,0 +1,131 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ComputeBudgetController.h"
+#include "dso/util/settings.h"
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+void dmvio::ComputeBudgetSettings::registerArgs(dmvio::SettingsUtil& set)
+{
+    set.registerArg("budgetEnabled", enabled);
+    set.registerArg("budgetTargetFps", targetFps);
+    set.registerArg("budgetMinPointDensity", minPointDensity);
+    set.registerArg("budgetMaxPointDensity", maxPointDensity);
+    set.registerArg("budgetMinImmatureDensity", minImmatureDensity);
+    set.registerArg("budgetMaxImmatureDensity", maxImmatureDensity);
+    set.registerArg("budgetMinOptIterations", minOptIterations);
+    set.registerArg("budgetMaxOptIterations", maxOptIterations);
+    set.registerArg("budgetUpdateInterval", updateInterval);
+    set.registerArg("budgetMaxLoad", maxLoad);
+    set.registerArg("budgetMinLoad", minLoad);
+    set.registerArg("budgetMaxQueueSize", maxQueueSize);
+    set.registerArg("budgetDecreaseStep", decreaseStep);
+    set.registerArg("budgetIncreaseStep", increaseStep);
+}
+
+dmvio::ComputeBudgetController::ComputeBudgetController(dmvio::ComputeBudgetSettings settings)
+        : settings(std::move(settings))
+{
+    // Resolve the upper bounds to the configured values. Lower bounds are clamped so that they never exceed them.
+    auto resolveBounds = [](int& minVal, int& maxVal, int configured)
+    {
+        if(maxVal < 0) maxVal = configured;
+        minVal = std::min(minVal, maxVal);
+    };
+    resolveBounds(this->settings.minPointDensity, this->settings.maxPointDensity, dso::setting_desiredPointDensity);
+    resolveBounds(this->settings.minImmatureDensity, this->settings.maxImmatureDensity,
+                  dso::setting_desiredImmatureDensity);
+    resolveBounds(this->settings.minOptIterations, this->settings.maxOptIterations, dso::setting_maxOptIterations);
+
+    // With the default bounds the configured settings are kept until the quality is reduced.
+    if(this->settings.enabled && (this->settings.maxPointDensity != dso::setting_desiredPointDensity ||
+                                  this->settings.maxImmatureDensity != dso::setting_desiredImmatureDensity ||
+                                  this->settings.maxOptIterations != dso::setting_maxOptIterations))
+    {
+        applyQuality();
+    }
+}
+
+void dmvio::ComputeBudgetController::update(double trackingTime, int queueSize, int unmappedFrames,
+                                            double mappingTimeSum)
+{
+    if(!settings.enabled) return;
+
+    numFrames++;
+    trackingTimeSum += trackingTime;
+    maxQueueSize = std::max(maxQueueSize, queueSize);
+    maxUnmappedFrames = std::max(maxUnmappedFrames, unmappedFrames);
+
+    if(numFrames < settings.updateInterval) return;
+
+    double budget = numFrames / settings.targetFps;
+    double trackingLoad = trackingTimeSum / budget;
+    double mappingLoad = (mappingTimeSum - lastMappingTimeSum) / budget;
+    double load = std::max(trackingLoad, mappingLoad);
+
+    bool queueFull = maxQueueSize >= settings.maxQueueSize || maxUnmappedFrames >= settings.maxQueueSize;
+    double newQuality = quality;
+    if(load > settings.maxLoad || queueFull)
+    {
+        newQuality = std::max(0.0, quality - settings.decreaseStep);
+    }else if(load < settings.minLoad && maxQueueSize <= 1 && maxUnmappedFrames <= 1)
+    {
+        newQuality = std::min(1.0, quality + settings.increaseStep);
+    }
+
+    if(newQuality != quality)
+    {
+        std::cout << "ComputeBudget: quality " << quality << " -> " << newQuality << " (tracking load: "
+                  << trackingLoad << ", mapping load: " << mappingLoad << ", max image queue: " << maxQueueSize
+                  << ", max unmapped frames: " << maxUnmappedFrames << ")" << std::endl;
+        quality = newQuality;
+        applyQuality();
+    }
+
+    numFrames = 0;
+    trackingTimeSum = 0.0;
+    maxQueueSize = 0;
+    maxUnmappedFrames = 0;
+    lastMappingTimeSum = mappingTimeSum;
+}
+
+void dmvio::ComputeBudgetController::applyQuality()
+{
+    auto interpolate = [this](int minVal, int maxVal)
+    {
+        return (int) std::round(minVal + quality * (maxVal - minVal));
+    };
+    dso::setting_desiredPointDensity = interpolate(settings.minPointDensity, settings.maxPointDensity);
+    dso::setting_desiredImmatureDensity = interpolate(settings.minImmatureDensity, settings.maxImmatureDensity);
+    dso::setting_maxOptIterations = interpolate(settings.minOptIterations, settings.maxOptIterations);
+
+    std::cout << "ComputeBudget: point density " << dso::setting_desiredPointDensity << ", immature density "
+              << dso::setting_desiredImmatureDensity << ", max optimization iterations "
+              << dso::setting_maxOptIterations << std::endl;
+}
+
+double dmvio::ComputeBudgetController::getQuality() const
+{
+    return quality;
+}
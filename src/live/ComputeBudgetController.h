@@ -0,0 +1,96 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DMVIO_COMPUTEBUDGETCONTROLLER_H
+#define DMVIO_COMPUTEBUDGETCONTROLLER_H
+
+#include "util/SettingsUtil.h"
+
+namespace dmvio
+{
+
+// Settings for the compute budget controller.
+class ComputeBudgetSettings
+{
+public:
+    void registerArgs(dmvio::SettingsUtil& set);
+
+    bool enabled = false;
+    double targetFps = 30.0; // The system should be able to process frames at this rate.
+
+    // Bounds for the adapted settings. The controller starts at the upper bounds.
+    // -1 for the upper bounds means the configured value (setting_desiredPointDensity, etc.) is used.
+    int minPointDensity = 400;
+    int maxPointDensity = -1;
+    int minImmatureDensity = 600;
+    int maxImmatureDensity = -1;
+    int minOptIterations = 2;
+    int maxOptIterations = -1;
+
+    // Number of frames over which the load is averaged before each decision.
+    int updateInterval = 10;
+
+    // Load is measured as the fraction of the frame budget (1 / targetFps) used by tracking or mapping.
+    double maxLoad = 0.9; // Reduce quality if the load is above this ...
+    double minLoad = 0.6; // ... and increase it if it is below this.
+    int maxQueueSize = 2; // Also reduce quality if the image queue or the mapping queue reaches this size.
+
+    // Step sizes for the quality level (between 0 and 1). Reducing is faster than recovering to avoid oscillations.
+    double decreaseStep = 0.2;
+    double increaseStep = 0.05;
+};
+
+// Adapts point density, immature point budget and the number of BA iterations at runtime, so that the system can
+// keep up with the target frame rate without dropping frames. Accuracy degrades gracefully instead.
+// Adjusts the global settings setting_desiredPointDensity, setting_desiredImmatureDensity and setting_maxOptIterations.
+class ComputeBudgetController
+{
+public:
+    // Must be constructed after the settings have been parsed.
+    ComputeBudgetController(ComputeBudgetSettings settings);
+
+    // Call once per processed frame.
+    // trackingTime: time spent in FullSystem::addActiveFrame for this frame (seconds).
+    // queueSize: number of images waiting to be processed.
+    // unmappedFrames: number of tracked frames waiting for the mapping thread (FullSystem::getNumUnmappedFrames).
+    // mappingTimeSum: accumulated busy time of the mapping thread (FullSystem::getMappingTimeSum).
+    void update(double trackingTime, int queueSize, int unmappedFrames, double mappingTimeSum);
+
+    double getQuality() const;
+
+private:
+    void applyQuality();
+
+    ComputeBudgetSettings settings;
+
+    double quality = 1.0;
+
+    int numFrames = 0;
+    double trackingTimeSum = 0.0;
+    int maxQueueSize = 0;
+    int maxUnmappedFrames = 0;
+    double lastMappingTimeSum = 0.0;
+};
+
+}
+
+#endif //DMVIO_COMPUTEBUDGETCONTROLLER_H
@@ -21,6 +21,7 @@
 */
 
 #include "DatasetSaver.h"
+#include "util/ThreadTopology.h"
 #include <boost/filesystem.hpp>
 #include <thread>
 #include <opencv2/imgcodecs.hpp>
@@ -49,6 +50,7 @@ dmvio::DatasetSaver::DatasetSaver(std::string saveFolder)
 
 void dmvio::DatasetSaver::saveImagesWorker()
 {
+    ThreadTopology::applyToCurrentThread(THREAD_IMAGE_SAVE);
     while(running)
     {
         std::tuple<cv::Mat, double, double> tuple;
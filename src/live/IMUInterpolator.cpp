@@ -82,8 +82,8 @@ void dmvio::IMUInterpolator::insertAccDataIfNecessary()
         }
         it++;
     }
-    if(!saver) return;
-    // Save IMU data to file.
+    if(!saver && !imuListener) return;
+    // Save IMU data to file and forward it to the listener.
     for(auto&& data : output)
     {
         if(data.saveStatus != IMUDataDuringInterpolation::DONT_SAVE)
@@ -95,7 +95,14 @@ void dmvio::IMUInterpolator::insertAccDataIfNecessary()
             }
             if(data.saveStatus == IMUDataDuringInterpolation::SHALL_SAVE)
             {
-                saver->addIMUData(data.timestamp, data.accData, data.gyrData);
+                if(saver)
+                {
+                    saver->addIMUData(data.timestamp, data.accData, data.gyrData);
+                }
+                if(imuListener)
+                {
+                    imuListener(data.timestamp, data.accData, data.gyrData);
+                }
                 data.saveStatus = IMUDataDuringInterpolation::SAVED;
             }
         }
@@ -234,6 +241,12 @@ void dmvio::IMUInterpolator::addImage(std::unique_ptr<dso::ImageAndExposure> ima
 
 }
 
+void dmvio::IMUInterpolator::setIMUListener(IMUListener listener)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    imuListener = std::move(listener);
+}
+
 void dmvio::IMUInterpolator::trySendingImages()
 {
     std::sort(output.begin(), output.end());
@@ -30,6 +30,7 @@
 #include "FrameContainer.h"
 #include "DatasetSaver.h"
 #include <mutex>
+#include <functional>
 
 namespace dmvio
 {
@@ -84,10 +85,16 @@ public:
     // arrived.
     void addImage(std::unique_ptr<dso::ImageAndExposure> image, double timestamp);
 
+    // Called for each (gyroscope) measurement as soon as the interpolated accelerometer data for it is available.
+    // Arguments are timestamp, accelerometer and gyroscope data. Called while the internal mutex is held.
+    typedef std::function<void(double, const std::vector<float>&, const std::vector<float>&)> IMUListener;
+    void setIMUListener(IMUListener listener);
+
 private:
 
     FrameContainer& frameContainer;
     DatasetSaver* saver = nullptr; // also save IMU data to file.
+    IMUListener imuListener; // optionally forward completed IMU measurements.
 
     // Protects all methods.
     std::mutex mutex;
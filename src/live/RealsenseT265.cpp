@@ -194,17 +194,16 @@ void dmvio::RealsenseT265::start()
                     saver->addImage(mat.clone(), timestamp / 1000.0, exposure);
                 }
 
-                auto img = std::make_unique<dso::MinimalImageB>(mat.cols, mat.rows);
-                memcpy(img->data, mat.data, mat.rows * mat.cols);
+                // mat only wraps the buffer of the realsense frame, so we can undistort from it without a copy.
+                dso::ImageViewB img(mat.data, mat.cols, mat.rows, static_cast<int>(mat.step));
 
                 // timestamp is in milliseconds, but shall be in seconds
                 double finalTimestamp = timestamp / 1000.0;
                 // gets float exposure and double timestamp
                 std::unique_ptr<dso::ImageAndExposure> finalImage(undistorter->undistort<unsigned char>(
-                        img.get(),
+                        img,
                         static_cast<float>(exposure),
                         finalTimestamp));
-                img.reset();
 
                 // Add image to the IMU interpolator, which will forward it to the FrameContainer, once the
                 // corresponding IMU data is available.
@@ -338,6 +337,11 @@ void RealsenseT265::setUndistorter(dso::Undistort* undistort)
     this->undistorter = undistort;
 }
 
+void RealsenseT265::setIMUListener(IMUInterpolator::IMUListener listener)
+{
+    imuInt.setIMUListener(std::move(listener));
+}
+
 
 // This Method was copied from https://github.com/IntelRealSense/librealsense/blob/master/wrappers/opencv/cv-helpers.hpp
 // License: Apache 2.0. See http://www.apache.org/licenses/LICENSE-2.0 or below.
@@ -47,6 +47,9 @@ public:
     // Set the undistorter to use. Until this is set, no images are passed forward to the frameContainer.
     void setUndistorter(dso::Undistort* undistort);
 
+    // Forwards each IMU measurement (see IMUInterpolator::setIMUListener).
+    void setIMUListener(IMUInterpolator::IMUListener listener);
+
     std::unique_ptr<IMUCalibration> imuCalibration;
 private:
     void readCalibration();
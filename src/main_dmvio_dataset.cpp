@@ -53,6 +53,8 @@
 
 #include "IOWrapper/Pangolin/PangolinDSOViewer.h"
 #include "IOWrapper/OutputWrapper/SampleOutputWrapper.h"
+#include "util/SharedMemoryOutputWrapper.h"
+#include "util/ThreadTopology.h"
 
 std::string gtFile = "";
 std::string tsFile = "";
@@ -64,6 +66,8 @@ int start = 0;
 int end = 100000;
 int maxPreloadImages = 0; // If set we only preload if there are less images to be loade.
 bool useSampleOutput = false;
+bool asyncSampleOutput = false; // Feed the sample output through dmvio::AsyncOutputWrapper.
+std::string restoreCheckpointFile = "";
 
 using namespace dso;
 
@@ -71,6 +75,8 @@ using namespace dso;
 dmvio::MainSettings mainSettings;
 dmvio::IMUCalibration imuCalibration;
 dmvio::IMUSettings imuSettings;
+dmvio::AsyncOutputSettings asyncOutputSettings;
+dmvio::ThreadTopologySettings threadTopologySettings;
 
 void my_exit_handler(int s)
 {
@@ -96,6 +102,7 @@ void exitThread()
 
 void run(ImageFolderReader* reader, IOWrap::PangolinDSOViewer* viewer)
 {
+    dmvio::ThreadTopology::applyToCurrentThread(dmvio::THREAD_TRACKING);
 
     if(setting_photometricCalibration > 0 && reader->getPhotometricGamma() == 0)
     {
@@ -118,6 +125,17 @@ void run(ImageFolderReader* reader, IOWrap::PangolinDSOViewer* viewer)
         linc = -1;
     }
 
+    std::unique_ptr<dmvio::SystemCheckpoint> checkpoint;
+    if(!restoreCheckpointFile.empty())
+    {
+        assert(!reverse);
+        checkpoint = dmvio::loadCheckpoint(restoreCheckpointFile);
+        // Continue with the first frame after the last keyframe in the checkpoint.
+        lstart = checkpoint->keyframes.back().incomingId + 1;
+        std::cout << "Restoring from checkpoint " << restoreCheckpointFile << ", starting at image " << lstart
+                  << std::endl;
+    }
+
 
     bool linearizeOperation = (mainSettings.playbackSpeed == 0);
 
@@ -138,12 +156,38 @@ void run(ImageFolderReader* reader, IOWrap::PangolinDSOViewer* viewer)
     }
 
     std::unique_ptr<IOWrap::SampleOutputWrapper> sampleOutPutWrapper;
-    if(useSampleOutput)
+    std::unique_ptr<IOWrap::SampleSnapshotConsumer> sampleSnapshotConsumer;
+    std::unique_ptr<dmvio::AsyncOutputWrapper> asyncOutputWrapper;
+    if(useSampleOutput && asyncSampleOutput)
+    {
+        sampleSnapshotConsumer.reset(new IOWrap::SampleSnapshotConsumer());
+        asyncOutputWrapper.reset(new dmvio::AsyncOutputWrapper(sampleSnapshotConsumer.get(), asyncOutputSettings));
+        fullSystem->outputWrapper.push_back(asyncOutputWrapper.get());
+    }else if(useSampleOutput)
     {
         sampleOutPutWrapper.reset(new IOWrap::SampleOutputWrapper());
         fullSystem->outputWrapper.push_back(sampleOutPutWrapper.get());
     }
 
+    std::unique_ptr<dmvio::SharedMemoryOutputWrapper> shmOutputWrapper;
+    if(!mainSettings.shmOutput.empty())
+    {
+        shmOutputWrapper.reset(new dmvio::SharedMemoryOutputWrapper(mainSettings.shmOutput));
+        fullSystem->outputWrapper.push_back(shmOutputWrapper.get());
+    }
+
+    if(checkpoint)
+    {
+        fullSystem->restoreFromCheckpoint(*checkpoint);
+        checkpoint.reset();
+    }
+    if(!mainSettings.checkpointFile.empty())
+    {
+        fullSystem->enableCheckpoints(mainSettings.checkpointFile);
+    }
+
+    dmvio::ThreadTopology::printReport(std::cout);
+
     std::vector<int> idsToPlay;
     std::vector<double> timesToPlayAt;
     for(int i = lstart; i >= 0 && i < reader->getNumImages() && linc * i < linc * lend; i += linc)
@@ -201,11 +245,16 @@ void run(ImageFolderReader* reader, IOWrap::PangolinDSOViewer* viewer)
         int i = idsToPlay[ii];
 
 
-        ImageAndExposure* img;
+        // Without preloading the raw image is undistorted directly into the new frame.
+        ImageAndExposure* img = nullptr;
+        std::unique_ptr<MinimalImageB> rawImg;
+        std::unique_ptr<MinimalImage<unsigned short>> rawImg16;
         if(mainSettings.preload)
             img = preloadedImages[ii];
+        else if(reader->is16Bit())
+            rawImg16.reset(reader->getImageRaw16(i));
         else
-            img = reader->getImage(i);
+            rawImg.reset(reader->getImageRaw(i));
 
 
         bool skipFrame = false;
@@ -245,7 +294,19 @@ void run(ImageFolderReader* reader, IOWrap::PangolinDSOViewer* viewer)
                 skippedIMUData.clear();
                 imuDataSkipped = false;
             }
-            fullSystem->addActiveFrame(img, i, imuData.get(), (gtDataThere && found) ? &data : 0);
+            dmvio::GTData* gtData = (gtDataThere && found) ? &data : 0;
+            if(img)
+            {
+                fullSystem->addActiveFrame(img, i, imuData.get(), gtData);
+            }else if(rawImg16)
+            {
+                fullSystem->addActiveFrame(*reader->undistort, ImageViewW(*rawImg16), reader->getExposure(i),
+                                           reader->getTimestamp(i), i, imuData.get(), gtData, 1.0f / 256.0f);
+            }else
+            {
+                fullSystem->addActiveFrame(*reader->undistort, ImageViewB(*rawImg), reader->getExposure(i),
+                                           reader->getTimestamp(i), i, imuData.get(), gtData);
+            }
             if(gtDataThere && found && !disableAllDisplay)
             {
                 viewer->addGTCamPose(data.pose);
@@ -264,13 +325,8 @@ void run(ImageFolderReader* reader, IOWrap::PangolinDSOViewer* viewer)
             if(ii < 250 || setting_fullResetRequested)
             {
                 printf("RESETTING!\n");
-                std::vector<IOWrap::Output3DWrapper*> wraps = fullSystem->outputWrapper;
-                delete fullSystem;
-                for(IOWrap::Output3DWrapper* ow : wraps) ow->reset();
-
-                fullSystem = new FullSystem(linearizeOperation, imuCalibration, imuSettings);
-                fullSystem->setGammaFunction(reader->getPhotometricGamma());
-                fullSystem->outputWrapper = wraps;
+                fullSystem->reset();
+                for(IOWrap::Output3DWrapper* ow : fullSystem->outputWrapper) ow->reset();
 
                 setting_fullResetRequested = false;
             }
@@ -336,6 +392,13 @@ void run(ImageFolderReader* reader, IOWrap::PangolinDSOViewer* viewer)
         ow->join();
     }
 
+    if(asyncOutputWrapper)
+    {
+        dmvio::AsyncOutputStatistics stats = asyncOutputWrapper->getStatistics();
+        printf("Async output: %ld snapshots delivered, %ld dropped, latency mean %.2fms, max %.2fms\n",
+               stats.numDelivered, stats.numDropped, stats.meanLatency * 1000.0, stats.maxLatency * 1000.0);
+    }
+
 
     printf("DELETE FULLSYSTEM!\n");
     delete fullSystem;
@@ -362,6 +425,8 @@ int main(int argc, char** argv)
     imuSettings.registerArgs(*settingsUtil);
     imuCalibration.registerArgs(*settingsUtil);
     mainSettings.registerArgs(*settingsUtil);
+    asyncOutputSettings.registerArgs(*settingsUtil);
+    threadTopologySettings.registerArgs(*settingsUtil);
 
     // Dataset specific arguments. For other commandline arguments check out MainSettings::parseArgument,
     // MainSettings::registerArgs, IMUSettings.h and IMUInitSettings.h
@@ -372,9 +437,11 @@ int main(int argc, char** argv)
     settingsUtil->registerArg("gtFile", gtFile);
     settingsUtil->registerArg("tsFile", tsFile);
     settingsUtil->registerArg("sampleoutput", useSampleOutput);
+    settingsUtil->registerArg("asyncSampleOutput", asyncSampleOutput);
     settingsUtil->registerArg("reverse", reverse);
     settingsUtil->registerArg("use16Bit", use16Bit);
     settingsUtil->registerArg("maxPreloadImages", maxPreloadImages);
+    settingsUtil->registerArg("restoreCheckpoint", restoreCheckpointFile);
 
     // This call will parse all commandline arguments and potentially also read a settings yaml file if passed.
     mainSettings.parseArguments(argc, argv, *settingsUtil);
@@ -393,6 +460,9 @@ int main(int argc, char** argv)
         settingsUtil->printAllSettings(settingsStream);
     }
 
+    // Has to be done before any of the threads is started.
+    dmvio::ThreadTopology::configure(threadTopologySettings);
+
     // hook crtl+C.
     boost::thread exThread = boost::thread(exitThread);
 
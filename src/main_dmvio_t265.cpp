@@ -53,10 +53,14 @@
 
 #include "IOWrapper/Pangolin/PangolinDSOViewer.h"
 #include "IOWrapper/OutputWrapper/SampleOutputWrapper.h"
+#include "util/SharedMemoryOutputWrapper.h"
 
 #include "live/RealsenseT265.h"
 #include "util/MainSettings.h"
 #include "live/FrameSkippingStrategy.h"
+#include "live/ComputeBudgetController.h"
+#include "util/ThreadTopology.h"
+#include "IMU/IMUPropagator.h"
 
 #include <boost/filesystem.hpp>
 
@@ -74,7 +78,10 @@ dmvio::MainSettings mainSettings;
 dmvio::IMUCalibration imuCalibration;
 dmvio::IMUSettings imuSettings;
 dmvio::FrameSkippingSettings frameSkippingSettings;
+dmvio::ComputeBudgetSettings computeBudgetSettings;
+dmvio::ThreadTopologySettings threadTopologySettings;
 std::unique_ptr<dmvio::DatasetSaver> datasetSaver;
+std::unique_ptr<dmvio::IMUPropagator> imuPropagator; // Publishes poses at IMU rate.
 std::string saveDatasetPath = "";
 
 void my_exit_handler(int s)
@@ -97,6 +104,7 @@ void exitThread()
 
 void run(IOWrap::PangolinDSOViewer* viewer, Undistort* undistorter)
 {
+    dmvio::ThreadTopology::applyToCurrentThread(dmvio::THREAD_TRACKING);
     bool linearizeOperation = false;
     auto fullSystem = std::make_unique<FullSystem>(linearizeOperation, imuCalibration, imuSettings);
 
@@ -116,10 +124,32 @@ void run(IOWrap::PangolinDSOViewer* viewer, Undistort* undistorter)
         fullSystem->outputWrapper.push_back(viewer);
     }
 
+    std::unique_ptr<dmvio::SharedMemoryOutputWrapper> shmOutputWrapper;
+    if(!mainSettings.shmOutput.empty())
+    {
+        shmOutputWrapper.reset(new dmvio::SharedMemoryOutputWrapper(mainSettings.shmOutput));
+        fullSystem->outputWrapper.push_back(shmOutputWrapper.get());
+    }
+
     dmvio::FrameSkippingStrategy frameSkipping(frameSkippingSettings);
     // frameSkipping registers as an outputWrapper to get notified of changes of the system status.
     fullSystem->outputWrapper.push_back(&frameSkipping);
 
+    imuPropagator->setOutputWrapper(fullSystem->outputWrapper);
+    fullSystem->imuPropagator = imuPropagator.get();
+
+    // Restoring is not supported for live operation, but the checkpoints can be used with the dataset main
+    // (e.g. together with saveDatasetPath).
+    if(!mainSettings.checkpointFile.empty())
+    {
+        fullSystem->enableCheckpoints(mainSettings.checkpointFile);
+    }
+
+    // Reduces the computational load when the system cannot keep up, so that less frames need to be skipped.
+    dmvio::ComputeBudgetController computeBudget(computeBudgetSettings);
+
+    dmvio::ThreadTopology::printReport(std::cout);
+
     int ii = 0;
     int lastResetIndex = 0;
 
@@ -137,23 +167,18 @@ void run(IOWrap::PangolinDSOViewer* viewer, Undistort* undistorter)
 
         auto pair = frameContainer.getImageAndIMUData(frameSkipping.getMaxSkipFrames(frameContainer.getQueueSize()));
 
+        dmvio::TimeMeasurement frameTime("addActiveFrameT265");
         fullSystem->addActiveFrame(pair.first.get(), ii, &(pair.second), nullptr);
+        computeBudget.update(frameTime.end(), frameContainer.getQueueSize(), fullSystem->getNumUnmappedFrames(),
+                             fullSystem->getMappingTimeSum());
 
         if(fullSystem->initFailed || setting_fullResetRequested)
         {
             if(ii - lastResetIndex < 250 || setting_fullResetRequested)
             {
                 printf("RESETTING!\n");
-                std::vector<IOWrap::Output3DWrapper*> wraps = fullSystem->outputWrapper;
-                fullSystem.reset();
-                for(IOWrap::Output3DWrapper* ow : wraps) ow->reset();
-
-                fullSystem = std::make_unique<FullSystem>(linearizeOperation, imuCalibration, imuSettings);
-                if(undistorter->photometricUndist != nullptr)
-                {
-                    fullSystem->setGammaFunction(undistorter->photometricUndist->getG());
-                }
-                fullSystem->outputWrapper = wraps;
+                fullSystem->reset(); // also resets the imuPropagator.
+                for(IOWrap::Output3DWrapper* ow : fullSystem->outputWrapper) ow->reset();
 
                 setting_fullResetRequested = false;
                 lastResetIndex = ii;
@@ -211,6 +236,8 @@ int main(int argc, char** argv)
     imuCalibration.registerArgs(*settingsUtil);
     mainSettings.registerArgs(*settingsUtil);
     frameSkippingSettings.registerArgs(*settingsUtil);
+    computeBudgetSettings.registerArgs(*settingsUtil);
+    threadTopologySettings.registerArgs(*settingsUtil);
 
     settingsUtil->registerArg("start", start);
     settingsUtil->registerArg("calibSavePath", calibSavePath);
@@ -232,6 +259,9 @@ int main(int argc, char** argv)
         settingsUtil->printAllSettings(settingsStream);
     }
 
+    // Has to be done before any of the threads is started.
+    dmvio::ThreadTopology::configure(threadTopologySettings);
+
     // hook crtl+C.
     boost::thread exThread = boost::thread(exitThread);
 
@@ -281,6 +311,14 @@ int main(int argc, char** argv)
         imuCalibration = *(realsense.imuCalibration);
     }
 
+    imuPropagator = std::make_unique<dmvio::IMUPropagator>(imuCalibration.gravity);
+    realsense.setIMUListener([](double timestamp, const std::vector<float>& accData, const std::vector<float>& gyrData)
+                             {
+                                 imuPropagator->addIMUData(timestamp,
+                                                           Eigen::Vector3d(accData[0], accData[1], accData[2]),
+                                                           Eigen::Vector3d(gyrData[0], gyrData[1], gyrData[2]));
+                             });
+
     if(!disableAllDisplay)
     {
         IOWrap::PangolinDSOViewer* viewer = new IOWrap::PangolinDSOViewer(wG[0], hG[0], false, settingsUtil,
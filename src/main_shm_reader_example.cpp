@@ -0,0 +1,101 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Example consumer for the shared memory output. Run DM-VIO with shmOutput=/dmvio and this with
+// ./dmvio_shm_reader_example /dmvio
+// Only depends on the standard library and SharedMemoryReader.
+
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include "util/SharedMemoryReader.h"
+
+using namespace dmvio;
+
+int main(int argc, char** argv)
+{
+    std::string name = argc > 1 ? argv[1] : "/dmvio";
+
+    std::unique_ptr<SharedMemoryReader> reader;
+    while(!reader)
+    {
+        try
+        {
+            reader.reset(new SharedMemoryReader(name));
+        }catch(const std::runtime_error& e)
+        {
+            std::cout << e.what() << " Retrying..." << std::endl;
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+    }
+
+    // KeyframeData is large so we don't put it on the stack.
+    std::unique_ptr<shm::KeyframeData> keyframe(new shm::KeyframeData());
+    uint64_t lastNumPoses = 0, lastNumKeyframeUpdates = 0, lastNumResets = reader->getNumResets();
+    while(true)
+    {
+        if(reader->getNumResets() != lastNumResets)
+        {
+            lastNumResets = reader->getNumResets();
+            std::cout << "System was reset." << std::endl;
+        }
+
+        if(reader->getNumPoses() != lastNumPoses)
+        {
+            lastNumPoses = reader->getNumPoses();
+            shm::PoseData pose;
+            shm::StatusData status;
+            if(reader->getLatestPose(pose) && reader->getStatus(status))
+            {
+                std::cout << "Frame " << pose.incomingId << " at " << pose.timestamp << ": position "
+                          << pose.camToWorld[12] << " " << pose.camToWorld[13] << " " << pose.camToWorld[14]
+                          << ", status " << status.systemStatus;
+                if(status.hasTransform)
+                {
+                    std::cout << ", scale " << status.scale;
+                }
+                std::cout << std::endl;
+            }
+        }
+
+        uint64_t numKeyframeUpdates = reader->getNumKeyframeUpdates();
+        if(numKeyframeUpdates != lastNumKeyframeUpdates)
+        {
+            lastNumKeyframeUpdates = numKeyframeUpdates;
+            int numFinal = 0, numPoints = 0;
+            for(int i = 0; i < shm::numKeyframeSlots; i++)
+            {
+                if(reader->getKeyframe(i, *keyframe))
+                {
+                    numFinal += keyframe->final;
+                    numPoints += keyframe->numPoints;
+                }
+            }
+            std::cout << "Map: " << numPoints << " points in the last " << shm::numKeyframeSlots << " keyframes ("
+                      << numFinal << " final)." << std::endl;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return 0;
+}
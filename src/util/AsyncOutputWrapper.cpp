@@ -0,0 +1,244 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "AsyncOutputWrapper.h"
+#include "FullSystem/HessianBlocks.h"
+#include "FullSystem/ImmaturePoint.h"
+#include "util/FrameShell.h"
+#include "util/globalCalib.h"
+#include "GTSAMIntegration/PoseTransformationIMU.h"
+#include "ThreadTopology.h"
+#include <algorithm>
+
+using namespace dmvio;
+
+void dmvio::AsyncOutputSettings::registerArgs(dmvio::SettingsUtil& set)
+{
+    set.registerArg("asyncOutputQueueSize", queueSize);
+    set.registerArg("asyncOutputDropPolicy", dropPolicy);
+}
+
+AsyncOutputWrapper::AsyncOutputWrapper(OutputSnapshotConsumer* consumer, AsyncOutputSettings settings)
+        : consumer(consumer), settings(std::move(settings))
+{
+    consumerThread = std::thread{&AsyncOutputWrapper::consumerLoop, this};
+}
+
+AsyncOutputWrapper::~AsyncOutputWrapper()
+{
+    join();
+}
+
+void AsyncOutputWrapper::push(std::function<void(OutputSnapshotConsumer&)>&& deliver, bool droppable)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if(!running) return;
+
+    if((int) queue.size() >= settings.queueSize)
+    {
+        if(settings.dropPolicy == AsyncOutputSettings::BLOCK)
+        {
+            spaceAvailableCond.wait(lock, [this]()
+            { return (int) queue.size() < settings.queueSize || !running; });
+        }else if(settings.dropPolicy == AsyncOutputSettings::DROP_NEWEST && droppable)
+        {
+            statistics.numDropped++;
+            return;
+        }else
+        {
+            // If only non-droppable snapshots are queued the queue is allowed to grow.
+            auto it = std::find_if(queue.begin(), queue.end(), [](const Snapshot& snapshot)
+            { return snapshot.droppable; });
+            if(it != queue.end())
+            {
+                queue.erase(it);
+                statistics.numDropped++;
+            }
+        }
+    }
+
+    queue.push_back(Snapshot{std::move(deliver), droppable, std::chrono::steady_clock::now()});
+    statistics.numQueued++;
+    lock.unlock();
+    snapshotArrivedCond.notify_one();
+}
+
+void AsyncOutputWrapper::consumerLoop()
+{
+    ThreadTopology::applyToCurrentThread(THREAD_OUTPUT);
+    while(true)
+    {
+        Snapshot snapshot;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            snapshotArrivedCond.wait(lock, [this]()
+            { return !queue.empty() || !running; });
+            if(queue.empty()) return; // Only happens if not running anymore.
+            snapshot = std::move(queue.front());
+            queue.pop_front();
+        }
+        spaceAvailableCond.notify_all();
+
+        double latency = std::chrono::duration<double>(std::chrono::steady_clock::now() - snapshot.created).count();
+        snapshot.deliver(*consumer);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        statistics.numDelivered++;
+        latencySum += latency;
+        statistics.meanLatency = latencySum / statistics.numDelivered;
+        statistics.maxLatency = std::max(statistics.maxLatency, latency);
+    }
+}
+
+void AsyncOutputWrapper::join()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        running = false;
+    }
+    snapshotArrivedCond.notify_all();
+    spaceAvailableCond.notify_all();
+    if(consumerThread.joinable())
+    {
+        consumerThread.join();
+    }
+}
+
+AsyncOutputStatistics AsyncOutputWrapper::getStatistics() const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return statistics;
+}
+
+void AsyncOutputWrapper::reset()
+{
+    push([](OutputSnapshotConsumer& c)
+         { c.reset(); }, false);
+}
+
+void AsyncOutputWrapper::publishSystemStatus(dmvio::SystemStatus systemStatus)
+{
+    push([systemStatus](OutputSnapshotConsumer& c)
+         { c.consumeSystemStatus(systemStatus); }, false);
+}
+
+void AsyncOutputWrapper::publishTransformDSOToIMU(const TransformDSOToIMU& transformDSOToIMU)
+{
+    std::shared_ptr<const TransformDSOToIMU> copy = std::make_shared<TransformDSOToIMU>(transformDSOToIMU);
+    push([copy](OutputSnapshotConsumer& c)
+         { c.consumeTransformDSOToIMU(copy); }, false);
+}
+
+void AsyncOutputWrapper::publishGraph(const std::map<uint64_t, Eigen::Vector2i, std::less<uint64_t>,
+        Eigen::aligned_allocator<std::pair<const uint64_t, Eigen::Vector2i>>>& connectivity)
+{
+    auto edges = std::make_shared<std::vector<GraphEdgeSnapshot>>();
+    edges->reserve(connectivity.size());
+    for(const auto& pair : connectivity)
+    {
+        edges->push_back(GraphEdgeSnapshot{(int) (pair.first >> 32), (int) (pair.first & ((uint64_t) 0xFFFFFFFF)),
+                                           pair.second[0], pair.second[1]});
+    }
+    push([edges](OutputSnapshotConsumer& c)
+         { c.consumeGraph(*edges); }, true);
+}
+
+void AsyncOutputWrapper::publishKeyframes(std::vector<dso::FrameHessian*>& frames, bool final,
+                                          dso::CalibHessian* HCalib)
+{
+    bool needPoints = consumer->needPoints();
+    auto snapshots = std::make_shared<std::vector<KeyframeSnapshot, Eigen::aligned_allocator<KeyframeSnapshot>>>(
+            frames.size());
+    for(size_t i = 0; i < frames.size(); i++)
+    {
+        dso::FrameHessian* fh = frames[i];
+        KeyframeSnapshot& kf = (*snapshots)[i];
+        kf.frameID = fh->frameID;
+        kf.id = fh->shell->id;
+        kf.incomingId = fh->shell->incoming_id;
+        kf.timestamp = fh->shell->timestamp;
+        kf.camToWorld = fh->shell->camToWorld.matrix();
+        kf.calib = Eigen::Vector4f(HCalib->fxl(), HCalib->fyl(), HCalib->cxl(), HCalib->cyl());
+        if(!needPoints) continue;
+
+        kf.points.reserve(fh->pointHessians.size() + fh->pointHessiansMarginalized.size() + fh->immaturePoints.size());
+        auto addPoints = [&kf](const std::vector<dso::PointHessian*>& points, PointSnapshot::Type type)
+        {
+            for(dso::PointHessian* ph : points)
+            {
+                if(ph == nullptr) continue;
+                kf.points.push_back(PointSnapshot{type, ph->u, ph->v, ph->idepth_scaled, ph->idepth_hessian,
+                                                  ph->maxRelBaseline, ph->numGoodResiduals, ph->color[0]});
+            }
+        };
+        addPoints(fh->pointHessians, PointSnapshot::ACTIVE);
+        addPoints(fh->pointHessiansMarginalized, PointSnapshot::MARGINALIZED);
+        for(dso::ImmaturePoint* ip : fh->immaturePoints)
+        {
+            if(ip == nullptr) continue;
+            kf.points.push_back(PointSnapshot{PointSnapshot::IMMATURE, ip->u, ip->v,
+                                              (ip->idepth_min + ip->idepth_max) * 0.5f, 0.0f, 0.0f, 0,
+                                              ip->color[0]});
+        }
+    }
+    // Final keyframes are only published once, so they are never dropped.
+    push([snapshots, final](OutputSnapshotConsumer& c)
+         { c.consumeKeyframes(*snapshots, final); }, !final);
+}
+
+void AsyncOutputWrapper::publishCamPose(dso::FrameShell* frame, dso::CalibHessian* HCalib)
+{
+    auto pose = std::make_shared<CamPoseSnapshot>();
+    pose->id = frame->id;
+    pose->incomingId = frame->incoming_id;
+    pose->timestamp = frame->timestamp;
+    pose->poseValid = frame->poseValid;
+    pose->camToWorld = frame->camToWorld.matrix();
+    push([pose](OutputSnapshotConsumer& c)
+         { c.consumeCamPose(*pose); }, true);
+}
+
+void AsyncOutputWrapper::publishIMURatePose(const IMUState& state)
+{
+    auto copy = std::make_shared<IMUState>(state);
+    push([copy](OutputSnapshotConsumer& c)
+         { c.consumeIMURatePose(*copy); }, true);
+}
+
+void AsyncOutputWrapper::pushLiveFrame(dso::FrameHessian* image)
+{
+    if(!consumer->needLiveFrames()) return;
+    auto frame = std::make_shared<LiveFrameSnapshot>();
+    frame->id = image->shell->id;
+    frame->incomingId = image->shell->incoming_id;
+    frame->timestamp = image->shell->timestamp;
+    frame->w = dso::wG[0];
+    frame->h = dso::hG[0];
+    frame->image.resize(frame->w * frame->h);
+    const dso::ImageLevel dI = image->image(0);
+    for(int i = 0; i < frame->w * frame->h; i++)
+    {
+        frame->image[i] = dI[i][0];
+    }
+    push([frame](OutputSnapshotConsumer& c)
+         { c.consumeLiveFrame(*frame); }, true);
+}
@@ -0,0 +1,218 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DMVIO_ASYNCOUTPUTWRAPPER_H
+#define DMVIO_ASYNCOUTPUTWRAPPER_H
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <memory>
+#include "IOWrapper/Output3DWrapper.h"
+#include "IMU/IMUPropagator.h"
+#include "util/SettingsUtil.h"
+
+namespace dmvio
+{
+
+// Immutable copies of the data passed to Output3DWrapper. They do not reference any internal structs of the system,
+// so they can be processed in a different thread while the system continues.
+struct PointSnapshot
+{
+    enum Type
+    {
+        ACTIVE, MARGINALIZED, IMMATURE
+    };
+    Type type;
+    float u, v;
+    float idepth; // For immature points the mean of idepth_min and idepth_max.
+    float idepthHessian; // 0 for immature points.
+    float maxRelBaseline;
+    int numGoodResiduals;
+    float color; // Intensity in the host frame.
+};
+
+struct KeyframeSnapshot
+{
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    int frameID; // incremental ID for keyframes only.
+    int id, incomingId;
+    double timestamp;
+    Eigen::Matrix4d camToWorld;
+    Eigen::Vector4f calib; // fx, fy, cx, cy.
+    std::vector<PointSnapshot> points; // Only filled if OutputSnapshotConsumer::needPoints.
+};
+
+struct CamPoseSnapshot
+{
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    int id, incomingId;
+    double timestamp;
+    bool poseValid;
+    Eigen::Matrix4d camToWorld;
+};
+
+struct GraphEdgeSnapshot
+{
+    int hostId, targetId;
+    int numActiveResiduals, numMarginalizedResiduals;
+};
+
+struct LiveFrameSnapshot
+{
+    int id, incomingId;
+    double timestamp;
+    int w, h;
+    std::vector<float> image;
+};
+
+// Receives the snapshots in the consumer thread of AsyncOutputWrapper.
+class OutputSnapshotConsumer
+{
+public:
+    virtual ~OutputSnapshotConsumer() = default;
+
+    virtual void consumeSystemStatus(SystemStatus systemStatus)
+    {}
+
+    virtual void consumeTransformDSOToIMU(std::shared_ptr<const TransformDSOToIMU> transformDSOToIMU)
+    {}
+
+    virtual void consumeGraph(const std::vector<GraphEdgeSnapshot>& edges)
+    {}
+
+    virtual void consumeKeyframes(const std::vector<KeyframeSnapshot, Eigen::aligned_allocator<KeyframeSnapshot>>& frames,
+                                  bool final)
+    {}
+
+    virtual void consumeCamPose(const CamPoseSnapshot& pose)
+    {}
+
+    virtual void consumeIMURatePose(const IMUState& state)
+    {}
+
+    virtual void consumeLiveFrame(const LiveFrameSnapshot& frame)
+    {}
+
+    virtual void reset()
+    {}
+
+    // These are called in the producing threads to avoid copying data that is not used. Must be thread-safe.
+    virtual bool needPoints() const
+    { return true; }
+
+    virtual bool needLiveFrames() const
+    { return false; }
+};
+
+class AsyncOutputSettings
+{
+public:
+    void registerArgs(dmvio::SettingsUtil& set);
+
+    enum DropPolicy
+    {
+        DROP_OLDEST = 0, // Remove the oldest droppable snapshot from the full queue.
+        DROP_NEWEST = 1, // Discard the incoming snapshot if the queue is full.
+        BLOCK = 2 // Wait until the consumer has made space (the system is stalled like with synchronous publishing).
+    };
+
+    int queueSize = 50;
+    int dropPolicy = DROP_OLDEST;
+};
+
+struct AsyncOutputStatistics
+{
+    long numQueued = 0;
+    long numDelivered = 0;
+    long numDropped = 0;
+    double meanLatency = 0.0; // Seconds between publishing and delivery to the consumer.
+    double maxLatency = 0.0;
+};
+
+// Output3DWrapper which copies the published data into snapshots and hands them to an OutputSnapshotConsumer in a
+// separate thread, so that slow consumers (file writers, network bridges, ...) do not stall tracking and mapping.
+// Snapshots of the system status, the scale and final keyframes are never dropped.
+// Existing Output3DWrappers can still be added to FullSystem::outputWrapper directly and are called synchronously.
+class AsyncOutputWrapper : public dso::IOWrap::Output3DWrapper
+{
+public:
+    // consumer is not owned and must outlive this object.
+    AsyncOutputWrapper(OutputSnapshotConsumer* consumer, AsyncOutputSettings settings);
+
+    ~AsyncOutputWrapper() override;
+
+    void publishTransformDSOToIMU(const dmvio::TransformDSOToIMU& transformDSOToIMU) override;
+
+    void publishSystemStatus(dmvio::SystemStatus systemStatus) override;
+
+    void publishGraph(const std::map<uint64_t, Eigen::Vector2i, std::less<uint64_t>,
+            Eigen::aligned_allocator<std::pair<const uint64_t, Eigen::Vector2i>>>& connectivity) override;
+
+    void publishKeyframes(std::vector<dso::FrameHessian*>& frames, bool final, dso::CalibHessian* HCalib) override;
+
+    void publishCamPose(dso::FrameShell* frame, dso::CalibHessian* HCalib) override;
+
+    void publishIMURatePose(const dmvio::IMUState& state) override;
+
+    void pushLiveFrame(dso::FrameHessian* image) override;
+
+    // Delivers all queued snapshots and stops the consumer thread.
+    void join() override;
+
+    void reset() override;
+
+    AsyncOutputStatistics getStatistics() const;
+
+private:
+    struct Snapshot
+    {
+        std::function<void(OutputSnapshotConsumer&)> deliver;
+        bool droppable;
+        std::chrono::steady_clock::time_point created;
+    };
+
+    void push(std::function<void(OutputSnapshotConsumer&)>&& deliver, bool droppable);
+
+    void consumerLoop();
+
+    OutputSnapshotConsumer* consumer;
+    AsyncOutputSettings settings;
+
+    std::thread consumerThread;
+
+    // protects all members below.
+    mutable std::mutex mutex;
+    std::condition_variable snapshotArrivedCond, spaceAvailableCond;
+    std::deque<Snapshot> queue;
+    bool running = true;
+
+    AsyncOutputStatistics statistics;
+    double latencySum = 0.0;
+};
+
+}
+
+#endif //DMVIO_ASYNCOUTPUTWRAPPER_H
@@ -0,0 +1,80 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DMVIO_COPYONWRITE_H
+#define DMVIO_COPYONWRITE_H
+
+#include <atomic>
+#include <memory>
+
+namespace dmvio
+{
+
+// Holds an object which is shared between copies of the CopyOnWrite until one of them is modified with mutate.
+// Different CopyOnWrite instances can be used from different threads, as long as each instance is only used by one.
+template<typename T> class CopyOnWrite
+{
+public:
+    CopyOnWrite() : data(std::make_shared<T>())
+    {}
+
+    explicit CopyOnWrite(T value) : data(std::make_shared<T>(std::move(value)))
+    {}
+
+    const T& get() const
+    { return *data; }
+
+    // Returns a mutable reference, copying the object first if it is currently shared.
+    T& mutate()
+    {
+        if(data.use_count() > 1)
+        {
+            data = std::make_shared<T>(*data);
+        }else
+        {
+            // use_count is a relaxed load: synchronize with the release of the last other owner (e.g. a copy which was
+            // destroyed in another thread after reading the object), before the object is modified in place.
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        return *data;
+    }
+
+    // Replaces the object without copying the old one.
+    void reset(T value)
+    {
+        data = std::make_shared<T>(std::move(value));
+    }
+
+    bool isShared() const
+    { return data.use_count() > 1; }
+
+    // Identifies the underlying object (equal for instances sharing it).
+    const void* id() const
+    { return data.get(); }
+
+private:
+    std::shared_ptr<T> data;
+};
+
+}
+
+#endif //DMVIO_COPYONWRITE_H
@@ -0,0 +1,54 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef DMVIO_LOCKCONTENTION_H
+#define DMVIO_LOCKCONTENTION_H
+
+#include <chrono>
+#include <string>
+#include <boost/thread/mutex.hpp>
+#include "dso/util/settings.h"
+#include "util/TimeMeasurement.h"
+
+namespace dmvio
+{
+
+// Locks mutex. If setting_measureLockContention is enabled, the time waited for it is logged with TimeMeasurement as
+// "lockWait_<name>". As with TimeMeasurement, name should be different for each thread (e.g. "shellPoseMutex_mapping").
+template<typename Mutex>
+boost::unique_lock<Mutex> measuredLock(Mutex& mutex, const char* name)
+{
+    if(!dso::setting_measureLockContention)
+    {
+        return boost::unique_lock<Mutex>(mutex);
+    }
+    auto begin = std::chrono::high_resolution_clock::now();
+    boost::unique_lock<Mutex> lock(mutex);
+    double waited = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    TimeMeasurement::addMeasurement(std::string("lockWait_") + name, waited);
+    return lock;
+}
+
+}
+
+#endif //DMVIO_LOCKCONTENTION_H
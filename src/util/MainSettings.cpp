@@ -186,6 +186,8 @@ void MainSettings::registerArgs(SettingsUtil& set)
     set.registerArg("gamma", gammaCalib);
     set.registerArg("calib", calib);
     set.registerArg("imuCalib", imuCalibFile);
+    set.registerArg("checkpointFile", checkpointFile);
+    set.registerArg("shmOutput", shmOutput);
     set.registerArg("speed", playbackSpeed);
     set.registerArg("preload", preload);
 
@@ -200,6 +202,18 @@ void MainSettings::registerArgs(SettingsUtil& set)
     set.registerArg("setting_weightZeroPriorDSOInitX", setting_weightZeroPriorDSOInitX);
     set.registerArg("setting_forceNoKFTranslationThresh", setting_forceNoKFTranslationThresh);
     set.registerArg("setting_minFramesBetweenKeyframes", setting_minFramesBetweenKeyframes);
+    set.registerArg("setting_coarseTrackerPublishLevel", setting_coarseTrackerPublishLevel);
+    set.registerArg("setting_coarseAdaptiveStartLevel", setting_coarseAdaptiveStartLevel);
+    set.registerArg("setting_coarseAdaptiveBasin", setting_coarseAdaptiveBasin);
+    set.registerArg("setting_coarseAdaptiveSigmaFactor", setting_coarseAdaptiveSigmaFactor);
+    set.registerArg("setting_coarseAdaptiveMinIterations", setting_coarseAdaptiveMinIterations);
+    set.registerArg("setting_batchedPointActivation", setting_batchedPointActivation);
+    set.registerArg("setting_fusedOptimization", setting_fusedOptimization);
+    set.registerArg("setting_checkpointInterval", setting_checkpointInterval);
+    set.registerArg("setting_nonBlockingTracking", setting_nonBlockingTracking);
+    set.registerArg("setting_measureLockContention", setting_measureLockContention);
+    set.registerArg("setting_compactImages", setting_compactImages);
+    set.registerArg("setting_multiThreadedPyramid", setting_multiThreadedPyramid);
 
 }
 
@@ -47,6 +47,8 @@ public:
     std::string gammaCalib = "";
     std::string calib = "";
     std::string imuCalibFile = "";
+    std::string checkpointFile = ""; // If set, checkpoints are written to this file (see setting_checkpointInterval).
+    std::string shmOutput = ""; // If set (e.g. "/dmvio"), the output is also published to this shared memory segment.
 
     // only relevant for datasets.
     float playbackSpeed = 0;    // 0 for linearize (play as fast as possible, while sequentializing tracking & mapping). otherwise, factor on timestamps.
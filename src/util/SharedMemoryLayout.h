@@ -0,0 +1,140 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DMVIO_SHAREDMEMORYLAYOUT_H
+#define DMVIO_SHAREDMEMORYLAYOUT_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+// Memory layout of the shared memory segment written by SharedMemoryOutputWrapper and read by SharedMemoryReader.
+// Only depends on the standard library, so that consumers do not need to link against DM-VIO.
+// Each block is protected by a seqlock: The (single) writer makes the sequence number odd while writing, readers
+// retry if it was odd or has changed while copying. Neither side ever blocks.
+// All poses are in the DSO world frame (arbitrary scale), matrices are stored column-major.
+namespace dmvio
+{
+namespace shm
+{
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Shared memory output needs lock-free 64 bit atomics.");
+
+constexpr uint32_t magic = 0x4F49564D;
+constexpr uint32_t version = 1;
+
+constexpr int numPoseSlots = 64;
+constexpr int numKeyframeSlots = 32;
+constexpr int maxPointsPerKeyframe = 8192;
+
+struct PoseData
+{
+    int32_t id; // Internal frame id.
+    int32_t incomingId;
+    int32_t poseValid;
+    double timestamp;
+    double camToWorld[16];
+};
+
+struct StatusData
+{
+    int32_t systemStatus; // dmvio::SystemStatus
+    int32_t hasTransform; // Only if set the fields below are valid.
+    double scale; // Scale from the DSO world to the metric world.
+    double R_dsoW_metricW[9]; // Rotation from the metric world (gravity along -z) to the DSO world.
+    double T_cam_imu[16];
+};
+
+struct PointData
+{
+    float x, y, z; // In the coordinate frame of the host keyframe.
+    float intensity;
+};
+
+struct KeyframeData
+{
+    int32_t frameId; // Keyframe counter, the slot is frameId % numKeyframeSlots.
+    int32_t id;
+    int32_t incomingId;
+    int32_t final; // Set once the keyframe was marginalized (its pose will not change anymore).
+    int32_t numPoints;
+    double timestamp;
+    double camToWorld[16];
+    PointData points[maxPointsPerKeyframe];
+};
+
+template<typename T> struct SeqLocked
+{
+    std::atomic<uint64_t> seq;
+    T data;
+};
+
+struct Header
+{
+    std::atomic<uint32_t> magic; // Written last by the writer, so readers can check that the segment is initialized.
+    uint32_t version;
+    uint64_t size;
+    std::atomic<uint64_t> numPoses; // Total number of poses written, the latest is in slot (numPoses - 1) % numPoseSlots.
+    std::atomic<uint64_t> numKeyframeUpdates; // Incremented after each written keyframe.
+    std::atomic<uint64_t> numResets; // Incremented on each full reset of the system.
+};
+
+struct Segment
+{
+    Header header;
+    SeqLocked<StatusData> status;
+    SeqLocked<PoseData> poses[numPoseSlots];
+    SeqLocked<KeyframeData> keyframes[numKeyframeSlots];
+};
+
+// Only one thread may write to a block at the same time.
+template<typename T, typename Func> void seqlockWrite(SeqLocked<T>& block, Func&& writeData)
+{
+    uint64_t seq = block.seq.load(std::memory_order_relaxed);
+    block.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    writeData(block.data);
+    block.seq.store(seq + 2, std::memory_order_release);
+}
+
+// Returns false if the block was never written or no consistent copy could be obtained within maxTries.
+template<typename T> bool seqlockRead(const SeqLocked<T>& block, T& out, int maxTries = 1000)
+{
+    for(int i = 0; i < maxTries; i++)
+    {
+        uint64_t before = block.seq.load(std::memory_order_acquire);
+        if(before & 1) continue;
+        std::memcpy(&out, &block.data, sizeof(T));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = block.seq.load(std::memory_order_relaxed);
+        if(before == after)
+        {
+            return before != 0;
+        }
+    }
+    return false;
+}
+
+}
+}
+
+#endif //DMVIO_SHAREDMEMORYLAYOUT_H
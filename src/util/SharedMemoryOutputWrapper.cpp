@@ -0,0 +1,168 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SharedMemoryOutputWrapper.h"
+#include "FullSystem/HessianBlocks.h"
+#include "util/FrameShell.h"
+#include "GTSAMIntegration/PoseTransformationIMU.h"
+#include <stdexcept>
+#include <iostream>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace dmvio;
+
+namespace
+{
+template<typename Derived> void copyMatrix(const Eigen::MatrixBase<Derived>& mat, double* out)
+{
+    typedef Eigen::Matrix<double, Derived::RowsAtCompileTime, Derived::ColsAtCompileTime> MatD;
+    Eigen::Map<MatD> map(out);
+    map = mat.template cast<double>();
+}
+}
+
+SharedMemoryOutputWrapper::SharedMemoryOutputWrapper(std::string name)
+        : name(std::move(name))
+{
+    // Truncating an existing segment would make readers that still map it crash with SIGBUS. Instead we create a new
+    // one under the same name: old readers keep their mapping, new readers attach to the new segment.
+    shm_unlink(this->name.c_str());
+    int fd = shm_open(this->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if(fd < 0)
+    {
+        throw std::runtime_error("Cannot create shared memory " + this->name);
+    }
+    // ftruncate fills the segment with zeros, which is a valid initial state for all blocks.
+    if(ftruncate(fd, sizeof(shm::Segment)) != 0)
+    {
+        close(fd);
+        shm_unlink(this->name.c_str());
+        throw std::runtime_error("Cannot resize shared memory " + this->name);
+    }
+    void* memory = mmap(nullptr, sizeof(shm::Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(memory == MAP_FAILED)
+    {
+        shm_unlink(this->name.c_str());
+        throw std::runtime_error("Cannot map shared memory " + this->name);
+    }
+    segment = static_cast<shm::Segment*>(memory);
+    segment->header.version = shm::version;
+    segment->header.size = sizeof(shm::Segment);
+    segment->header.magic.store(shm::magic, std::memory_order_release);
+
+    std::cout << "Publishing output to shared memory " << this->name << " (" << sizeof(shm::Segment) / 1024
+              << " KB)." << std::endl;
+}
+
+SharedMemoryOutputWrapper::~SharedMemoryOutputWrapper()
+{
+    munmap(segment, sizeof(shm::Segment));
+    shm_unlink(name.c_str());
+}
+
+void SharedMemoryOutputWrapper::publishSystemStatus(dmvio::SystemStatus systemStatus)
+{
+    std::unique_lock<std::mutex> lock(statusMutex);
+    status.systemStatus = systemStatus;
+    shm::seqlockWrite(segment->status, [this](shm::StatusData& data)
+    { data = status; });
+}
+
+void SharedMemoryOutputWrapper::publishTransformDSOToIMU(const TransformDSOToIMU& transformDSOToIMU)
+{
+    std::unique_lock<std::mutex> lock(statusMutex);
+    status.hasTransform = 1;
+    status.scale = transformDSOToIMU.getScale();
+    copyMatrix(transformDSOToIMU.getR_dsoW_metricW().matrix(), status.R_dsoW_metricW);
+    copyMatrix(transformDSOToIMU.getT_cam_imu().matrix(), status.T_cam_imu);
+    shm::seqlockWrite(segment->status, [this](shm::StatusData& data)
+    { data = status; });
+}
+
+void SharedMemoryOutputWrapper::publishCamPose(dso::FrameShell* frame, dso::CalibHessian* HCalib)
+{
+    std::unique_lock<std::mutex> lock(poseMutex);
+    uint64_t index = segment->header.numPoses.load(std::memory_order_relaxed);
+    shm::seqlockWrite(segment->poses[index % shm::numPoseSlots], [frame](shm::PoseData& data)
+    {
+        data.id = frame->id;
+        data.incomingId = frame->incoming_id;
+        data.poseValid = frame->poseValid;
+        data.timestamp = frame->timestamp;
+        copyMatrix(frame->camToWorld.matrix(), data.camToWorld);
+    });
+    segment->header.numPoses.store(index + 1, std::memory_order_release);
+}
+
+void SharedMemoryOutputWrapper::publishKeyframes(std::vector<dso::FrameHessian*>& frames, bool final,
+                                                 dso::CalibHessian* HCalib)
+{
+    std::unique_lock<std::mutex> lock(keyframeMutex);
+    float fxi = 1.0f / HCalib->fxl(), fyi = 1.0f / HCalib->fyl();
+    float cx = HCalib->cxl(), cy = HCalib->cyl();
+    for(dso::FrameHessian* fh : frames)
+    {
+        shm::seqlockWrite(segment->keyframes[fh->frameID % shm::numKeyframeSlots], [&](shm::KeyframeData& data)
+        {
+            data.frameId = fh->frameID;
+            data.id = fh->shell->id;
+            data.incomingId = fh->shell->incoming_id;
+            data.final = final;
+            data.timestamp = fh->shell->timestamp;
+            copyMatrix(fh->shell->camToWorld.matrix(), data.camToWorld);
+
+            int num = 0;
+            auto addPoints = [&](const std::vector<dso::PointHessian*>& points)
+            {
+                for(dso::PointHessian* ph : points)
+                {
+                    if(num >= shm::maxPointsPerKeyframe) return;
+                    if(ph == nullptr || ph->idepth_scaled <= 0) continue;
+                    float depth = 1.0f / ph->idepth_scaled;
+                    shm::PointData& point = data.points[num++];
+                    point.x = (ph->u - cx) * fxi * depth;
+                    point.y = (ph->v - cy) * fyi * depth;
+                    point.z = depth;
+                    point.intensity = ph->color[0];
+                }
+            };
+            addPoints(fh->pointHessians);
+            addPoints(fh->pointHessiansMarginalized);
+            data.numPoints = num;
+        });
+        segment->header.numKeyframeUpdates.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void SharedMemoryOutputWrapper::reset()
+{
+    {
+        std::unique_lock<std::mutex> lock(statusMutex);
+        status = shm::StatusData{};
+        shm::seqlockWrite(segment->status, [this](shm::StatusData& data)
+        { data = status; });
+    }
+    segment->header.numResets.fetch_add(1, std::memory_order_release);
+}
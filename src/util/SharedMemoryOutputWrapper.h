@@ -0,0 +1,68 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DMVIO_SHAREDMEMORYOUTPUTWRAPPER_H
+#define DMVIO_SHAREDMEMORYOUTPUTWRAPPER_H
+
+#include <mutex>
+#include <string>
+#include "IOWrapper/Output3DWrapper.h"
+#include "SharedMemoryLayout.h"
+
+namespace dmvio
+{
+
+// Publishes the latest camera poses, the system status, the scale / gravity direction and the keyframe point clouds
+// into a shared memory segment (in /dev/shm), so that other processes on the same machine can read them with
+// SharedMemoryReader without sockets or serialization. See SharedMemoryLayout.h for the format.
+// Writing never waits for readers.
+class SharedMemoryOutputWrapper : public dso::IOWrap::Output3DWrapper
+{
+public:
+    // name of the shared memory object, must start with a slash (e.g. "/dmvio"). Throws std::runtime_error if it cannot
+    // be created. An existing segment with this name (e.g. of a previous run) is replaced, readers still attached to it
+    // keep the old one. The segment is removed again in the destructor.
+    explicit SharedMemoryOutputWrapper(std::string name);
+    ~SharedMemoryOutputWrapper() override;
+
+    void publishTransformDSOToIMU(const dmvio::TransformDSOToIMU& transformDSOToIMU) override;
+
+    void publishSystemStatus(dmvio::SystemStatus systemStatus) override;
+
+    void publishKeyframes(std::vector<dso::FrameHessian*>& frames, bool final, dso::CalibHessian* HCalib) override;
+
+    void publishCamPose(dso::FrameShell* frame, dso::CalibHessian* HCalib) override;
+
+    void reset() override;
+
+private:
+    std::string name;
+    shm::Segment* segment = nullptr;
+
+    // The seqlocks allow only one writer per block, but e.g. the status is published by tracking and mapping thread.
+    std::mutex statusMutex, poseMutex, keyframeMutex;
+    shm::StatusData status{};
+};
+
+}
+
+#endif //DMVIO_SHAREDMEMORYOUTPUTWRAPPER_H
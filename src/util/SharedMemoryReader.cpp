@@ -0,0 +1,102 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SharedMemoryReader.h"
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace dmvio;
+
+SharedMemoryReader::SharedMemoryReader(const std::string& name)
+{
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if(fd < 0)
+    {
+        throw std::runtime_error("Cannot open shared memory " + name);
+    }
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) != 0 || fileStat.st_size < (off_t) sizeof(shm::Segment))
+    {
+        close(fd);
+        throw std::runtime_error("Shared memory " + name + " has the wrong size.");
+    }
+    void* memory = mmap(nullptr, sizeof(shm::Segment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(memory == MAP_FAILED)
+    {
+        throw std::runtime_error("Cannot map shared memory " + name);
+    }
+    segment = static_cast<const shm::Segment*>(memory);
+
+    if(segment->header.magic.load(std::memory_order_acquire) != shm::magic ||
+       segment->header.version != shm::version || segment->header.size != sizeof(shm::Segment))
+    {
+        munmap(const_cast<shm::Segment*>(segment), sizeof(shm::Segment));
+        throw std::runtime_error("Shared memory " + name + " is not initialized or has an incompatible version.");
+    }
+}
+
+SharedMemoryReader::~SharedMemoryReader()
+{
+    munmap(const_cast<shm::Segment*>(segment), sizeof(shm::Segment));
+}
+
+bool SharedMemoryReader::getLatestPose(shm::PoseData& poseOut) const
+{
+    // If the writer laps the ring while we copy, the seqlock read fails and we retry with the new latest pose.
+    for(int i = 0; i < 100; i++)
+    {
+        uint64_t numPoses = segment->header.numPoses.load(std::memory_order_acquire);
+        if(numPoses == 0) return false;
+        if(shm::seqlockRead(segment->poses[(numPoses - 1) % shm::numPoseSlots], poseOut, 1)) return true;
+    }
+    return false;
+}
+
+bool SharedMemoryReader::getStatus(shm::StatusData& statusOut) const
+{
+    return shm::seqlockRead(segment->status, statusOut);
+}
+
+bool SharedMemoryReader::getKeyframe(int slot, shm::KeyframeData& keyframeOut) const
+{
+    if(slot < 0 || slot >= shm::numKeyframeSlots) return false;
+    return shm::seqlockRead(segment->keyframes[slot], keyframeOut);
+}
+
+uint64_t SharedMemoryReader::getNumPoses() const
+{
+    return segment->header.numPoses.load(std::memory_order_acquire);
+}
+
+uint64_t SharedMemoryReader::getNumKeyframeUpdates() const
+{
+    return segment->header.numKeyframeUpdates.load(std::memory_order_acquire);
+}
+
+uint64_t SharedMemoryReader::getNumResets() const
+{
+    return segment->header.numResets.load(std::memory_order_acquire);
+}
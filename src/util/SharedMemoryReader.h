@@ -0,0 +1,62 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DMVIO_SHAREDMEMORYREADER_H
+#define DMVIO_SHAREDMEMORYREADER_H
+
+#include <string>
+#include "SharedMemoryLayout.h"
+
+namespace dmvio
+{
+
+// Reads the output of SharedMemoryOutputWrapper from another process. All methods are wait-free for the writer and
+// only copy the requested block. Not thread-safe.
+class SharedMemoryReader
+{
+public:
+    // name is the shared memory name passed to the writer (e.g. "/dmvio"). Throws std::runtime_error if the segment
+    // does not exist or has an incompatible version.
+    explicit SharedMemoryReader(const std::string& name);
+    ~SharedMemoryReader();
+
+    SharedMemoryReader(const SharedMemoryReader&) = delete;
+    SharedMemoryReader& operator=(const SharedMemoryReader&) = delete;
+
+    // Each method returns false if the data is not available (yet).
+    bool getLatestPose(shm::PoseData& poseOut) const;
+    bool getStatus(shm::StatusData& statusOut) const;
+    // slot in [0, shm::numKeyframeSlots). Note that KeyframeData is large, better reuse the object.
+    bool getKeyframe(int slot, shm::KeyframeData& keyframeOut) const;
+
+    // Can be polled to find out if there are new poses / keyframes.
+    uint64_t getNumPoses() const;
+    uint64_t getNumKeyframeUpdates() const;
+    uint64_t getNumResets() const;
+
+private:
+    const shm::Segment* segment = nullptr;
+};
+
+}
+
+#endif //DMVIO_SHAREDMEMORYREADER_H
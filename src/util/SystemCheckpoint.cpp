@@ -0,0 +1,259 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SystemCheckpoint.h"
+#include "TimeMeasurement.h"
+#include "ThreadTopology.h"
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/array.hpp>
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace boost
+{
+namespace serialization
+{
+
+template<class Archive, typename Scalar, int Rows, int Cols, int Options, int MaxRows, int MaxCols>
+void save(Archive& ar, const Eigen::Matrix<Scalar, Rows, Cols, Options, MaxRows, MaxCols>& m, unsigned int)
+{
+    Eigen::Index rows = m.rows(), cols = m.cols();
+    ar & rows & cols;
+    ar & make_array(m.data(), m.size());
+}
+
+template<class Archive, typename Scalar, int Rows, int Cols, int Options, int MaxRows, int MaxCols>
+void load(Archive& ar, Eigen::Matrix<Scalar, Rows, Cols, Options, MaxRows, MaxCols>& m, unsigned int)
+{
+    Eigen::Index rows, cols;
+    ar & rows & cols;
+    m.resize(rows, cols);
+    ar & make_array(m.data(), m.size());
+}
+
+template<class Archive, typename Scalar, int Rows, int Cols, int Options, int MaxRows, int MaxCols>
+void serialize(Archive& ar, Eigen::Matrix<Scalar, Rows, Cols, Options, MaxRows, MaxCols>& m, unsigned int version)
+{
+    split_free(ar, m, version);
+}
+
+template<class Archive> void serialize(Archive& ar, dmvio::ResidualCheckpoint& r, unsigned int)
+{
+    ar & r.targetIndex & r.state & r.energy & r.isNew;
+}
+
+template<class Archive> void serialize(Archive& ar, dmvio::PointCheckpoint& p, unsigned int)
+{
+    ar & p.u & p.v & p.type & p.idepth & p.idepthZero & p.maxRelBaseline & p.numGoodResiduals & p.hasDepthPrior;
+    ar & p.residuals & p.lastResidualIndex & p.lastResidualState;
+}
+
+template<class Archive> void serialize(Archive& ar, dmvio::ImmaturePointCheckpoint& p, unsigned int)
+{
+    ar & p.u & p.v & p.type & p.idepthMin & p.idepthMax & p.quality & p.lastTraceStatus & p.lastTraceUV;
+    ar & p.lastTracePixelInterval;
+}
+
+template<class Archive> void serialize(Archive& ar, dmvio::KeyframeCheckpoint& k, unsigned int)
+{
+    ar & k.id & k.incomingId & k.frameId & k.timestamp & k.abExposure & k.frameEnergyTH;
+    ar & k.camToWorld & k.worldToCamEvalPT & k.stateZero & k.state;
+    ar & k.image & k.points & k.immaturePoints;
+}
+
+template<class Archive> void serialize(Archive& ar, dmvio::ValueCheckpoint& v, unsigned int)
+{
+    ar & v.key & v.data;
+}
+
+template<class Archive> void serialize(Archive& ar, dmvio::LinearFactorCheckpoint& f, unsigned int)
+{
+    ar & f.keys & f.dims & f.augmentedHessian & f.linearizationPoint;
+}
+
+template<class Archive> void serialize(Archive& ar, dmvio::BACheckpoint& b, unsigned int)
+{
+    ar & b.currBATimestamp & b.values & b.evalValues & b.fejValues & b.graphFactor;
+}
+
+template<class Archive> void serialize(Archive& ar, dmvio::IMUCheckpoint& i, unsigned int)
+{
+    ar & i.firstFrameId & i.noIMUInOrderingUntilKFId & i.previousKeyframeId & i.firstBATimestamp & i.scaleFixed;
+    ar & i.optimizeScale & i.optimizeGravity & i.optimizeIMUExtrinsics & i.optimizeTransform;
+    ar & i.factorForCoarseGraph;
+}
+
+template<class Archive> void serialize(Archive& ar, dmvio::SystemCheckpoint& c, unsigned int)
+{
+    ar & c.width & c.height & c.calib & c.calibZero & c.firstPose;
+    ar & c.numFramesTotal & c.numKeyframesTotal & c.keyframes;
+    ar & c.HM & c.HMForGTSAM & c.bM & c.bMForGTSAM;
+    ar & c.hasIMU & c.ba & c.imu;
+}
+
+}
+}
+
+namespace
+{
+// fsync of a file or directory.
+bool syncToDisk(const std::string& path, int flags)
+{
+    int fd = open(path.c_str(), flags);
+    if(fd < 0) return false;
+    bool success = fsync(fd) == 0;
+    close(fd);
+    return success;
+}
+}
+
+bool dmvio::saveCheckpoint(const SystemCheckpoint& checkpoint, const std::string& filename)
+{
+    dmvio::TimeMeasurement timeMeasurement("saveCheckpoint");
+    std::string tmpFilename = filename + ".tmp";
+    try
+    {
+        {
+            std::ofstream stream(tmpFilename, std::ios::binary | std::ios::trunc);
+            if(!stream)
+            {
+                throw std::runtime_error("Cannot open file.");
+            }
+            {
+                boost::archive::binary_oarchive archive(stream);
+                archive << checkpoint.version;
+                archive << checkpoint;
+            }
+            // The archive flushes when destroyed, but does not report errors (e.g. full disk).
+            stream.flush();
+            if(!stream.good())
+            {
+                throw std::runtime_error("Writing failed.");
+            }
+        }
+        // Make sure the data is on disk before the rename can replace the last checkpoint.
+        if(!syncToDisk(tmpFilename, O_RDONLY))
+        {
+            throw std::runtime_error("Cannot sync file.");
+        }
+    }catch(const std::exception& e)
+    {
+        std::cerr << "ERROR: Cannot write checkpoint file " << tmpFilename << ": " << e.what() << std::endl;
+        std::remove(tmpFilename.c_str());
+        return false;
+    }
+
+    if(std::rename(tmpFilename.c_str(), filename.c_str()) != 0)
+    {
+        std::cerr << "ERROR: Cannot move checkpoint to " << filename << std::endl;
+        std::remove(tmpFilename.c_str());
+        return false;
+    }
+    // Persist the rename.
+    size_t slash = filename.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : filename.substr(0, std::max<size_t>(slash, 1));
+    if(!syncToDisk(directory, O_RDONLY | O_DIRECTORY))
+    {
+        std::cerr << "WARNING: Cannot sync directory " << directory << " of checkpoint." << std::endl;
+    }
+    return true;
+}
+
+std::unique_ptr<dmvio::SystemCheckpoint> dmvio::loadCheckpoint(const std::string& filename)
+{
+    std::ifstream stream(filename, std::ios::binary);
+    if(!stream)
+    {
+        throw std::runtime_error("Cannot open checkpoint file " + filename);
+    }
+    boost::archive::binary_iarchive archive(stream);
+    std::unique_ptr<SystemCheckpoint> checkpoint = std::make_unique<SystemCheckpoint>();
+    archive >> checkpoint->version;
+    if(checkpoint->version != SystemCheckpoint::currentVersion)
+    {
+        throw std::runtime_error("Checkpoint " + filename + " has incompatible version.");
+    }
+    archive >> *checkpoint;
+    return checkpoint;
+}
+
+dmvio::CheckpointWriter::CheckpointWriter(std::string filename)
+        : filename(std::move(filename))
+{
+    writeThread = std::thread{&CheckpointWriter::writeWorker, this};
+}
+
+dmvio::CheckpointWriter::~CheckpointWriter()
+{
+    end();
+}
+
+void dmvio::CheckpointWriter::addCheckpoint(std::unique_ptr<SystemCheckpoint> checkpoint)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if(pending)
+        {
+            std::cout << "Checkpoint writer is behind, skipping checkpoint." << std::endl;
+        }
+        pending = std::move(checkpoint);
+    }
+    checkpointArrivedCond.notify_all();
+}
+
+void dmvio::CheckpointWriter::writeWorker()
+{
+    ThreadTopology::applyToCurrentThread(THREAD_OUTPUT);
+    while(true)
+    {
+        std::unique_ptr<SystemCheckpoint> checkpoint;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while(!pending)
+            {
+                if(!running) return;
+                checkpointArrivedCond.wait(lock);
+            }
+            checkpoint = std::move(pending);
+        }
+        saveCheckpoint(*checkpoint, filename);
+    }
+}
+
+void dmvio::CheckpointWriter::end()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        running = false;
+    }
+    checkpointArrivedCond.notify_all();
+    if(writeThread.joinable())
+    {
+        writeThread.join();
+    }
+}
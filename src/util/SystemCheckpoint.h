@@ -0,0 +1,187 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DMVIO_SYSTEMCHECKPOINT_H
+#define DMVIO_SYSTEMCHECKPOINT_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <cstdint>
+#include <Eigen/Core>
+
+// Plain data describing the active window of the system, so that it can be written to disk and later restored
+// (crash recovery / warm restart). Filled by FullSystem::createCheckpoint and consumed by
+// FullSystem::restoreFromCheckpoint. Kept independent of DSO and GTSAM types.
+namespace dmvio
+{
+
+struct ResidualCheckpoint
+{
+    int targetIndex = -1; // Index of the target keyframe in SystemCheckpoint::keyframes.
+    int state = 0; // dso::ResState
+    double energy = 0.0;
+    bool isNew = false;
+};
+
+struct PointCheckpoint
+{
+    int u = 0, v = 0;
+    float type = 0;
+    float idepth = 0, idepthZero = 0;
+    float maxRelBaseline = 0;
+    int numGoodResiduals = 0;
+    bool hasDepthPrior = false;
+    std::vector<ResidualCheckpoint> residuals;
+    // dso::PointHessian::lastResiduals as index into residuals (or -1) and residual state.
+    int lastResidualIndex[2] = {-1, -1};
+    int lastResidualState[2] = {0, 0};
+};
+
+struct ImmaturePointCheckpoint
+{
+    int u = 0, v = 0;
+    float type = 0;
+    float idepthMin = 0, idepthMax = 0;
+    float quality = 0;
+    int lastTraceStatus = 0;
+    Eigen::Vector2f lastTraceUV = Eigen::Vector2f::Zero();
+    float lastTracePixelInterval = 0;
+};
+
+struct KeyframeCheckpoint
+{
+    int id = -1; // FrameShell::id
+    int incomingId = -1;
+    int frameId = -1; // FrameHessian::frameID (keyframe counter).
+    double timestamp = 0.0;
+    float abExposure = 0, frameEnergyTH = 0;
+    Eigen::Matrix4d camToWorld = Eigen::Matrix4d::Identity();
+    Eigen::Matrix4d worldToCamEvalPT = Eigen::Matrix4d::Identity();
+    Eigen::Matrix<double, 10, 1> stateZero = Eigen::Matrix<double, 10, 1>::Zero();
+    Eigen::Matrix<double, 10, 1> state = Eigen::Matrix<double, 10, 1>::Zero();
+    std::vector<float> image; // Photometrically corrected level 0 intensities.
+    std::vector<PointCheckpoint> points;
+    std::vector<ImmaturePointCheckpoint> immaturePoints;
+};
+
+// A gtsam::Value stored as flat vector, its type is defined by the character of the key symbol.
+struct ValueCheckpoint
+{
+    std::uint64_t key = 0;
+    std::vector<double> data;
+};
+
+// A linear factor in information form: augmented Hessian [H, -b; -b^T, f] for the keys with the given dimensions,
+// together with its linearization point.
+struct LinearFactorCheckpoint
+{
+    std::vector<std::uint64_t> keys;
+    std::vector<int> dims;
+    Eigen::MatrixXd augmentedHessian;
+    std::vector<ValueCheckpoint> linearizationPoint;
+
+    bool empty() const
+    { return keys.empty(); }
+};
+
+// State of BAGTSAMIntegration. The GTSAM main graph is stored linearized as a single factor.
+struct BACheckpoint
+{
+    double currBATimestamp = -1;
+    std::vector<ValueCheckpoint> values, evalValues, fejValues;
+    LinearFactorCheckpoint graphFactor;
+};
+
+// State of the BAIMULogic.
+struct IMUCheckpoint
+{
+    int firstFrameId = -1;
+    int noIMUInOrderingUntilKFId = -1;
+    int previousKeyframeId = -1;
+    double firstBATimestamp = -1;
+    bool scaleFixed = false;
+    bool optimizeScale = false, optimizeGravity = false, optimizeIMUExtrinsics = false, optimizeTransform = false;
+    LinearFactorCheckpoint factorForCoarseGraph;
+};
+
+struct SystemCheckpoint
+{
+    static constexpr int currentVersion = 1;
+    int version = currentVersion;
+
+    int width = 0, height = 0;
+    Eigen::Vector4d calib = Eigen::Vector4d::Zero(), calibZero = Eigen::Vector4d::Zero();
+    Eigen::Matrix4d firstPose = Eigen::Matrix4d::Identity();
+
+    int numFramesTotal = 0; // Size of allFrameHistory.
+    int numKeyframesTotal = 0; // Size of allKeyFramesHistory.
+    std::vector<KeyframeCheckpoint> keyframes; // Ordered like the active window.
+
+    // Marginalization priors of the EnergyFunctional.
+    Eigen::MatrixXd HM, HMForGTSAM;
+    Eigen::VectorXd bM, bMForGTSAM;
+
+    bool hasIMU = false;
+    BACheckpoint ba;
+    IMUCheckpoint imu;
+};
+
+// Writes to a temporary file first, syncs it to disk and renames it, so that a crash or power loss during writing never
+// corrupts the last checkpoint. Errors (e.g. full disk) are printed and return false, the temporary file is removed.
+bool saveCheckpoint(const SystemCheckpoint& checkpoint, const std::string& filename);
+
+// Throws std::runtime_error if the file cannot be read or has an incompatible version.
+std::unique_ptr<SystemCheckpoint> loadCheckpoint(const std::string& filename);
+
+// Writes checkpoints in a separate thread. If a new checkpoint arrives while the previous one is still pending, the
+// pending one is replaced, so the mapping thread never waits for the disk.
+class CheckpointWriter
+{
+public:
+    explicit CheckpointWriter(std::string filename);
+    ~CheckpointWriter();
+
+    void addCheckpoint(std::unique_ptr<SystemCheckpoint> checkpoint);
+
+    // Writes the pending checkpoint (if any) and stops the thread.
+    void end();
+
+private:
+    void writeWorker();
+
+    std::string filename;
+    std::thread writeThread;
+
+    // protects pending and running.
+    std::mutex mutex;
+    std::condition_variable checkpointArrivedCond;
+    std::unique_ptr<SystemCheckpoint> pending;
+    bool running = true;
+};
+
+}
+
+#endif //DMVIO_SYSTEMCHECKPOINT_H
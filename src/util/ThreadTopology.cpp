@@ -0,0 +1,221 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ThreadTopology.h"
+#include "SettingsUtil.h"
+#include <sstream>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+using namespace dmvio;
+
+namespace
+{
+const char* roleNames[NUM_THREAD_ROLES] = {"Tracking", "Mapping", "Reduce", "Viewer", "ImageSave", "IMUInit", "Output"};
+
+// Parses e.g. "0-3,6". Returns false if the string is malformed.
+bool parseCores(const std::string& string, std::vector<int>& cores)
+{
+    std::stringstream stream(string);
+    std::string part;
+    while(std::getline(stream, part, ','))
+    {
+        if(part.empty()) continue;
+        size_t dash = part.find('-');
+        try
+        {
+            int first = std::stoi(part.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(part.substr(dash + 1));
+            if(first < 0 || last < first || last >= CPU_SETSIZE) return false;
+            for(int i = first; i <= last; i++)
+            {
+                cores.push_back(i);
+            }
+        }catch(const std::exception&)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string formatCores(const cpu_set_t& set)
+{
+    std::stringstream stream;
+    bool firstRange = true;
+    for(int i = 0; i < CPU_SETSIZE; i++)
+    {
+        if(!CPU_ISSET(i, &set)) continue;
+        int last = i;
+        while(last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &set)) last++;
+        if(!firstRange) stream << ',';
+        stream << i;
+        if(last > i) stream << '-' << last;
+        firstRange = false;
+        i = last;
+    }
+    return stream.str();
+}
+}
+
+std::mutex ThreadTopology::mutex;
+ThreadTopologySettings ThreadTopology::settings;
+ThreadTopology::RoleStatus ThreadTopology::status[NUM_THREAD_ROLES];
+
+void ThreadRoleSettings::registerArgs(SettingsUtil& set, std::string prefix)
+{
+    set.registerArg(prefix + "Cores", cores);
+    set.registerArg(prefix + "Nice", nice);
+    set.registerArg(prefix + "RealtimePriority", realtimePriority);
+}
+
+void ThreadTopologySettings::registerArgs(SettingsUtil& set)
+{
+    for(int i = 0; i < NUM_THREAD_ROLES; i++)
+    {
+        roles[i].registerArgs(set, std::string("threads") + roleNames[i]);
+    }
+    set.registerArg("threadsReducePoolSize", reducePoolSize);
+}
+
+void ThreadTopology::configure(const ThreadTopologySettings& settingsPassed)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    settings = settingsPassed;
+}
+
+void ThreadTopology::applyToCurrentThread(ThreadRole role)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    const ThreadRoleSettings& roleSettings = settings.roles[role];
+    RoleStatus& roleStatus = status[role];
+    roleStatus.numThreads++;
+
+    std::string error;
+    std::vector<int> cores;
+    if(!parseCores(roleSettings.cores, cores))
+    {
+        error += " invalid core list '" + roleSettings.cores + "'.";
+    }
+    if(!cores.empty())
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for(int core : cores) CPU_SET(core, &set);
+        if(pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+        {
+            error += " cannot set affinity.";
+        }
+    }
+    if(roleSettings.realtimePriority > 0)
+    {
+        sched_param param{};
+        param.sched_priority = roleSettings.realtimePriority;
+        if(pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+        {
+            error += " cannot set realtime priority.";
+        }
+    }else if(roleSettings.nice != 0)
+    {
+        // On Linux the nice value is per thread.
+        if(setpriority(PRIO_PROCESS, syscall(SYS_gettid), roleSettings.nice) != 0)
+        {
+            error += " cannot set nice value.";
+        }
+    }
+
+    // Read back the effective placement.
+    cpu_set_t effective;
+    CPU_ZERO(&effective);
+    pthread_getaffinity_np(pthread_self(), sizeof(effective), &effective);
+    roleStatus.effectiveCores = formatCores(effective);
+    int policy;
+    sched_param param{};
+    pthread_getschedparam(pthread_self(), &policy, &param);
+    if(policy == SCHED_FIFO || policy == SCHED_RR)
+    {
+        roleStatus.effectiveScheduling = "realtime priority " + std::to_string(param.sched_priority);
+    }else
+    {
+        roleStatus.effectiveScheduling = "nice " + std::to_string(getpriority(PRIO_PROCESS, syscall(SYS_gettid)));
+    }
+
+    if(!error.empty())
+    {
+        roleStatus.numFailures++;
+        std::cerr << "WARNING: ThreadTopology, " << roleNames[role] << " thread:" << error << std::endl;
+    }
+}
+
+int ThreadTopology::getReducePoolSize(int maxSize)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if(settings.reducePoolSize <= 0 || settings.reducePoolSize > maxSize) return maxSize;
+    return settings.reducePoolSize;
+}
+
+const char* ThreadTopology::getRoleName(ThreadRole role)
+{
+    return roleNames[role];
+}
+
+void ThreadTopology::printReport(std::ostream& stream)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    stream << "Thread placement (" << sysconf(_SC_NPROCESSORS_ONLN) << " cores online):\n";
+    for(int i = 0; i < NUM_THREAD_ROLES; i++)
+    {
+        const ThreadRoleSettings& roleSettings = settings.roles[i];
+        const RoleStatus& roleStatus = status[i];
+        stream << "  " << roleNames[i] << ": configured cores "
+               << (roleSettings.cores.empty() ? std::string("all") : roleSettings.cores) << ", ";
+        if(roleSettings.realtimePriority > 0)
+        {
+            stream << "realtime priority " << roleSettings.realtimePriority;
+        }else
+        {
+            stream << "nice " << roleSettings.nice;
+        }
+        if(i == THREAD_REDUCE)
+        {
+            stream << ", pool size " << (settings.reducePoolSize > 0 ? std::to_string(settings.reducePoolSize)
+                                                                     : std::string("default"));
+        }
+        if(roleStatus.numThreads == 0)
+        {
+            stream << " -> not started yet\n";
+        }else
+        {
+            stream << " -> " << roleStatus.numThreads << " thread(s) on cores " << roleStatus.effectiveCores << ", "
+                   << roleStatus.effectiveScheduling;
+            if(roleStatus.numFailures > 0)
+            {
+                stream << " (" << roleStatus.numFailures << " failed)";
+            }
+            stream << "\n";
+        }
+    }
+    stream.flush();
+}
@@ -0,0 +1,111 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DMVIO_THREADTOPOLOGY_H
+#define DMVIO_THREADTOPOLOGY_H
+
+#include <string>
+#include <mutex>
+#include <vector>
+#include <iostream>
+
+namespace dmvio
+{
+class SettingsUtil;
+
+enum ThreadRole
+{
+    THREAD_TRACKING = 0, // Thread calling FullSystem::addActiveFrame.
+    THREAD_MAPPING, // FullSystem::mappingThread.
+    THREAD_REDUCE, // Workers of IndexThreadReduce.
+    THREAD_VIEWER, // Pangolin viewer.
+    THREAD_IMAGE_SAVE, // DatasetSaver.
+    THREAD_IMU_INIT, // Realtime IMU initializer threads.
+    THREAD_OUTPUT, // AsyncOutputWrapper and CheckpointWriter.
+    NUM_THREAD_ROLES
+};
+
+// Placement of all threads of one role.
+class ThreadRoleSettings
+{
+public:
+    void registerArgs(dmvio::SettingsUtil& set, std::string prefix);
+
+    // Comma separated cores or core ranges, e.g. "0-3,6". Empty means no restriction.
+    std::string cores = "";
+    // Nice value of the threads (lower means higher priority). Negative values require CAP_SYS_NICE.
+    // 0 keeps the value inherited from the creating thread.
+    int nice = 0;
+    // If > 0 the threads are scheduled with SCHED_FIFO and this priority (1-99) instead. Requires CAP_SYS_NICE.
+    int realtimePriority = 0;
+};
+
+// Settings are called e.g. threadsTrackingCores, threadsMappingNice, threadsReduceRealtimePriority, so they can be set
+// in the settings yaml file like all other settings.
+class ThreadTopologySettings
+{
+public:
+    void registerArgs(dmvio::SettingsUtil& set);
+
+    ThreadRoleSettings roles[NUM_THREAD_ROLES];
+    // Number of workers of each IndexThreadReduce (the FullSystem has one for mapping and one for tracking).
+    // 0 or values larger than NUM_THREADS mean NUM_THREADS.
+    int reducePoolSize = 0;
+};
+
+// Applies the ThreadTopologySettings to the threads of the system. Each thread calls applyToCurrentThread with its
+// role when it starts. Thread-safe.
+class ThreadTopology
+{
+public:
+    // Should be called before the FullSystem is created, threads started earlier keep their placement.
+    static void configure(const ThreadTopologySettings& settings);
+
+    // Sets affinity and priority of the calling thread according to its role and records the result for printReport.
+    // Failures (e.g. missing permissions) are printed but not fatal.
+    static void applyToCurrentThread(ThreadRole role);
+
+    // Number of workers that an IndexThreadReduce should start.
+    static int getReducePoolSize(int maxSize);
+
+    // Prints the configured and the effective placement of the threads started so far.
+    static void printReport(std::ostream& stream);
+
+    static const char* getRoleName(ThreadRole role);
+
+private:
+    struct RoleStatus
+    {
+        int numThreads = 0;
+        int numFailures = 0;
+        std::string effectiveCores; // Read back from the last thread of this role.
+        std::string effectiveScheduling;
+    };
+
+    static std::mutex mutex;
+    static ThreadTopologySettings settings;
+    static RoleStatus status[NUM_THREAD_ROLES];
+};
+
+}
+
+#endif //DMVIO_THREADTOPOLOGY_H
@@ -70,6 +70,11 @@ void dmvio::TimeMeasurement::saveResults(std::string filename)
     saveFile.close();
 }
 
+void dmvio::TimeMeasurement::addMeasurement(std::string name, double duration)
+{
+    logs[name].addMeasurement(duration);
+}
+
 void dmvio::TimeMeasurement::cancel()
 {
     ended = true;
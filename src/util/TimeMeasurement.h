@@ -76,6 +76,9 @@ public:
 
     static void saveResults(std::string filename);
 
+    // Add a duration (in seconds) which was not measured with an instance, e.g. an estimated saving.
+    static void addMeasurement(std::string name, double duration);
+
 private:
     static bool saveFileOpen;
     static std::ofstream saveFile;
@@ -0,0 +1,135 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "util/AsyncOutputWrapper.h"
+#include "util/FrameShell.h"
+
+using namespace dmvio;
+
+namespace
+{
+// Records the delivered snapshots. The first delivery blocks until release is called, so that the queue fills up.
+class BlockedConsumer : public OutputSnapshotConsumer
+{
+public:
+    void consumeCamPose(const CamPoseSnapshot& pose) override
+    {
+        record("pose" + std::to_string(pose.id));
+    }
+
+    void consumeSystemStatus(SystemStatus systemStatus) override
+    {
+        record("status");
+    }
+
+    void waitUntilBlocked()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this]() { return blocked; });
+    }
+
+    void release()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            released = true;
+        }
+        cond.notify_all();
+    }
+
+    std::vector<std::string> delivered;
+
+private:
+    void record(const std::string& name)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        delivered.push_back(name);
+        blocked = true;
+        cond.notify_all();
+        cond.wait(lock, [this]() { return released; });
+    }
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool blocked = false, released = false;
+};
+
+// Publishes pose 0 (which blocks the consumer), then poses 1-5, the system status (never dropped) and pose 6 into a
+// queue of size 3. Returns the delivered snapshots in order.
+std::vector<std::string> runOverflow(AsyncOutputSettings::DropPolicy policy, AsyncOutputStatistics& statistics)
+{
+    AsyncOutputSettings settings;
+    settings.queueSize = 3;
+    settings.dropPolicy = policy;
+    BlockedConsumer consumer;
+    AsyncOutputWrapper wrapper(&consumer, settings);
+
+    dso::FrameShell shell;
+    auto publishPose = [&](int id)
+    {
+        shell.id = id;
+        wrapper.publishCamPose(&shell, nullptr);
+    };
+    publishPose(0);
+    consumer.waitUntilBlocked();
+    for(int id = 1; id <= 5; id++) publishPose(id);
+    wrapper.publishSystemStatus(VISUAL_INERTIAL);
+    publishPose(6);
+
+    consumer.release();
+    wrapper.join(); // Delivers the remaining queue.
+    statistics = wrapper.getStatistics();
+    return consumer.delivered;
+}
+}
+
+TEST(AsyncOutputWrapperTest, DropOldestOnOverflow)
+{
+    AsyncOutputStatistics statistics;
+    std::vector<std::string> delivered = runOverflow(AsyncOutputSettings::DROP_OLDEST, statistics);
+    // Each snapshot pushed into the full queue replaces the oldest pose in it.
+    std::vector<std::string> expected{"pose0", "pose5", "status", "pose6"};
+    EXPECT_EQ(delivered, expected);
+    EXPECT_EQ(statistics.numQueued, 8);
+    EXPECT_EQ(statistics.numDropped, 4);
+    EXPECT_EQ(statistics.numDelivered, (long) delivered.size());
+    EXPECT_EQ(statistics.numQueued, statistics.numDelivered + statistics.numDropped);
+}
+
+TEST(AsyncOutputWrapperTest, DropNewestOnOverflow)
+{
+    AsyncOutputStatistics statistics;
+    std::vector<std::string> delivered = runOverflow(AsyncOutputSettings::DROP_NEWEST, statistics);
+    // Poses arriving at the full queue are discarded. The status is not droppable, it replaces the oldest pose.
+    std::vector<std::string> expected{"pose0", "pose2", "pose3", "status"};
+    EXPECT_EQ(delivered, expected);
+    EXPECT_EQ(statistics.numQueued, 5); // Poses 4, 5 and 6 are never queued.
+    EXPECT_EQ(statistics.numDropped, 4);
+    EXPECT_EQ(statistics.numDelivered, (long) delivered.size());
+    // Every published snapshot is either delivered or dropped.
+    EXPECT_EQ(statistics.numDelivered + statistics.numDropped, 8);
+}
@@ -0,0 +1,149 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <gtsam/nonlinear/LinearContainerFactor.h>
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/slam/PriorFactor.h>
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/linear/HessianFactor.h>
+#include "GTSAMIntegration/AugmentedScatter.hpp"
+
+using namespace gtsam;
+using namespace dmvio;
+using symbol_shorthand::P;
+
+// Graph resembling a large delayed graph: a chain of relative pose factors and dense priors connecting many poses
+// (like the marginalization priors).
+void buildLargeGraph(int numPoses, NonlinearFactorGraph& graph, Values& values)
+{
+    auto noise = noiseModel::Isotropic::Sigma(6, 0.1);
+    for(int i = 0; i < numPoses; i++)
+    {
+        values.insert(P(i), Pose3(Rot3::Ypr(0.01 * i, 0.02, -0.01 * i), Point3(0.5 * i, 0.1 * i, 0.0)));
+    }
+    graph.emplace_shared<PriorFactor<Pose3>>(P(0), values.at<Pose3>(P(0)), noise);
+    for(int i = 0; i + 1 < numPoses; i++)
+    {
+        Pose3 between(Rot3::Ypr(0.011, 0.0, -0.009), Point3(0.48, 0.11, 0.01));
+        graph.emplace_shared<BetweenFactor<Pose3>>(P(i), P(i + 1), between, noise);
+    }
+    const int priorSize = 10;
+    for(int start = 0; start + priorSize <= numPoses; start += priorSize / 2)
+    {
+        KeyVector keys;
+        for(int i = start; i < start + priorSize; i++) keys.push_back(P(i));
+        // Augmented information matrix [H b; b^T f].
+        Matrix A = Matrix::Random(6 * priorSize + 1, 6 * priorSize + 1);
+        std::vector<size_t> dims(priorSize, 6);
+        SymmetricBlockMatrix augmented(dims, true);
+        augmented.setFullMatrix(A.transpose() * A);
+        graph.emplace_shared<LinearContainerFactor>(HessianFactor(keys, augmented), values);
+    }
+}
+
+TEST(AugmentedScatterTest, MultiThreadedEqualsSingleThreaded)
+{
+    NonlinearFactorGraph graph;
+    Values values;
+    buildLargeGraph(300, graph, values);
+
+    dso::IndexThreadReduce<dso::Vec10> red;
+    Ordering ordering;
+    std::map<Key, size_t> keyDimMap;
+
+    GaussianFactorGraph::shared_ptr gfg = graph.linearize(values);
+    AugmentedScatter scatter(*gfg, ordering, keyDimMap);
+    Matrix expected = scatter.computeAugmentedHessian(*gfg);
+
+    GaussianFactorGraph::shared_ptr gfgMT = linearizeMT(graph, values, &red);
+    AugmentedScatter scatterMT(*gfgMT, ordering, keyDimMap);
+    Matrix actual = scatterMT.computeAugmentedHessianMT(*gfgMT, &red);
+
+    ASSERT_EQ(expected.rows(), actual.rows());
+    EXPECT_LT((expected - actual).cwiseAbs().maxCoeff(), 1e-8 * expected.cwiseAbs().maxCoeff());
+}
+
+// Graphs just below and exactly at the threshold for multi-threading (minFactorsMT = 50 in AugmentedScatter.cpp).
+// They contain null factors (like the graphs after removing factors) and the scatter has an ordering with a key that
+// is not in the graph, so it is only known from keyDimMap.
+TEST(AugmentedScatterTest, ThresholdWithNullFactorsAndOrdering)
+{
+    for(size_t numFactors : {49, 50})
+    {
+        SCOPED_TRACE(numFactors);
+        NonlinearFactorGraph chain;
+        Values values;
+        buildLargeGraph(20, chain, values);
+
+        // Interleave null factors until the graph has the requested size.
+        NonlinearFactorGraph graph;
+        size_t numNull = numFactors - chain.size();
+        for(auto&& factor : chain)
+        {
+            graph.push_back(factor);
+            if(numNull > 0)
+            {
+                graph.push_back(NonlinearFactor::shared_ptr());
+                numNull--;
+            }
+        }
+        for(; numNull > 0; numNull--) graph.push_back(NonlinearFactor::shared_ptr());
+        ASSERT_EQ(graph.size(), numFactors);
+        ASSERT_EQ(graph.nrFactors(), chain.size());
+
+        // Ordering with the poses in reverse, starting with an additional key that has no factors.
+        Key unusedKey = P(1000);
+        Ordering ordering;
+        ordering.push_back(unusedKey);
+        for(int i = 19; i >= 0; i--) ordering.push_back(P(i));
+        std::map<Key, size_t> keyDimMap;
+        keyDimMap[unusedKey] = 6;
+        for(int i = 0; i < 20; i++) keyDimMap[P(i)] = 6;
+
+        dso::IndexThreadReduce<dso::Vec10> red;
+        GaussianFactorGraph::shared_ptr gfg = graph.linearize(values);
+        GaussianFactorGraph::shared_ptr gfgMT = linearizeMT(graph, values, &red);
+        ASSERT_EQ(gfgMT->size(), numFactors);
+        for(size_t i = 0; i < numFactors; i++)
+        {
+            EXPECT_EQ(!graph[i], !gfgMT->at(i)) << "factor " << i;
+        }
+
+        AugmentedScatter scatter(*gfg, ordering, keyDimMap);
+        AugmentedScatter scatterMT(*gfgMT, ordering, keyDimMap);
+        ASSERT_EQ(scatter.size(), 21u);
+        EXPECT_EQ(scatterMT.begin()->key, unusedKey);
+
+        auto expected = scatter.computeHessian(*gfg);
+        auto actual = scatterMT.computeHessianMT(*gfgMT, &red);
+        ASSERT_EQ(expected.first.rows(), 21 * 6);
+        ASSERT_EQ(actual.first.rows(), expected.first.rows());
+        double scale = expected.first.cwiseAbs().maxCoeff();
+        EXPECT_LT((expected.first - actual.first).cwiseAbs().maxCoeff(), 1e-8 * scale);
+        EXPECT_LT((expected.second - actual.second).cwiseAbs().maxCoeff(), 1e-8 * scale);
+        // The unused key is first in the ordering and has no information.
+        EXPECT_EQ(actual.first.topRows(6).cwiseAbs().maxCoeff(), 0.0);
+        EXPECT_EQ(actual.second.head(6).cwiseAbs().maxCoeff(), 0.0);
+    }
+}
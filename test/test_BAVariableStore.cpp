@@ -0,0 +1,168 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/linear/VectorValues.h>
+#include "GTSAMIntegration/BAVariableStore.h"
+#include "GTSAMIntegration/PoseTransformation.h"
+#include "GTSAMIntegration/PoseTransformationIMU.h"
+
+using namespace dmvio;
+using gtsam::Symbol;
+
+namespace
+{
+// BA window like the one of BAGTSAMIntegration: calibration followed by pose and affine brightness of each frame.
+class BAWindowTest : public ::testing::Test
+{
+protected:
+    const int numCPARS = 4;
+    const int numFrames = 7;
+    gtsam::Ordering ordering;
+    std::map<gtsam::Key, size_t> keyDimMap;
+    gtsam::Values values;
+    std::vector<gtsam::Pose3> poses;
+
+    void SetUp() override
+    {
+        std::srand(11);
+        ordering.push_back(Symbol('c', 0));
+        keyDimMap[Symbol('c', 0)] = numCPARS;
+        values.insert(Symbol('c', 0), gtsam::Vector(gtsam::Vector4::Random()));
+        for(int i = 0; i < numFrames; i++)
+        {
+            // Frame ids in the window are not contiguous.
+            int id = 3 * i + 5;
+            ordering.push_back(Symbol('p', id));
+            ordering.push_back(Symbol('a', id));
+            keyDimMap[Symbol('p', id)] = 6;
+            keyDimMap[Symbol('a', id)] = 2;
+            poses.push_back(gtsam::Pose3::Expmap(gtsam::Vector6::Random()));
+            values.insert(Symbol('p', id), poses.back());
+            values.insert(Symbol('a', id), gtsam::Vector(gtsam::Vector2::Random()));
+        }
+    }
+
+    int dim() const
+    { return numCPARS + 8 * numFrames; }
+
+    // The Values-based conversion as it was before the blockwise overload: reorder rotation and translation, then
+    // multiply with the dense relative Jacobian.
+    std::pair<gtsam::Matrix, gtsam::Vector> convertWithValues(const dso::MatXX& HInput, const dso::VecX& bInput,
+                                                              PoseTransformation& transformation, double weight)
+    {
+        int n = dim();
+        gtsam::Matrix H = HInput;
+        gtsam::Vector b = bInput;
+        for(int i = 0; i < numFrames; ++i)
+        {
+            int id = numCPARS + 8 * i;
+            H.block(id, 0, 3, n) = HInput.block(id + 3, 0, 3, n);
+            H.block(id + 3, 0, 3, n) = HInput.block(id, 0, 3, n);
+            b.segment(id, 3) = bInput.segment(id + 3, 3);
+            b.segment(id + 3, 3) = bInput.segment(id, 3);
+        }
+        for(int i = 0; i < numFrames; ++i)
+        {
+            int id = numCPARS + 8 * i;
+            gtsam::Matrix tmp = H.block(0, id, n, 3);
+            H.block(0, id, n, 3) = H.block(0, id + 3, n, 3);
+            H.block(0, id + 3, n, 3) = tmp;
+        }
+        H *= weight;
+        b *= weight;
+        auto pair = convertHAndBWithPoseTransformation(std::make_pair(H, b), ordering, keyDimMap, values,
+                                                       transformation, DerivativeDirection::RIGHT_TO_LEFT);
+        pair.second = -pair.second;
+        return pair;
+    }
+
+    void expectSameConversion(PoseTransformation& transformation)
+    {
+        gtsam::Matrix A = gtsam::Matrix::Random(dim(), dim());
+        dso::MatXX H = A.transpose() * A;
+        dso::VecX b = dso::VecX::Random(dim());
+        const double weight = 0.7;
+
+        auto expected = convertWithValues(H, b, transformation, weight);
+        auto blockwise = convertHAndBFromDSO(H, b, transformation, weight, numCPARS, poses);
+        auto dispatched = convertHAndBFromDSO(H, b, transformation, weight, ordering, values, keyDimMap);
+
+        double scale = expected.first.cwiseAbs().maxCoeff();
+        ASSERT_EQ(blockwise.first.rows(), dim());
+        EXPECT_LT((blockwise.first - expected.first).cwiseAbs().maxCoeff(), 1e-9 * scale);
+        EXPECT_LT((blockwise.second - expected.second).cwiseAbs().maxCoeff(), 1e-9 * scale);
+        EXPECT_LT((dispatched.first - expected.first).cwiseAbs().maxCoeff(), 1e-9 * scale);
+        EXPECT_LT((dispatched.second - expected.second).cwiseAbs().maxCoeff(), 1e-9 * scale);
+    }
+};
+}
+
+TEST_F(BAWindowTest, BlockwiseConversionEqualsValuesConversion)
+{
+    {
+        SCOPED_TRACE("identity");
+        TransformIdentity identity;
+        expectSameConversion(identity);
+    }
+    {
+        SCOPED_TRACE("DSO to IMU without optimized variables");
+        gtsam::Pose3 T_cam_imu(gtsam::Rot3::Ypr(0.1, -0.2, 0.05), gtsam::Point3(0.05, -0.02, 0.01));
+        TransformDSOToIMU transform(T_cam_imu, std::make_shared<bool>(false), std::make_shared<bool>(false),
+                                    std::make_shared<bool>(false), true, 0);
+        transform.setScale(2.5);
+        ASSERT_TRUE(transform.getAllOptimizedSymbols().empty());
+        expectSameConversion(transform);
+    }
+}
+
+TEST_F(BAWindowTest, StoreRetractEqualsValuesRetract)
+{
+    BAVariableStore store;
+    store.setLayout(ordering, keyDimMap);
+    store.loadFrom(values);
+    ASSERT_EQ(store.getTotalDim(), dim());
+    for(int i = 0; i < numFrames; i++)
+    {
+        int index = store.find(Symbol('p', 3 * i + 5));
+        ASSERT_GE(index, 0);
+        EXPECT_TRUE(store.getPose(index).equals(poses[i]));
+    }
+
+    gtsam::Vector inc = 0.1 * gtsam::Vector::Random(dim());
+    gtsam::VectorValues incValues;
+    int offset = 0;
+    for(gtsam::Key key : ordering)
+    {
+        incValues.insert(key, inc.segment(offset, keyDimMap.at(key)));
+        offset += keyDimMap.at(key);
+    }
+    gtsam::Values expected = values.retract(incValues);
+
+    BAVariableStore retracted;
+    store.retract(inc, retracted);
+    gtsam::Values actual;
+    retracted.writeTo(actual);
+    EXPECT_TRUE(actual.equals(expected, 1e-9));
+}
@@ -0,0 +1,157 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <gtsam/inference/Symbol.h>
+#include "IMUInitialization/CoarseIMUInitOptimizer.h"
+#include "GTSAMIntegration/PoseTransformationIMU.h"
+#include "GTSAMIntegration/Sim3GTSAM.h"
+#include "IMU/IMUUtils.h"
+
+using namespace dmvio;
+using gtsam::symbol_shorthand::S, gtsam::symbol_shorthand::V;
+
+namespace
+{
+// Ground truth IMU trajectory in the metric world with constant angular velocity and a smooth translation.
+struct SimulatedTrajectory
+{
+    Eigen::Vector3d gravity{0, 0, -9.8082};
+    Eigen::Vector3d angularVelocity{0.3, -0.2, 0.5};
+
+    Sophus::SO3d rotation(double t) const
+    { return Sophus::SO3d::exp(angularVelocity * t); }
+
+    Eigen::Vector3d position(double t) const
+    { return Eigen::Vector3d(std::sin(t), 0.5 * std::cos(t), 0.2 * t); }
+
+    Eigen::Vector3d velocity(double t) const
+    { return Eigen::Vector3d(std::cos(t), -0.5 * std::sin(t), 0.2); }
+
+    Eigen::Vector3d acceleration(double t) const
+    { return Eigen::Vector3d(-std::sin(t), -0.5 * std::cos(t), 0.0); }
+
+    Eigen::Vector3d accData(double t) const
+    { return rotation(t).inverse() * (acceleration(t) - gravity); }
+};
+
+// Runs the CoarseIMUInitOptimizer on a noise free trajectory, where the DSO world is scaled by 1 / trueScale and
+// rotated by R_dsoW_metricW (without yaw, which is not observable).
+class CoarseIMUInitTest : public ::testing::Test
+{
+protected:
+    SimulatedTrajectory traj;
+    const double trueScale = 2.5;
+    const Eigen::Matrix3d R_dsoW_metricW =
+            Eigen::AngleAxisd(0.3, Eigen::Vector3d(1.0, 1.0, 0.0).normalized()).toRotationMatrix();
+    const Sophus::SE3d T_cam_imu{Sophus::SO3d::exp(Eigen::Vector3d(0.1, -0.05, 0.02)),
+                                 Eigen::Vector3d(0.05, -0.02, 0.01)};
+
+    const int numFrames = 30;
+    const double frameDt = 0.1;
+    const int imuPerFrame = 100;
+
+    IMUCalibration imuCalibration{T_cam_imu};
+    CoarseIMUInitOptimizerSettings settings;
+    std::shared_ptr<TransformDSOToIMU> transform;
+    std::unique_ptr<CoarseIMUInitOptimizer> optimizer;
+
+    void SetUp() override
+    {
+        settings.updatePoses = false; // Poses are passed with ids, not FrameShells.
+        imuCalibration.gravity = traj.gravity;
+        transform = std::make_shared<TransformDSOToIMU>(gtsam::Pose3(T_cam_imu.matrix()), std::make_shared<bool>(true),
+                                                        std::make_shared<bool>(true), std::make_shared<bool>(false),
+                                                        true, 0);
+        optimizer = std::make_unique<CoarseIMUInitOptimizer>(transform, imuCalibration, settings);
+        // Weak gravity prior, so that the refinement converges to the true values.
+        IMUTransformPriorSettings priorSettings;
+        priorSettings.priorGravityDirection = 100.0;
+        for(auto&& factor : getPriorsAndAddValuesForTransform(*transform, priorSettings, optimizer->values))
+        {
+            optimizer->graph.add(factor);
+        }
+
+        auto params = boost::make_shared<gtsam::PreintegrationParams>(traj.gravity);
+        params->setIntegrationCovariance(std::pow(imuCalibration.integration_sigma, 2) * Eigen::Matrix3d::Identity());
+        params->setAccelerometerCovariance(std::pow(imuCalibration.accel_sigma, 2) * Eigen::Matrix3d::Identity());
+        params->setGyroscopeCovariance(std::pow(imuCalibration.gyro_sigma, 2) * Eigen::Matrix3d::Identity());
+
+        for(int i = 0; i < numFrames; i++)
+        {
+            double t = i * frameDt;
+            gtsam::PreintegratedImuMeasurements imuData(params);
+            if(i > 0)
+            {
+                double imuDt = frameDt / imuPerFrame;
+                for(int j = 0; j < imuPerFrame; j++)
+                {
+                    // Sample in the middle of the interval, so the integration error is negligible.
+                    double tImu = t - frameDt + (j + 0.5) * imuDt;
+                    imuData.integrateMeasurement(traj.accData(tImu), traj.angularVelocity, imuDt);
+                }
+            }
+            Sophus::SE3d T_metricW_cam = Sophus::SE3d(traj.rotation(t), traj.position(t)) * T_cam_imu.inverse();
+            Sophus::SE3d camToWorld(Sophus::SO3d(R_dsoW_metricW) * T_metricW_cam.so3(),
+                                    R_dsoW_metricW * T_metricW_cam.translation() / trueScale);
+            // Ids start at 1, as 0 is treated as no previous frame.
+            optimizer->addPose(i + 1, camToWorld, i > 0 ? &imuData : nullptr);
+        }
+    }
+
+    void expectTrueValues(const gtsam::Values& values, double tolerance)
+    {
+        EXPECT_NEAR(values.at<ScaleGTSAM>(S(0)).scale, trueScale, tolerance * trueScale);
+        EXPECT_TRUE(values.at<gtsam::Rot3>(gtsam::Symbol('g', 0)).equals(gtsam::Rot3(R_dsoW_metricW), tolerance));
+        for(int i = 0; i < numFrames; i++)
+        {
+            Eigen::Vector3d velocity = values.at<gtsam::Vector3>(V(i + 1));
+            EXPECT_LT((velocity - traj.velocity(i * frameDt)).norm(), tolerance) << "frame " << i;
+        }
+    }
+};
+}
+
+TEST_F(CoarseIMUInitTest, LinearInitializationRecoversScaleGravityAndVelocities)
+{
+    double scaleVariance = -1.0;
+    ASSERT_TRUE(optimizer->linearInitialization(scaleVariance));
+    EXPECT_GT(scaleVariance, 0.0);
+    expectTrueValues(optimizer->values, 1e-3);
+}
+
+TEST_F(CoarseIMUInitTest, RefinementFromLinearWarmStart)
+{
+    settings.linearWarmStart = true;
+    CoarseIMUInitOptimizer::OptimizationResult result = optimizer->optimize();
+    EXPECT_FALSE(result.linearOnly);
+    EXPECT_GT(result.linearScaleVariance, 0.0);
+    // The bias is optimized as well.
+    expectTrueValues(optimizer->optimizedValues, 1e-2);
+
+    // Skipped refinement returns the linear solution.
+    result = optimizer->optimize(result.linearScaleVariance * 2.0);
+    EXPECT_TRUE(result.linearOnly);
+    EXPECT_EQ(result.numIterations, 0);
+    expectTrueValues(optimizer->optimizedValues, 1e-3);
+}
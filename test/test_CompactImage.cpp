@@ -0,0 +1,120 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <gtest/gtest.h>
+#include <random>
+#include <memory>
+#include "util/globalCalib.h"
+#include "util/settings.h"
+#include "FullSystem/HessianBlocks.h"
+
+using namespace dso;
+
+namespace
+{
+// Textured image with the intensity range of a photometrically calibrated camera image.
+std::vector<float> makeTestImage(int w, int h)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> noise(-2.0f, 2.0f);
+    std::vector<float> image(w * h);
+    for(int y = 0; y < h; y++)
+    {
+        for(int x = 0; x < w; x++)
+        {
+            image[x + y * w] = 128.0f + 100.0f * std::sin(0.05f * x) * std::cos(0.031f * y) +
+                               20.0f * std::sin(0.7f * x + 0.3f * y) + noise(rng);
+        }
+    }
+    return image;
+}
+
+std::unique_ptr<FrameHessian> makeFrame(std::vector<float>& image, bool compact)
+{
+    bool compactBefore = setting_compactImages;
+    setting_compactImages = compact;
+    std::unique_ptr<FrameHessian> frame(new FrameHessian());
+    frame->makeImages(image.data(), nullptr);
+    setting_compactImages = compactBefore;
+    return frame;
+}
+}
+
+TEST(CompactImageTest, MatchesDensePyramid)
+{
+    int w = 1280, h = 800;
+    Eigen::Matrix3f K;
+    K << 700, 0, w / 2.0f, 0, 700, h / 2.0f, 0, 0, 1;
+    setGlobalCalib(w, h, K);
+
+    std::vector<float> image = makeTestImage(w, h);
+    auto dense = makeFrame(image, false);
+    auto compact = makeFrame(image, true);
+    ASSERT_NE(dense->dIp[0], nullptr);
+    ASSERT_EQ(compact->dIp[0], nullptr);
+    ASSERT_NE(compact->dIpCompact[0], nullptr);
+
+    size_t numPixels = 0;
+    for(int lvl = 0; lvl < pyrLevelsUsed; lvl++) numPixels += wG[lvl] * hG[lvl];
+    size_t denseBytes = numPixels * (sizeof(Eigen::Vector3f) + sizeof(float));
+    size_t compactBytes = numPixels * (sizeof(CompactPixel) + sizeof(float));
+    std::cout << "Pyramid memory per frame at " << w << "x" << h << ": dense " << denseBytes / 1024 << " KB, compact "
+              << compactBytes / 1024 << " KB. Bytes read per interpolation: " << 4 * sizeof(Eigen::Vector3f)
+              << " vs " << 4 * sizeof(CompactPixel) << std::endl;
+    EXPECT_EQ(sizeof(CompactPixel), 6u);
+
+    // Quantization error of each stored value is at most 0.5 / compactImageScale, which bilinear interpolation keeps.
+    float maxAllowed = 0.5f / compactImageScale + 1e-4f;
+    std::mt19937 rng(1);
+    for(int lvl = 0; lvl < pyrLevelsUsed; lvl++)
+    {
+        int wl = wG[lvl], hl = hG[lvl];
+        std::uniform_real_distribution<float> distX(2.0f, wl - 3.0f), distY(2.0f, hl - 3.0f);
+        ImageLevel denseLevel = dense->image(lvl);
+        ImageLevel compactLevel = compact->image(lvl);
+        Eigen::Vector3f maxError = Eigen::Vector3f::Zero();
+        for(int i = 0; i < 10000; i++)
+        {
+            float x = distX(rng), y = distY(rng);
+            Eigen::Vector3f errorInterp = (getInterpolatedElement33(denseLevel, x, y, wl) -
+                                           getInterpolatedElement33(compactLevel, x, y, wl)).cwiseAbs();
+            maxError = maxError.cwiseMax(errorInterp);
+            EXPECT_NEAR(getInterpolatedElement31(denseLevel, x, y, wl), getInterpolatedElement31(compactLevel, x, y, wl),
+                        maxAllowed);
+            Eigen::Vector3f errorBiLin = (getInterpolatedElement33BiLin(denseLevel, x, y, wl) -
+                                          getInterpolatedElement33BiLin(compactLevel, x, y, wl)).cwiseAbs();
+            // The BiLin gradients are differences of two interpolated values.
+            EXPECT_LE(errorBiLin[0], maxAllowed);
+            EXPECT_LE(errorBiLin.tail<2>().maxCoeff(), 2 * maxAllowed);
+        }
+        std::cout << "Level " << lvl << " max interpolation error (intensity, dx, dy): " << maxError.transpose()
+                  << std::endl;
+        EXPECT_LE(maxError.maxCoeff(), maxAllowed);
+
+        // The first and last row are not computed by makePyramid.
+        for(int idx = wl; idx < wl * (hl - 1); idx++)
+        {
+            EXPECT_EQ(dense->absSquaredGrad[lvl][idx], compact->absSquaredGrad[lvl][idx]);
+        }
+    }
+}
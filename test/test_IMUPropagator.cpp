@@ -0,0 +1,168 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include "IMU/IMUPropagator.h"
+
+using namespace dmvio;
+
+// Records the published states together with the time they arrived.
+class RecordingWrapper : public dso::IOWrap::Output3DWrapper
+{
+public:
+    void publishIMURatePose(const IMUState& state) override
+    {
+        states.push_back(state);
+        arrivalTimes.push_back(std::chrono::steady_clock::now());
+    }
+
+    std::vector<IMUState, Eigen::aligned_allocator<IMUState>> states;
+    std::vector<std::chrono::steady_clock::time_point> arrivalTimes;
+};
+
+// Ground truth trajectory with constant angular velocity and a smooth translation.
+class SimulatedTrajectory
+{
+public:
+    Eigen::Vector3d gravity{0, 0, -9.8082};
+    Eigen::Vector3d angularVelocity{0.3, -0.2, 0.5};
+    Eigen::Vector3d accBias{0.05, -0.02, 0.1};
+    Eigen::Vector3d gyrBias{0.01, 0.005, -0.01};
+
+    Sophus::SO3d rotation(double t) const
+    { return Sophus::SO3d::exp(angularVelocity * t); }
+
+    Eigen::Vector3d position(double t) const
+    { return Eigen::Vector3d(std::sin(t), 0.5 * std::cos(t), 0.2 * t); }
+
+    Eigen::Vector3d velocity(double t) const
+    { return Eigen::Vector3d(std::cos(t), -0.5 * std::sin(t), 0.2); }
+
+    Eigen::Vector3d acceleration(double t) const
+    { return Eigen::Vector3d(-std::sin(t), -0.5 * std::cos(t), 0.0); }
+
+    IMUState state(double t) const
+    {
+        IMUState state;
+        state.timestamp = t;
+        state.imuToWorld = Sophus::SE3d(rotation(t), position(t));
+        state.velocity = velocity(t);
+        state.accBias = accBias;
+        state.gyrBias = gyrBias;
+        return state;
+    }
+
+    // Measurements as they would be returned by the IMU.
+    Eigen::Vector3d accData(double t) const
+    { return rotation(t).inverse() * (acceleration(t) - gravity) + accBias; }
+
+    Eigen::Vector3d gyrData(double t) const
+    { return angularVelocity + gyrBias; }
+};
+
+// Replays 200 Hz IMU data with 20 Hz frames. Each frame is re-anchored with the ground truth state after a tracking
+// delay of 3 IMU measurements. Measures the drift just before each re-anchoring and the output latency.
+TEST(IMUPropagatorTest, ReplayDriftAndLatency)
+{
+    SimulatedTrajectory traj;
+    IMUPropagator propagator(traj.gravity);
+    RecordingWrapper wrapper;
+    propagator.setOutputWrapper({&wrapper});
+
+    const double imuDt = 1.0 / 200.0;
+    const int imuPerFrame = 10;
+    const int trackingDelay = 3;
+
+    double maxPosDrift = 0.0, maxRotDrift = 0.0, maxVelDrift = 0.0;
+    double latencySum = 0.0;
+    int numLatency = 0;
+    int numFrames = 0;
+
+    for(int i = 1; i <= 2000; ++i)
+    {
+        double t = i * imuDt;
+
+        // Drift right before the next IMU measurement, i.e. at the end of the propagation interval.
+        IMUState current;
+        if((i - trackingDelay) % imuPerFrame == 0 && propagator.getCurrentState(current))
+        {
+            IMUState gt = traj.state(current.timestamp);
+            maxPosDrift = std::max(maxPosDrift, (current.imuToWorld.translation() - gt.imuToWorld.translation()).norm());
+            maxRotDrift = std::max(maxRotDrift, (current.imuToWorld.so3().inverse() * gt.imuToWorld.so3()).log().norm());
+            maxVelDrift = std::max(maxVelDrift, (current.velocity - gt.velocity).norm());
+        }
+
+        size_t numBefore = wrapper.states.size();
+        auto begin = std::chrono::steady_clock::now();
+        propagator.addIMUData(t, traj.accData(t), traj.gyrData(t));
+        if(wrapper.states.size() > numBefore)
+        {
+            latencySum += std::chrono::duration<double>(wrapper.arrivalTimes.back() - begin).count();
+            numLatency++;
+            EXPECT_EQ(wrapper.states.back().timestamp, t);
+        }
+
+        // The tracking result for the frame at time t - trackingDelay * imuDt arrives now.
+        if(i > trackingDelay && (i - trackingDelay) % imuPerFrame == 0)
+        {
+            propagator.reanchor(traj.state(t - trackingDelay * imuDt));
+            numFrames++;
+
+            // After catching up the state is at the newest IMU measurement again.
+            ASSERT_TRUE(propagator.getCurrentState(current));
+            EXPECT_EQ(current.timestamp, t);
+        }
+    }
+
+    double meanLatency = latencySum / numLatency;
+    std::cout << "Frames: " << numFrames << ", published IMU states: " << wrapper.states.size()
+              << ", mean output latency: " << meanLatency * 1e6 << " us" << std::endl;
+    std::cout << "Max drift between frames: position " << maxPosDrift << " m, rotation " << maxRotDrift
+              << " rad, velocity " << maxVelDrift << " m/s" << std::endl;
+
+    EXPECT_GT(numLatency, 1900);
+    EXPECT_LT(meanLatency, 1e-3);
+    EXPECT_LT(maxPosDrift, 1e-3);
+    EXPECT_LT(maxRotDrift, 1e-6);
+    EXPECT_LT(maxVelDrift, 1e-2);
+}
+
+TEST(IMUPropagatorTest, NoOutputWithoutAnchor)
+{
+    SimulatedTrajectory traj;
+    IMUPropagator propagator(traj.gravity);
+    RecordingWrapper wrapper;
+    propagator.setOutputWrapper({&wrapper});
+
+    propagator.addIMUData(0.1, traj.accData(0.1), traj.gyrData(0.1));
+    EXPECT_EQ(wrapper.states.size(), 0);
+
+    propagator.reanchor(traj.state(0.1));
+    propagator.addIMUData(0.2, traj.accData(0.2), traj.gyrData(0.2));
+    EXPECT_EQ(wrapper.states.size(), 1);
+
+    propagator.reset();
+    propagator.addIMUData(0.3, traj.accData(0.3), traj.gyrData(0.3));
+    EXPECT_EQ(wrapper.states.size(), 1);
+}
@@ -0,0 +1,182 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <memory>
+#include "FullSystem/ImagePyramid.h"
+#include "FullSystem/HessianBlocks.h"
+#include "util/IndexThreadReduce.h"
+
+using namespace dso;
+
+namespace
+{
+// Scalar implementation of FrameHessian::makePyramid before it was vectorized.
+void makePyramidReference(Eigen::Vector3f** dIp, float** absSquaredGrad, const int* wG, const int* hG, int levels,
+                          CalibHessian* HCalib)
+{
+    for(int lvl = 0; lvl < levels; lvl++)
+    {
+        int wl = wG[lvl], hl = hG[lvl];
+        Eigen::Vector3f* dI_l = dIp[lvl];
+
+        float* dabs_l = absSquaredGrad[lvl];
+        if(lvl > 0)
+        {
+            int lvlm1 = lvl - 1;
+            int wlm1 = wG[lvlm1];
+            Eigen::Vector3f* dI_lm = dIp[lvlm1];
+            for(int y = 0; y < hl; y++)
+                for(int x = 0; x < wl; x++)
+                {
+                    dI_l[x + y * wl][0] = 0.25f * (dI_lm[2 * x + 2 * y * wlm1][0] +
+                                                   dI_lm[2 * x + 1 + 2 * y * wlm1][0] +
+                                                   dI_lm[2 * x + 2 * y * wlm1 + wlm1][0] +
+                                                   dI_lm[2 * x + 1 + 2 * y * wlm1 + wlm1][0]);
+                }
+        }
+
+        for(int idx = wl; idx < wl * (hl - 1); idx++)
+        {
+            float dx = 0.5f * (dI_l[idx + 1][0] - dI_l[idx - 1][0]);
+            float dy = 0.5f * (dI_l[idx + wl][0] - dI_l[idx - wl][0]);
+            if(!std::isfinite(dx)) dx = 0;
+            if(!std::isfinite(dy)) dy = 0;
+            dI_l[idx][1] = dx;
+            dI_l[idx][2] = dy;
+            dabs_l[idx] = dx * dx + dy * dy;
+            if(HCalib != 0)
+            {
+                float gw = HCalib->getBGradOnly((float) (dI_l[idx][0]));
+                dabs_l[idx] *= gw * gw;
+            }
+        }
+    }
+}
+
+struct TestPyramid
+{
+    TestPyramid(const int* w, const int* h, int levels, const std::vector<float>& image) : levels(levels)
+    {
+        for(int lvl = 0; lvl < levels; lvl++)
+        {
+            dIp[lvl] = new Eigen::Vector3f[w[lvl] * h[lvl]];
+            absSquaredGrad[lvl] = new float[w[lvl] * h[lvl]];
+        }
+        for(size_t i = 0; i < image.size(); i++) dIp[0][i] = Eigen::Vector3f(image[i], 0, 0);
+    }
+    ~TestPyramid()
+    {
+        for(int lvl = 0; lvl < levels; lvl++)
+        {
+            delete[] dIp[lvl];
+            delete[] absSquaredGrad[lvl];
+        }
+    }
+
+    int levels;
+    Eigen::Vector3f* dIp[PYR_LEVELS];
+    float* absSquaredGrad[PYR_LEVELS];
+};
+
+bool same(float a, float b)
+{
+    return (std::isnan(a) && std::isnan(b)) || a == b;
+}
+
+void expectEqualPyramids(const TestPyramid& expected, const TestPyramid& actual, const int* w, const int* h)
+{
+    for(int lvl = 0; lvl < expected.levels; lvl++)
+    {
+        int numDifferent = 0;
+        for(int idx = 0; idx < w[lvl] * h[lvl]; idx++)
+        {
+            numDifferent += !same(expected.dIp[lvl][idx][0], actual.dIp[lvl][idx][0]);
+            // Gradients of the first and last row are not computed.
+            if(idx < w[lvl] || idx >= w[lvl] * (h[lvl] - 1)) continue;
+            numDifferent += !same(expected.dIp[lvl][idx][1], actual.dIp[lvl][idx][1]);
+            numDifferent += !same(expected.dIp[lvl][idx][2], actual.dIp[lvl][idx][2]);
+            numDifferent += !same(expected.absSquaredGrad[lvl][idx], actual.absSquaredGrad[lvl][idx]);
+        }
+        EXPECT_EQ(numDifferent, 0) << "level " << lvl;
+    }
+}
+}
+
+TEST(ImagePyramidTest, EqualsScalarImplementation)
+{
+    // Odd sizes so that the scalar remainders are used.
+    const int levels = 5;
+    int w[levels] = {1283}, h[levels] = {803};
+    for(int lvl = 1; lvl < levels; lvl++)
+    {
+        w[lvl] = w[lvl - 1] / 2;
+        h[lvl] = h[lvl - 1] / 2;
+    }
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> dist(0.0f, 255.0f);
+    std::vector<float> image(w[0] * h[0]);
+    for(float& val : image) val = dist(rng);
+    // Some invalid pixels.
+    for(int i = 0; i < 20; i++) image[rng() % image.size()] = NAN;
+
+    CalibHessian HCalib;
+    for(int i = 0; i < 256; i++) HCalib.B[i] = 255.0f * std::pow(i / 255.0f, 0.8f);
+
+    IndexThreadReduce<Vec10> red;
+    for(CalibHessian* gammaCalib : {(CalibHessian*) nullptr, &HCalib})
+    {
+        TestPyramid expected(w, h, levels, image);
+        makePyramidReference(expected.dIp, expected.absSquaredGrad, w, h, levels, gammaCalib);
+
+        TestPyramid serial(w, h, levels, image);
+        makeImagePyramid(serial.dIp, serial.absSquaredGrad, w, h, levels, gammaCalib, nullptr);
+        expectEqualPyramids(expected, serial, w, h);
+
+        TestPyramid stripes(w, h, levels, image);
+        makeImagePyramid(stripes.dIp, stripes.absSquaredGrad, w, h, levels, gammaCalib, &red);
+        expectEqualPyramids(expected, stripes, w, h);
+    }
+
+    // Timing (not checked).
+    TestPyramid pyramid(w, h, levels, image);
+    auto measure = [&](const std::function<void()>& function)
+    {
+        const int repetitions = 20;
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < repetitions; i++) function();
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count() / repetitions;
+    };
+    double timeReference = measure([&]()
+                                   { makePyramidReference(pyramid.dIp, pyramid.absSquaredGrad, w, h, levels, &HCalib); });
+    double timeSerial = measure([&]()
+                                { makeImagePyramid(pyramid.dIp, pyramid.absSquaredGrad, w, h, levels, &HCalib); });
+    double timeStripes = measure([&]()
+                                 { makeImagePyramid(pyramid.dIp, pyramid.absSquaredGrad, w, h, levels, &HCalib, &red); });
+    std::cout << "Pyramid of " << w[0] << "x" << h[0] << ": scalar " << timeReference << " ms, SIMD " << timeSerial
+              << " ms, SIMD + row stripes " << timeStripes << " ms" << std::endl;
+}
@@ -0,0 +1,129 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <random>
+#include "FullSystem/HessianBlocks.h"
+#include "util/Undistort.h"
+#include "util/ImageView.h"
+#include "util/globalCalib.h"
+
+using namespace dso;
+
+namespace
+{
+// Pinhole camera without photometric calibration. rectification is either "none" (passthrough) or "crop" (remap).
+std::unique_ptr<Undistort> makeUndistorter(const std::string& rectification)
+{
+    std::string filename = testing::TempDir() + "dmvio_test_camera_" + rectification + ".txt";
+    {
+        std::ofstream file(filename);
+        file << "0.6 0.8 0.5 0.5 0\n640 480\n" << rectification << "\n640 480\n";
+    }
+    std::unique_ptr<Undistort> undistorter(Undistort::getUndistorterForFile(filename, "", ""));
+    std::remove(filename.c_str());
+    return undistorter;
+}
+
+bool same(float a, float b)
+{
+    return (std::isnan(a) && std::isnan(b)) || a == b;
+}
+
+void expectEqualFrames(const FrameHessian& expected, const FrameHessian& actual)
+{
+    for(int lvl = 0; lvl < pyrLevelsUsed; lvl++)
+    {
+        int numDifferent = 0;
+        for(int idx = 0; idx < wG[lvl] * hG[lvl]; idx++)
+        {
+            numDifferent += !same(expected.dIp[lvl][idx][0], actual.dIp[lvl][idx][0]);
+            // Gradients of the first and last row are not computed.
+            if(idx < wG[lvl] || idx >= wG[lvl] * (hG[lvl] - 1)) continue;
+            numDifferent += !same(expected.dIp[lvl][idx][1], actual.dIp[lvl][idx][1]);
+            numDifferent += !same(expected.dIp[lvl][idx][2], actual.dIp[lvl][idx][2]);
+            numDifferent += !same(expected.absSquaredGrad[lvl][idx], actual.absSquaredGrad[lvl][idx]);
+        }
+        EXPECT_EQ(numDifferent, 0) << "level " << lvl;
+    }
+}
+
+// Runs a strided view through undistortInto + makePyramid and compares with undistort + makeImages on a contiguous
+// copy of the same image (the ImageAndExposure path).
+template<typename T>
+void testStridedView(Undistort& undistorter, float factor)
+{
+    const int w = undistorter.getOriginalSize()[0], h = undistorter.getOriginalSize()[1];
+    const int padding = 13;
+    const int stride = (w + padding) * sizeof(T);
+
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> dist(0, std::numeric_limits<T>::max());
+    std::vector<uint8_t> strided(stride * h);
+    MinimalImage<T> contiguous(w, h);
+    for(int y = 0; y < h; y++)
+    {
+        T* row = reinterpret_cast<T*>(strided.data() + y * stride);
+        for(int x = 0; x < w + padding; x++)
+        {
+            // The padding is filled with garbage as well, it must never be read.
+            row[x] = (T) dist(rng);
+        }
+        std::memcpy(contiguous.data + y * w, row, w * sizeof(T));
+    }
+
+    Eigen::Matrix3f K = undistorter.getK().cast<float>();
+    setGlobalCalib(undistorter.getSize()[0], undistorter.getSize()[1], K);
+    CalibHessian HCalib;
+
+    const float exposure = 12.5f;
+    std::unique_ptr<ImageAndExposure> undistorted(undistorter.undistort<T>(&contiguous, exposure, 0.0, factor));
+    FrameHessian expected;
+    expected.ab_exposure = undistorted->exposure_time;
+    expected.makeImages(undistorted->image, &HCalib);
+
+    FrameHessian actual;
+    actual.allocateImages();
+    actual.ab_exposure = undistorter.undistortInto(ImageView<T>(reinterpret_cast<const T*>(strided.data()), w, h,
+                                                                stride), actual.dI[0].data(), 3, exposure, factor);
+    actual.makePyramid(&HCalib);
+
+    EXPECT_EQ(expected.ab_exposure, actual.ab_exposure);
+    expectEqualFrames(expected, actual);
+}
+}
+
+TEST(ImageViewTest, StridedViewEqualsImageAndExposurePath)
+{
+    for(std::string rectification : {"none", "crop"})
+    {
+        SCOPED_TRACE(rectification);
+        std::unique_ptr<Undistort> undistorter = makeUndistorter(rectification);
+        ASSERT_TRUE(undistorter);
+        testStridedView<unsigned char>(*undistorter, 1.0f);
+        testStridedView<unsigned short>(*undistorter, 1.0f / 256.0f);
+    }
+}
@@ -0,0 +1,148 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <random>
+#include <memory>
+#include "util/globalCalib.h"
+#include "util/settings.h"
+#include "FullSystem/HessianBlocks.h"
+#include "FullSystem/ImmaturePoint.h"
+
+using namespace dso;
+
+namespace
+{
+// Renders the plane Z=1 (world coordinates) for a camera with identity rotation and translation t (worldToCam).
+// The plane is textureless for X > 0.45, points there are not well-constrained. If occluded, a different texture is
+// used, so that residuals to this frame are outliers.
+std::vector<float> renderPlane(int w, int h, const Eigen::Matrix3f& K, const Eigen::Vector3f& t, bool occluded)
+{
+    std::vector<float> image(w * h);
+    Eigen::Vector3f center = -t;
+    for(int y = 0; y < h; y++)
+    {
+        for(int x = 0; x < w; x++)
+        {
+            Eigen::Vector3f dir((x - K(0, 2)) / K(0, 0), (y - K(1, 2)) / K(1, 1), 1);
+            Eigen::Vector3f pointW = center + (1 - center[2]) * dir;
+            float X = pointW[0], Y = pointW[1];
+            if(X > 0.45f)
+                image[x + y * w] = 128.0f;
+            else if(occluded)
+                image[x + y * w] = 128.0f + 90.0f * std::cos(13 * X + 4 * Y);
+            else
+                image[x + y * w] = 128.0f + 90.0f * std::sin(7 * X) * std::cos(5 * Y) + 25.0f * std::sin(23 * X + 11 * Y);
+        }
+    }
+    return image;
+}
+}
+
+// The batched activation has to make the same decisions as the scalar one for each point.
+TEST(ImmaturePointActivationTest, BatchEqualsScalar)
+{
+    int w = 640, h = 480;
+    Eigen::Matrix3f K;
+    K << 500, 0, w / 2.0f, 0, 500, h / 2.0f, 0, 0, 1;
+    setGlobalCalib(w, h, K);
+    CalibHessian HCalib;
+
+    // The host is not the first frame. The last target has a large baseline, so points at the border go out of
+    // bounds, and one target sees a different texture.
+    std::vector<Eigen::Vector3f> translations = {{0.05f, 0, 0}, {0, 0, 0}, {-0.04f, 0.03f, 0}, {0.02f, -0.05f, 0.05f},
+                                                 {0.03f, 0.03f, 0}, {0.15f, 0.02f, -0.05f}};
+    int hostIndex = 1, occludedIndex = 4;
+    std::vector<std::unique_ptr<FrameHessian>> frameStorage;
+    std::vector<FrameHessian*> frames;
+    for(size_t i = 0; i < translations.size(); i++)
+    {
+        std::vector<float> image = renderPlane(w, h, K, translations[i], (int) i == occludedIndex);
+        frameStorage.emplace_back(new FrameHessian());
+        frameStorage.back()->makeImages(image.data(), &HCalib);
+        frameStorage.back()->idx = i;
+        frames.push_back(frameStorage.back().get());
+    }
+    FrameHessian* host = frames[hostIndex];
+    host->targetPrecalc.resize(frames.size());
+    for(size_t i = 0; i < frames.size(); i++)
+    {
+        FrameFramePrecalc& precalc = host->targetPrecalc[i];
+        precalc.PRE_RTll.setIdentity();
+        precalc.PRE_tTll = translations[i] - translations[hostIndex];
+        precalc.PRE_aff_mode = Vec2f(1, 0);
+    }
+
+    // Most points start close to the true inverse depth 1, some far away from it.
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> uDist(5, w - 5), vDist(5, h - 5), unit(0, 1);
+    std::vector<std::unique_ptr<ImmaturePoint>> points;
+    while(points.size() < 203)
+    {
+        std::unique_ptr<ImmaturePoint> point(new ImmaturePoint(uDist(rng), vDist(rng), host, 1, &HCalib));
+        if(!std::isfinite(point->energyTH)) continue;
+        bool far = points.size() % 10 == 0;
+        point->idepth_min = far ? 0.1f + 0.2f * unit(rng) : 0.7f + 0.2f * unit(rng);
+        point->idepth_max = far ? 0.3f + 0.5f * unit(rng) : 1.1f + 0.3f * unit(rng);
+        points.push_back(std::move(point));
+    }
+
+    int nres = frames.size() - 1;
+    int numConverged = 0;
+    int numStates[3] = {0, 0, 0};
+    std::vector<ImmaturePointTemporaryResidual> scalarRes(nres), batchRes(4 * nres);
+    // Start with a partial batch, so that the unused lanes are covered.
+    for(size_t first = 0, num = 3; first < points.size(); first += num, num = std::min<size_t>(4, points.size() - first))
+    {
+        ImmaturePoint* batch[4];
+        for(size_t l = 0; l < num; l++) batch[l] = points[first + l].get();
+        float batchIdepth[4];
+        bool batchConverged[4];
+        ImmaturePoint::optimizeIdepthBatch(batch, num, frames, &HCalib, batchRes.data(), batchIdepth, batchConverged);
+
+        for(size_t l = 0; l < num; l++)
+        {
+            float idepth = NAN;
+            bool converged = batch[l]->optimizeIdepth(frames, &HCalib, scalarRes.data(), idepth);
+            ASSERT_EQ(converged, batchConverged[l]) << "point " << first + l;
+            if(!converged) continue;
+            numConverged++;
+            EXPECT_FLOAT_EQ(idepth, batchIdepth[l]) << "point " << first + l;
+            for(int i = 0; i < nres; i++)
+            {
+                const ImmaturePointTemporaryResidual& expected = scalarRes[i];
+                const ImmaturePointTemporaryResidual& actual = batchRes[l * nres + i];
+                EXPECT_EQ(expected.target, actual.target);
+                EXPECT_EQ(expected.state_state, actual.state_state) << "point " << first + l << " residual " << i;
+                EXPECT_FLOAT_EQ(expected.state_energy, actual.state_energy);
+                numStates[expected.state_state]++;
+            }
+        }
+    }
+
+    // Make sure that all cases were covered.
+    EXPECT_GT(numConverged, 100);
+    EXPECT_LT(numConverged, (int) points.size());
+    EXPECT_GT(numStates[ResState::IN], 0);
+    EXPECT_GT(numStates[ResState::OOB], 0);
+    EXPECT_GT(numStates[ResState::OUTLIER], 0);
+}
@@ -0,0 +1,118 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/slam/PriorFactor.h>
+#include <gtsam/nonlinear/LevenbergMarquardtOptimizer.h>
+#include "IMUInitialization/IncrementalPGBASolver.h"
+#include "GTSAMIntegration/DelayedMarginalization.h"
+
+using namespace dmvio;
+using gtsam::symbol_shorthand::P;
+
+// Pose graph which is marginalized with a delay (like the graph of the PGBA). After each new pose the incremental
+// solver is compared to a batch Levenberg-Marquardt optimization of the same graph.
+TEST(IncrementalPGBATest, MatchesBatchOnDelayedGraph)
+{
+    const int numPoses = 15;
+    const int delay = 3;
+    DelayedGraph delayedGraph(delay, 0);
+    IncrementalPGBASolver solver(10);
+
+    auto noiseModel = gtsam::noiseModel::Diagonal::Sigmas(
+            (gtsam::Vector(6) << 0.05, 0.05, 0.05, 0.1, 0.1, 0.1).finished());
+    std::mt19937 rng(7);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    auto perturbation = [&](double sigma)
+    {
+        gtsam::Vector6 delta;
+        for(int i = 0; i < 6; i++) delta(i) = sigma * noise(rng);
+        return gtsam::Pose3::Expmap(delta);
+    };
+
+    // Ground truth: poses on a circle.
+    std::vector<gtsam::Pose3> truePoses;
+    for(int i = 0; i < numPoses; i++)
+    {
+        double angle = 0.3 * i;
+        truePoses.emplace_back(gtsam::Rot3::Rz(angle), gtsam::Point3(2.0 * std::cos(angle), 2.0 * std::sin(angle), 0));
+    }
+
+    gtsam::Values estimate; // Initial values (and FEJ values for the marginalization) of all poses.
+    delayedGraph.addFactor(boost::make_shared<gtsam::PriorFactor<gtsam::Pose3>>(P(0), truePoses[0], noiseModel), 0);
+    estimate.insert(P(0), truePoses[0]);
+    for(int i = 1; i < numPoses; i++)
+    {
+        // Odometry factors to the last two poses with noisy measurements.
+        for(int j = std::max(0, i - 2); j < i; j++)
+        {
+            gtsam::Pose3 measurement = truePoses[j].between(truePoses[i]) * perturbation(0.02);
+            delayedGraph.addFactor(boost::make_shared<gtsam::BetweenFactor<gtsam::Pose3>>(P(j), P(i), measurement,
+                                                                                        noiseModel), 0);
+        }
+        estimate.insert(P(i), truePoses[i] * perturbation(0.1));
+
+        // Marginalize the oldest pose (executed once the delay is reached).
+        if(i >= 3)
+        {
+            auto values = boost::make_shared<gtsam::Values>(estimate);
+            delayedGraph.marginalize({P(i - 3)}, values, values);
+        }
+
+        const gtsam::NonlinearFactorGraph& graph = *delayedGraph.getGraph();
+        gtsam::Values initialValues;
+        for(gtsam::Key key : graph.keys())
+        {
+            initialValues.insert(key, estimate.at(key));
+        }
+
+        gtsam::Values incrementalResult;
+        ASSERT_TRUE(solver.optimize(graph, initialValues, incrementalResult)) << "pose " << i;
+
+        gtsam::LevenbergMarquardtOptimizer optimizer(graph, initialValues,
+                                                     gtsam::LevenbergMarquardtParams::CeresDefaults());
+        gtsam::Values batchResult = optimizer.optimize();
+
+        EXPECT_EQ(incrementalResult.size(), batchResult.size()) << "pose " << i;
+        // The marginalization factors can have a negative error.
+        double batchError = graph.error(batchResult);
+        EXPECT_NEAR(graph.error(incrementalResult), batchError, 1e-2 * std::abs(batchError) + 1e-6) << "pose " << i;
+        for(auto&& pair : batchResult)
+        {
+            gtsam::Pose3 incrementalPose = incrementalResult.at<gtsam::Pose3>(pair.key);
+            EXPECT_TRUE(incrementalPose.equals(pair.value.cast<gtsam::Pose3>(), 5e-3)) << "pose " << i;
+        }
+
+        // Continue from the optimized estimate, like the PGBA does.
+        for(auto&& pair : batchResult)
+        {
+            estimate.update(pair.key, pair.value);
+        }
+    }
+    // The graph contains the 3 newest poses and the ones whose marginalization is delayed.
+    EXPECT_EQ(delayedGraph.getGraph()->keys().size(), 3 + delay);
+}
@@ -0,0 +1,155 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include "util/SharedMemoryLayout.h"
+
+using namespace dmvio;
+
+namespace
+{
+// All fields of a snapshot are derived from its counter k, so a torn read shows up as a mismatch.
+// midpoint is called in the middle of writing the snapshot.
+void fillPose(shm::PoseData& pose, int k, const std::function<void()>& midpoint)
+{
+    pose.id = k;
+    pose.incomingId = -k;
+    midpoint();
+    pose.poseValid = 1;
+    pose.timestamp = k * 0.5;
+    for(int i = 0; i < 16; i++) pose.camToWorld[i] = k + i;
+}
+
+bool poseConsistent(const shm::PoseData& pose)
+{
+    int k = pose.id;
+    bool ok = pose.incomingId == -k && pose.poseValid == 1 && pose.timestamp == k * 0.5;
+    for(int i = 0; i < 16; i++) ok = ok && pose.camToWorld[i] == k + i;
+    return ok;
+}
+
+void fillKeyframe(shm::KeyframeData& keyframe, int k, const std::function<void()>& midpoint)
+{
+    keyframe.frameId = k;
+    keyframe.id = 2 * k;
+    keyframe.incomingId = 3 * k;
+    keyframe.final = k % 2;
+    keyframe.numPoints = shm::maxPointsPerKeyframe;
+    keyframe.timestamp = k * 0.25;
+    for(int i = 0; i < 16; i++) keyframe.camToWorld[i] = k - i;
+    midpoint();
+    for(int i = 0; i < shm::maxPointsPerKeyframe; i++)
+    {
+        keyframe.points[i] = shm::PointData{(float) k, (float) i, (float) (k + i), (float) (k % 256)};
+    }
+}
+
+bool keyframeConsistent(const shm::KeyframeData& keyframe)
+{
+    int k = keyframe.frameId;
+    bool ok = keyframe.id == 2 * k && keyframe.incomingId == 3 * k && keyframe.final == k % 2 &&
+              keyframe.numPoints == shm::maxPointsPerKeyframe && keyframe.timestamp == k * 0.25;
+    for(int i = 0; i < 16; i++) ok = ok && keyframe.camToWorld[i] == k - i;
+    for(int i = 0; ok && i < shm::maxPointsPerKeyframe; i++)
+    {
+        const shm::PointData& p = keyframe.points[i];
+        ok = p.x == (float) k && p.y == (float) i && p.z == (float) (k + i) && p.intensity == (float) (k % 256);
+    }
+    return ok;
+}
+
+// One writer thread continuously overwrites block with snapshots 1..numWrites, while the reader copies it. Every
+// accepted copy has to be one complete snapshot, and snapshots never go back in time.
+// In the middle of each snapshot the writer waits for the next read attempt, so that reads overlap with writes
+// even on a single core.
+template<typename T, typename Fill, typename Consistent>
+void testConcurrentReads(shm::SeqLocked<T>& block, int numWrites, Fill fill, Consistent consistent,
+                         int T::* counter)
+{
+    std::atomic<bool> writerDone{false};
+    std::atomic<int> numReadAttempts{0};
+    std::thread writer([&]()
+                       {
+                           auto waitForReader = [&]()
+                           {
+                               int attempts = numReadAttempts;
+                               while(numReadAttempts == attempts)
+                               {
+                                   std::this_thread::sleep_for(std::chrono::microseconds(1));
+                               }
+                           };
+                           for(int k = 1; k <= numWrites; k++)
+                           {
+                               shm::seqlockWrite(block, [&](T& data) { fill(data, k, waitForReader); });
+                           }
+                           writerDone = true;
+                       });
+
+    std::unique_ptr<T> copy(new T());
+    int numAccepted = 0, numInconsistent = 0, last = 0;
+    bool monotonic = true;
+    while(!writerDone || numAccepted == 0)
+    {
+        bool accepted = shm::seqlockRead(block, *copy, 1);
+        numReadAttempts++;
+        if(!accepted) continue;
+        numAccepted++;
+        if(!consistent(*copy)) numInconsistent++;
+        monotonic = monotonic && (*copy).*counter >= last;
+        last = (*copy).*counter;
+    }
+    writer.join();
+
+    EXPECT_GT(numAccepted, 0);
+    EXPECT_EQ(numInconsistent, 0) << "of " << numAccepted << " accepted snapshots";
+    EXPECT_TRUE(monotonic);
+
+    // After the writer has finished the last snapshot is read.
+    ASSERT_TRUE(shm::seqlockRead(block, *copy));
+    EXPECT_EQ((*copy).*counter, numWrites);
+    EXPECT_TRUE(consistent(*copy));
+}
+}
+
+TEST(SharedMemoryLayoutTest, SeqlockReadsAreNeverTorn)
+{
+    // The segment is too large for the stack.
+    std::unique_ptr<shm::Segment> segment(new shm::Segment());
+
+    shm::PoseData pose;
+    EXPECT_FALSE(shm::seqlockRead(segment->poses[0], pose)); // Never written.
+
+    {
+        SCOPED_TRACE("pose");
+        testConcurrentReads(segment->poses[0], 2000, fillPose, poseConsistent, &shm::PoseData::id);
+    }
+    {
+        SCOPED_TRACE("keyframe");
+        testConcurrentReads(segment->keyframes[0], 500, fillKeyframe, keyframeConsistent,
+                            &shm::KeyframeData::frameId);
+    }
+}
@@ -0,0 +1,228 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/navigation/ImuBias.h>
+#include <gtsam/linear/HessianFactor.h>
+#include "util/SystemCheckpoint.h"
+#include "GTSAMIntegration/GTSAMUtils.h"
+#include "GTSAMIntegration/Sim3GTSAM.h"
+
+using namespace dmvio;
+using gtsam::Symbol;
+
+namespace
+{
+std::string tempFilename()
+{
+    return testing::TempDir() + "dmvio_test_checkpoint_" +
+           testing::UnitTest::GetInstance()->current_test_info()->name();
+}
+
+bool fileExists(const std::string& filename)
+{
+    return std::ifstream(filename).good();
+}
+
+gtsam::Values makeValues()
+{
+    gtsam::Values values;
+    values.insert(Symbol('p', 3), gtsam::Pose3(gtsam::Rot3::RzRyRx(0.1, -0.2, 0.3), gtsam::Point3(1, 2, 3)));
+    values.insert(Symbol('i', 0), gtsam::Pose3(gtsam::Rot3::RzRyRx(-0.4, 0.0, 0.2), gtsam::Point3(0.1, 0, -0.2)));
+    values.insert(Symbol('g', 0), gtsam::Rot3::RzRyRx(0.05, 0.02, 0));
+    values.insert(Symbol('a', 3), gtsam::Vector2(0.5, -3));
+    values.insert(Symbol('v', 3), gtsam::Vector3(0.3, -0.1, 0.7));
+    values.insert(Symbol('c', 0), gtsam::Vector4(400, 410, 320, 240));
+    values.insert(Symbol('b', 3),
+                  gtsam::imuBias::ConstantBias(gtsam::Vector3(0.01, 0.02, -0.03), gtsam::Vector3(0.001, 0, -0.002)));
+    values.insert(Symbol('s', 0), ScaleGTSAM(1.7));
+    return values;
+}
+
+// Random positive definite Hessian for the poses p3 and p4 and the velocity v3.
+gtsam::LinearContainerFactor makeLinearFactor(const gtsam::Values& linearizationPoint)
+{
+    std::vector<size_t> dims{6, 6, 3};
+    gtsam::Matrix A = gtsam::Matrix::Random(20, 16);
+    gtsam::SymmetricBlockMatrix augmented(dims, true);
+    augmented.setFullMatrix(A.transpose() * A);
+    gtsam::Ordering ordering{Symbol('p', 3), Symbol('p', 4), Symbol('v', 3)};
+    return gtsam::LinearContainerFactor(gtsam::HessianFactor(ordering, augmented), linearizationPoint);
+}
+
+SystemCheckpoint makeCheckpoint()
+{
+    SystemCheckpoint checkpoint;
+    checkpoint.width = 64;
+    checkpoint.height = 48;
+    checkpoint.calib = Eigen::Vector4d(400, 410, 32, 24);
+    checkpoint.calibZero = Eigen::Vector4d(401, 409, 31, 25);
+    checkpoint.firstPose(0, 3) = 1.5;
+    checkpoint.numFramesTotal = 120;
+    checkpoint.numKeyframesTotal = 17;
+    for(int k = 0; k < 2; k++)
+    {
+        KeyframeCheckpoint keyframe;
+        keyframe.id = 100 + k;
+        keyframe.incomingId = 110 + k;
+        keyframe.frameId = 15 + k;
+        keyframe.timestamp = 12.25 + k;
+        keyframe.abExposure = 0.02f;
+        keyframe.frameEnergyTH = 144;
+        keyframe.camToWorld(1, 3) = -2.0 * k;
+        keyframe.state = Eigen::Matrix<double, 10, 1>::Random();
+        keyframe.image.resize(checkpoint.width * checkpoint.height);
+        for(size_t i = 0; i < keyframe.image.size(); i++) keyframe.image[i] = 0.5f * i;
+
+        PointCheckpoint point;
+        point.u = 10;
+        point.v = 20 + k;
+        point.idepth = 0.8f;
+        point.idepthZero = 0.79f;
+        point.numGoodResiduals = 1;
+        point.residuals.push_back(ResidualCheckpoint{1 - k, 2, 35.5, true});
+        point.lastResidualIndex[0] = 0;
+        point.lastResidualState[0] = 2;
+        keyframe.points.push_back(point);
+
+        ImmaturePointCheckpoint immature;
+        immature.u = 30;
+        immature.idepthMax = NAN;
+        immature.lastTraceUV = Eigen::Vector2f(3, 4);
+        keyframe.immaturePoints.push_back(immature);
+        checkpoint.keyframes.push_back(keyframe);
+    }
+    checkpoint.HM = Eigen::MatrixXd::Random(14, 14);
+    checkpoint.bM = Eigen::VectorXd::Random(14);
+
+    checkpoint.hasIMU = true;
+    gtsam::Values values = makeValues();
+    checkpoint.ba.currBATimestamp = 13.25;
+    checkpoint.ba.values = valuesToCheckpoint(values);
+    checkpoint.ba.graphFactor = linearFactorToCheckpoint(makeLinearFactor(values));
+    checkpoint.imu.firstFrameId = 4;
+    checkpoint.imu.optimizeScale = true;
+    return checkpoint;
+}
+}
+
+TEST(SystemCheckpointTest, SaveLoadRoundTrip)
+{
+    std::string filename = tempFilename();
+    SystemCheckpoint checkpoint = makeCheckpoint();
+    ASSERT_TRUE(saveCheckpoint(checkpoint, filename));
+    EXPECT_FALSE(fileExists(filename + ".tmp"));
+
+    std::unique_ptr<SystemCheckpoint> loaded = loadCheckpoint(filename);
+    std::remove(filename.c_str());
+
+    EXPECT_EQ(loaded->width, checkpoint.width);
+    EXPECT_EQ(loaded->height, checkpoint.height);
+    EXPECT_EQ(loaded->calib, checkpoint.calib);
+    EXPECT_EQ(loaded->calibZero, checkpoint.calibZero);
+    EXPECT_EQ(loaded->firstPose, checkpoint.firstPose);
+    EXPECT_EQ(loaded->numFramesTotal, checkpoint.numFramesTotal);
+    EXPECT_EQ(loaded->numKeyframesTotal, checkpoint.numKeyframesTotal);
+    EXPECT_EQ(loaded->HM, checkpoint.HM);
+    EXPECT_EQ(loaded->bM, checkpoint.bM);
+    EXPECT_EQ(loaded->HMForGTSAM.size(), 0);
+
+    ASSERT_EQ(loaded->keyframes.size(), checkpoint.keyframes.size());
+    for(size_t k = 0; k < checkpoint.keyframes.size(); k++)
+    {
+        const KeyframeCheckpoint& expected = checkpoint.keyframes[k];
+        const KeyframeCheckpoint& actual = loaded->keyframes[k];
+        EXPECT_EQ(actual.id, expected.id);
+        EXPECT_EQ(actual.incomingId, expected.incomingId);
+        EXPECT_EQ(actual.frameId, expected.frameId);
+        EXPECT_EQ(actual.timestamp, expected.timestamp);
+        EXPECT_EQ(actual.abExposure, expected.abExposure);
+        EXPECT_EQ(actual.frameEnergyTH, expected.frameEnergyTH);
+        EXPECT_EQ(actual.camToWorld, expected.camToWorld);
+        EXPECT_EQ(actual.state, expected.state);
+        EXPECT_EQ(actual.image, expected.image);
+
+        ASSERT_EQ(actual.points.size(), 1u);
+        const PointCheckpoint& point = actual.points[0];
+        EXPECT_EQ(point.v, expected.points[0].v);
+        EXPECT_EQ(point.idepth, expected.points[0].idepth);
+        EXPECT_EQ(point.idepthZero, expected.points[0].idepthZero);
+        ASSERT_EQ(point.residuals.size(), 1u);
+        EXPECT_EQ(point.residuals[0].targetIndex, expected.points[0].residuals[0].targetIndex);
+        EXPECT_EQ(point.residuals[0].state, 2);
+        EXPECT_EQ(point.residuals[0].energy, 35.5);
+        EXPECT_TRUE(point.residuals[0].isNew);
+        EXPECT_EQ(point.lastResidualIndex[0], 0);
+        EXPECT_EQ(point.lastResidualIndex[1], -1);
+        EXPECT_EQ(point.lastResidualState[0], 2);
+
+        ASSERT_EQ(actual.immaturePoints.size(), 1u);
+        EXPECT_EQ(actual.immaturePoints[0].u, 30);
+        EXPECT_TRUE(std::isnan(actual.immaturePoints[0].idepthMax));
+        EXPECT_EQ(actual.immaturePoints[0].lastTraceUV, expected.immaturePoints[0].lastTraceUV);
+    }
+
+    EXPECT_TRUE(loaded->hasIMU);
+    EXPECT_EQ(loaded->ba.currBATimestamp, checkpoint.ba.currBATimestamp);
+    EXPECT_EQ(loaded->imu.firstFrameId, checkpoint.imu.firstFrameId);
+    EXPECT_TRUE(loaded->imu.optimizeScale);
+    EXPECT_FALSE(loaded->imu.optimizeGravity);
+    EXPECT_TRUE(loaded->imu.factorForCoarseGraph.empty());
+
+    // Conversion back to GTSAM.
+    gtsam::Values values = makeValues();
+    gtsam::Values loadedValues = valuesFromCheckpoint(loaded->ba.values);
+    EXPECT_TRUE(loadedValues.equals(values, 1e-12));
+
+    gtsam::LinearContainerFactor::shared_ptr loadedFactor = linearFactorFromCheckpoint(loaded->ba.graphFactor);
+    ASSERT_TRUE(loadedFactor);
+    gtsam::LinearContainerFactor factor = makeLinearFactor(values);
+    EXPECT_TRUE(loadedFactor->factor()->equals(*factor.factor(), 1e-12));
+    ASSERT_TRUE(loadedFactor->linearizationPoint());
+    EXPECT_TRUE(loadedFactor->linearizationPoint()->equals(values, 1e-12));
+    EXPECT_NEAR(loadedFactor->error(values), factor.error(values), 1e-9);
+}
+
+TEST(SystemCheckpointTest, FailedWriteKeepsOldCheckpoint)
+{
+    // Writing into a missing directory fails without throwing.
+    EXPECT_FALSE(saveCheckpoint(makeCheckpoint(), "/nonexistent_dmvio_directory/checkpoint"));
+
+    std::string filename = tempFilename();
+    SystemCheckpoint checkpoint = makeCheckpoint();
+    ASSERT_TRUE(saveCheckpoint(checkpoint, filename));
+
+    // A directory in place of the temporary file makes the next write fail.
+    ASSERT_EQ(mkdir((filename + ".tmp").c_str(), 0755), 0);
+    checkpoint.numFramesTotal = 121;
+    EXPECT_FALSE(saveCheckpoint(checkpoint, filename));
+    rmdir((filename + ".tmp").c_str());
+
+    EXPECT_EQ(loadCheckpoint(filename)->numFramesTotal, 120);
+    std::remove(filename.c_str());
+}